@@ -31,6 +31,10 @@
 // Convenience method - pass it a file containing the data to compress in sourcePath, and it will write deflated data to destinationPath
 + (BOOL)compressDataFromFile:(NSString *)sourcePath toFile:(NSString *)destinationPath error:(NSError **)err;
 
+// As above, but checks *cancelFlag before compressing each chunk, and gives up (returning NO with no error) when it becomes YES
+// ASIHTTPRequest uses this so that requests compressing a large body from disk can be cancelled part way through
++ (BOOL)compressDataFromFile:(NSString *)sourcePath toFile:(NSString *)destinationPath cancelFlag:(volatile BOOL *)cancelFlag error:(NSError **)err;
+
 // Sets up zlib to handle the inflating. You only need to call this yourself if you aren't using the convenience constructor 'compressor'
 - (NSError *)setupStream;
 
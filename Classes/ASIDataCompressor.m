@@ -132,6 +132,11 @@
 
 
 + (BOOL)compressDataFromFile:(NSString *)sourcePath toFile:(NSString *)destinationPath error:(NSError **)err
+{
+	return [self compressDataFromFile:sourcePath toFile:destinationPath cancelFlag:NULL error:err];
+}
+
++ (BOOL)compressDataFromFile:(NSString *)sourcePath toFile:(NSString *)destinationPath cancelFlag:(volatile BOOL *)cancelFlag error:(NSError **)err
 {
 	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
 
@@ -164,6 +169,13 @@
 	[outputStream open];
 	
     while ([compressor streamReady]) {
+
+		if (cancelFlag && *cancelFlag) {
+			[compressor closeStream];
+			[inputStream close];
+			[outputStream close];
+			return NO;
+		}
 		
 		// Read some data from the file
 		readLength = [inputStream read:inputData maxLength:DATA_CHUNK_SIZE];
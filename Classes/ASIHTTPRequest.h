@@ -25,6 +25,8 @@
 #import "ASICacheDelegate.h"
 
 @class ASIDataDecompressor;
+@class ASITrafficArchive;
+@class ASIPermanentRedirectCache;
 
 extern NSString *ASIHTTPRequestVersion;
 
@@ -81,6 +83,13 @@ typedef void (^ASIProgressBlock)(unsigned long long size, unsigned long long tot
 typedef void (^ASIDataBlock)(NSData *data);
 #endif
 
+// Rarely used state is kept in these structures (see ASIHTTPRequest.m), which are only allocated when something in them is set
+// This keeps the size of each request down when you have large numbers of them in flight or queued
+struct ASIRequestAuthenticationDetails;
+struct ASIRequestProxyDetails;
+struct ASIRequestUploadDetails;
+struct ASIRequestBlocks;
+
 @interface ASIHTTPRequest : NSOperation <NSCopying> {
 	
 	// The url for this operation, should include GET params in the query string where appropriate
@@ -103,32 +112,17 @@ typedef void (^ASIDataBlock)(NSData *data);
 	// HTTP method to use (GET / POST / PUT / DELETE / HEAD). Defaults to GET
 	NSString *requestMethod;
 	
-	// Request body - only used when the whole body is stored in memory (shouldStreamPostDataFromDisk is false)
-	NSMutableData *postBody;
-	
-	// gzipped request body used when shouldCompressRequestBody is YES
-	NSData *compressedPostBody;
+	// Request body, the file it is streamed from and the streams used to send it
+	// Only allocated for requests that have a body
+	struct ASIRequestUploadDetails *uploadDetails;
 	
 	// When true, post body will be streamed from a file on disk, rather than loaded into memory at once (useful for large uploads)
 	// Automatically set to true in ASIFormDataRequests when using setFile:forKey:
 	BOOL shouldStreamPostDataFromDisk;
 	
-	// Path to file used to store post body (when shouldStreamPostDataFromDisk is true)
-	// You can set this yourself - useful if you want to PUT a file from local disk 
-	NSString *postBodyFilePath;
-	
-	// Path to a temporary file used to store a deflated post body (when shouldCompressPostBody is YES)
-	NSString *compressedPostBodyFilePath;
-	
 	// Set to true when ASIHTTPRequest automatically created a temporary file containing the request body (when true, the file at postBodyFilePath will be deleted at the end of the request)
 	BOOL didCreateTemporaryPostDataFile;
 	
-	// Used when writing to the post body when shouldStreamPostDataFromDisk is true (via appendPostData: or appendPostDataFromFile:)
-	NSOutputStream *postBodyWriteStream;
-	
-	// Used for reading from the post body when sending the request
-	NSInputStream *postBodyReadStream;
-	
 	// Dictionary for custom HTTP request headers
 	NSMutableDictionary *requestHeaders;
 	
@@ -176,31 +170,27 @@ typedef void (^ASIDataBlock)(NSData *data);
 	NSOutputStream *inflatedFileDownloadOutputStream;
 	
 	// When the request fails or completes successfully, complete will be true
+	// Only changed on the request's thread, read without taking cancelledLock
 	BOOL complete;
 	
     // external "finished" indicator, subject of KVO notifications; updates after 'complete'
     BOOL finished;
     
-    // True if our 'cancel' selector has been called
+    // True once the request has been cancelled on its thread (see cancelOnRequestThread)
+    // Only ever changes from NO to YES, so isCancelled reads it without taking cancelledLock
     BOOL cancelled;
+
+	// Set as soon as cancel is called, from whichever thread calls it
+	// Long running setup work (building the post body, looking up proxies) checks this so it can stop early, before the cancellation reaches the request's thread
+	volatile BOOL cancellationRequested;
     
 	// If an error occurs, error will contain an NSError
 	// If error code is = ASIConnectionFailureErrorType (1, Connection failure occurred) - inspect [[error userInfo] objectForKey:NSUnderlyingErrorKey] for more information
 	NSError *error;
 	
-	// Username and password used for authentication
-	NSString *username;
-	NSString *password;
-	
-	// Domain used for NTLM authentication
-	NSString *domain;
-	
-	// Username and password used for proxy authentication
-	NSString *proxyUsername;
-	NSString *proxyPassword;
-	
-	// Domain used for NTLM proxy authentication
-	NSString *proxyDomain;
+	// Credentials, realms and schemes used for server and proxy authentication
+	// Only allocated when authentication is used
+	struct ASIRequestAuthenticationDetails *authenticationDetails;
 	
 	// Delegate for displaying upload progress (usually an NSProgressIndicator, but you can supply a different object and handle this yourself)
 	id <ASIProgressDelegate> uploadProgressDelegate;
@@ -220,16 +210,6 @@ typedef void (^ASIDataBlock)(NSData *data);
 	
 	// Used for authentication
     CFHTTPAuthenticationRef requestAuthentication; 
-	NSDictionary *requestCredentials;
-	
-	// Used during NTLM authentication
-	int authenticationRetryCount;
-	
-	// Authentication scheme (Basic, Digest, NTLM)
-	NSString *authenticationScheme;
-	
-	// Realm for authentication when credentials are required
-	NSString *authenticationRealm;
 	
 	// When YES, ASIHTTPRequest will present a dialog allowing users to enter credentials when no-matching credentials were found for a server that requires authentication
 	// The dialog will not be shown if your delegate responds to authenticationNeededForRequest:
@@ -243,16 +223,6 @@ typedef void (^ASIDataBlock)(NSData *data);
 	
 	// Used for proxy authentication
     CFHTTPAuthenticationRef proxyAuthentication; 
-	NSDictionary *proxyCredentials;
-	
-	// Used during authentication with an NTLM proxy
-	int proxyAuthenticationRetryCount;
-	
-	// Authentication scheme for the proxy (Basic, Digest, NTLM)
-	NSString *proxyAuthenticationScheme;	
-	
-	// Realm for proxy authentication when credentials are required
-	NSString *proxyAuthenticationRealm;
 	
 	// HTTP status code, eg: 200 = OK, 404 = Not found etc
 	int responseStatusCode;
@@ -282,6 +252,7 @@ typedef void (^ASIDataBlock)(NSData *data);
 	unsigned long long lastBytesSent;
 	
 	// This lock prevents the operation from being cancelled at an inopportune moment
+	// It is not held while building the post body or looking up proxies, so cancel and accessors that use it are not held up by slow setup work
 	NSRecursiveLock *cancelledLock;
 	
 	// Called on the delegate (if implemented) when the request starts. Default is requestStarted:
@@ -365,16 +336,9 @@ typedef void (^ASIDataBlock)(NSData *data);
     SecIdentityRef clientCertificateIdentity;
 	NSArray *clientCertificates;
 	
-	// Details on the proxy to use - you could set these yourself, but it's probably best to let ASIHTTPRequest detect the system proxy settings
-	NSString *proxyHost;
-	int proxyPort;
-	
-	// ASIHTTPRequest will assume kCFProxyTypeHTTP if the proxy type could not be automatically determined
-	// Set to kCFProxyTypeSOCKS if you are manually configuring a SOCKS proxy
-	NSString *proxyType;
-
-	// URL for a PAC (Proxy Auto Configuration) file. If you want to set this yourself, it's probably best if you use a local file
-	NSURL *PACurl;
+	// Details on the proxy to use and any PAC file used to find it
+	// Only allocated when a proxy or PAC file is used
+	struct ASIRequestProxyDetails *proxyDetails;
 	
 	// See ASIAuthenticationState values above. 0 == default == No authentication needed yet
 	ASIAuthenticationState authenticationNeeded;
@@ -456,6 +420,17 @@ typedef void (^ASIDataBlock)(NSData *data);
 	// Set secondsToCache to use a custom time interval for expiring the response when it is stored in a cache
 	NSTimeInterval secondsToCache;
 
+	// When set, responses will be recorded to this archive, or replayed from it instead of going to the network, depending on the archive's mode
+	// Use [ASIHTTPRequest setDefaultTrafficArchive:archive] to have all new requests use an archive - see ASITrafficArchive.h for more info
+	ASITrafficArchive *trafficArchive;
+
+	// The response being recorded or replayed (when using a traffic archive)
+	NSDictionary *trafficExchange;
+
+	// When set, permanent redirects this request receives are remembered here, and the request goes straight to where it was redirected to last time
+	// Use [ASIHTTPRequest setDefaultPermanentRedirectCache:cache] to have all new requests use a cache - see ASIPermanentRedirectCache.h for more info
+	ASIPermanentRedirectCache *permanentRedirectCache;
+
 	#if TARGET_OS_IPHONE && __IPHONE_OS_VERSION_MAX_ALLOWED >= __IPHONE_4_0
 	BOOL shouldContinueWhenAppEntersBackground;
 	UIBackgroundTaskIdentifier backgroundTask;
@@ -482,54 +457,12 @@ typedef void (^ASIDataBlock)(NSData *data);
 	// Will be YES if this is a request created behind the scenes to download a PAC file - these requests do not attempt to configure their own proxies
 	BOOL isPACFileRequest;
 
-	// Used for downloading PAC files from http / https webservers
-	ASIHTTPRequest *PACFileRequest;
-
-	// Used for asynchronously reading PAC files from file:// URLs
-	NSInputStream *PACFileReadStream;
-
-	// Used for storing PAC data from file URLs as it is downloaded
-	NSMutableData *PACFileData;
-
 	// Set to YES in startSynchronous. Currently used by proxy detection to download PAC files synchronously when appropriate
 	BOOL isSynchronous;
 
 	#if NS_BLOCKS_AVAILABLE
-	//block to execute when request starts
-	ASIBasicBlock startedBlock;
-
-	//block to execute when headers are received
-	ASIHeadersBlock headersReceivedBlock;
-
-	//block to execute when request completes successfully
-	ASIBasicBlock completionBlock;
-
-	//block to execute when request fails
-	ASIBasicBlock failureBlock;
-
-	//block for when bytes are received
-	ASIProgressBlock bytesReceivedBlock;
-
-	//block for when bytes are sent
-	ASIProgressBlock bytesSentBlock;
-
-	//block for when download size is incremented
-	ASISizeBlock downloadSizeIncrementedBlock;
-
-	//block for when upload size is incremented
-	ASISizeBlock uploadSizeIncrementedBlock;
-
-	//block for handling raw bytes received
-	ASIDataBlock dataReceivedBlock;
-
-	//block for handling authentication
-	ASIBasicBlock authenticationNeededBlock;
-
-	//block for handling proxy authentication
-	ASIBasicBlock proxyAuthenticationNeededBlock;
-	
-    //block for handling redirections, if you want to
-    ASIBasicBlock requestRedirectedBlock;
+	// Blocks to call when things happen - only allocated when a block is set
+	struct ASIRequestBlocks *requestBlocks;
 	#endif
 }
 
@@ -544,6 +477,10 @@ typedef void (^ASIDataBlock)(NSData *data);
 + (id)requestWithURL:(NSURL *)newURL usingCache:(id <ASICacheDelegate>)cache;
 + (id)requestWithURL:(NSURL *)newURL usingCache:(id <ASICacheDelegate>)cache andCachePolicy:(ASICachePolicy)policy;
 
+// Copies settings that don't depend on the url (credentials, proxy details, timeouts, cache and redirect behaviour, delegates and selectors) from another request
+// Used by ASIRequestTemplate to set up new requests. Unlike copyWithZone:, the url, body, headers, cookies and userInfo are not copied
+- (void)copySettingsFromRequest:(ASIHTTPRequest *)otherRequest;
+
 #if NS_BLOCKS_AVAILABLE
 - (void)setStartedBlock:(ASIBasicBlock)aStartedBlock;
 - (void)setHeadersReceivedBlock:(ASIHeadersBlock)aReceivedBlock;
@@ -577,6 +514,10 @@ typedef void (^ASIDataBlock)(NSData *data);
 // Create the post body
 - (void)buildPostBody;
 
+// The class used to stream the request body, returns ASIInputStream by default
+// Subclasses can override this to return a subclass of ASIInputStream that changes the body as it is sent (ASIS3Request uses it to sign the body one chunk at a time)
+- (Class)postBodyReadStreamClass;
+
 // Called to add data to the post body. Will append to postBody when shouldStreamPostDataFromDisk is false, or write to postBodyWriteStream when true
 - (void)appendPostData:(NSData *)data;
 - (void)appendPostDataFromFile:(NSString *)file;
@@ -708,6 +649,11 @@ typedef void (^ASIDataBlock)(NSData *data);
 - (void)handleStreamComplete;
 - (void)handleStreamError;
 
+// Called by handleBytesAvailable with each chunk of the response body as it is read
+// If the response is being inflated as it downloads, this receives the inflated data. It is not called for compressed responses when shouldWaitToInflateCompressedResponses is YES, or for the body of a redirect
+// Does nothing by default - subclasses can override this to look at the content as it arrives (ASIWebPageRequest uses it to parse HTML while it downloads)
+- (void)didReceiveResponseBytes:(const void *)bytes length:(NSUInteger)length;
+
 #pragma mark cleanup
 
 // Cleans up and lets the queue know this operation is finished.
@@ -844,6 +790,16 @@ typedef void (^ASIDataBlock)(NSData *data);
 + (void)setDefaultCache:(id <ASICacheDelegate>)cache;
 + (id <ASICacheDelegate>)defaultCache;
 
+#pragma mark traffic recording and replay
+
++ (void)setDefaultTrafficArchive:(ASITrafficArchive *)archive;
++ (ASITrafficArchive *)defaultTrafficArchive;
+
+#pragma mark permanent redirects
+
++ (void)setDefaultPermanentRedirectCache:(ASIPermanentRedirectCache *)cache;
++ (ASIPermanentRedirectCache *)defaultPermanentRedirectCache;
+
 // Returns the maximum amount of data we can read as part of the current measurement period, and sleeps this thread if our allowance is used up
 + (unsigned long)maxUploadReadLength;
 
@@ -948,6 +904,8 @@ typedef void (^ASIDataBlock)(NSData *data);
 @property (assign) BOOL allowResumeForFileDownloads;
 @property (retain) NSDictionary *userInfo;
 @property (retain) NSString *postBodyFilePath;
+@property (assign) unsigned long long postBodyFileOffset;
+@property (assign) unsigned long long postBodyFileLength;
 @property (assign) BOOL shouldStreamPostDataFromDisk;
 @property (assign) BOOL didCreateTemporaryPostDataFile;
 @property (assign) BOOL useHTTPVersionOne;
@@ -985,5 +943,7 @@ typedef void (^ASIDataBlock)(NSData *data);
 #endif
 @property (retain) ASIDataDecompressor *dataDecompressor;
 @property (assign) BOOL shouldWaitToInflateCompressedResponses;
+@property (retain) ASITrafficArchive *trafficArchive;
+@property (retain) ASIPermanentRedirectCache *permanentRedirectCache;
 
 @end
@@ -22,6 +22,9 @@
 #import "ASIInputStream.h"
 #import "ASIDataDecompressor.h"
 #import "ASIDataCompressor.h"
+#import "ASITrafficArchive.h"
+#import "ASIPermanentRedirectCache.h"
+#import <libkern/OSAtomic.h>
 
 // Automatically set on build
 NSString *ASIHTTPRequestVersion = @"v1.8-56 2011-02-06";
@@ -122,6 +125,10 @@ static NSDate *throttleWakeUpTime = nil;
 
 static id <ASICacheDelegate> defaultCache = nil;
 
+static ASITrafficArchive *defaultTrafficArchive = nil;
+
+static ASIPermanentRedirectCache *defaultPermanentRedirectCache = nil;
+
 
 // Used for tracking when requests are using the network
 static unsigned int runningRequestCount = 0;
@@ -132,6 +139,190 @@ static unsigned int runningRequestCount = 0;
 // By default this does nothing on Mac OS X, but again override the above methods for a different behaviour
 static BOOL shouldUpdateNetworkActivityIndicator = YES;
 
+// Rarely used state lives in these structures rather than in the request itself
+// Each one is allocated the first time one of its fields is set (see ASIDetailsAllocatingIfNeeded below) and freed in dealloc
+// Requests that don't use authentication, proxies, a request body or blocks never allocate them at all
+
+struct ASIRequestAuthenticationDetails {
+	// Username and password used for authentication
+	NSString *username;
+	NSString *password;
+
+	// Domain used for NTLM authentication
+	NSString *domain;
+
+	// Username and password used for proxy authentication
+	NSString *proxyUsername;
+	NSString *proxyPassword;
+
+	// Domain used for NTLM proxy authentication
+	NSString *proxyDomain;
+
+	// Used for authentication
+	NSDictionary *requestCredentials;
+
+	// Used during NTLM authentication
+	int authenticationRetryCount;
+
+	// Authentication scheme (Basic, Digest, NTLM)
+	NSString *authenticationScheme;
+
+	// Realm for authentication when credentials are required
+	NSString *authenticationRealm;
+
+	// Used for proxy authentication
+	NSDictionary *proxyCredentials;
+
+	// Used during authentication with an NTLM proxy
+	int proxyAuthenticationRetryCount;
+
+	// Authentication scheme for the proxy (Basic, Digest, NTLM)
+	NSString *proxyAuthenticationScheme;
+
+	// Realm for proxy authentication when credentials are required
+	NSString *proxyAuthenticationRealm;
+};
+
+struct ASIRequestProxyDetails {
+	// Details on the proxy to use - you could set these yourself, but it's probably best to let ASIHTTPRequest detect the system proxy settings
+	NSString *proxyHost;
+	int proxyPort;
+
+	// ASIHTTPRequest will assume kCFProxyTypeHTTP if the proxy type could not be automatically determined
+	// Set to kCFProxyTypeSOCKS if you are manually configuring a SOCKS proxy
+	NSString *proxyType;
+
+	// URL for a PAC (Proxy Auto Configuration) file. If you want to set this yourself, it's probably best if you use a local file
+	NSURL *PACurl;
+
+	// Used for downloading PAC files from http / https webservers
+	ASIHTTPRequest *PACFileRequest;
+
+	// Used for asynchronously reading PAC files from file:// URLs
+	NSInputStream *PACFileReadStream;
+
+	// Used for storing PAC data from file URLs as it is downloaded
+	NSMutableData *PACFileData;
+};
+
+struct ASIRequestUploadDetails {
+	// Request body - only used when the whole body is stored in memory (shouldStreamPostDataFromDisk is false)
+	NSMutableData *postBody;
+
+	// gzipped request body used when shouldCompressRequestBody is YES
+	NSData *compressedPostBody;
+
+	// Path to file used to store post body (when shouldStreamPostDataFromDisk is true)
+	// You can set this yourself - useful if you want to PUT a file from local disk
+	NSString *postBodyFilePath;
+
+	// When postBodyFileLength is set, only that many bytes of the file at postBodyFilePath, starting at postBodyFileOffset, are sent
+	// This lets several requests send different parts of the same file without copying them (eg for S3 multipart uploads)
+	unsigned long long postBodyFileOffset;
+	unsigned long long postBodyFileLength;
+
+	// Path to a temporary file used to store a deflated post body (when shouldCompressPostBody is YES)
+	NSString *compressedPostBodyFilePath;
+
+	// Used when writing to the post body when shouldStreamPostDataFromDisk is true (via appendPostData: or appendPostDataFromFile:)
+	NSOutputStream *postBodyWriteStream;
+
+	// Used for reading from the post body when sending the request
+	NSInputStream *postBodyReadStream;
+};
+
+#if NS_BLOCKS_AVAILABLE
+struct ASIRequestBlocks {
+	//block to execute when request starts
+	ASIBasicBlock startedBlock;
+
+	//block to execute when headers are received
+	ASIHeadersBlock headersReceivedBlock;
+
+	//block to execute when request completes successfully
+	ASIBasicBlock completionBlock;
+
+	//block to execute when request fails
+	ASIBasicBlock failureBlock;
+
+	//block for when bytes are received
+	ASIProgressBlock bytesReceivedBlock;
+
+	//block for when bytes are sent
+	ASIProgressBlock bytesSentBlock;
+
+	//block for when download size is incremented
+	ASISizeBlock downloadSizeIncrementedBlock;
+
+	//block for when upload size is incremented
+	ASISizeBlock uploadSizeIncrementedBlock;
+
+	//block for handling raw bytes received
+	ASIDataBlock dataReceivedBlock;
+
+	//block for handling authentication
+	ASIBasicBlock authenticationNeededBlock;
+
+	//block for handling proxy authentication
+	ASIBasicBlock proxyAuthenticationNeededBlock;
+
+	//block for handling redirections, if you want to
+	ASIBasicBlock requestRedirectedBlock;
+};
+#endif
+
+// Protects reads and writes of object fields in the structures above, so their accessors stay atomic like the synthesized ones they replace
+// Accessors only hold it for a pointer swap, so one lock shared by all requests is fine
+static OSSpinLock detailsLock = OS_SPINLOCK_INIT;
+
+// Returns the structure pointed to by *details, allocating a zeroed one of the given size first if needed
+// If two threads race to allocate, only one structure is installed and the other is thrown away
+static void *ASIDetailsAllocatingIfNeeded(void **details, size_t size)
+{
+	void *existingDetails = *details;
+	if (existingDetails) {
+		return existingDetails;
+	}
+	void *newDetails = calloc(1, size);
+	if (OSAtomicCompareAndSwapPtrBarrier(NULL, newDetails, details)) {
+		return newDetails;
+	}
+	free(newDetails);
+	return *details;
+}
+
+static id ASIGetDetail(id *field)
+{
+	OSSpinLockLock(&detailsLock);
+	id value = [*field retain];
+	OSSpinLockUnlock(&detailsLock);
+	return [value autorelease];
+}
+
+static void ASISetDetail(id *field, id newValue)
+{
+	[newValue retain];
+	OSSpinLockLock(&detailsLock);
+	id oldValue = *field;
+	*field = newValue;
+	OSSpinLockUnlock(&detailsLock);
+	[oldValue release];
+}
+
+// Generate accessors for an object or scalar field in one of the structures above
+// Setting nil or 0 when the structure hasn't been allocated yet does nothing, so clearing a value never allocates
+#define ASI_DETAILS_OBJECT_ACCESSORS(details, type, name, setter) \
+- (type)name { return details ? (type)ASIGetDetail((id *)&details->name) : nil; } \
+- (void)setter:(type)newValue { if (!newValue && !details) return; ASISetDetail((id *)&((typeof(details))ASIDetailsAllocatingIfNeeded((void **)&details, sizeof(*details)))->name, newValue); }
+
+#define ASI_DETAILS_SCALAR_ACCESSORS(details, type, name, setter) \
+- (type)name { return details ? details->name : 0; } \
+- (void)setter:(type)newValue { if (!newValue && !details) return; ((typeof(details))ASIDetailsAllocatingIfNeeded((void **)&details, sizeof(*details)))->name = newValue; }
+
+// Blocks are copied rather than retained, otherwise these work like the object setters above
+#define ASI_DETAILS_BLOCK_SETTER(type, name, setter) \
+- (void)setter:(type)newBlock { if (!newBlock && !requestBlocks) return; ASISetDetail((id *)&((struct ASIRequestBlocks *)ASIDetailsAllocatingIfNeeded((void **)&requestBlocks, sizeof(struct ASIRequestBlocks)))->name, [[newBlock copy] autorelease]); }
+
 
 //**Queue stuff**/
 
@@ -166,6 +357,7 @@ static NSOperationQueue *sharedQueue = nil;
 - (void)reportFinished;
 - (void)markAsFinished;
 - (void)performRedirect;
+- (BOOL)willAskDelegateAboutRedirect;
 - (BOOL)shouldTimeOut;
 
 + (void)performInvocation:(NSInvocation *)invocation onTarget:(id *)target releasingObject:(id)objectToRelease;
@@ -175,6 +367,7 @@ static NSOperationQueue *sharedQueue = nil;
 
 // Handling Proxy autodetection and PAC file downloads
 - (BOOL)configureProxies;
+- (BOOL)detectSystemProxySettings;
 - (void)fetchPACFile;
 - (void)finishedDownloadingPACFile:(ASIHTTPRequest *)theRequest;
 - (void)runPACScript:(NSString *)script;
@@ -182,6 +375,11 @@ static NSOperationQueue *sharedQueue = nil;
 
 - (void)useDataFromCache;
 
+// Helpers for recording and replaying responses with an ASITrafficArchive
+- (BOOL)isRecordingTraffic;
+- (BOOL)isReplayingTraffic;
+- (CFHTTPMessageRef)copyResponseHeaderMessage;
+
 // Called to update the size of a partial download when starting a request, or retrying after a timeout
 - (void)updatePartialDownloadSize;
 
@@ -240,6 +438,7 @@ static NSOperationQueue *sharedQueue = nil;
 @property (retain, nonatomic) NSTimer *statusTimer;
 @property (assign) BOOL didUseCachedResponse;
 @property (retain, nonatomic) NSURL *redirectURL;
+@property (retain, nonatomic) NSDictionary *trafficExchange;
 
 @property (assign, nonatomic) BOOL isPACFileRequest;
 @property (retain, nonatomic) ASIHTTPRequest *PACFileRequest;
@@ -309,6 +508,8 @@ static NSOperationQueue *sharedQueue = nil;
 	[self setURL:newURL];
 	[self setCancelledLock:[[[NSRecursiveLock alloc] init] autorelease]];
 	[self setDownloadCache:[[self class] defaultCache]];
+	[self setTrafficArchive:[[self class] defaultTrafficArchive]];
+	[self setPermanentRedirectCache:[[self class] defaultPermanentRedirectCache]];
 	return self;
 }
 
@@ -351,8 +552,6 @@ static NSOperationQueue *sharedQueue = nil;
 	[statusTimer release];
 	[queue release];
 	[userInfo release];
-	[postBody release];
-	[compressedPostBody release];
 	[error release];
 	[requestHeaders release];
 	[requestCookies release];
@@ -361,20 +560,6 @@ static NSOperationQueue *sharedQueue = nil;
 	[temporaryUncompressedDataDownloadPath release];
 	[fileDownloadOutputStream release];
 	[inflatedFileDownloadOutputStream release];
-	[username release];
-	[password release];
-	[domain release];
-	[authenticationRealm release];
-	[authenticationScheme release];
-	[requestCredentials release];
-	[proxyHost release];
-	[proxyType release];
-	[proxyUsername release];
-	[proxyPassword release];
-	[proxyDomain release];
-	[proxyAuthenticationRealm release];
-	[proxyAuthenticationScheme release];
-	[proxyCredentials release];
 	[url release];
 	[originalURL release];
 	[lastActivityTime release];
@@ -383,19 +568,52 @@ static NSOperationQueue *sharedQueue = nil;
 	[responseHeaders release];
 	[requestMethod release];
 	[cancelledLock release];
-	[postBodyFilePath release];
-	[compressedPostBodyFilePath release];
-	[postBodyWriteStream release];
-	[postBodyReadStream release];
-	[PACurl release];
 	[clientCertificates release];
 	[responseStatusMessage release];
 	[connectionInfo release];
 	[requestID release];
 	[dataDecompressor release];
+	[trafficArchive release];
+	[trafficExchange release];
+	[permanentRedirectCache release];
+
+	if (authenticationDetails) {
+		[authenticationDetails->username release];
+		[authenticationDetails->password release];
+		[authenticationDetails->domain release];
+		[authenticationDetails->proxyUsername release];
+		[authenticationDetails->proxyPassword release];
+		[authenticationDetails->proxyDomain release];
+		[authenticationDetails->requestCredentials release];
+		[authenticationDetails->authenticationScheme release];
+		[authenticationDetails->authenticationRealm release];
+		[authenticationDetails->proxyCredentials release];
+		[authenticationDetails->proxyAuthenticationScheme release];
+		[authenticationDetails->proxyAuthenticationRealm release];
+		free(authenticationDetails);
+	}
+	if (proxyDetails) {
+		[proxyDetails->proxyHost release];
+		[proxyDetails->proxyType release];
+		[proxyDetails->PACurl release];
+		[proxyDetails->PACFileRequest release];
+		[proxyDetails->PACFileReadStream release];
+		[proxyDetails->PACFileData release];
+		free(proxyDetails);
+	}
+	if (uploadDetails) {
+		[uploadDetails->postBody release];
+		[uploadDetails->compressedPostBody release];
+		[uploadDetails->postBodyFilePath release];
+		[uploadDetails->compressedPostBodyFilePath release];
+		[uploadDetails->postBodyWriteStream release];
+		[uploadDetails->postBodyReadStream release];
+		free(uploadDetails);
+	}
 
 	#if NS_BLOCKS_AVAILABLE
 	[self releaseBlocksOnMainThread];
+	free(requestBlocks);
 	#endif
 
 	[super dealloc];
@@ -404,61 +622,69 @@ static NSOperationQueue *sharedQueue = nil;
 #if NS_BLOCKS_AVAILABLE
 - (void)releaseBlocksOnMainThread
 {
+	if (!requestBlocks) {
+		return;
+	}
 	NSMutableArray *blocks = [NSMutableArray array];
-	if (completionBlock) {
-		[blocks addObject:completionBlock];
-		[completionBlock release];
-		completionBlock = nil;
-	}
-	if (failureBlock) {
-		[blocks addObject:failureBlock];
-		[failureBlock release];
-		failureBlock = nil;
-	}
-	if (startedBlock) {
-		[blocks addObject:startedBlock];
-		[startedBlock release];
-		startedBlock = nil;
-	}
-	if (headersReceivedBlock) {
-		[blocks addObject:headersReceivedBlock];
-		[headersReceivedBlock release];
-		headersReceivedBlock = nil;
-	}
-	if (bytesReceivedBlock) {
-		[blocks addObject:bytesReceivedBlock];
-		[bytesReceivedBlock release];
-		bytesReceivedBlock = nil;
-	}
-	if (bytesSentBlock) {
-		[blocks addObject:bytesSentBlock];
-		[bytesSentBlock release];
-		bytesSentBlock = nil;
-	}
-	if (downloadSizeIncrementedBlock) {
-		[blocks addObject:downloadSizeIncrementedBlock];
-		[downloadSizeIncrementedBlock release];
-		downloadSizeIncrementedBlock = nil;
-	}
-	if (uploadSizeIncrementedBlock) {
-		[blocks addObject:uploadSizeIncrementedBlock];
-		[uploadSizeIncrementedBlock release];
-		uploadSizeIncrementedBlock = nil;
-	}
-	if (dataReceivedBlock) {
-		[blocks addObject:dataReceivedBlock];
-		[dataReceivedBlock release];
-		dataReceivedBlock = nil;
-	}
-	if (proxyAuthenticationNeededBlock) {
-		[blocks addObject:proxyAuthenticationNeededBlock];
-		[proxyAuthenticationNeededBlock release];
-		proxyAuthenticationNeededBlock = nil;
-	}
-	if (authenticationNeededBlock) {
-		[blocks addObject:authenticationNeededBlock];
-		[authenticationNeededBlock release];
-		authenticationNeededBlock = nil;
+	if (requestBlocks->completionBlock) {
+		[blocks addObject:requestBlocks->completionBlock];
+		[requestBlocks->completionBlock release];
+		requestBlocks->completionBlock = nil;
+	}
+	if (requestBlocks->failureBlock) {
+		[blocks addObject:requestBlocks->failureBlock];
+		[requestBlocks->failureBlock release];
+		requestBlocks->failureBlock = nil;
+	}
+	if (requestBlocks->startedBlock) {
+		[blocks addObject:requestBlocks->startedBlock];
+		[requestBlocks->startedBlock release];
+		requestBlocks->startedBlock = nil;
+	}
+	if (requestBlocks->headersReceivedBlock) {
+		[blocks addObject:requestBlocks->headersReceivedBlock];
+		[requestBlocks->headersReceivedBlock release];
+		requestBlocks->headersReceivedBlock = nil;
+	}
+	if (requestBlocks->bytesReceivedBlock) {
+		[blocks addObject:requestBlocks->bytesReceivedBlock];
+		[requestBlocks->bytesReceivedBlock release];
+		requestBlocks->bytesReceivedBlock = nil;
+	}
+	if (requestBlocks->bytesSentBlock) {
+		[blocks addObject:requestBlocks->bytesSentBlock];
+		[requestBlocks->bytesSentBlock release];
+		requestBlocks->bytesSentBlock = nil;
+	}
+	if (requestBlocks->downloadSizeIncrementedBlock) {
+		[blocks addObject:requestBlocks->downloadSizeIncrementedBlock];
+		[requestBlocks->downloadSizeIncrementedBlock release];
+		requestBlocks->downloadSizeIncrementedBlock = nil;
+	}
+	if (requestBlocks->uploadSizeIncrementedBlock) {
+		[blocks addObject:requestBlocks->uploadSizeIncrementedBlock];
+		[requestBlocks->uploadSizeIncrementedBlock release];
+		requestBlocks->uploadSizeIncrementedBlock = nil;
+	}
+	if (requestBlocks->dataReceivedBlock) {
+		[blocks addObject:requestBlocks->dataReceivedBlock];
+		[requestBlocks->dataReceivedBlock release];
+		requestBlocks->dataReceivedBlock = nil;
+	}
+	if (requestBlocks->proxyAuthenticationNeededBlock) {
+		[blocks addObject:requestBlocks->proxyAuthenticationNeededBlock];
+		[requestBlocks->proxyAuthenticationNeededBlock release];
+		requestBlocks->proxyAuthenticationNeededBlock = nil;
+	}
+	if (requestBlocks->authenticationNeededBlock) {
+		[blocks addObject:requestBlocks->authenticationNeededBlock];
+		[requestBlocks->authenticationNeededBlock release];
+		requestBlocks->authenticationNeededBlock = nil;
+	}
+	if (requestBlocks->requestRedirectedBlock) {
+		[blocks addObject:requestBlocks->requestRedirectedBlock];
+		[requestBlocks->requestRedirectedBlock release];
+		requestBlocks->requestRedirectedBlock = nil;
 	}
 	[[self class] performSelectorOnMainThread:@selector(releaseBlocks:) withObject:blocks waitUntilDone:[NSThread isMainThread]];
 }
@@ -505,8 +731,13 @@ static NSOperationQueue *sharedQueue = nil;
 				[self setCompressedPostBodyFilePath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]]];
 				
 				NSError *err = nil;
-				if (![ASIDataCompressor compressDataFromFile:[self postBodyFilePath] toFile:[self compressedPostBodyFilePath] error:&err]) {
-					[self failWithError:err];
+				if (![ASIDataCompressor compressDataFromFile:[self postBodyFilePath] toFile:[self compressedPostBodyFilePath] cancelFlag:&cancellationRequested error:&err]) {
+					if (cancellationRequested) {
+						[[[[NSFileManager alloc] init] autorelease] removeItemAtPath:[self compressedPostBodyFilePath] error:NULL];
+						[self setCompressedPostBodyFilePath:nil];
+					} else {
+						[self failWithError:err];
+					}
 					return;
 				}
 			}
@@ -520,6 +751,15 @@ static NSOperationQueue *sharedQueue = nil;
 			[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to get attributes for file at path '%@'",path],NSLocalizedDescriptionKey,error,NSUnderlyingErrorKey,nil]]];
 			return;
 		}
+
+		// We're only sending part of the file
+		if ([self postBodyFileLength] && ![self shouldCompressRequestBody]) {
+			if ([self postBodyFileOffset]+[self postBodyFileLength] > [self postLength]) {
+				[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"The file at path '%@' is too short to send %llu bytes from offset %llu",path,[self postBodyFileLength],[self postBodyFileOffset]],NSLocalizedDescriptionKey,nil]]];
+				return;
+			}
+			[self setPostLength:[self postBodyFileLength]];
+		}
 		
 	// Otherwise, we have an in-memory request body
 	} else {
@@ -547,6 +787,11 @@ static NSOperationQueue *sharedQueue = nil;
 
 }
 
+- (Class)postBodyReadStreamClass
+{
+	return [ASIInputStream class];
+}
+
 // Sets up storage for the post body
 - (void)setupPostBody
 {
@@ -691,6 +936,7 @@ static NSOperationQueue *sharedQueue = nil;
 	CFRetain(self);
     [self willChangeValueForKey:@"isCancelled"];
     cancelled = YES;
+	OSMemoryBarrier();
     [self didChangeValueForKey:@"isCancelled"];
     
 	[[self cancelledLock] unlock];
@@ -699,6 +945,9 @@ static NSOperationQueue *sharedQueue = nil;
 
 - (void)cancel
 {
+	// Let any setup work in progress on another thread know it can stop now
+	cancellationRequested = YES;
+	OSMemoryBarrier();
     [self performSelector:@selector(cancelOnRequestThread) onThread:[[self class] threadForRequest:self] withObject:nil waitUntilDone:NO];    
 }
 
@@ -722,15 +971,24 @@ static NSOperationQueue *sharedQueue = nil;
 }
 
 
+// cancelled only ever goes from NO to YES, so we don't need cancelledLock to read it
+// Anything that must not race with cancellation should still take the lock and check again
 - (BOOL)isCancelled
 {
-    BOOL result;
-    
-	[[self cancelledLock] lock];
-    result = cancelled;
-    [[self cancelledLock] unlock];
-    
-    return result;
+	OSMemoryBarrier();
+	return cancelled;
+}
+
+- (BOOL)complete
+{
+	OSMemoryBarrier();
+	return complete;
+}
+
+- (void)setComplete:(BOOL)newComplete
+{
+	complete = newComplete;
+	OSMemoryBarrier();
 }
 
 // Call this method to get the received data as an NSString. Don't use for binary data!
@@ -816,9 +1074,13 @@ static NSOperationQueue *sharedQueue = nil;
 // Create the request
 - (void)main
 {
+	// We only hold cancelledLock while touching state that other threads read or change
+	// Building the post body (which may mean compressing a large file) and looking up the system proxy settings happen without it
+	BOOL haveLock = NO;
 	@try {
 		
 		[[self cancelledLock] lock];
+		haveLock = YES;
 		
 		#if TARGET_OS_IPHONE && __IPHONE_OS_VERSION_MAX_ALLOWED >= __IPHONE_4_0
 		if ([ASIHTTPRequest isMultitaskingSupported] && [self shouldContinueWhenAppEntersBackground]) {
@@ -852,11 +1114,40 @@ static NSOperationQueue *sharedQueue = nil;
 			[self failWithError:ASIUnableToCreateRequestError];
 			return;		
 		}
+
+		[[self cancelledLock] unlock];
+		haveLock = NO;
 		
 		// Must call before we create the request so that the request method can be set if needs be
 		if (![self mainRequest]) {
 			[self buildPostBody];
 		}
+
+		// If we were cancelled while building the body, the cancellation will be handled on this thread once we return
+		if (cancellationRequested || [self complete]) {
+			return;
+		}
+
+		[[self cancelledLock] lock];
+		haveLock = YES;
+
+		// If we've been permanently redirected from this url before, skip the redirect and go straight to where it took us
+		// We do this after building the body, because that may change the request method
+		// Requests that don't follow redirects, or whose delegate or queue wants to be asked about them, always talk to the original url
+		if ([self permanentRedirectCache] && ![self mainRequest] && [self shouldRedirect] && ![self willAskDelegateAboutRedirect]) {
+			NSURL *destinationURL = [[self permanentRedirectCache] destinationURLForURL:[self url] requestMethod:[self requestMethod]];
+			if (destinationURL) {
+				if ([self redirectCount] == 0) {
+					[self setOriginalURL:[self url]];
+				}
+				[self setURL:destinationURL];
+				[self setRedirectCount:[self redirectCount]+1];
+
+				// As for a live redirect, manually added cookies aren't sent, since we might be going to a different domain
+				[self setRequestCookies:[NSMutableArray array]];
+				[self setHaveBuiltRequestHeaders:NO];
+			}
+		}
 		
 		if (![[self requestMethod] isEqualToString:@"GET"]) {
 			[self setDownloadCache:nil];
@@ -921,6 +1212,19 @@ static NSOperationQueue *sharedQueue = nil;
 			CFHTTPMessageSetHeaderFieldValue(request, (CFStringRef)header, (CFStringRef)[[self requestHeaders] objectForKey:header]);
 		}
 
+		// Looking up the system proxy settings can be slow, so we do it without the lock
+		// configureProxies will use whatever we find, or fetch the PAC file if the settings point to one
+		if (![self isPACFileRequest] && ![self proxyHost] && ![self proxyPort] && ![self PACurl]) {
+			[[self cancelledLock] unlock];
+			haveLock = NO;
+			[self detectSystemProxySettings];
+			if (cancellationRequested || [self complete]) {
+				return;
+			}
+			[[self cancelledLock] lock];
+			haveLock = YES;
+		}
+
 		// If we immediately have access to proxy settings, start the request
 		// Otherwise, we'll start downloading the proxy PAC file, and call startRequest once that process is complete
 		if ([self configureProxies]) {
@@ -932,7 +1236,9 @@ static NSOperationQueue *sharedQueue = nil;
 		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIUnhandledExceptionError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[exception name],NSLocalizedDescriptionKey,[exception reason],NSLocalizedFailureReasonErrorKey,underlyingError,NSUnderlyingErrorKey,nil]]];
 
 	} @finally {
-		[[self cancelledLock] unlock];
+		if (haveLock) {
+			[[self cancelledLock] unlock];
+		}
 	}
 }
 
@@ -1113,15 +1419,39 @@ static NSOperationQueue *sharedQueue = nil;
 	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
 
 	[self setReadStreamIsScheduled:NO];
-	
+
+	// Are we recording or replaying this request with a traffic archive?
+	[self setTrafficExchange:nil];
+	if ([self trafficArchive]) {
+		if ([[self trafficArchive] mode] == ASITrafficArchiveReplayMode) {
+			NSDictionary *exchange = [[self trafficArchive] exchangeForReplayingRequest:self];
+			if (!exchange) {
+				[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIInternalErrorWhileBuildingRequestType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"No recorded response for %@ %@",[self requestMethod],[self url]],NSLocalizedDescriptionKey,nil]]];
+				return;
+			}
+			[self setTrafficExchange:exchange];
+
+			// Replayed responses never use a real connection
+			[self setShouldAttemptPersistentConnection:NO];
+		} else {
+			[self setTrafficExchange:[[self trafficArchive] exchangeForRecordingRequest:self]];
+		}
+	}
+
+	// When replaying, the response body is read from a stream fed by the archive
+	if ([self isReplayingTraffic]) {
+		[self setReadStream:[[self trafficArchive] readStreamForExchange:[self trafficExchange] runLoopMode:[self runLoopMode]]];
+
 	// Do we need to stream the request body from disk
-	if ([self shouldStreamPostDataFromDisk] && [self postBodyFilePath] && [fileManager fileExistsAtPath:[self postBodyFilePath]]) {
+	} else if ([self shouldStreamPostDataFromDisk] && [self postBodyFilePath] && [fileManager fileExistsAtPath:[self postBodyFilePath]]) {
 		
 		// Are we gzipping the request body?
 		if ([self compressedPostBodyFilePath] && [fileManager fileExistsAtPath:[self compressedPostBodyFilePath]]) {
-			[self setPostBodyReadStream:[ASIInputStream inputStreamWithFileAtPath:[self compressedPostBodyFilePath] request:self]];
+			[self setPostBodyReadStream:[[self postBodyReadStreamClass] inputStreamWithFileAtPath:[self compressedPostBodyFilePath] request:self]];
+		} else if ([self postBodyFileLength]) {
+			[self setPostBodyReadStream:[[self postBodyReadStreamClass] inputStreamWithFileAtPath:[self postBodyFilePath] offset:[self postBodyFileOffset] length:[self postBodyFileLength] request:self]];
 		} else {
-			[self setPostBodyReadStream:[ASIInputStream inputStreamWithFileAtPath:[self postBodyFilePath] request:self]];
+			[self setPostBodyReadStream:[[self postBodyReadStreamClass] inputStreamWithFileAtPath:[self postBodyFilePath] request:self]];
 		}
 		[self setReadStream:[(NSInputStream *)CFReadStreamCreateForStreamedHTTPRequest(kCFAllocatorDefault, request,(CFReadStreamRef)[self postBodyReadStream]) autorelease]];
     } else {
@@ -1129,9 +1459,9 @@ static NSOperationQueue *sharedQueue = nil;
 		// If we have a request body, we'll stream it from memory using our custom stream, so that we can measure bandwidth use and it can be bandwidth-throttled if necessary
 		if ([self postBody] && [[self postBody] length] > 0) {
 			if ([self shouldCompressRequestBody] && [self compressedPostBody]) {
-				[self setPostBodyReadStream:[ASIInputStream inputStreamWithData:[self compressedPostBody] request:self]];
+				[self setPostBodyReadStream:[[self postBodyReadStreamClass] inputStreamWithData:[self compressedPostBody] request:self]];
 			} else if ([self postBody]) {
-				[self setPostBodyReadStream:[ASIInputStream inputStreamWithData:[self postBody] request:self]];
+				[self setPostBodyReadStream:[[self postBodyReadStreamClass] inputStreamWithData:[self postBody] request:self]];
 			}
 			[self setReadStream:[(NSInputStream *)CFReadStreamCreateForStreamedHTTPRequest(kCFAllocatorDefault, request,(CFReadStreamRef)[self postBodyReadStream]) autorelease]];
 		
@@ -1375,8 +1705,23 @@ static NSOperationQueue *sharedQueue = nil;
 	}
 }
 
+// Should be called with cancelledLock held, so the delegate and queue can't change while we check them
+- (BOOL)willAskDelegateAboutRedirect
+{
+	return (([self delegate] && [[self delegate] respondsToSelector:[self willRedirectSelector]]) || ([self queue] && [[self queue] respondsToSelector:@selector(request:willRedirectToURL:)]));
+}
+
 - (void)performRedirect
 {
+	// Remember permanent redirects we are about to follow, so next time we can skip them
+	// If a delegate sent us somewhere other than the Location the server gave us, that's the delegate's choice, not the server's, so we don't store it
+	if ([self permanentRedirectCache] && ([self responseStatusCode] == 301 || [self responseStatusCode] == 308) && [self redirectCount] < RedirectionLimit) {
+		NSURL *location = [[NSURL URLWithString:[[self responseHeaders] valueForKey:@"Location"] relativeToURL:[self url]] absoluteURL];
+		if ([location isEqual:[self redirectURL]]) {
+			[[self permanentRedirectCache] storeRedirectForRequest:self toURL:[self redirectURL]];
+		}
+	}
+
 	[self setURL:[self redirectURL]];
 	[self setComplete:YES];
 	[self setNeedsRedirect:NO];
@@ -1421,6 +1766,11 @@ static NSOperationQueue *sharedQueue = nil;
 
 - (void)checkRequestStatus
 {
+	// This is called on every timer tick, so we look without the lock first
+	if ([self isCancelled] || [self complete]) {
+		return;
+	}
+
 	// We won't let the request cancel while we're updating progress / checking for a timeout
 	[[self cancelledLock] lock];
 	// See if our NSOperationQueue told us to cancel
@@ -1489,14 +1839,14 @@ static NSOperationQueue *sharedQueue = nil;
 - (void)cancelLoad
 {
 	// If we're in the middle of downloading a PAC file, let's stop that first
-	if (PACFileReadStream) {
-		[PACFileReadStream setDelegate:nil];
-		[PACFileReadStream close];
+	if ([self PACFileReadStream]) {
+		[[self PACFileReadStream] setDelegate:nil];
+		[[self PACFileReadStream] close];
 		[self setPACFileReadStream:nil];
 		[self setPACFileData:nil];
-	} else if (PACFileRequest) {
-		[PACFileRequest setDelegate:nil];
-		[PACFileRequest cancel];
+	} else if ([self PACFileRequest]) {
+		[[self PACFileRequest] setDelegate:nil];
+		[[self PACFileRequest] cancel];
 		[self setPACFileRequest:nil];
 	}
 
@@ -1662,9 +2012,9 @@ static NSOperationQueue *sharedQueue = nil;
 	[ASIHTTPRequest updateProgressIndicator:&downloadProgressDelegate withProgress:[self totalBytesRead]+[self partialDownloadSize] ofTotal:[self contentLength]+[self partialDownloadSize]];
 
 	#if NS_BLOCKS_AVAILABLE
-    if (bytesReceivedBlock) {
+    if (requestBlocks && requestBlocks->bytesReceivedBlock) {
 		unsigned long long totalSize = [self contentLength] + [self partialDownloadSize];
-		[self performBlockOnMainThread:^{ if (bytesReceivedBlock) { bytesReceivedBlock(value, totalSize); }}];
+		[self performBlockOnMainThread:^{ if (requestBlocks && requestBlocks->bytesReceivedBlock) { requestBlocks->bytesReceivedBlock(value, totalSize); }}];
     }
 	#endif
 	[self setLastBytesRead:bytesReadSoFar];
@@ -1706,9 +2056,9 @@ static NSOperationQueue *sharedQueue = nil;
 	[ASIHTTPRequest updateProgressIndicator:&uploadProgressDelegate withProgress:[self totalBytesSent]-[self uploadBufferSize] ofTotal:[self postLength]-[self uploadBufferSize]];
 
 	#if NS_BLOCKS_AVAILABLE
-    if(bytesSentBlock){
+    if (requestBlocks && requestBlocks->bytesSentBlock){
 		unsigned long long totalSize = [self postLength];
-		[self performBlockOnMainThread:^{ if (bytesSentBlock) { bytesSentBlock(value, totalSize); }}];
+		[self performBlockOnMainThread:^{ if (requestBlocks && requestBlocks->bytesSentBlock) { requestBlocks->bytesSentBlock(value, totalSize); }}];
 	}
 	#endif
 }
@@ -1720,8 +2070,8 @@ static NSOperationQueue *sharedQueue = nil;
 	[ASIHTTPRequest performSelector:@selector(request:incrementDownloadSizeBy:) onTarget:&downloadProgressDelegate withObject:self amount:&length callerToRetain:self];
 
 	#if NS_BLOCKS_AVAILABLE
-    if(downloadSizeIncrementedBlock){
-		[self performBlockOnMainThread:^{ if (downloadSizeIncrementedBlock) { downloadSizeIncrementedBlock(length); }}];
+    if (requestBlocks && requestBlocks->downloadSizeIncrementedBlock){
+		[self performBlockOnMainThread:^{ if (requestBlocks && requestBlocks->downloadSizeIncrementedBlock) { requestBlocks->downloadSizeIncrementedBlock(length); }}];
     }
 	#endif
 }
@@ -1732,8 +2082,8 @@ static NSOperationQueue *sharedQueue = nil;
 	[ASIHTTPRequest performSelector:@selector(request:incrementUploadSizeBy:) onTarget:&uploadProgressDelegate withObject:self amount:&length callerToRetain:self];
 
 	#if NS_BLOCKS_AVAILABLE
-    if(uploadSizeIncrementedBlock) {
-		[self performBlockOnMainThread:^{ if (uploadSizeIncrementedBlock) { uploadSizeIncrementedBlock(length); }}];
+    if (requestBlocks && requestBlocks->uploadSizeIncrementedBlock) {
+		[self performBlockOnMainThread:^{ if (requestBlocks && requestBlocks->uploadSizeIncrementedBlock) { requestBlocks->uploadSizeIncrementedBlock(length); }}];
     }
 	#endif
 }
@@ -1747,9 +2097,9 @@ static NSOperationQueue *sharedQueue = nil;
 	[ASIHTTPRequest updateProgressIndicator:&uploadProgressDelegate withProgress:0 ofTotal:[self postLength]];
 
 	#if NS_BLOCKS_AVAILABLE
-    if(bytesSentBlock){
+    if (requestBlocks && requestBlocks->bytesSentBlock){
 		unsigned long long totalSize = [self postLength];
-		[self performBlockOnMainThread:^{  if (bytesSentBlock) { bytesSentBlock(progressToRemove, totalSize); }}];
+		[self performBlockOnMainThread:^{  if (requestBlocks && requestBlocks->bytesSentBlock) { requestBlocks->bytesSentBlock(progressToRemove, totalSize); }}];
 	}
 	#endif
 }
@@ -1861,8 +2211,8 @@ static NSOperationQueue *sharedQueue = nil;
 		[queue performSelector:@selector(requestStarted:) withObject:self];
 	}
 	#if NS_BLOCKS_AVAILABLE
-	if(startedBlock){
-		startedBlock();
+	if (requestBlocks && requestBlocks->startedBlock){
+		requestBlocks->startedBlock();
 	}
 	#endif
 }
@@ -1878,8 +2228,8 @@ static NSOperationQueue *sharedQueue = nil;
 		[[self delegate] performSelector:@selector(requestRedirected:) withObject:self];
 	}
 	#if NS_BLOCKS_AVAILABLE
-	if(requestRedirectedBlock){
-		requestRedirectedBlock();
+	if (requestBlocks && requestBlocks->requestRedirectedBlock){
+		requestBlocks->requestRedirectedBlock();
 	}
 	#endif
 }
@@ -1900,8 +2250,8 @@ static NSOperationQueue *sharedQueue = nil;
 	}
     
 	#if NS_BLOCKS_AVAILABLE
-	if(headersReceivedBlock){
-		headersReceivedBlock(newResponseHeaders);
+	if (requestBlocks && requestBlocks->headersReceivedBlock){
+		requestBlocks->headersReceivedBlock(newResponseHeaders);
     }
 	#endif
 }
@@ -1947,8 +2297,8 @@ static NSOperationQueue *sharedQueue = nil;
 		[queue performSelector:@selector(requestFinished:) withObject:self];
 	}
 #if NS_BLOCKS_AVAILABLE
-	if(completionBlock){
-		completionBlock();
+	if (requestBlocks && requestBlocks->completionBlock){
+		requestBlocks->completionBlock();
 	}
 #endif
 }
@@ -1963,8 +2313,8 @@ static NSOperationQueue *sharedQueue = nil;
 		[queue performSelector:@selector(requestFailed:) withObject:self];
 	}
 	#if NS_BLOCKS_AVAILABLE
-    if(failureBlock){
-        failureBlock();
+    if (requestBlocks && requestBlocks->failureBlock){
+        requestBlocks->failureBlock();
     }
 	#endif
 }
@@ -1977,8 +2327,8 @@ static NSOperationQueue *sharedQueue = nil;
 	}
 
 	#if NS_BLOCKS_AVAILABLE
-	if (dataReceivedBlock) {
-		dataReceivedBlock(data);
+	if (requestBlocks && requestBlocks->dataReceivedBlock) {
+		requestBlocks->dataReceivedBlock(data);
 	}
 	#endif
 }
@@ -2051,7 +2401,7 @@ static NSOperationQueue *sharedQueue = nil;
 {
 	[self setAuthenticationNeeded:ASINoAuthenticationNeededYet];
 
-	CFHTTPMessageRef message = (CFHTTPMessageRef)CFReadStreamCopyProperty((CFReadStreamRef)[self readStream], kCFStreamPropertyHTTPResponseHeader);
+	CFHTTPMessageRef message = [self copyResponseHeaderMessage];
 	if (!message) {
 		return;
 	}
@@ -2133,7 +2483,7 @@ static NSOperationQueue *sharedQueue = nil;
 	// Do we need to redirect?
 	// Note that ASIHTTPRequest does not currently support 305 Use Proxy
 	if ([self shouldRedirect] && [responseHeaders valueForKey:@"Location"]) {
-		if (([self responseStatusCode] > 300 && [self responseStatusCode] < 304) || [self responseStatusCode] == 307) {
+		if (([self responseStatusCode] > 300 && [self responseStatusCode] < 304) || [self responseStatusCode] == 307 || [self responseStatusCode] == 308) {
             
 			[self performSelectorOnMainThread:@selector(requestRedirected) withObject:nil waitUntilDone:[NSThread isMainThread]];
 			
@@ -2142,7 +2492,8 @@ static NSOperationQueue *sharedQueue = nil;
 			// See also:
 			// http://allseeing-i.lighthouseapp.com/projects/27881/tickets/27-302-redirection-issue
 							
-			if ([self responseStatusCode] != 307 && (![self shouldUseRFC2616RedirectBehaviour] || [self responseStatusCode] == 303)) {
+			// 307 and 308 redirects always keep the request method and body
+			if ([self responseStatusCode] != 307 && [self responseStatusCode] != 308 && (![self shouldUseRFC2616RedirectBehaviour] || [self responseStatusCode] == 303)) {
 				[self setRequestMethod:@"GET"];
 				[self setPostBody:nil];
 				[self setPostLength:0];
@@ -2528,7 +2879,7 @@ static NSOperationQueue *sharedQueue = nil;
 	}
 
 	#if NS_BLOCKS_AVAILABLE
-	if(proxyAuthenticationNeededBlock){
+	if (requestBlocks && requestBlocks->proxyAuthenticationNeededBlock){
 		delegateOrBlockWillHandleAuthentication = YES;
 	}
 	#endif
@@ -2552,8 +2903,8 @@ static NSOperationQueue *sharedQueue = nil;
 		return;
 	}
 	#if NS_BLOCKS_AVAILABLE
-	if(proxyAuthenticationNeededBlock){
-		proxyAuthenticationNeededBlock();
+	if (requestBlocks && requestBlocks->proxyAuthenticationNeededBlock){
+		requestBlocks->proxyAuthenticationNeededBlock();
 	}
 	#endif
 }
@@ -2575,7 +2926,7 @@ static NSOperationQueue *sharedQueue = nil;
 	}
 
 	#if NS_BLOCKS_AVAILABLE
-	if (authenticationNeededBlock) {
+	if (requestBlocks && requestBlocks->authenticationNeededBlock) {
 		delegateOrBlockWillHandleAuthentication = YES;
 	}
 	#endif
@@ -2600,8 +2951,8 @@ static NSOperationQueue *sharedQueue = nil;
 	}
 	
 	#if NS_BLOCKS_AVAILABLE
-	if (authenticationNeededBlock) {
-		authenticationNeededBlock();
+	if (requestBlocks && requestBlocks->authenticationNeededBlock) {
+		requestBlocks->authenticationNeededBlock();
 	}
 	#endif	
 }
@@ -2615,7 +2966,7 @@ static NSOperationQueue *sharedQueue = nil;
 	
 	// Read authentication data
 	if (!proxyAuthentication) {
-		CFHTTPMessageRef responseHeader = (CFHTTPMessageRef) CFReadStreamCopyProperty((CFReadStreamRef)[self readStream],kCFStreamPropertyHTTPResponseHeader);
+		CFHTTPMessageRef responseHeader = [self copyResponseHeaderMessage];
 		proxyAuthentication = CFHTTPAuthenticationCreateFromResponse(NULL, responseHeader);
 		CFRelease(responseHeader);
 		[self setProxyAuthenticationScheme:[(NSString *)CFHTTPAuthenticationCopyMethod(proxyAuthentication) autorelease]];
@@ -2648,7 +2999,7 @@ static NSOperationQueue *sharedQueue = nil;
 			[delegateAuthenticationLock lock];
 			
 			// We know the credentials we just presented are bad, we should remove them from the session store too
-			[[self class] removeProxyAuthenticationCredentialsFromSessionStore:proxyCredentials];
+			[[self class] removeProxyAuthenticationCredentialsFromSessionStore:[self proxyCredentials]];
 			[self setProxyCredentials:nil];
 			
 			
@@ -2690,10 +3041,10 @@ static NSOperationQueue *sharedQueue = nil;
 
 	[self cancelLoad];
 	
-	if (proxyCredentials) {
+	if ([self proxyCredentials]) {
 		
 		// We use startRequest rather than starting all over again in load request because NTLM requires we reuse the request
-		if ((([self proxyAuthenticationScheme] != (NSString *)kCFHTTPAuthenticationSchemeNTLM) || [self proxyAuthenticationRetryCount] < 2) && [self applyProxyCredentials:proxyCredentials]) {
+		if ((([self proxyAuthenticationScheme] != (NSString *)kCFHTTPAuthenticationSchemeNTLM) || [self proxyAuthenticationRetryCount] < 2) && [self applyProxyCredentials:[self proxyCredentials]]) {
 			[self startRequest];
 			
 		// We've failed NTLM authentication twice, we should assume our credentials are wrong
@@ -2790,7 +3141,7 @@ static NSOperationQueue *sharedQueue = nil;
 	
 	// Read authentication data
 	if (!requestAuthentication) {
-		CFHTTPMessageRef responseHeader = (CFHTTPMessageRef) CFReadStreamCopyProperty((CFReadStreamRef)[self readStream],kCFStreamPropertyHTTPResponseHeader);
+		CFHTTPMessageRef responseHeader = [self copyResponseHeaderMessage];
 		requestAuthentication = CFHTTPAuthenticationCreateFromResponse(NULL, responseHeader);
 		CFRelease(responseHeader);
 		[self setAuthenticationScheme:[(NSString *)CFHTTPAuthenticationCopyMethod(requestAuthentication) autorelease]];
@@ -2822,7 +3173,7 @@ static NSOperationQueue *sharedQueue = nil;
 			[delegateAuthenticationLock lock];
 			
 			// We know the credentials we just presented are bad, we should remove them from the session store too
-			[[self class] removeAuthenticationCredentialsFromSessionStore:requestCredentials];
+			[[self class] removeAuthenticationCredentialsFromSessionStore:[self requestCredentials]];
 			[self setRequestCredentials:nil];
 			
 			// If the user cancelled authentication via a dialog presented by another request, our queue may have cancelled us
@@ -2862,9 +3213,9 @@ static NSOperationQueue *sharedQueue = nil;
 	
 	[self cancelLoad];
 	
-	if (requestCredentials) {
+	if ([self requestCredentials]) {
 		
-		if ((([self authenticationScheme] != (NSString *)kCFHTTPAuthenticationSchemeNTLM) || [self authenticationRetryCount] < 2) && [self applyCredentials:requestCredentials]) {
+		if ((([self authenticationScheme] != (NSString *)kCFHTTPAuthenticationSchemeNTLM) || [self authenticationRetryCount] < 2) && [self applyCredentials:[self requestCredentials]]) {
 			[self startRequest];
 			
 			// We've failed NTLM authentication twice, we should assume our credentials are wrong
@@ -2980,7 +3331,7 @@ static NSOperationQueue *sharedQueue = nil;
 		[[self cancelledLock] lock];
 		// Here we perform an initial check to see if either the delegate or the queue wants to be asked about the redirect, because if not we should redirect straight away
 		// We will check again on the main thread later
-		BOOL needToAskDelegateAboutRedirect = (([self delegate] && [[self delegate] respondsToSelector:[self willRedirectSelector]]) || ([self queue] && [[self queue] respondsToSelector:@selector(request:willRedirectToURL:)]));
+		BOOL needToAskDelegateAboutRedirect = [self willAskDelegateAboutRedirect];
 		[[self cancelledLock] unlock];
 
 		// Either the delegate or the queue's delegate is interested in being told when we are about to redirect
@@ -3058,6 +3409,10 @@ static NSOperationQueue *sharedQueue = nil;
 	// If zero bytes were read, wait for the EOF to come.
     } else if (bytesRead) {
 
+		if ([self isRecordingTraffic]) {
+			[[self trafficArchive] exchange:(NSMutableDictionary *)[self trafficExchange] didReceiveBytes:buffer length:(NSUInteger)bytesRead];
+		}
+
 		// If we are inflating the response on the fly
 		NSData *inflatedData = nil;
 		if ([self isResponseCompressed] && ![self shouldWaitToInflateCompressedResponses]) {
@@ -3082,13 +3437,22 @@ static NSOperationQueue *sharedQueue = nil;
 		if ([self needsRedirect] && [self shouldRedirect] && [self allowResumeForFileDownloads]) {
 			return;
 		}
+
+		// Let subclasses see the content as it arrives
+		if (![self needsRedirect]) {
+			if (inflatedData) {
+				[self didReceiveResponseBytes:[inflatedData bytes] length:[inflatedData length]];
+			} else if (![self isResponseCompressed]) {
+				[self didReceiveResponseBytes:buffer length:(NSUInteger)bytesRead];
+			}
+		}
 		
 		BOOL dataWillBeHandledExternally = NO;
 		if ([[self delegate] respondsToSelector:[self didReceiveDataSelector]]) {
 			dataWillBeHandledExternally = YES;
 		}
 		#if NS_BLOCKS_AVAILABLE
-		if (dataReceivedBlock) {
+		if (requestBlocks && requestBlocks->dataReceivedBlock) {
 			dataWillBeHandledExternally = YES;
 		}
 		#endif
@@ -3150,6 +3514,10 @@ static NSOperationQueue *sharedQueue = nil;
     }
 }
 
+- (void)didReceiveResponseBytes:(const void *)bytes length:(NSUInteger)length
+{
+}
+
 - (void)handleStreamComplete
 {	
 
@@ -3163,6 +3531,11 @@ static NSOperationQueue *sharedQueue = nil;
 		[self readResponseHeaders];
 	}
 
+	if ([self isRecordingTraffic]) {
+		[[self trafficArchive] finishRecordingExchange:(NSMutableDictionary *)[self trafficExchange] forRequest:self];
+		[self setTrafficExchange:nil];
+	}
+
 	[progressLock lock];	
 	// Find out how much data we've uploaded so far
 	[self setLastBytesSent:totalBytesSent];	
@@ -3562,54 +3935,56 @@ static NSOperationQueue *sharedQueue = nil;
 	if (![self isPACFileRequest] && (![self proxyHost] && ![self proxyPort])) {
 
 		// If not, we need to figure out what they'll be
-		NSArray *proxies = nil;
+		// Normally main will already have looked at the system settings, we only do it here if that failed, or we're being redirected
+		if (![self PACurl] && ![self detectSystemProxySettings]) {
+			[self setReadStream:nil];
+			[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIInternalErrorWhileBuildingRequestType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Unable to obtain information on proxy servers needed for request",NSLocalizedDescriptionKey,nil]]];
+			return NO;
+		}
 
 		// Have we been given a proxy auto config file?
+		// If yes, we'll need to fetch the PAC file asynchronously, so we stop this request to wait until we have the proxy details.
 		if ([self PACurl]) {
-
-			// If yes, we'll need to fetch the PAC file asynchronously, so we stop this request to wait until we have the proxy details.
 			[self fetchPACFile];
 			return NO;
+		}
+	}
+	return YES;
+}
 
-			// Detect proxy settings and apply them
-		} else {
-
+// Looks up the proxy to use for our url in the system settings, setting proxyHost, proxyPort and proxyType, or PACurl if the settings point to a PAC file
+// Returns NO if we couldn't get the settings
+- (BOOL)detectSystemProxySettings
+{
 #if TARGET_OS_IPHONE
-			NSDictionary *proxySettings = NSMakeCollectable([(NSDictionary *)CFNetworkCopySystemProxySettings() autorelease]);
+	NSDictionary *proxySettings = NSMakeCollectable([(NSDictionary *)CFNetworkCopySystemProxySettings() autorelease]);
 #else
-			NSDictionary *proxySettings = NSMakeCollectable([(NSDictionary *)SCDynamicStoreCopyProxies(NULL) autorelease]);
+	NSDictionary *proxySettings = NSMakeCollectable([(NSDictionary *)SCDynamicStoreCopyProxies(NULL) autorelease]);
 #endif
 
-			proxies = NSMakeCollectable([(NSArray *)CFNetworkCopyProxiesForURL((CFURLRef)[self url], (CFDictionaryRef)proxySettings) autorelease]);
+	NSArray *proxies = NSMakeCollectable([(NSArray *)CFNetworkCopyProxiesForURL((CFURLRef)[self url], (CFDictionaryRef)proxySettings) autorelease]);
+	if (!proxies) {
+		return NO;
+	}
+	if ([proxies count] > 0) {
 
-			// Now check to see if the proxy settings contained a PAC url, we need to run the script to get the real list of proxies if so
-			NSDictionary *settings = [proxies objectAtIndex:0];
-			if ([settings objectForKey:(NSString *)kCFProxyAutoConfigurationURLKey]) {
-				[self setPACurl:[settings objectForKey:(NSString *)kCFProxyAutoConfigurationURLKey]];
-				[self fetchPACFile];
-				return NO;
-			}
+		// Now check to see if the proxy settings contained a PAC url, we need to run the script to get the real list of proxies if so
+		NSDictionary *settings = [proxies objectAtIndex:0];
+		if ([settings objectForKey:(NSString *)kCFProxyAutoConfigurationURLKey]) {
+			[self setPACurl:[settings objectForKey:(NSString *)kCFProxyAutoConfigurationURLKey]];
+			return YES;
 		}
 
-		if (!proxies) {
-			[self setReadStream:nil];
-			[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIInternalErrorWhileBuildingRequestType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Unable to obtain information on proxy servers needed for request",NSLocalizedDescriptionKey,nil]]];
-			return NO;
-		}
 		// I don't really understand why the dictionary returned by CFNetworkCopyProxiesForURL uses different key names from CFNetworkCopySystemProxySettings/SCDynamicStoreCopyProxies
 		// and why its key names are documented while those we actually need to use don't seem to be (passing the kCF* keys doesn't seem to work)
-		if ([proxies count] > 0) {
-			NSDictionary *settings = [proxies objectAtIndex:0];
-			[self setProxyHost:[settings objectForKey:(NSString *)kCFProxyHostNameKey]];
-			[self setProxyPort:[[settings objectForKey:(NSString *)kCFProxyPortNumberKey] intValue]];
-			[self setProxyType:[settings objectForKey:(NSString *)kCFProxyTypeKey]];
-		}
+		[self setProxyHost:[settings objectForKey:(NSString *)kCFProxyHostNameKey]];
+		[self setProxyPort:[[settings objectForKey:(NSString *)kCFProxyPortNumberKey] intValue]];
+		[self setProxyType:[settings objectForKey:(NSString *)kCFProxyTypeKey]];
 	}
 	return YES;
 }
 
 
-
 // Attempts to download a PAC (Proxy Auto-Configuration) file
 // PAC files at file://, http:// and https:// addresses are supported
 - (void)fetchPACFile
@@ -3801,6 +4176,8 @@ static NSOperationQueue *sharedQueue = nil;
 	[newRequest setPostBody:[self postBody]];
 	[newRequest setShouldStreamPostDataFromDisk:[self shouldStreamPostDataFromDisk]];
 	[newRequest setPostBodyFilePath:[self postBodyFilePath]];
+	[newRequest setPostBodyFileOffset:[self postBodyFileOffset]];
+	[newRequest setPostBodyFileLength:[self postBodyFileLength]];
 	[newRequest setRequestHeaders:[[[self requestHeaders] mutableCopyWithZone:zone] autorelease]];
 	[newRequest setRequestCookies:[[[self requestCookies] mutableCopyWithZone:zone] autorelease]];
 	[newRequest setUseCookiePersistence:[self useCookiePersistence]];
@@ -3845,9 +4222,72 @@ static NSOperationQueue *sharedQueue = nil;
 	[newRequest setShouldUseRFC2616RedirectBehaviour:[self shouldUseRFC2616RedirectBehaviour]];
 	[newRequest setShouldAttemptPersistentConnection:[self shouldAttemptPersistentConnection]];
 	[newRequest setPersistentConnectionTimeoutSeconds:[self persistentConnectionTimeoutSeconds]];
+	[newRequest setTrafficArchive:[self trafficArchive]];
+	[newRequest setPermanentRedirectCache:[self permanentRedirectCache]];
 	return newRequest;
 }
 
+- (void)copySettingsFromRequest:(ASIHTTPRequest *)otherRequest
+{
+	// Plain values are copied directly, this is called once for every request created from a template
+	delegate = otherRequest->delegate;
+	uploadProgressDelegate = otherRequest->uploadProgressDelegate;
+	downloadProgressDelegate = otherRequest->downloadProgressDelegate;
+	didStartSelector = otherRequest->didStartSelector;
+	didReceiveResponseHeadersSelector = otherRequest->didReceiveResponseHeadersSelector;
+	willRedirectSelector = otherRequest->willRedirectSelector;
+	didFinishSelector = otherRequest->didFinishSelector;
+	didFailSelector = otherRequest->didFailSelector;
+	didReceiveDataSelector = otherRequest->didReceiveDataSelector;
+	useKeychainPersistence = otherRequest->useKeychainPersistence;
+	useSessionPersistence = otherRequest->useSessionPersistence;
+	useCookiePersistence = otherRequest->useCookiePersistence;
+	allowCompressedResponse = otherRequest->allowCompressedResponse;
+	shouldWaitToInflateCompressedResponses = otherRequest->shouldWaitToInflateCompressedResponses;
+	shouldCompressRequestBody = otherRequest->shouldCompressRequestBody;
+	allowResumeForFileDownloads = otherRequest->allowResumeForFileDownloads;
+	shouldPresentAuthenticationDialog = otherRequest->shouldPresentAuthenticationDialog;
+	shouldPresentProxyAuthenticationDialog = otherRequest->shouldPresentProxyAuthenticationDialog;
+	shouldPresentCredentialsBeforeChallenge = otherRequest->shouldPresentCredentialsBeforeChallenge;
+	timeOutSeconds = otherRequest->timeOutSeconds;
+	shouldResetDownloadProgress = otherRequest->shouldResetDownloadProgress;
+	shouldResetUploadProgress = otherRequest->shouldResetUploadProgress;
+	showAccurateProgress = otherRequest->showAccurateProgress;
+	defaultResponseEncoding = otherRequest->defaultResponseEncoding;
+	useHTTPVersionOne = otherRequest->useHTTPVersionOne;
+	shouldRedirect = otherRequest->shouldRedirect;
+	shouldUseRFC2616RedirectBehaviour = otherRequest->shouldUseRFC2616RedirectBehaviour;
+	validatesSecureCertificate = otherRequest->validatesSecureCertificate;
+	numberOfTimesToRetryOnTimeout = otherRequest->numberOfTimesToRetryOnTimeout;
+	shouldAttemptPersistentConnection = otherRequest->shouldAttemptPersistentConnection;
+	persistentConnectionTimeoutSeconds = otherRequest->persistentConnectionTimeoutSeconds;
+	cachePolicy = otherRequest->cachePolicy;
+	cacheStoragePolicy = otherRequest->cacheStoragePolicy;
+	secondsToCache = otherRequest->secondsToCache;
+	#if TARGET_OS_IPHONE && __IPHONE_OS_VERSION_MAX_ALLOWED >= __IPHONE_4_0
+	shouldContinueWhenAppEntersBackground = otherRequest->shouldContinueWhenAppEntersBackground;
+	#endif
+
+	[self setRequestMethod:[otherRequest requestMethod]];
+	[self setUsername:[otherRequest username]];
+	[self setPassword:[otherRequest password]];
+	[self setDomain:[otherRequest domain]];
+	[self setAuthenticationScheme:[otherRequest authenticationScheme]];
+	[self setProxyUsername:[otherRequest proxyUsername]];
+	[self setProxyPassword:[otherRequest proxyPassword]];
+	[self setProxyDomain:[otherRequest proxyDomain]];
+	[self setProxyAuthenticationScheme:[otherRequest proxyAuthenticationScheme]];
+	[self setProxyHost:[otherRequest proxyHost]];
+	[self setProxyPort:[otherRequest proxyPort]];
+	[self setProxyType:[otherRequest proxyType]];
+	[self setPACurl:[otherRequest PACurl]];
+	[self setClientCertificateIdentity:otherRequest->clientCertificateIdentity];
+	[self setClientCertificates:[otherRequest clientCertificates]];
+	[self setDownloadCache:[otherRequest downloadCache]];
+	[self setTrafficArchive:[otherRequest trafficArchive]];
+	[self setPermanentRedirectCache:[otherRequest permanentRedirectCache]];
+}
+
 #pragma mark default time out
 
 + (NSTimeInterval)defaultTimeOutSeconds
@@ -4400,6 +4840,52 @@ static NSOperationQueue *sharedQueue = nil;
 	return defaultCache;
 }
 
+#pragma mark traffic recording and replay
+
++ (void)setDefaultTrafficArchive:(ASITrafficArchive *)archive
+{
+	[defaultTrafficArchive release];
+	defaultTrafficArchive = [archive retain];
+}
+
++ (ASITrafficArchive *)defaultTrafficArchive
+{
+	return defaultTrafficArchive;
+}
+
+#pragma mark permanent redirects
+
++ (void)setDefaultPermanentRedirectCache:(ASIPermanentRedirectCache *)cache
+{
+	[defaultPermanentRedirectCache release];
+	defaultPermanentRedirectCache = [cache retain];
+}
+
++ (ASIPermanentRedirectCache *)defaultPermanentRedirectCache
+{
+	return defaultPermanentRedirectCache;
+}
+
+- (BOOL)isRecordingTraffic
+{
+	return ([self trafficExchange] && [[self trafficArchive] mode] == ASITrafficArchiveRecordMode);
+}
+
+- (BOOL)isReplayingTraffic
+{
+	return ([self trafficExchange] && [[self trafficArchive] mode] == ASITrafficArchiveReplayMode);
+}
+
+// Returns the response headers for the current stream, or the recorded headers if we are replaying
+// The caller must release the returned message
+- (CFHTTPMessageRef)copyResponseHeaderMessage
+{
+	if ([self isReplayingTraffic]) {
+		return [ASITrafficArchive newResponseMessageForExchange:[self trafficExchange]];
+	}
+	return (CFHTTPMessageRef)CFReadStreamCopyProperty((CFReadStreamRef)[self readStream], kCFStreamPropertyHTTPResponseHeader);
+}
+
 
 #pragma mark network activity
 
@@ -4582,84 +5068,56 @@ static NSOperationQueue *sharedQueue = nil;
 #pragma mark -
 #pragma mark blocks
 #if NS_BLOCKS_AVAILABLE
-- (void)setStartedBlock:(ASIBasicBlock)aStartedBlock
-{
-	[startedBlock release];
-	startedBlock = [aStartedBlock copy];
-}
-
-- (void)setHeadersReceivedBlock:(ASIHeadersBlock)aReceivedBlock
-{
-	[headersReceivedBlock release];
-	headersReceivedBlock = [aReceivedBlock copy];
-}
-
-- (void)setCompletionBlock:(ASIBasicBlock)aCompletionBlock
-{
-	[completionBlock release];
-	completionBlock = [aCompletionBlock copy];
-}
-
-- (void)setFailedBlock:(ASIBasicBlock)aFailedBlock
-{
-	[failureBlock release];
-	failureBlock = [aFailedBlock copy];
-}
-
-- (void)setBytesReceivedBlock:(ASIProgressBlock)aBytesReceivedBlock
-{
-	[bytesReceivedBlock release];
-	bytesReceivedBlock = [aBytesReceivedBlock copy];
-}
-
-- (void)setBytesSentBlock:(ASIProgressBlock)aBytesSentBlock
-{
-	[bytesSentBlock release];
-	bytesSentBlock = [aBytesSentBlock copy];
-}
-
-- (void)setDownloadSizeIncrementedBlock:(ASISizeBlock)aDownloadSizeIncrementedBlock{
-	[downloadSizeIncrementedBlock release];
-	downloadSizeIncrementedBlock = [aDownloadSizeIncrementedBlock copy];
-}
-
-- (void)setUploadSizeIncrementedBlock:(ASISizeBlock)anUploadSizeIncrementedBlock
-{
-	[uploadSizeIncrementedBlock release];
-	uploadSizeIncrementedBlock = [anUploadSizeIncrementedBlock copy];
-}
-
-- (void)setDataReceivedBlock:(ASIDataBlock)aReceivedBlock
-{
-	[dataReceivedBlock release];
-	dataReceivedBlock = [aReceivedBlock copy];
-}
-
-- (void)setAuthenticationNeededBlock:(ASIBasicBlock)anAuthenticationBlock
-{
-	[authenticationNeededBlock release];
-	authenticationNeededBlock = [anAuthenticationBlock copy];
-}
-- (void)setProxyAuthenticationNeededBlock:(ASIBasicBlock)aProxyAuthenticationBlock
-{
-	[proxyAuthenticationNeededBlock release];
-	proxyAuthenticationNeededBlock = [aProxyAuthenticationBlock copy];
-}
-- (void)setRequestRedirectedBlock:(ASIBasicBlock)aRedirectBlock
-{
-	[requestRedirectedBlock release];
-	requestRedirectedBlock = [aRedirectBlock copy];
-}
+ASI_DETAILS_BLOCK_SETTER(ASIBasicBlock, startedBlock, setStartedBlock)
+ASI_DETAILS_BLOCK_SETTER(ASIHeadersBlock, headersReceivedBlock, setHeadersReceivedBlock)
+ASI_DETAILS_BLOCK_SETTER(ASIBasicBlock, completionBlock, setCompletionBlock)
+ASI_DETAILS_BLOCK_SETTER(ASIBasicBlock, failureBlock, setFailedBlock)
+ASI_DETAILS_BLOCK_SETTER(ASIProgressBlock, bytesReceivedBlock, setBytesReceivedBlock)
+ASI_DETAILS_BLOCK_SETTER(ASIProgressBlock, bytesSentBlock, setBytesSentBlock)
+ASI_DETAILS_BLOCK_SETTER(ASISizeBlock, downloadSizeIncrementedBlock, setDownloadSizeIncrementedBlock)
+ASI_DETAILS_BLOCK_SETTER(ASISizeBlock, uploadSizeIncrementedBlock, setUploadSizeIncrementedBlock)
+ASI_DETAILS_BLOCK_SETTER(ASIDataBlock, dataReceivedBlock, setDataReceivedBlock)
+ASI_DETAILS_BLOCK_SETTER(ASIBasicBlock, authenticationNeededBlock, setAuthenticationNeededBlock)
+ASI_DETAILS_BLOCK_SETTER(ASIBasicBlock, proxyAuthenticationNeededBlock, setProxyAuthenticationNeededBlock)
+ASI_DETAILS_BLOCK_SETTER(ASIBasicBlock, requestRedirectedBlock, setRequestRedirectedBlock)
 #endif
 
+#pragma mark cold state accessors
+
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, username, setUsername)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, password, setPassword)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, domain, setDomain)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, proxyUsername, setProxyUsername)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, proxyPassword, setProxyPassword)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, proxyDomain, setProxyDomain)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSDictionary *, requestCredentials, setRequestCredentials)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, authenticationScheme, setAuthenticationScheme)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, authenticationRealm, setAuthenticationRealm)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSDictionary *, proxyCredentials, setProxyCredentials)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, proxyAuthenticationScheme, setProxyAuthenticationScheme)
+ASI_DETAILS_OBJECT_ACCESSORS(authenticationDetails, NSString *, proxyAuthenticationRealm, setProxyAuthenticationRealm)
+ASI_DETAILS_SCALAR_ACCESSORS(authenticationDetails, int, authenticationRetryCount, setAuthenticationRetryCount)
+ASI_DETAILS_SCALAR_ACCESSORS(authenticationDetails, int, proxyAuthenticationRetryCount, setProxyAuthenticationRetryCount)
+
+ASI_DETAILS_OBJECT_ACCESSORS(proxyDetails, NSString *, proxyHost, setProxyHost)
+ASI_DETAILS_SCALAR_ACCESSORS(proxyDetails, int, proxyPort, setProxyPort)
+ASI_DETAILS_OBJECT_ACCESSORS(proxyDetails, NSString *, proxyType, setProxyType)
+ASI_DETAILS_OBJECT_ACCESSORS(proxyDetails, NSURL *, PACurl, setPACurl)
+ASI_DETAILS_OBJECT_ACCESSORS(proxyDetails, ASIHTTPRequest *, PACFileRequest, setPACFileRequest)
+ASI_DETAILS_OBJECT_ACCESSORS(proxyDetails, NSInputStream *, PACFileReadStream, setPACFileReadStream)
+ASI_DETAILS_OBJECT_ACCESSORS(proxyDetails, NSMutableData *, PACFileData, setPACFileData)
+
+ASI_DETAILS_OBJECT_ACCESSORS(uploadDetails, NSMutableData *, postBody, setPostBody)
+ASI_DETAILS_OBJECT_ACCESSORS(uploadDetails, NSData *, compressedPostBody, setCompressedPostBody)
+ASI_DETAILS_OBJECT_ACCESSORS(uploadDetails, NSString *, postBodyFilePath, setPostBodyFilePath)
+ASI_DETAILS_SCALAR_ACCESSORS(uploadDetails, unsigned long long, postBodyFileOffset, setPostBodyFileOffset)
+ASI_DETAILS_SCALAR_ACCESSORS(uploadDetails, unsigned long long, postBodyFileLength, setPostBodyFileLength)
+ASI_DETAILS_OBJECT_ACCESSORS(uploadDetails, NSString *, compressedPostBodyFilePath, setCompressedPostBodyFilePath)
+ASI_DETAILS_OBJECT_ACCESSORS(uploadDetails, NSOutputStream *, postBodyWriteStream, setPostBodyWriteStream)
+ASI_DETAILS_OBJECT_ACCESSORS(uploadDetails, NSInputStream *, postBodyReadStream, setPostBodyReadStream)
+
 #pragma mark ===
 
-@synthesize username;
-@synthesize password;
-@synthesize domain;
-@synthesize proxyUsername;
-@synthesize proxyPassword;
-@synthesize proxyDomain;
 @synthesize url;
 @synthesize originalURL;
 @synthesize delegate;
@@ -4678,22 +5136,16 @@ static NSOperationQueue *sharedQueue = nil;
 @synthesize didFinishSelector;
 @synthesize didFailSelector;
 @synthesize didReceiveDataSelector;
-@synthesize authenticationRealm;
-@synthesize proxyAuthenticationRealm;
 @synthesize error;
-@synthesize complete;
 @synthesize requestHeaders;
 @synthesize responseHeaders;
 @synthesize responseCookies;
 @synthesize requestCookies;
-@synthesize requestCredentials;
 @synthesize responseStatusCode;
 @synthesize rawResponseData;
 @synthesize lastActivityTime;
 @synthesize timeOutSeconds;
 @synthesize requestMethod;
-@synthesize postBody;
-@synthesize compressedPostBody;
 @synthesize contentLength;
 @synthesize partialDownloadSize;
 @synthesize postLength;
@@ -4709,10 +5161,6 @@ static NSOperationQueue *sharedQueue = nil;
 @synthesize allowCompressedResponse;
 @synthesize allowResumeForFileDownloads;
 @synthesize userInfo;
-@synthesize postBodyFilePath;
-@synthesize compressedPostBodyFilePath;
-@synthesize postBodyWriteStream;
-@synthesize postBodyReadStream;
 @synthesize shouldStreamPostDataFromDisk;
 @synthesize didCreateTemporaryPostDataFile;
 @synthesize useHTTPVersionOne;
@@ -4722,21 +5170,12 @@ static NSOperationQueue *sharedQueue = nil;
 @synthesize haveBuiltPostBody;
 @synthesize fileDownloadOutputStream;
 @synthesize inflatedFileDownloadOutputStream;
-@synthesize authenticationRetryCount;
-@synthesize proxyAuthenticationRetryCount;
 @synthesize updatedProgress;
 @synthesize shouldRedirect;
 @synthesize validatesSecureCertificate;
 @synthesize needsRedirect;
 @synthesize redirectCount;
 @synthesize shouldCompressRequestBody;
-@synthesize proxyCredentials;
-@synthesize proxyHost;
-@synthesize proxyPort;
-@synthesize proxyType;
-@synthesize PACurl;
-@synthesize authenticationScheme;
-@synthesize proxyAuthenticationScheme;
 @synthesize shouldPresentAuthenticationDialog;
 @synthesize shouldPresentProxyAuthenticationDialog;
 @synthesize authenticationNeeded;
@@ -4769,11 +5208,11 @@ static NSOperationQueue *sharedQueue = nil;
 #endif
 @synthesize dataDecompressor;
 @synthesize shouldWaitToInflateCompressedResponses;
+@synthesize trafficArchive;
+@synthesize trafficExchange;
+@synthesize permanentRedirectCache;
 
 @synthesize isPACFileRequest;
-@synthesize PACFileRequest;
-@synthesize PACFileReadStream;
-@synthesize PACFileData;
 
 @synthesize isSynchronous;
 @end
@@ -17,8 +17,16 @@
 @interface ASIInputStream : NSObject {
 	NSInputStream *stream;
 	ASIHTTPRequest *request;
+
+	// When reading part of a file, where the part starts and how much of it is left to read
+	unsigned long long fileOffset;
+	unsigned long long bytesRemaining;
+	BOOL hasLengthLimit;
 }
 + (id)inputStreamWithFileAtPath:(NSString *)path request:(ASIHTTPRequest *)request;
+
+// Reads only length bytes of the file, starting at offset
++ (id)inputStreamWithFileAtPath:(NSString *)path offset:(unsigned long long)offset length:(unsigned long long)length request:(ASIHTTPRequest *)request;
 + (id)inputStreamWithData:(NSData *)data request:(ASIHTTPRequest *)request;
 
 @property (retain, nonatomic) NSInputStream *stream;
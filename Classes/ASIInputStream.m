@@ -29,6 +29,15 @@ static NSLock *readLock = nil;
 	return theStream;
 }
 
++ (id)inputStreamWithFileAtPath:(NSString *)path offset:(unsigned long long)offset length:(unsigned long long)length request:(ASIHTTPRequest *)theRequest
+{
+	ASIInputStream *theStream = [self inputStreamWithFileAtPath:path request:theRequest];
+	theStream->fileOffset = offset;
+	theStream->bytesRemaining = length;
+	theStream->hasLengthLimit = YES;
+	return theStream;
+}
+
 + (id)inputStreamWithData:(NSData *)data request:(ASIHTTPRequest *)theRequest
 {
 	ASIInputStream *theStream = [[[self alloc] init] autorelease];
@@ -58,9 +67,31 @@ static NSLock *readLock = nil;
 		}
 		[request performThrottling];
 	}
+	if (hasLengthLimit) {
+		if (bytesRemaining == 0) {
+			[readLock unlock];
+			return 0;
+		}
+		if (toRead > bytesRemaining) {
+			toRead = (unsigned long)bytesRemaining;
+		}
+	}
 	[ASIHTTPRequest incrementBandwidthUsedInLastSecond:toRead];
 	[readLock unlock];
-	return [stream read:buffer maxLength:toRead];
+	NSInteger bytesRead = [stream read:buffer maxLength:toRead];
+	if (hasLengthLimit && bytesRead > 0) {
+		bytesRemaining -= (unsigned long long)bytesRead;
+	}
+	return bytesRead;
+}
+
+// When we're reading part of a file, we stop reporting data as soon as we've read the whole part
+- (BOOL)hasBytesAvailable
+{
+	if (hasLengthLimit && bytesRemaining == 0) {
+		return NO;
+	}
+	return [stream hasBytesAvailable];
 }
 
 /*
@@ -71,6 +102,9 @@ static NSLock *readLock = nil;
 - (void)open
 {
     [stream open];
+	if (fileOffset) {
+		[stream setProperty:[NSNumber numberWithUnsignedLongLong:fileOffset] forKey:NSStreamFileCurrentOffsetKey];
+	}
 }
 
 - (void)close
@@ -110,6 +144,9 @@ static NSLock *readLock = nil;
 
 - (NSStreamStatus)streamStatus
 {
+	if (hasLengthLimit && bytesRemaining == 0 && [stream streamStatus] == NSStreamStatusOpen) {
+		return NSStreamStatusAtEnd;
+	}
     return [stream streamStatus];
 }
 
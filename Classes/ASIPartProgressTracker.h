@@ -0,0 +1,30 @@
+//
+//  ASIPartProgressTracker.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Used by requests that send a transfer in parts, each part using its own request that may be retried
+//  (ASIS3MultipartUploadRequest, ASIS3ParallelDownloadRequest and ASICloudFilesLargeObjectUploadRequest)
+//  Keeps a running total of the progress reported by the current attempt at each part,
+//  so when a part is retried the progress of the failed attempt can be taken back, and anything the failed attempt reports later is ignored
+
+#import <Foundation/Foundation.h>
+
+@interface ASIPartProgressTracker : NSObject {
+
+	// Maps each part number to [attempt, bytes transferred, change to the transfer size] for the current attempt at that part
+	NSMutableDictionary *progress;
+}
+
++ (id)trackerWithCapacity:(NSUInteger)numberOfParts;
+
+// Adds progress reported by a request for attempt at part
+// Returns NO for progress from an earlier attempt that has already been taken back, which should not be passed on
+- (BOOL)recordBytes:(long long)bytes sizeChange:(long long)sizeChange forPart:(NSNumber *)part attempt:(int)attempt;
+
+// Call before starting attempt at part
+// Sets bytes and sizeChange to the amounts that will take back the progress reported by the previous attempt (or 0 if it didn't report any)
+- (void)startAttempt:(int)attempt forPart:(NSNumber *)part bytesToTakeBack:(long long *)bytes sizeChangeToTakeBack:(long long *)sizeChange;
+@end
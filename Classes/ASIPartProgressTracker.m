@@ -0,0 +1,53 @@
+//
+//  ASIPartProgressTracker.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIPartProgressTracker.h"
+
+@interface ASIPartProgressTracker ()
+@property (retain, nonatomic) NSMutableDictionary *progress;
+@end
+
+@implementation ASIPartProgressTracker
+
++ (id)trackerWithCapacity:(NSUInteger)numberOfParts
+{
+	ASIPartProgressTracker *tracker = [[[self alloc] init] autorelease];
+	[tracker setProgress:[NSMutableDictionary dictionaryWithCapacity:numberOfParts]];
+	return tracker;
+}
+
+- (void)dealloc
+{
+	[progress release];
+	[super dealloc];
+}
+
+- (BOOL)recordBytes:(long long)bytes sizeChange:(long long)sizeChange forPart:(NSNumber *)part attempt:(int)attempt
+{
+	NSArray *reported = [[self progress] objectForKey:part];
+	if (reported) {
+		if ([[reported objectAtIndex:0] intValue] != attempt) {
+			return NO;
+		}
+		bytes += [[reported objectAtIndex:1] longLongValue];
+		sizeChange += [[reported objectAtIndex:2] longLongValue];
+	}
+	[[self progress] setObject:[NSArray arrayWithObjects:[NSNumber numberWithInt:attempt],[NSNumber numberWithLongLong:bytes],[NSNumber numberWithLongLong:sizeChange],nil] forKey:part];
+	return YES;
+}
+
+- (void)startAttempt:(int)attempt forPart:(NSNumber *)part bytesToTakeBack:(long long *)bytes sizeChangeToTakeBack:(long long *)sizeChange
+{
+	NSArray *reported = [[self progress] objectForKey:part];
+	*bytes = -[[reported objectAtIndex:1] longLongValue];
+	*sizeChange = -[[reported objectAtIndex:2] longLongValue];
+	[[self progress] setObject:[NSArray arrayWithObjects:[NSNumber numberWithInt:attempt],[NSNumber numberWithLongLong:0],[NSNumber numberWithLongLong:0],nil] forKey:part];
+}
+
+@synthesize progress;
+@end
@@ -0,0 +1,91 @@
+//
+//  ASIPermanentRedirectCache.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  An ASIPermanentRedirectCache remembers where permanent redirects (301 and 308 responses) took requests
+//  Requests using the cache go straight to the url they were redirected to last time, rather than asking the original server again every time
+//  If the destination was itself permanently redirected, requests follow the chain (up to the redirection limit) before they start
+//  Redirects are only skipped for requests that would follow them without asking anyone - requests with shouldRedirect set to NO, or whose delegate or queue implements request:willRedirectToURL:, always go to the original url
+//  Redirects are remembered when a request follows them, so a redirect a delegate changed or cancelled isn't stored
+//
+//  Redirects are kept until the time given by a max-age in the Cache-Control header, or the Expires header, of the redirect response
+//  If the response has neither, redirects are kept for defaultMaxAge seconds. Responses with Cache-Control: no-store or no-cache are not remembered
+//  Only the most recently used maxEntries redirects are kept
+//
+//  301 redirects are only reused for GET and HEAD requests, because by default other requests are redirected as GETs, and a skipped redirect couldn't do that
+//  308 redirects are reused for all requests, as they keep their method and body
+//
+//  If you create a cache with a storage path, redirects are written to a property list there whenever they change, and read back when the cache is created
+//  Writes happen in the background, so requests never wait for the disk. Several changes in quick succession are saved with a single write
+//
+//  ASIPermanentRedirectCache *cache = [ASIPermanentRedirectCache cacheWithStoragePath:@"/path/to/redirects.plist"];
+//  [ASIHTTPRequest setDefaultPermanentRedirectCache:cache];
+
+#import <Foundation/Foundation.h>
+
+@class ASIHTTPRequest;
+
+@interface ASIPermanentRedirectCache : NSObject {
+
+	// The property list redirects are saved to, or nil to keep them in memory only
+	NSString *storagePath;
+
+	// The maximum number of redirects to keep. Defaults to 100
+	NSUInteger maxEntries;
+
+	// How long to keep redirects whose responses don't say how long they can be cached for, in seconds. Defaults to one day
+	NSTimeInterval defaultMaxAge;
+
+	// Maps the absolute string of a redirected url to a dictionary with the destination url, the status code and the expiry date
+	NSMutableDictionary *redirects;
+
+	// Keys from redirects, least recently used first
+	NSMutableArray *keysByLastUse;
+
+	// Number of lookups that found a redirect, and the number that didn't
+	NSUInteger hitCount;
+	NSUInteger missCount;
+
+	// Mediates access to the cache
+	NSRecursiveLock *accessLock;
+
+	// Writes the redirects to storagePath, one save at a time
+	NSOperationQueue *saveQueue;
+
+	// A copy of the redirects waiting to be written by saveQueue, or nil if there aren't any changes to save
+	NSArray *unsavedRedirects;
+}
+
+// Create a cache that only keeps redirects in memory
++ (id)cache;
+
+// Create a cache that saves redirects to the property list at path (which will be loaded immediately if it exists)
++ (id)cacheWithStoragePath:(NSString *)path;
+- (id)initWithStoragePath:(NSString *)path;
+
+// Called by a request before it starts
+// Returns the url the request should go to instead of theURL, or nil if we don't know of a usable permanent redirect for it
+- (NSURL *)destinationURLForURL:(NSURL *)theURL requestMethod:(NSString *)requestMethod;
+
+// Called by a request when it receives a 301 or 308 response, to remember the redirect to newURL
+- (void)storeRedirectForRequest:(ASIHTTPRequest *)request toURL:(NSURL *)newURL;
+
+// Forget a redirect, or all of them
+- (void)removeRedirectForURL:(NSURL *)theURL;
+- (void)removeAllRedirects;
+
+// Returns the number of redirects currently stored (including any that have expired but haven't been looked up since)
+- (NSUInteger)redirectCount;
+
+// Blocks until any changes have been written to storagePath
+- (void)waitUntilSaved;
+
+@property (retain, readonly) NSString *storagePath;
+@property (assign) NSUInteger maxEntries;
+@property (assign) NSTimeInterval defaultMaxAge;
+@property (assign, readonly) NSUInteger hitCount;
+@property (assign, readonly) NSUInteger missCount;
+@end
@@ -0,0 +1,299 @@
+//
+//  ASIPermanentRedirectCache.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIPermanentRedirectCache.h"
+#import "ASIHTTPRequest.h"
+
+// Keys used in redirect dictionaries (these are also written to disk)
+static NSString *ASIRedirectURLKey = @"URL";
+static NSString *ASIRedirectDestinationURLKey = @"DestinationURL";
+static NSString *ASIRedirectStatusCodeKey = @"StatusCode";
+static NSString *ASIRedirectExpiryDateKey = @"ExpiryDate";
+
+// The most redirects we'll follow for a single lookup, this matches the limit ASIHTTPRequest uses for live redirects
+static const NSUInteger ASIMaximumRedirectChainLength = 5;
+
+@interface ASIPermanentRedirectCache ()
+- (void)loadRedirects;
+- (void)saveRedirects;
+- (void)writeUnsavedRedirects;
+- (void)removeRedirectForKey:(NSString *)key;
++ (NSDate *)expiryDateForRequest:(ASIHTTPRequest *)request maxAge:(NSTimeInterval)maxAge;
+@property (retain) NSString *storagePath;
+@property (retain) NSMutableDictionary *redirects;
+@property (retain) NSMutableArray *keysByLastUse;
+@property (retain) NSRecursiveLock *accessLock;
+@property (retain) NSOperationQueue *saveQueue;
+@property (retain) NSArray *unsavedRedirects;
+@end
+
+@implementation ASIPermanentRedirectCache
+
++ (id)cache
+{
+	return [[[self alloc] initWithStoragePath:nil] autorelease];
+}
+
++ (id)cacheWithStoragePath:(NSString *)path
+{
+	return [[[self alloc] initWithStoragePath:path] autorelease];
+}
+
+- (id)init
+{
+	return [self initWithStoragePath:nil];
+}
+
+- (id)initWithStoragePath:(NSString *)path
+{
+	self = [super init];
+	[self setStoragePath:path];
+	[self setMaxEntries:100];
+	[self setDefaultMaxAge:60*60*24];
+	[self setRedirects:[NSMutableDictionary dictionary]];
+	[self setKeysByLastUse:[NSMutableArray array]];
+	[self setAccessLock:[[[NSRecursiveLock alloc] init] autorelease]];
+	if (path) {
+		[self setSaveQueue:[[[NSOperationQueue alloc] init] autorelease]];
+		[[self saveQueue] setMaxConcurrentOperationCount:1];
+		[self loadRedirects];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[storagePath release];
+	[redirects release];
+	[keysByLastUse release];
+	[accessLock release];
+	[saveQueue release];
+	[unsavedRedirects release];
+	[super dealloc];
+}
+
+#pragma mark looking up redirects
+
+- (NSURL *)destinationURLForURL:(NSURL *)theURL requestMethod:(NSString *)requestMethod
+{
+	BOOL canReuseMovedPermanently = ([requestMethod isEqualToString:@"GET"] || [requestMethod isEqualToString:@"HEAD"]);
+
+	[[self accessLock] lock];
+	NSURL *destinationURL = nil;
+	NSMutableSet *visitedKeys = [NSMutableSet set];
+	NSString *key = [theURL absoluteString];
+	while ([visitedKeys count] < ASIMaximumRedirectChainLength && ![visitedKeys containsObject:key]) {
+		NSDictionary *redirect = [[self redirects] objectForKey:key];
+		if (!redirect) {
+			break;
+		}
+		if ([[redirect objectForKey:ASIRedirectExpiryDateKey] timeIntervalSinceNow] < 0) {
+			[self removeRedirectForKey:key];
+			break;
+		}
+		if ([[redirect objectForKey:ASIRedirectStatusCodeKey] intValue] == 301 && !canReuseMovedPermanently) {
+			break;
+		}
+		[visitedKeys addObject:key];
+
+		// Move this redirect to the end of the list, so it is the last to be thrown away
+		[[self keysByLastUse] removeObject:key];
+		[[self keysByLastUse] addObject:key];
+
+		destinationURL = [NSURL URLWithString:[redirect objectForKey:ASIRedirectDestinationURLKey]];
+		key = [destinationURL absoluteString];
+	}
+
+	// If the redirects we know of go round in a circle, we let the request ask the server instead
+	if ([visitedKeys containsObject:key]) {
+		destinationURL = nil;
+	}
+	if (destinationURL) {
+		hitCount++;
+	} else {
+		missCount++;
+	}
+	[[self accessLock] unlock];
+	return destinationURL;
+}
+
+#pragma mark storing redirects
+
+- (void)storeRedirectForRequest:(ASIHTTPRequest *)request toURL:(NSURL *)newURL
+{
+	int status = [request responseStatusCode];
+	NSString *key = [[request url] absoluteString];
+	if ((status != 301 && status != 308) || !key || !newURL) {
+		return;
+	}
+
+	[[self accessLock] lock];
+
+	// If the server no longer wants us to remember this redirect, we forget any earlier copy too
+	NSDate *expiryDate = [[self class] expiryDateForRequest:request maxAge:[self defaultMaxAge]];
+	if (!expiryDate || [expiryDate timeIntervalSinceNow] <= 0) {
+		if ([[self redirects] objectForKey:key]) {
+			[self removeRedirectForKey:key];
+			[self saveRedirects];
+		}
+		[[self accessLock] unlock];
+		return;
+	}
+
+	NSDictionary *redirect = [NSDictionary dictionaryWithObjectsAndKeys:key,ASIRedirectURLKey,[newURL absoluteString],ASIRedirectDestinationURLKey,[NSNumber numberWithInt:status],ASIRedirectStatusCodeKey,expiryDate,ASIRedirectExpiryDateKey,nil];
+	[[self redirects] setObject:redirect forKey:key];
+	[[self keysByLastUse] removeObject:key];
+	[[self keysByLastUse] addObject:key];
+
+	while ([[self keysByLastUse] count] > [self maxEntries]) {
+		[self removeRedirectForKey:[[self keysByLastUse] objectAtIndex:0]];
+	}
+	[self saveRedirects];
+	[[self accessLock] unlock];
+}
+
+// Returns the date the redirect returned to request should be forgotten, or nil if it shouldn't be remembered at all
++ (NSDate *)expiryDateForRequest:(ASIHTTPRequest *)request maxAge:(NSTimeInterval)maxAge
+{
+	NSString *cacheControl = [[[request responseHeaders] objectForKey:@"Cache-Control"] lowercaseString];
+	if (cacheControl) {
+		if ([cacheControl rangeOfString:@"no-store"].location != NSNotFound || [cacheControl rangeOfString:@"no-cache"].location != NSNotFound) {
+			return nil;
+		}
+
+		// RFC 2616 says max-age must override any Expires header
+		NSScanner *scanner = [NSScanner scannerWithString:cacheControl];
+		[scanner scanUpToString:@"max-age" intoString:NULL];
+		if ([scanner scanString:@"max-age" intoString:NULL]) {
+			[scanner scanString:@"=" intoString:NULL];
+			NSTimeInterval responseMaxAge = 0;
+			[scanner scanDouble:&responseMaxAge];
+			return [NSDate dateWithTimeIntervalSinceNow:responseMaxAge];
+		}
+	}
+	NSString *expires = [[request responseHeaders] objectForKey:@"Expires"];
+	if (expires) {
+		return [ASIHTTPRequest dateFromRFC1123String:expires];
+	}
+	return [NSDate dateWithTimeIntervalSinceNow:maxAge];
+}
+
+#pragma mark removing redirects
+
+- (void)removeRedirectForURL:(NSURL *)theURL
+{
+	[[self accessLock] lock];
+	if ([[self redirects] objectForKey:[theURL absoluteString]]) {
+		[self removeRedirectForKey:[theURL absoluteString]];
+		[self saveRedirects];
+	}
+	[[self accessLock] unlock];
+}
+
+- (void)removeAllRedirects
+{
+	[[self accessLock] lock];
+	[[self redirects] removeAllObjects];
+	[[self keysByLastUse] removeAllObjects];
+	[self saveRedirects];
+	[[self accessLock] unlock];
+}
+
+- (void)removeRedirectForKey:(NSString *)key
+{
+	[[key retain] autorelease];
+	[[self redirects] removeObjectForKey:key];
+	[[self keysByLastUse] removeObject:key];
+}
+
+- (NSUInteger)redirectCount
+{
+	[[self accessLock] lock];
+	NSUInteger count = [[self redirects] count];
+	[[self accessLock] unlock];
+	return count;
+}
+
+#pragma mark persistence
+
+// Redirects are stored as an array, least recently used first, so the order survives loading them again
+// Hits don't cause the file to be written, so after a relaunch the order is the one from the last time a redirect was stored or removed
+// Called with accessLock held. We only take a copy of the redirects here, saveQueue writes it once we've let go of the lock
+// If a save is already waiting to run, it will write this copy instead of the older one
+- (void)saveRedirects
+{
+	if (![self storagePath]) {
+		return;
+	}
+	NSMutableArray *redirectList = [NSMutableArray arrayWithCapacity:[[self keysByLastUse] count]];
+	for (NSString *key in [self keysByLastUse]) {
+		[redirectList addObject:[[self redirects] objectForKey:key]];
+	}
+	BOOL haveScheduledSave = ([self unsavedRedirects] != nil);
+	[self setUnsavedRedirects:redirectList];
+	if (!haveScheduledSave) {
+		[[self saveQueue] addOperation:[[[NSInvocationOperation alloc] initWithTarget:self selector:@selector(writeUnsavedRedirects) object:nil] autorelease]];
+	}
+}
+
+// Runs on saveQueue
+- (void)writeUnsavedRedirects
+{
+	[[self accessLock] lock];
+	NSArray *redirectList = [[[self unsavedRedirects] retain] autorelease];
+	[self setUnsavedRedirects:nil];
+	[[self accessLock] unlock];
+	[redirectList writeToFile:[self storagePath] atomically:YES];
+}
+
+- (void)waitUntilSaved
+{
+	[[self saveQueue] waitUntilAllOperationsAreFinished];
+}
+
+- (void)loadRedirects
+{
+	NSArray *redirectList = [NSArray arrayWithContentsOfFile:[self storagePath]];
+	for (NSDictionary *redirect in redirectList) {
+		NSString *key = [redirect objectForKey:ASIRedirectURLKey];
+		if (!key || ![redirect objectForKey:ASIRedirectDestinationURLKey] || [[redirect objectForKey:ASIRedirectExpiryDateKey] timeIntervalSinceNow] <= 0) {
+			continue;
+		}
+		[[self redirects] setObject:redirect forKey:key];
+		[[self keysByLastUse] removeObject:key];
+		[[self keysByLastUse] addObject:key];
+	}
+}
+
+#pragma mark counters
+
+- (NSUInteger)hitCount
+{
+	[[self accessLock] lock];
+	NSUInteger count = hitCount;
+	[[self accessLock] unlock];
+	return count;
+}
+
+- (NSUInteger)missCount
+{
+	[[self accessLock] lock];
+	NSUInteger count = missCount;
+	[[self accessLock] unlock];
+	return count;
+}
+
+@synthesize storagePath;
+@synthesize maxEntries;
+@synthesize defaultMaxAge;
+@synthesize redirects;
+@synthesize keysByLastUse;
+@synthesize accessLock;
+@synthesize saveQueue;
+@synthesize unsavedRedirects;
+@end
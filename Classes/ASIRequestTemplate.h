@@ -0,0 +1,59 @@
+//
+//  ASIRequestTemplate.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  An ASIRequestTemplate is an immutable snapshot of a configured request, used to create large numbers of requests that differ only in their url
+//  Work that would otherwise be repeated for every request is done once when the template is created:
+//  - Headers that don't depend on the url (custom headers, User-Agent and Accept-Encoding) are built up front
+//  - When the system settings give a proxy server for the template's url, it is looked up once, and reused for requests to the same scheme and host
+//  - Settings, credentials, delegates and selectors are copied straight into each new request, rather than through copyWithZone:
+//
+//  ASIHTTPRequest *prototype = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://api.example.com/v1/"]];
+//  [prototype setDelegate:self];
+//  [prototype setTimeOutSeconds:20];
+//  [prototype addRequestHeader:@"Accept" value:@"application/json"];
+//  ASIRequestTemplate *template = [ASIRequestTemplate templateWithRequest:prototype];
+//  ...
+//  ASIHTTPRequest *request = [template requestWithPath:@"items/42?fields=name"];
+//
+//  Changes made to the prototype after the template is created have no effect on the template
+//  Request bodies, cookies, blocks and userInfo are not part of the template - set them on each request as needed
+//  As with requests, the template does not retain its delegates
+
+#import <Foundation/Foundation.h>
+
+@class ASIHTTPRequest;
+
+@interface ASIRequestTemplate : NSObject {
+
+	// Private copy of the request the template was created from - never started, and never changed after the template is created
+	ASIHTTPRequest *prototype;
+
+	// The url of the request the template was created from, relative paths passed to requestWithPath: are resolved against this
+	NSURL *baseURL;
+
+	// Headers applied to every request created from this template
+	NSDictionary *requestHeaders;
+
+	// YES when the template looked up the proxy to use itself, rather than the proxy being set on the prototype
+	// Looked up proxies are only used for requests with the same scheme and host as baseURL
+	BOOL didResolveProxy;
+}
+
+// Create a template from a configured request
+// The request is not modified, and can be discarded once the template is created
++ (id)templateWithRequest:(ASIHTTPRequest *)request;
+- (id)initWithRequest:(ASIHTTPRequest *)request;
+
+// Create a new request (of the same class as the prototype) configured from the template
+- (id)requestWithURL:(NSURL *)newURL;
+
+// Create a new request for a path and optional query string, relative to baseURL
+- (id)requestWithPath:(NSString *)pathAndQuery;
+
+@property (retain, readonly) NSURL *baseURL;
+@property (retain, readonly) NSDictionary *requestHeaders;
+@end
@@ -0,0 +1,139 @@
+//
+//  ASIRequestTemplate.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIRequestTemplate.h"
+#import "ASIHTTPRequest.h"
+#if !TARGET_OS_IPHONE
+#import <SystemConfiguration/SystemConfiguration.h>
+#endif
+
+@interface ASIRequestTemplate ()
+- (void)buildRequestHeaders;
+- (void)resolveProxy;
+- (BOOL)canUseResolvedProxyForURL:(NSURL *)newURL;
+
+@property (retain, nonatomic) ASIHTTPRequest *prototype;
+@property (retain) NSURL *baseURL;
+@property (retain) NSDictionary *requestHeaders;
+@end
+
+@implementation ASIRequestTemplate
+
++ (id)templateWithRequest:(ASIHTTPRequest *)request
+{
+	return [[[self alloc] initWithRequest:request] autorelease];
+}
+
+- (id)initWithRequest:(ASIHTTPRequest *)request
+{
+	self = [super init];
+	if (!self) {
+		return nil;
+	}
+	[self setBaseURL:[request url]];
+
+	// Take our own copy of the request, so later changes to it don't affect requests created from the template
+	ASIHTTPRequest *newPrototype = [[[[request class] alloc] initWithURL:[request url]] autorelease];
+	[newPrototype copySettingsFromRequest:request];
+	[newPrototype setRequestHeaders:[[[request requestHeaders] mutableCopy] autorelease]];
+	[self setPrototype:newPrototype];
+
+	[self buildRequestHeaders];
+	[self resolveProxy];
+	return self;
+}
+
+- (void)dealloc
+{
+	[prototype release];
+	[baseURL release];
+	[requestHeaders release];
+	[super dealloc];
+}
+
+// Builds the headers ASIHTTPRequest would otherwise add in buildRequestHeaders, as long as they don't depend on the url
+// Cookies, Range and Authorization headers are still added by each request when it starts
+- (void)buildRequestHeaders
+{
+	if (![[[self prototype] requestHeaders] objectForKey:@"User-Agent"]) {
+		NSString *userAgentString = [ASIHTTPRequest defaultUserAgentString];
+		if (userAgentString) {
+			[[self prototype] addRequestHeader:@"User-Agent" value:userAgentString];
+		}
+	}
+	if ([[self prototype] allowCompressedResponse]) {
+		[[self prototype] addRequestHeader:@"Accept-Encoding" value:@"gzip"];
+	}
+	if ([[self prototype] shouldCompressRequestBody]) {
+		[[self prototype] addRequestHeader:@"Content-Encoding" value:@"gzip"];
+	}
+	[self setRequestHeaders:[NSDictionary dictionaryWithDictionary:[[self prototype] requestHeaders]]];
+}
+
+// Looks up the system proxy for baseURL, unless a proxy or PAC file was set on the prototype
+// When the system settings point to a PAC file, we leave each request to run it, as the result may depend on the url
+- (void)resolveProxy
+{
+	ASIHTTPRequest *theRequest = [self prototype];
+	if ([theRequest proxyHost] || [theRequest proxyPort] || [theRequest proxyType] || [theRequest PACurl] || ![self baseURL]) {
+		return;
+	}
+
+#if TARGET_OS_IPHONE
+	NSDictionary *proxySettings = NSMakeCollectable([(NSDictionary *)CFNetworkCopySystemProxySettings() autorelease]);
+#else
+	NSDictionary *proxySettings = NSMakeCollectable([(NSDictionary *)SCDynamicStoreCopyProxies(NULL) autorelease]);
+#endif
+	if (!proxySettings) {
+		return;
+	}
+	NSArray *proxies = NSMakeCollectable([(NSArray *)CFNetworkCopyProxiesForURL((CFURLRef)[self baseURL], (CFDictionaryRef)proxySettings) autorelease]);
+	if (![proxies count]) {
+		return;
+	}
+	NSDictionary *settings = [proxies objectAtIndex:0];
+
+	// Requests look up the system settings again whenever they have no proxy host, so there's nothing to gain from storing a direct connection
+	if ([settings objectForKey:(NSString *)kCFProxyAutoConfigurationURLKey] || ![settings objectForKey:(NSString *)kCFProxyHostNameKey]) {
+		return;
+	}
+	[theRequest setProxyHost:[settings objectForKey:(NSString *)kCFProxyHostNameKey]];
+	[theRequest setProxyPort:[[settings objectForKey:(NSString *)kCFProxyPortNumberKey] intValue]];
+	[theRequest setProxyType:[settings objectForKey:(NSString *)kCFProxyTypeKey]];
+	didResolveProxy = YES;
+}
+
+- (BOOL)canUseResolvedProxyForURL:(NSURL *)newURL
+{
+	return ([[[newURL scheme] lowercaseString] isEqualToString:[[[self baseURL] scheme] lowercaseString]] && [[[newURL host] lowercaseString] isEqualToString:[[[self baseURL] host] lowercaseString]]);
+}
+
+- (id)requestWithURL:(NSURL *)newURL
+{
+	ASIHTTPRequest *newRequest = [[[[[self prototype] class] alloc] initWithURL:newURL] autorelease];
+	[newRequest copySettingsFromRequest:[self prototype]];
+	[newRequest setRequestHeaders:[[[self requestHeaders] mutableCopy] autorelease]];
+
+	// A proxy we looked up for a different host may not be the right one, so let the request look for itself
+	if (didResolveProxy && ![self canUseResolvedProxyForURL:newURL]) {
+		[newRequest setProxyHost:nil];
+		[newRequest setProxyPort:0];
+		[newRequest setProxyType:nil];
+	}
+	return newRequest;
+}
+
+- (id)requestWithPath:(NSString *)pathAndQuery
+{
+	return [self requestWithURL:[[NSURL URLWithString:pathAndQuery relativeToURL:[self baseURL]] absoluteURL]];
+}
+
+@synthesize prototype;
+@synthesize baseURL;
+@synthesize requestHeaders;
+@end
@@ -0,0 +1,102 @@
+//
+//  ASITrafficArchive.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  An ASITrafficArchive records the responses to requests (status line, headers, raw body and the time each chunk arrived) to a folder on disk
+//  In replay mode, requests using the archive never touch the network - the recorded response is fed back through the request's read stream,
+//  so headers are parsed, data is inflated, cached and passed on to delegates exactly as they would be for a live response
+//  This is mainly useful for profiling and load testing ASIHTTPRequest itself, without the network getting in the way
+//
+//  To record:
+//  ASITrafficArchive *archive = [ASITrafficArchive archiveWithPath:@"/path/to/folder" mode:ASITrafficArchiveRecordMode];
+//  [ASIHTTPRequest setDefaultTrafficArchive:archive];
+//  ...run some requests...
+//
+//  To replay, create the archive with ASITrafficArchiveReplayMode instead, and optionally set replaySpeed
+
+#import <Foundation/Foundation.h>
+#if TARGET_OS_IPHONE
+	#import <CFNetwork/CFNetwork.h>
+#endif
+
+@class ASIHTTPRequest;
+
+typedef enum _ASITrafficArchiveMode {
+	ASITrafficArchiveRecordMode = 0,
+	ASITrafficArchiveReplayMode = 1
+} ASITrafficArchiveMode;
+
+typedef enum _ASITrafficReplaySpeed {
+	// Responses are available to read as soon as the request starts
+	ASIReplayAtFullSpeed = 0,
+
+	// Each chunk of the body becomes available at the same time (relative to the start of the request) as when it was recorded
+	// Response headers are still available as soon as the request starts, as the time they arrived isn't recorded
+	ASIReplayWithOriginalTiming = 1
+} ASITrafficReplaySpeed;
+
+@interface ASITrafficArchive : NSObject {
+
+	// The folder where recorded exchanges are stored, one property list per exchange
+	NSString *storagePath;
+
+	ASITrafficArchiveMode mode;
+
+	ASITrafficReplaySpeed replaySpeed;
+
+	// When replaying, maps a key made from the request method and url to an array of recorded exchanges
+	NSMutableDictionary *exchanges;
+
+	// When replaying, the index of the next exchange to use for each key
+	// When a key has been recorded more than once, requests for it cycle through the recordings in the order they were made
+	NSMutableDictionary *replayPositions;
+
+	// Number of exchanges written so far when recording, used to name files
+	unsigned long recordedExchangeCount;
+
+	// Mediates access to the archive
+	NSRecursiveLock *accessLock;
+}
+
+// Create an archive backed by the folder at path (which will be created if needed)
+// When replaying, all exchanges stored in the folder are loaded immediately
++ (id)archiveWithPath:(NSString *)path mode:(ASITrafficArchiveMode)mode;
+- (id)initWithPath:(NSString *)path mode:(ASITrafficArchiveMode)mode;
+
+#pragma mark recording
+
+// Called by a request when it starts, returns a new exchange the request will fill in as it runs
+- (NSMutableDictionary *)exchangeForRecordingRequest:(ASIHTTPRequest *)request;
+
+// Called by a request each time it reads raw (possibly still compressed) data from its read stream
+- (void)exchange:(NSMutableDictionary *)exchange didReceiveBytes:(const void *)bytes length:(NSUInteger)length;
+
+// Called by a request when it has read the whole response, stores the response headers and writes the exchange to disk
+- (void)finishRecordingExchange:(NSMutableDictionary *)exchange forRequest:(ASIHTTPRequest *)request;
+
+#pragma mark replaying
+
+// Returns the next recorded exchange matching the request's method and url, or nil if none was recorded
+- (NSDictionary *)exchangeForReplayingRequest:(ASIHTTPRequest *)request;
+
+// Returns a new read stream that will deliver the recorded body, honouring replaySpeed
+// The stream should be scheduled and opened on the current thread's runloop, as for a normal HTTP read stream
+- (NSInputStream *)readStreamForExchange:(NSDictionary *)exchange runLoopMode:(NSString *)runLoopMode;
+
+// Builds a response header message matching the one recorded for exchange
+// The caller is responsible for releasing the returned message
++ (CFHTTPMessageRef)newResponseMessageForExchange:(NSDictionary *)exchange;
+
+// Removes all recorded exchanges from the archive's folder
+- (void)clearRecordedExchanges;
+
+// Returns the number of exchanges recorded (when recording) or available for replay
+- (NSUInteger)exchangeCount;
+
+@property (retain, readonly) NSString *storagePath;
+@property (assign, readonly) ASITrafficArchiveMode mode;
+@property (assign) ASITrafficReplaySpeed replaySpeed;
+@end
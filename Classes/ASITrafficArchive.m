@@ -0,0 +1,348 @@
+//
+//  ASITrafficArchive.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASITrafficArchive.h"
+#import "ASIHTTPRequest.h"
+
+// Keys used in exchange dictionaries
+static NSString *ASITrafficRequestMethodKey = @"RequestMethod";
+static NSString *ASITrafficURLKey = @"URL";
+static NSString *ASITrafficStatusLineKey = @"StatusLine";
+static NSString *ASITrafficStatusCodeKey = @"StatusCode";
+static NSString *ASITrafficResponseHeadersKey = @"ResponseHeaders";
+static NSString *ASITrafficBodyKey = @"Body";
+static NSString *ASITrafficChunkLengthsKey = @"ChunkLengths";
+static NSString *ASITrafficChunkTimesKey = @"ChunkTimes";
+static NSString *ASITrafficDurationKey = @"Duration";
+
+// Only used while recording, not written to disk
+static NSString *ASITrafficStartDateKey = @"StartDate";
+
+// Writes a recorded body into the write end of a bound stream pair, one chunk at a time, at the times the chunks were originally received
+// Timers retain their target, so a writer stays alive until it has written everything or the read end of the pair goes away
+@interface ASITrafficReplayWriter : NSObject {
+	NSOutputStream *writeStream;
+	NSDictionary *exchange;
+	NSDate *startDate;
+	NSString *runLoopMode;
+	NSUInteger nextChunk;
+	NSUInteger offset;
+}
+- (id)initWithWriteStream:(NSOutputStream *)stream exchange:(NSDictionary *)exchange runLoopMode:(NSString *)mode;
+- (void)start;
+- (void)scheduleNextWriteAfterDelay:(NSTimeInterval)delay;
+- (void)writeDueChunks:(NSTimer *)timer;
+@end
+
+@interface ASITrafficArchive ()
++ (NSString *)keyForRequestMethod:(NSString *)method URL:(NSURL *)url;
+- (void)loadRecordedExchanges;
+@property (retain) NSString *storagePath;
+@property (assign) ASITrafficArchiveMode mode;
+@property (retain) NSMutableDictionary *exchanges;
+@property (retain) NSMutableDictionary *replayPositions;
+@property (retain) NSRecursiveLock *accessLock;
+@end
+
+@implementation ASITrafficArchive
+
++ (id)archiveWithPath:(NSString *)path mode:(ASITrafficArchiveMode)theMode
+{
+	return [[[self alloc] initWithPath:path mode:theMode] autorelease];
+}
+
+- (id)initWithPath:(NSString *)path mode:(ASITrafficArchiveMode)theMode
+{
+	self = [super init];
+	[self setStoragePath:path];
+	[self setMode:theMode];
+	[self setReplaySpeed:ASIReplayAtFullSpeed];
+	[self setAccessLock:[[[NSRecursiveLock alloc] init] autorelease]];
+	[self setExchanges:[NSMutableDictionary dictionary]];
+	[self setReplayPositions:[NSMutableDictionary dictionary]];
+
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	BOOL isDirectory = NO;
+	if (![fileManager fileExistsAtPath:path isDirectory:&isDirectory] || !isDirectory) {
+		[fileManager createDirectoryAtPath:path withIntermediateDirectories:YES attributes:nil error:NULL];
+	}
+	if ([self mode] == ASITrafficArchiveReplayMode) {
+		[self loadRecordedExchanges];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[storagePath release];
+	[exchanges release];
+	[replayPositions release];
+	[accessLock release];
+	[super dealloc];
+}
+
++ (NSString *)keyForRequestMethod:(NSString *)method URL:(NSURL *)url
+{
+	return [NSString stringWithFormat:@"%@ %@",method,[url absoluteString]];
+}
+
+#pragma mark recording
+
+- (NSMutableDictionary *)exchangeForRecordingRequest:(ASIHTTPRequest *)request
+{
+	NSMutableDictionary *exchange = [NSMutableDictionary dictionaryWithCapacity:10];
+	[exchange setObject:[request requestMethod] forKey:ASITrafficRequestMethodKey];
+	[exchange setObject:[[request url] absoluteString] forKey:ASITrafficURLKey];
+	[exchange setObject:[NSMutableData data] forKey:ASITrafficBodyKey];
+	[exchange setObject:[NSMutableArray array] forKey:ASITrafficChunkLengthsKey];
+	[exchange setObject:[NSMutableArray array] forKey:ASITrafficChunkTimesKey];
+	[exchange setObject:[NSDate date] forKey:ASITrafficStartDateKey];
+	return exchange;
+}
+
+- (void)exchange:(NSMutableDictionary *)exchange didReceiveBytes:(const void *)bytes length:(NSUInteger)length
+{
+	NSTimeInterval elapsed = -[[exchange objectForKey:ASITrafficStartDateKey] timeIntervalSinceNow];
+	[[exchange objectForKey:ASITrafficBodyKey] appendBytes:bytes length:length];
+	[[exchange objectForKey:ASITrafficChunkLengthsKey] addObject:[NSNumber numberWithUnsignedInteger:length]];
+	[[exchange objectForKey:ASITrafficChunkTimesKey] addObject:[NSNumber numberWithDouble:elapsed]];
+}
+
+- (void)finishRecordingExchange:(NSMutableDictionary *)exchange forRequest:(ASIHTTPRequest *)request
+{
+	NSTimeInterval elapsed = -[[exchange objectForKey:ASITrafficStartDateKey] timeIntervalSinceNow];
+	[exchange removeObjectForKey:ASITrafficStartDateKey];
+	[exchange setObject:[NSNumber numberWithDouble:elapsed] forKey:ASITrafficDurationKey];
+	[exchange setObject:[NSNumber numberWithInt:[request responseStatusCode]] forKey:ASITrafficStatusCodeKey];
+	if ([request responseStatusMessage]) {
+		[exchange setObject:[request responseStatusMessage] forKey:ASITrafficStatusLineKey];
+	}
+	if ([request responseHeaders]) {
+		[exchange setObject:[request responseHeaders] forKey:ASITrafficResponseHeadersKey];
+	}
+
+	NSString *errorDescription = nil;
+	NSData *data = [NSPropertyListSerialization dataFromPropertyList:exchange format:NSPropertyListBinaryFormat_v1_0 errorDescription:&errorDescription];
+	if (!data) {
+		#if DEBUG_REQUEST_STATUS
+		NSLog(@"Failed to archive response for %@: %@",[request url],errorDescription);
+		#endif
+		[errorDescription release];
+		return;
+	}
+
+	[[self accessLock] lock];
+	recordedExchangeCount++;
+	NSString *path = [[self storagePath] stringByAppendingPathComponent:[NSString stringWithFormat:@"%08lu.plist",recordedExchangeCount]];
+	[[self accessLock] unlock];
+
+	[data writeToFile:path atomically:NO];
+}
+
+#pragma mark replaying
+
+- (void)loadRecordedExchanges
+{
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	NSArray *files = [[fileManager contentsOfDirectoryAtPath:[self storagePath] error:NULL] sortedArrayUsingSelector:@selector(compare:)];
+	for (NSString *file in files) {
+		if (![[file pathExtension] isEqualToString:@"plist"]) {
+			continue;
+		}
+		NSDictionary *exchange = [NSDictionary dictionaryWithContentsOfFile:[[self storagePath] stringByAppendingPathComponent:file]];
+		if (!exchange) {
+			continue;
+		}
+		NSString *key = [[self class] keyForRequestMethod:[exchange objectForKey:ASITrafficRequestMethodKey] URL:[NSURL URLWithString:[exchange objectForKey:ASITrafficURLKey]]];
+		NSMutableArray *recordings = [[self exchanges] objectForKey:key];
+		if (!recordings) {
+			recordings = [NSMutableArray arrayWithCapacity:1];
+			[[self exchanges] setObject:recordings forKey:key];
+		}
+		[recordings addObject:exchange];
+		recordedExchangeCount++;
+	}
+}
+
+- (NSDictionary *)exchangeForReplayingRequest:(ASIHTTPRequest *)request
+{
+	NSString *key = [[self class] keyForRequestMethod:[request requestMethod] URL:[request url]];
+	[[self accessLock] lock];
+	NSArray *recordings = [[self exchanges] objectForKey:key];
+	if (![recordings count]) {
+		[[self accessLock] unlock];
+		return nil;
+	}
+	NSUInteger position = [[[self replayPositions] objectForKey:key] unsignedIntegerValue];
+	NSDictionary *exchange = [[[recordings objectAtIndex:position % [recordings count]] retain] autorelease];
+	[[self replayPositions] setObject:[NSNumber numberWithUnsignedInteger:position+1] forKey:key];
+	[[self accessLock] unlock];
+	return exchange;
+}
+
+- (NSInputStream *)readStreamForExchange:(NSDictionary *)exchange runLoopMode:(NSString *)runLoopMode
+{
+	NSData *body = [exchange objectForKey:ASITrafficBodyKey];
+
+	// The buffer is large enough to hold the whole body, so writes to the pair never block
+	CFReadStreamRef readStream = NULL;
+	CFWriteStreamRef writeStream = NULL;
+	CFStreamCreateBoundPair(kCFAllocatorDefault, &readStream, &writeStream, (CFIndex)MAX([body length],1));
+	if (!readStream || !writeStream) {
+		if (readStream) {
+			CFRelease(readStream);
+		}
+		if (writeStream) {
+			CFRelease(writeStream);
+		}
+		return nil;
+	}
+	CFWriteStreamOpen(writeStream);
+
+	if ([self replaySpeed] == ASIReplayWithOriginalTiming) {
+		ASITrafficReplayWriter *writer = [[[ASITrafficReplayWriter alloc] initWithWriteStream:(NSOutputStream *)writeStream exchange:exchange runLoopMode:runLoopMode] autorelease];
+		[writer start];
+	} else {
+		NSUInteger written = 0;
+		while (written < [body length]) {
+			CFIndex result = CFWriteStreamWrite(writeStream, (const UInt8 *)[body bytes]+written, (CFIndex)([body length]-written));
+			if (result <= 0) {
+				break;
+			}
+			written += (NSUInteger)result;
+		}
+		CFWriteStreamClose(writeStream);
+	}
+	CFRelease(writeStream);
+	return [NSMakeCollectable((NSInputStream *)readStream) autorelease];
+}
+
++ (CFHTTPMessageRef)newResponseMessageForExchange:(NSDictionary *)exchange
+{
+	NSString *statusLine = [exchange objectForKey:ASITrafficStatusLineKey];
+	if (!statusLine) {
+		statusLine = [NSString stringWithFormat:@"HTTP/1.1 %i",[[exchange objectForKey:ASITrafficStatusCodeKey] intValue]];
+	}
+	NSMutableString *header = [NSMutableString stringWithCapacity:512];
+	[header appendString:statusLine];
+	[header appendString:@"\r\n"];
+	NSDictionary *headers = [exchange objectForKey:ASITrafficResponseHeadersKey];
+	for (NSString *name in headers) {
+		[header appendFormat:@"%@: %@\r\n",name,[headers objectForKey:name]];
+	}
+	[header appendString:@"\r\n"];
+
+	NSData *headerData = [header dataUsingEncoding:NSUTF8StringEncoding];
+	CFHTTPMessageRef message = CFHTTPMessageCreateEmpty(kCFAllocatorDefault, false);
+	if (!CFHTTPMessageAppendBytes(message, (const UInt8 *)[headerData bytes], (CFIndex)[headerData length])) {
+		CFRelease(message);
+		return NULL;
+	}
+	return message;
+}
+
+#pragma mark housekeeping
+
+- (void)clearRecordedExchanges
+{
+	[[self accessLock] lock];
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	for (NSString *file in [fileManager contentsOfDirectoryAtPath:[self storagePath] error:NULL]) {
+		if ([[file pathExtension] isEqualToString:@"plist"]) {
+			[fileManager removeItemAtPath:[[self storagePath] stringByAppendingPathComponent:file] error:NULL];
+		}
+	}
+	[[self exchanges] removeAllObjects];
+	[[self replayPositions] removeAllObjects];
+	recordedExchangeCount = 0;
+	[[self accessLock] unlock];
+}
+
+- (NSUInteger)exchangeCount
+{
+	[[self accessLock] lock];
+	NSUInteger count = recordedExchangeCount;
+	[[self accessLock] unlock];
+	return count;
+}
+
+@synthesize storagePath;
+@synthesize mode;
+@synthesize replaySpeed;
+@synthesize exchanges;
+@synthesize replayPositions;
+@synthesize accessLock;
+@end
+
+
+@implementation ASITrafficReplayWriter
+
+- (id)initWithWriteStream:(NSOutputStream *)stream exchange:(NSDictionary *)theExchange runLoopMode:(NSString *)mode
+{
+	self = [super init];
+	writeStream = [stream retain];
+	exchange = [theExchange retain];
+	runLoopMode = [mode retain];
+	return self;
+}
+
+- (void)dealloc
+{
+	[writeStream close];
+	[writeStream release];
+	[exchange release];
+	[startDate release];
+	[runLoopMode release];
+	[super dealloc];
+}
+
+- (void)scheduleNextWriteAfterDelay:(NSTimeInterval)delay
+{
+	NSTimer *timer = [NSTimer timerWithTimeInterval:MAX(delay,0) target:self selector:@selector(writeDueChunks:) userInfo:nil repeats:NO];
+	[[NSRunLoop currentRunLoop] addTimer:timer forMode:runLoopMode];
+}
+
+- (void)start
+{
+	startDate = [[NSDate alloc] init];
+	[self writeDueChunks:nil];
+}
+
+- (void)writeDueChunks:(NSTimer *)timer
+{
+	NSData *body = [exchange objectForKey:ASITrafficBodyKey];
+	NSArray *lengths = [exchange objectForKey:ASITrafficChunkLengthsKey];
+	NSArray *times = [exchange objectForKey:ASITrafficChunkTimesKey];
+	NSTimeInterval elapsed = -[startDate timeIntervalSinceNow];
+
+	while (nextChunk < [lengths count] && [[times objectAtIndex:nextChunk] doubleValue] <= elapsed) {
+		NSUInteger length = [[lengths objectAtIndex:nextChunk] unsignedIntegerValue];
+		if (offset+length > [body length]) {
+			length = [body length]-offset;
+		}
+		if ([writeStream write:(const uint8_t *)[body bytes]+offset maxLength:length] < 0) {
+			// The request has gone away
+			return;
+		}
+		offset += length;
+		nextChunk++;
+	}
+
+	if (nextChunk < [lengths count]) {
+		[self scheduleNextWriteAfterDelay:[[times objectAtIndex:nextChunk] doubleValue]-elapsed];
+		return;
+	}
+	NSTimeInterval duration = [[exchange objectForKey:ASITrafficDurationKey] doubleValue];
+	if (duration > elapsed) {
+		[self scheduleNextWriteAfterDelay:duration-elapsed];
+		return;
+	}
+	[writeStream close];
+}
+
+@end
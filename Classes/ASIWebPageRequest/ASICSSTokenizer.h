@@ -0,0 +1,73 @@
+//
+//  ASICSSTokenizer.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  ASICSSTokenizer finds the external resources referenced by a stylesheet - url() values and @import rules
+//  It works directly on the bytes of the stylesheet, and can be fed the data in chunks as it arrives
+//  Comments and the contents of other strings are skipped, and escapes in urls are decoded
+//  Used internally by ASIWebPageRequest
+
+#import <Foundation/Foundation.h>
+
+typedef enum _ASICSSTokenizerState {
+	ASICSSNormalState = 0,
+	ASICSSSlashState = 1,
+	ASICSSCommentState = 2,
+	ASICSSCommentStarState = 3,
+	ASICSSIdentifierState = 4,
+	ASICSSStringState = 5,
+	ASICSSEscapeState = 6,
+	ASICSSHexEscapeState = 7,
+	ASICSSImportState = 8,
+	ASICSSURLStartState = 9,
+	ASICSSUnquotedURLState = 10,
+	ASICSSURLEndState = 11
+} ASICSSTokenizerState;
+
+@interface ASICSSTokenizer : NSObject {
+
+	// Where we are in the stylesheet
+	ASICSSTokenizerState state;
+
+	// The state to return to when the current string or escape ends
+	ASICSSTokenizerState stringReturnState;
+	ASICSSTokenizerState escapeReturnState;
+
+	// The character that will end the current string
+	unsigned char quoteCharacter;
+
+	// When YES, the string or url we're reading is a url we want, so we store its bytes in urlBuffer
+	BOOL capturing;
+
+	// The (lowercased) identifier we're reading, used to spot url( and @import
+	// Longer identifiers can't be either, so we only keep enough to tell
+	char identifier[8];
+	NSUInteger identifierLength;
+
+	// The value and number of digits read so far for a hex escape (eg \20)
+	unsigned int escapeValue;
+	NSUInteger escapeLength;
+
+	// The bytes of the url we're reading
+	NSMutableData *urlBuffer;
+
+	// Urls found since they were last taken with takeURLs
+	NSMutableArray *urls;
+}
+
+// Convenience method to find all the urls in a complete stylesheet
++ (NSArray *)URLsInData:(NSData *)data;
+
+// Reads the next chunk of the stylesheet
+// Urls and strings may be split across chunks
+- (void)tokenizeBytes:(const unsigned char *)bytes length:(NSUInteger)length;
+
+// Call when there is no more data to read, to pick up a url left open at the end of the stylesheet
+- (void)finish;
+
+// Returns the urls found since the last time this was called
+- (NSArray *)takeURLs;
+@end
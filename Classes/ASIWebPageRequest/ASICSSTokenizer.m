@@ -0,0 +1,342 @@
+//
+//  ASICSSTokenizer.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASICSSTokenizer.h"
+
+// Largest identifier we care about is '@import'
+static const NSUInteger ASICSSMaxIdentifierLength = 7;
+
+static BOOL ASICSSIsWhitespace(unsigned char c)
+{
+	return (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f');
+}
+
+static BOOL ASICSSIsNewline(unsigned char c)
+{
+	return (c == '\n' || c == '\r' || c == '\f');
+}
+
+static BOOL ASICSSIsIdentifierCharacter(unsigned char c)
+{
+	return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c >= 0x80);
+}
+
+static int ASICSSHexValue(unsigned char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+@interface ASICSSTokenizer ()
+- (void)startIdentifierWithCharacter:(unsigned char)c;
+- (void)startStringWithQuote:(unsigned char)c capturing:(BOOL)shouldCapture returnState:(ASICSSTokenizerState)returnState;
+- (void)startEscapeReturningTo:(ASICSSTokenizerState)returnState;
+- (void)appendCodePoint:(unsigned int)codePoint;
+- (void)finishURL;
+@end
+
+@implementation ASICSSTokenizer
+
++ (NSArray *)URLsInData:(NSData *)data
+{
+	ASICSSTokenizer *tokenizer = [[[self alloc] init] autorelease];
+	[tokenizer tokenizeBytes:(const unsigned char *)[data bytes] length:[data length]];
+	[tokenizer finish];
+	return [tokenizer takeURLs];
+}
+
+- (id)init
+{
+	self = [super init];
+	if (!self) {
+		return nil;
+	}
+	urlBuffer = [[NSMutableData alloc] init];
+	urls = [[NSMutableArray alloc] init];
+	return self;
+}
+
+- (void)dealloc
+{
+	[urlBuffer release];
+	[urls release];
+	[super dealloc];
+}
+
+- (void)tokenizeBytes:(const unsigned char *)bytes length:(NSUInteger)length
+{
+	NSUInteger i = 0;
+	while (i < length) {
+		unsigned char c = bytes[i];
+
+		// Some states end on a character they don't consume, in which case we'll look at it again in the new state
+		BOOL consumed = YES;
+
+		switch (state) {
+
+			case ASICSSNormalState:
+				if (c == '/') {
+					state = ASICSSSlashState;
+				} else if (c == '"' || c == '\'') {
+					[self startStringWithQuote:c capturing:NO returnState:ASICSSNormalState];
+				} else if (c == '\\') {
+					[self startEscapeReturningTo:ASICSSNormalState];
+				} else if (c == '@' || (ASICSSIsIdentifierCharacter(c) && !(c >= '0' && c <= '9'))) {
+					[self startIdentifierWithCharacter:c];
+				}
+				break;
+
+			case ASICSSSlashState:
+				if (c == '*') {
+					state = ASICSSCommentState;
+				} else {
+					state = ASICSSNormalState;
+					consumed = NO;
+				}
+				break;
+
+			case ASICSSCommentState:
+				if (c == '*') {
+					state = ASICSSCommentStarState;
+				}
+				break;
+
+			case ASICSSCommentStarState:
+				if (c == '/') {
+					state = ASICSSNormalState;
+				} else if (c != '*') {
+					state = ASICSSCommentState;
+				}
+				break;
+
+			case ASICSSIdentifierState:
+				if (ASICSSIsIdentifierCharacter(c)) {
+					// Identifiers too long to be interesting are marked by a length we can never match
+					if (identifierLength < ASICSSMaxIdentifierLength) {
+						identifier[identifierLength] = (char)tolower(c);
+					}
+					if (identifierLength <= ASICSSMaxIdentifierLength) {
+						identifierLength++;
+					}
+					break;
+				}
+				if (c == '(' && identifierLength == 3 && strncmp(identifier, "url", 3) == 0) {
+					[urlBuffer setLength:0];
+					capturing = YES;
+					state = ASICSSURLStartState;
+				} else if (identifierLength == 7 && strncmp(identifier, "@import", 7) == 0) {
+					state = ASICSSImportState;
+					consumed = NO;
+				} else {
+					state = ASICSSNormalState;
+					consumed = NO;
+				}
+				break;
+
+			case ASICSSImportState:
+				if (c == '"' || c == '\'') {
+					[urlBuffer setLength:0];
+					[self startStringWithQuote:c capturing:YES returnState:ASICSSNormalState];
+				} else if (c == 'u' || c == 'U') {
+					[self startIdentifierWithCharacter:c];
+				} else if (!ASICSSIsWhitespace(c)) {
+					state = ASICSSNormalState;
+					consumed = NO;
+				}
+				break;
+
+			case ASICSSURLStartState:
+				if (c == '"' || c == '\'') {
+					[self startStringWithQuote:c capturing:YES returnState:ASICSSURLEndState];
+				} else if (c == ')') {
+					capturing = NO;
+					state = ASICSSNormalState;
+				} else if (c == '\\') {
+					[self startEscapeReturningTo:ASICSSUnquotedURLState];
+				} else if (!ASICSSIsWhitespace(c)) {
+					[urlBuffer appendBytes:&c length:1];
+					state = ASICSSUnquotedURLState;
+				}
+				break;
+
+			case ASICSSUnquotedURLState:
+				if (c == ')') {
+					[self finishURL];
+					state = ASICSSNormalState;
+				} else if (ASICSSIsWhitespace(c)) {
+					[self finishURL];
+					state = ASICSSURLEndState;
+				} else if (c == '\\') {
+					[self startEscapeReturningTo:ASICSSUnquotedURLState];
+				} else if (c == '"' || c == '\'' || c == '(') {
+					// Not allowed in an unquoted url, the whole thing is thrown away
+					capturing = NO;
+					state = ASICSSURLEndState;
+				} else {
+					[urlBuffer appendBytes:&c length:1];
+				}
+				break;
+
+			case ASICSSURLEndState:
+				if (c == ')') {
+					state = ASICSSNormalState;
+				}
+				break;
+
+			case ASICSSStringState:
+				if (c == quoteCharacter) {
+					if (capturing) {
+						[self finishURL];
+					}
+					state = stringReturnState;
+				} else if (c == '\\') {
+					[self startEscapeReturningTo:ASICSSStringState];
+				} else if (ASICSSIsNewline(c)) {
+					// Unterminated string, which is thrown away
+					capturing = NO;
+					state = ASICSSNormalState;
+					consumed = NO;
+				} else if (capturing) {
+					[urlBuffer appendBytes:&c length:1];
+				}
+				break;
+
+			case ASICSSEscapeState:
+				if (ASICSSHexValue(c) >= 0) {
+					escapeValue = (unsigned int)ASICSSHexValue(c);
+					escapeLength = 1;
+					state = ASICSSHexEscapeState;
+					break;
+				}
+				// A backslash before a newline in a string continues the string on the next line
+				if (!(ASICSSIsNewline(c) && escapeReturnState == ASICSSStringState) && capturing) {
+					[urlBuffer appendBytes:&c length:1];
+				}
+				state = escapeReturnState;
+				break;
+
+			case ASICSSHexEscapeState:
+				if (ASICSSHexValue(c) >= 0 && escapeLength < 6) {
+					escapeValue = (escapeValue << 4) | (unsigned int)ASICSSHexValue(c);
+					escapeLength++;
+					break;
+				}
+				[self appendCodePoint:escapeValue];
+				state = escapeReturnState;
+
+				// A single whitespace character after a hex escape is part of the escape
+				consumed = ASICSSIsWhitespace(c);
+				break;
+		}
+		if (consumed) {
+			i++;
+		}
+	}
+}
+
+- (void)finish
+{
+	// The end of the stylesheet closes any url or string that's still open
+	if (state == ASICSSHexEscapeState) {
+		[self appendCodePoint:escapeValue];
+		state = escapeReturnState;
+	}
+	if (capturing && (state == ASICSSUnquotedURLState || state == ASICSSStringState || state == ASICSSEscapeState)) {
+		[self finishURL];
+	}
+	capturing = NO;
+	state = ASICSSNormalState;
+}
+
+- (NSArray *)takeURLs
+{
+	NSArray *foundURLs = [[urls copy] autorelease];
+	[urls removeAllObjects];
+	return foundURLs;
+}
+
+- (void)startIdentifierWithCharacter:(unsigned char)c
+{
+	identifier[0] = (char)tolower(c);
+	identifierLength = 1;
+	state = ASICSSIdentifierState;
+}
+
+- (void)startStringWithQuote:(unsigned char)c capturing:(BOOL)shouldCapture returnState:(ASICSSTokenizerState)returnState
+{
+	quoteCharacter = c;
+	capturing = shouldCapture;
+	stringReturnState = returnState;
+	state = ASICSSStringState;
+}
+
+- (void)startEscapeReturningTo:(ASICSSTokenizerState)returnState
+{
+	escapeReturnState = returnState;
+	state = ASICSSEscapeState;
+}
+
+- (void)appendCodePoint:(unsigned int)codePoint
+{
+	if (!capturing) {
+		return;
+	}
+	// Null, surrogates and values outside the unicode range become the replacement character
+	if (codePoint == 0 || (codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF) {
+		codePoint = 0xFFFD;
+	}
+	unsigned char utf8[4];
+	NSUInteger length;
+	if (codePoint < 0x80) {
+		utf8[0] = (unsigned char)codePoint;
+		length = 1;
+	} else if (codePoint < 0x800) {
+		utf8[0] = (unsigned char)(0xC0 | (codePoint >> 6));
+		utf8[1] = (unsigned char)(0x80 | (codePoint & 0x3F));
+		length = 2;
+	} else if (codePoint < 0x10000) {
+		utf8[0] = (unsigned char)(0xE0 | (codePoint >> 12));
+		utf8[1] = (unsigned char)(0x80 | ((codePoint >> 6) & 0x3F));
+		utf8[2] = (unsigned char)(0x80 | (codePoint & 0x3F));
+		length = 3;
+	} else {
+		utf8[0] = (unsigned char)(0xF0 | (codePoint >> 18));
+		utf8[1] = (unsigned char)(0x80 | ((codePoint >> 12) & 0x3F));
+		utf8[2] = (unsigned char)(0x80 | ((codePoint >> 6) & 0x3F));
+		utf8[3] = (unsigned char)(0x80 | (codePoint & 0x3F));
+		length = 4;
+	}
+	[urlBuffer appendBytes:utf8 length:length];
+}
+
+- (void)finishURL
+{
+	capturing = NO;
+	if (![urlBuffer length]) {
+		return;
+	}
+	NSString *url = [[[NSString alloc] initWithData:urlBuffer encoding:NSUTF8StringEncoding] autorelease];
+
+	// Stylesheets that aren't UTF-8 are most likely Latin-1
+	if (!url) {
+		url = [[[NSString alloc] initWithData:urlBuffer encoding:NSISOLatin1StringEncoding] autorelease];
+	}
+	url = [url stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+	if ([url length]) {
+		[urls addObject:url];
+	}
+	[urlBuffer setLength:0];
+}
+
+@end
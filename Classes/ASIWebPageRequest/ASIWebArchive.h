@@ -0,0 +1,64 @@
+//
+//  ASIWebArchive.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  An ASIWebArchive stores responses in a single WARC (ISO 28500) file, with an index so any response can be read back without scanning the file
+//  ASIWebPageRequests using ASIStoreResourcesInWebArchive write the page and all its resources to an archive, and any number of pages can share one archive
+//
+//  Bodies are stored as they were after any gzip encoding was removed - not base64 encoded - and are copied into the archive a chunk at a time
+//  The index lives next to the archive (at the same path with '.idx' appended) with one line per response:
+//  <offset of record>\t<offset of body>\t<length of body>\t<content type>\t<url>
+//  If the same url is archived more than once, the index points at the most recent copy
+//  Responses to redirected requests are indexed under both the final url and the url originally requested, so either can be used to read them back
+//
+//  ASIWebArchive *archive = [ASIWebArchive archiveWithPath:@"/path/to/pages.warc"];
+//  ASIWebPageRequest *request = [ASIWebPageRequest requestWithURL:url];
+//  [request setUrlReplacementMode:ASIStoreResourcesInWebArchive];
+//  [request setWebArchive:archive];
+//  ...
+//  NSData *logo = [archive responseDataForURL:[NSURL URLWithString:@"http://allseeing-i.com/i/logo.png"]];
+
+#import <Foundation/Foundation.h>
+
+@class ASIHTTPRequest;
+
+@interface ASIWebArchive : NSObject {
+
+	// Location of the archive file
+	NSString *path;
+
+	// Location of the index file
+	NSString *indexPath;
+
+	// Maps url strings to an array of [record offset, body offset, body length, content type]
+	NSMutableDictionary *index;
+
+	// Used to format the WARC-Date of each record
+	NSDateFormatter *dateFormatter;
+
+	// Records are appended one at a time, and reads don't happen while a record is half written
+	NSLock *accessLock;
+}
+
+// Opens the archive at path, creating it if it doesn't exist
+// The index for an existing archive is loaded immediately
++ (id)archiveWithPath:(NSString *)path;
+- (id)initWithPath:(NSString *)path;
+
+// Appends a response record for a finished request
+// The body is read from the request's downloadDestinationPath if it has one, otherwise from its responseData
+- (BOOL)addResponseForRequest:(ASIHTTPRequest *)request error:(NSError **)error;
+
+// Random access to archived responses
+- (BOOL)containsResponseForURL:(NSURL *)url;
+- (NSData *)responseDataForURL:(NSURL *)url;
+- (NSString *)contentTypeForURL:(NSURL *)url;
+
+// The urls of every response in the archive (including the urls redirected requests were originally sent to)
+- (NSArray *)archivedURLs;
+
+@property (retain, readonly) NSString *path;
+@end
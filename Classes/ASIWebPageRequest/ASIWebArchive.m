@@ -0,0 +1,299 @@
+//
+//  ASIWebArchive.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIWebArchive.h"
+#import "ASIHTTPRequest.h"
+
+// Amount of a response body we copy into the archive at a time
+static const NSUInteger archiveChunkSize = 65536;
+
+static BOOL ASIArchiveWriteBytes(NSOutputStream *stream, const uint8_t *bytes, NSUInteger length)
+{
+	while (length > 0) {
+		NSInteger written = [stream write:bytes maxLength:length];
+		if (written <= 0) {
+			return NO;
+		}
+		bytes += written;
+		length -= (NSUInteger)written;
+	}
+	return YES;
+}
+
+static BOOL ASIArchiveWriteData(NSOutputStream *stream, NSData *data)
+{
+	return ASIArchiveWriteBytes(stream, (const uint8_t *)[data bytes], [data length]);
+}
+
+@interface ASIWebArchive ()
+- (void)loadIndex;
+- (NSData *)HTTPHeaderForRequest:(ASIHTTPRequest *)request bodyLength:(unsigned long long)bodyLength;
+- (NSError *)errorWithDescription:(NSString *)description;
+
+@property (retain) NSString *path;
+@property (retain, nonatomic) NSString *indexPath;
+@property (retain, nonatomic) NSMutableDictionary *index;
+@property (retain, nonatomic) NSDateFormatter *dateFormatter;
+@property (retain, nonatomic) NSLock *accessLock;
+@end
+
+@implementation ASIWebArchive
+
++ (id)archiveWithPath:(NSString *)newPath
+{
+	return [[[self alloc] initWithPath:newPath] autorelease];
+}
+
+- (id)initWithPath:(NSString *)newPath
+{
+	self = [super init];
+	if (!self) {
+		return nil;
+	}
+	[self setPath:newPath];
+	[self setIndexPath:[newPath stringByAppendingString:@".idx"]];
+	[self setIndex:[NSMutableDictionary dictionary]];
+	[self setAccessLock:[[[NSLock alloc] init] autorelease]];
+
+	NSDateFormatter *formatter = [[[NSDateFormatter alloc] init] autorelease];
+	[formatter setLocale:[[[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"] autorelease]];
+	[formatter setTimeZone:[NSTimeZone timeZoneWithAbbreviation:@"UTC"]];
+	[formatter setDateFormat:@"yyyy'-'MM'-'dd'T'HH':'mm':'ss'Z'"];
+	[self setDateFormatter:formatter];
+
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	if (![fileManager fileExistsAtPath:newPath]) {
+		[fileManager createFileAtPath:newPath contents:nil attributes:nil];
+		[fileManager createFileAtPath:[self indexPath] contents:nil attributes:nil];
+	} else {
+		[self loadIndex];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[path release];
+	[indexPath release];
+	[index release];
+	[dateFormatter release];
+	[accessLock release];
+	[super dealloc];
+}
+
+- (void)loadIndex
+{
+	NSString *indexString = [NSString stringWithContentsOfFile:[self indexPath] encoding:NSUTF8StringEncoding error:NULL];
+	for (NSString *line in [indexString componentsSeparatedByString:@"\n"]) {
+		NSArray *fields = [line componentsSeparatedByString:@"\t"];
+		if ([fields count] != 5) {
+			continue;
+		}
+		NSArray *entry = [NSArray arrayWithObjects:
+			[NSNumber numberWithUnsignedLongLong:strtoull([[fields objectAtIndex:0] UTF8String], NULL, 10)],
+			[NSNumber numberWithUnsignedLongLong:strtoull([[fields objectAtIndex:1] UTF8String], NULL, 10)],
+			[NSNumber numberWithUnsignedLongLong:strtoull([[fields objectAtIndex:2] UTF8String], NULL, 10)],
+			[fields objectAtIndex:3],
+			nil];
+		[[self index] setObject:entry forKey:[fields objectAtIndex:4]];
+	}
+}
+
+#pragma mark writing
+
+- (BOOL)addResponseForRequest:(ASIHTTPRequest *)request error:(NSError **)error
+{
+	NSString *url = [[[request url] absoluteURL] absoluteString];
+
+	// When the request was redirected, the record can also be found using the url it was originally asked for
+	NSMutableArray *indexedURLs = [NSMutableArray arrayWithObject:url];
+	NSString *originalURL = [[[request originalURL] absoluteURL] absoluteString];
+	if (originalURL && ![originalURL isEqualToString:url]) {
+		[indexedURLs addObject:originalURL];
+	}
+
+	NSString *contentType = [[request responseHeaders] objectForKey:@"Content-Type"];
+	if (!contentType) {
+		contentType = @"application/octet-stream";
+	}
+
+	// Work out where the body is coming from, and how long it is, before we start writing
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	NSString *bodyPath = [request downloadDestinationPath];
+	NSData *bodyData = nil;
+	unsigned long long bodyLength;
+	if (bodyPath) {
+		NSDictionary *attributes = [fileManager attributesOfItemAtPath:bodyPath error:NULL];
+		if (!attributes) {
+			if (error) {
+				*error = [self errorWithDescription:[NSString stringWithFormat:@"Unable to archive %@ because we couldn't read its body from %@",url,bodyPath]];
+			}
+			return NO;
+		}
+		bodyLength = [attributes fileSize];
+	} else {
+		bodyData = [request responseData];
+		bodyLength = [bodyData length];
+	}
+
+	NSData *httpHeader = [self HTTPHeaderForRequest:request bodyLength:bodyLength];
+
+	CFUUIDRef uuid = CFUUIDCreate(NULL);
+	NSString *recordID = [NSMakeCollectable(CFUUIDCreateString(NULL, uuid)) autorelease];
+	CFRelease(uuid);
+
+	NSMutableString *warcHeader = [NSMutableString stringWithString:@"WARC/1.0\r\nWARC-Type: response\r\n"];
+	[warcHeader appendFormat:@"WARC-Record-ID: <urn:uuid:%@>\r\n",[recordID lowercaseString]];
+	[warcHeader appendFormat:@"WARC-Target-URI: %@\r\n",url];
+	[warcHeader appendString:@"Content-Type: application/http; msgtype=response\r\n"];
+
+	[[self accessLock] lock];
+
+	[warcHeader appendFormat:@"WARC-Date: %@\r\n",[[self dateFormatter] stringFromDate:[NSDate date]]];
+	[warcHeader appendFormat:@"Content-Length: %llu\r\n\r\n",(unsigned long long)[httpHeader length]+bodyLength];
+
+	unsigned long long recordOffset = [[fileManager attributesOfItemAtPath:[self path] error:NULL] fileSize];
+	NSData *warcHeaderData = [warcHeader dataUsingEncoding:NSUTF8StringEncoding];
+	unsigned long long bodyOffset = recordOffset+[warcHeaderData length]+[httpHeader length];
+
+	NSOutputStream *stream = [NSOutputStream outputStreamToFileAtPath:[self path] append:YES];
+	[stream open];
+	BOOL success = ASIArchiveWriteData(stream, warcHeaderData) && ASIArchiveWriteData(stream, httpHeader);
+
+	// Copy the body into the archive a chunk at a time
+	if (success) {
+		if (bodyPath) {
+			NSInputStream *bodyStream = [NSInputStream inputStreamWithFileAtPath:bodyPath];
+			[bodyStream open];
+			uint8_t *buffer = malloc(archiveChunkSize);
+			unsigned long long copied = 0;
+			while (success && copied < bodyLength) {
+				NSInteger bytesRead = [bodyStream read:buffer maxLength:archiveChunkSize];
+				if (bytesRead <= 0) {
+					success = NO;
+					break;
+				}
+				success = ASIArchiveWriteBytes(stream, buffer, (NSUInteger)bytesRead);
+				copied += (unsigned long long)bytesRead;
+			}
+			free(buffer);
+			[bodyStream close];
+		} else {
+			success = ASIArchiveWriteData(stream, bodyData);
+		}
+	}
+	if (success) {
+		success = ASIArchiveWriteData(stream, [@"\r\n\r\n" dataUsingEncoding:NSUTF8StringEncoding]);
+	}
+	[stream close];
+
+	if (success) {
+		NSMutableString *indexLines = [NSMutableString string];
+		for (NSString *indexedURL in indexedURLs) {
+			[indexLines appendFormat:@"%llu\t%llu\t%llu\t%@\t%@\n",recordOffset,bodyOffset,bodyLength,contentType,indexedURL];
+		}
+		NSOutputStream *indexStream = [NSOutputStream outputStreamToFileAtPath:[self indexPath] append:YES];
+		[indexStream open];
+		success = ASIArchiveWriteData(indexStream, [indexLines dataUsingEncoding:NSUTF8StringEncoding]);
+		[indexStream close];
+	}
+	if (success) {
+		NSArray *entry = [NSArray arrayWithObjects:[NSNumber numberWithUnsignedLongLong:recordOffset],[NSNumber numberWithUnsignedLongLong:bodyOffset],[NSNumber numberWithUnsignedLongLong:bodyLength],contentType,nil];
+		for (NSString *indexedURL in indexedURLs) {
+			[[self index] setObject:entry forKey:indexedURL];
+		}
+	} else {
+		// Don't leave half a record at the end of the archive
+		NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:[self path]];
+		[fileHandle truncateFileAtOffset:recordOffset];
+		[fileHandle closeFile];
+	}
+
+	[[self accessLock] unlock];
+
+	if (!success && error) {
+		*error = [self errorWithDescription:[NSString stringWithFormat:@"Unable to write %@ to the archive at %@",url,[self path]]];
+	}
+	return success;
+}
+
+// Builds the status line and headers for the record
+// Bodies are stored without any content or transfer encoding, so the headers are changed to match
+- (NSData *)HTTPHeaderForRequest:(ASIHTTPRequest *)request bodyLength:(unsigned long long)bodyLength
+{
+	NSString *statusLine = [request responseStatusMessage];
+	if (!statusLine) {
+		statusLine = [NSString stringWithFormat:@"HTTP/1.1 %i",[request responseStatusCode]];
+	}
+	NSMutableString *header = [NSMutableString stringWithFormat:@"%@\r\n",statusLine];
+	for (NSString *name in [request responseHeaders]) {
+		NSString *lowercaseName = [name lowercaseString];
+		if ([lowercaseName isEqualToString:@"content-encoding"] || [lowercaseName isEqualToString:@"transfer-encoding"] || [lowercaseName isEqualToString:@"content-length"]) {
+			continue;
+		}
+		[header appendFormat:@"%@: %@\r\n",name,[[request responseHeaders] objectForKey:name]];
+	}
+	[header appendFormat:@"Content-Length: %llu\r\n\r\n",bodyLength];
+	return [header dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (NSError *)errorWithDescription:(NSString *)description
+{
+	return [NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:description,NSLocalizedDescriptionKey,nil]];
+}
+
+#pragma mark reading
+
+- (BOOL)containsResponseForURL:(NSURL *)url
+{
+	[[self accessLock] lock];
+	BOOL found = ([[self index] objectForKey:[[url absoluteURL] absoluteString]] != nil);
+	[[self accessLock] unlock];
+	return found;
+}
+
+- (NSData *)responseDataForURL:(NSURL *)url
+{
+	[[self accessLock] lock];
+	NSArray *entry = [[[[self index] objectForKey:[[url absoluteURL] absoluteString]] retain] autorelease];
+	NSData *data = nil;
+	if (entry) {
+		NSFileHandle *fileHandle = [NSFileHandle fileHandleForReadingAtPath:[self path]];
+		[fileHandle seekToFileOffset:[[entry objectAtIndex:1] unsignedLongLongValue]];
+		data = [fileHandle readDataOfLength:(NSUInteger)[[entry objectAtIndex:2] unsignedLongLongValue]];
+		[fileHandle closeFile];
+	}
+	[[self accessLock] unlock];
+	return data;
+}
+
+- (NSString *)contentTypeForURL:(NSURL *)url
+{
+	[[self accessLock] lock];
+	NSString *contentType = [[[[[self index] objectForKey:[[url absoluteURL] absoluteString]] lastObject] retain] autorelease];
+	[[self accessLock] unlock];
+	return contentType;
+}
+
+- (NSArray *)archivedURLs
+{
+	[[self accessLock] lock];
+	NSMutableArray *urls = [NSMutableArray arrayWithCapacity:[[self index] count]];
+	for (NSString *url in [self index]) {
+		[urls addObject:[NSURL URLWithString:url]];
+	}
+	[[self accessLock] unlock];
+	return urls;
+}
+
+@synthesize path;
+@synthesize indexPath;
+@synthesize index;
+@synthesize dateFormatter;
+@synthesize accessLock;
+@end
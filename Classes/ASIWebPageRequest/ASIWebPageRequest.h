@@ -9,6 +9,8 @@
 //  It is strongly recommend to set a downloadDestinationPath when using ASIWebPageRequest
 //  Also, performance will be better if your ASIWebPageRequest has a downloadCache setup
 //  Known issue: You cannot use startSychronous with an ASIWebPageRequest
+//  HTML pages and stylesheets are parsed as they download, so external resources start downloading before the page itself has finished
+//  This is why ASIWebPageRequests default to inflating gzipped responses as they arrive (shouldWaitToInflateCompressedResponses is NO)
 
 #import "ASIHTTPRequest.h"
 #import <libxml/HTMLparser.h>
@@ -17,6 +19,8 @@
 #import <libxml/xpathInternals.h>
 
 @class ASINetworkQueue;
+@class ASICSSTokenizer;
+@class ASIWebArchive;
 
 // Used internally for storing what type of data we got from the server
 typedef enum _ASIWebContentType {
@@ -25,6 +29,20 @@ typedef enum _ASIWebContentType {
     ASICSSWebContentType = 2
 } ASIWebContentType;
 
+// The kinds of external resource ASIWebPageRequest fetches, used to decide which to fetch first
+// Stylesheets and frames come first, as they are parsed for resources of their own
+// Then scripts and fonts, which are needed to render the page, then images, and finally audio and video
+typedef enum _ASIWebResourceType {
+	// We don't know where the url came from, so we'll guess from its file extension
+	ASIUnknownWebResourceType = 0,
+	ASIStylesheetWebResourceType = 1,
+	ASIFrameWebResourceType = 2,
+	ASIScriptWebResourceType = 3,
+	ASIFontWebResourceType = 4,
+	ASIImageWebResourceType = 5,
+	ASIMediaWebResourceType = 6
+} ASIWebResourceType;
+
 // These correspond with the urlReplacementMode property of ASIWebPageRequest
 typedef enum _ASIURLReplacementMode {
 
@@ -32,28 +50,71 @@ typedef enum _ASIURLReplacementMode {
     ASIDontModifyURLs = 0,
 
 	// Replace external resources urls (images, stylesheets etc) with data uris, so their content is embdedded directly in the html/css
+	// Resources are base64 encoded a chunk at a time as the page is written out, so memory use doesn't grow with the size of the resources
+	// (As long as you set a downloadDestinationPath - otherwise, the whole page will end up in memory)
     ASIReplaceExternalResourcesWithData = 1,
 
 	// Replace external resource urls with the url of locally cached content
 	// You must set the baseURL of a WebView / UIWebView to a file url pointing at the downloadDestinationPath of the main ASIWebPageRequest if you want to display your content
     // See the Mac or iPhone example projects for a demonstration of how to do this
 	// The hrefs of all hyperlinks are changed to use absolute urls when using this mode
-	ASIReplaceExternalResourcesWithLocalURLs = 2
+	ASIReplaceExternalResourcesWithLocalURLs = 2,
+
+	// Leave urls as they are, and store the page and all its resources in the ASIWebArchive set with setWebArchive:
+	// Resources are copied into the archive as soon as they finish downloading, and the page itself is added just before the request finishes
+	// Any number of pages can share the same archive, so archiving lots of pages doesn't create lots of files
+	ASIStoreResourcesInWebArchive = 3
 } ASIURLReplacementMode;
 
 
 
 @interface ASIWebPageRequest : ASIHTTPRequest {
 
-	// Each ASIWebPageRequest for an HTML or CSS file creates its own internal queue to download external resources
+	// The root ASIWebPageRequest (the one without a parentRequest) creates a single internal queue to download external resources
+	// This is shared by every request for the page's resources, including those found in stylesheets and frames, so they all share one concurrency limit
 	ASINetworkQueue *externalResourceQueue;
 
 	// This dictionary stores a list of external resources to download, along with their content-type data or a path to the data
 	NSMutableDictionary *resourceList;
 
+	// Only used by the root request
+	// Maps the absolute url of every external resource needed anywhere in the page to the request that fetches it, and the requests waiting for it
+	// This means a resource is only fetched once, however many times (and from however many stylesheets) it is referenced
+	NSMutableDictionary *sharedResources;
+
+	// Keys in the root request's sharedResources for the resources this request is still waiting for
+	NSMutableArray *outstandingResourceKeys;
+
 	// Used internally for parsing HTML (with libxml)
 	xmlDocPtr doc;
 
+	// Used internally for parsing HTML as it downloads (with libxml's push parser)
+	// This is only set while we are reading an HTML response
+	htmlParserCtxtPtr parserContext;
+
+	// Used internally for reading CSS as it downloads
+	// This is only set while we are reading a CSS response
+	ASICSSTokenizer *cssTokenizer;
+
+	// External resource urls found by the parser in the last chunk of HTML or CSS we read
+	// These are passed to the main thread to be fetched after each chunk is parsed
+	NSMutableArray *pendingResourceURLs;
+
+	// The ASIWebResourceType of each url in pendingResourceURLs, based on the element or rule it came from
+	NSMutableArray *pendingResourceTypes;
+
+	// Set to YES when the HTML or CSS in this response was parsed as it downloaded
+	BOOL parsedWhileDownloading;
+
+	// Set to YES on the main thread once the whole response has been parsed
+	// Until this is set, we may not have found all the resources we need, even if none are outstanding
+	BOOL finishedParsing;
+
+	// When replacing urls with data uris, urls in the page are first replaced with placeholders made from this prefix and an index into dataURIPlaceholders
+	// The data uris are written in place of the placeholders when the page is written out
+	NSString *dataURIPlaceholderPrefix;
+	NSMutableArray *dataURIPlaceholders;
+
 	// If the response is an HTML or CSS file, this will be set so the content can be correctly parsed when it has finished fetching external resources
 	ASIWebContentType webContentType;
 
@@ -64,17 +125,52 @@ typedef enum _ASIURLReplacementMode {
 
 	// Controls what ASIWebPageRequest does with external resources. See the notes above for more.
 	ASIURLReplacementMode urlReplacementMode;
+
+	// The archive responses are written to when using ASIStoreResourcesInWebArchive
+	ASIWebArchive *webArchive;
+
+	// Limits on how much the root request will fetch. Resources over these limits are not fetched, and their urls are left as they are
+	// A value of zero means no limit
+	// How many levels of resources to fetch - 1 fetches only the resources referred to by the page itself, 2 also fetches the images in its stylesheets, etc
+	NSUInteger maxResourceDepth;
+
+	// The largest single resource to fetch, in bytes
+	// Resources that turn out to be larger are cancelled part way through
+	unsigned long long maxResourceSize;
+
+	// Once this many bytes of resources have been downloaded, no more resources will be fetched
+	// Resources that have already started are allowed to finish, so the total may go over this a little
+	unsigned long long maxTotalResourceSize;
+
+	// Total bytes downloaded for finished resources, only used by the root request
+	unsigned long long fetchedResourceBytes;
+
+	// Set on a request for an external resource when it was cancelled because it was larger than maxResourceSize
+	BOOL exceededMaxResourceSize;
 }
 
 // Will return a data URI that contains a base64 version of the content at this url
 // This is used when replacing urls in the html and css with actual data
 // If you subclass ASIWebPageRequest, you can override this function to return different content or a url pointing at another location
+// Note that if you don't override this, it is not used when writing out the page, as the content is streamed straight from the resource into the page instead
 - (NSString *)contentForExternalURL:(NSString *)theURL;
 
 // Returns the location that a downloaded external resource's content will be stored in
 - (NSString *)cachePathForRequest:(ASIWebPageRequest *)theRequest;
 
+// Works out what kind of resource a url points to from its file extension
+// This is used for urls we found in stylesheets and style attributes, where we don't know what kind of resource to expect
++ (ASIWebResourceType)resourceTypeForURL:(NSString *)theURL;
+
+// Returns the priority in the root request's queue for a kind of resource
+// Override in a subclass if you want to fetch resources in a different order
++ (NSOperationQueuePriority)queuePriorityForResourceType:(ASIWebResourceType)resourceType;
+
 
 @property (retain, nonatomic) ASIWebPageRequest *parentRequest;
 @property (assign, nonatomic) ASIURLReplacementMode urlReplacementMode;
+@property (retain, nonatomic) ASIWebArchive *webArchive;
+@property (assign, nonatomic) NSUInteger maxResourceDepth;
+@property (assign, nonatomic) unsigned long long maxResourceSize;
+@property (assign, nonatomic) unsigned long long maxTotalResourceSize;
 @end
@@ -9,60 +9,208 @@
 
 #import "ASIWebPageRequest.h"
 #import "ASINetworkQueue.h"
+#import "ASICSSTokenizer.h"
+#import "ASIWebArchive.h"
 #import <CommonCrypto/CommonHMAC.h>
+#import <libxml/SAX2.h>
 
 // An xPath query that controls the external resources ASIWebPageRequest will fetch
 // By default, it will fetch stylesheets, javascript files, images, frames, iframes, and html 5 video / audio
 static xmlChar *xpathExpr = (xmlChar *)"//link/@href|//a/@href|//script/@src|//img/@src|//frame/@src|//iframe/@src|//style|//*/@style|//source/@src|//video/@poster|//audio/@src";
 
-static NSLock *xmlParsingLock = nil;
-static NSMutableArray *requestsUsingXMLParser = nil;
+// SAX handler used when parsing HTML as it downloads
+static htmlSAXHandler incrementalParsingHandler;
+
+// Amount of a resource we base64 encode at a time when writing data uris
+// This must be a multiple of 3, so the encoded chunks join up without padding
+static const NSUInteger dataURIChunkSize = 49152;
+
+// Number of hex digits used for the index at the end of a data uri placeholder
+static const NSUInteger dataURIPlaceholderIndexLength = 8;
+
+// Maps lowercase file extensions to the ASIWebResourceType of resources that use them
+// Built once in +initialize, so any thread can read it without taking a lock
+static NSDictionary *resourceTypesByExtension = nil;
 
 @interface ASIWebPageRequest ()
 - (void)readResourceURLs;
 - (void)updateResourceURLs;
 - (void)parseAsHTML;
 - (void)parseAsCSS;
-- (void)addURLToFetch:(NSString *)newURL;
+- (NSString *)addURLToFetch:(NSString *)newURL;
+- (ASIWebContentType)webContentTypeFromHeaders;
+- (xmlCharEncoding)characterEncoding;
+
+- (void)startParsingHTML;
+- (void)startParsingCSS;
+- (BOOL)canTokenizeResponseBytes;
+- (void)parseHTMLBytes:(const void *)bytes length:(NSUInteger)length;
+- (void)finishParsingHTML;
+- (void)discardParserContext;
+- (void)didFinishParsing;
+- (void)readResourceURLsFromElement:(xmlNodePtr)element;
+- (void)readResourceURLsFromStyleElement:(xmlNodePtr)element;
+- (void)resetPendingResources;
+- (void)addPendingResourceURL:(NSString *)theURL type:(ASIWebResourceType)resourceType;
+- (void)addPendingResourceURLs:(NSArray *)urls type:(ASIWebResourceType)resourceType;
+- (void)fetchPendingResources;
+- (void)fetchExternalResources:(NSDictionary *)resources;
+
+- (ASIWebPageRequest *)rootRequest;
+- (void)fetchResourceAtPath:(NSString *)path type:(ASIWebResourceType)resourceType forRequest:(ASIWebPageRequest *)theRequest;
+- (NSUInteger)resourceDepth;
+- (BOOL)exceededMaxResourceSize;
+- (void)cancelResourceOverMaxSize;
+- (BOOL)resourceWithKey:(NSString *)key isWaitingOnRequest:(ASIWebPageRequest *)theRequest;
+- (void)waitForResourceWithKey:(NSString *)key;
+- (void)finishedWaitingForResourceWithKey:(NSString *)key;
+- (void)useExternalResource:(ASIHTTPRequest *)externalResourceRequest forPath:(NSString *)path;
+- (void)externalResourceFailed:(ASIHTTPRequest *)externalResourceRequest;
+- (void)cancelLoadAndFailWithError:(NSError *)theError;
+- (void)releaseSharedResources;
+- (void)createExternalResourceQueue;
+- (ASIWebPageRequest *)requestForExternalResource:(NSString *)theURL;
 + (NSArray *)CSSURLsFromString:(NSString *)string;
 - (NSString *)relativePathTo:(NSString *)destinationPath fromPath:(NSString *)sourcePath;
+- (NSString *)replacementForExternalURL:(NSString *)theURL;
+- (BOOL)replaceDataURIPlaceholders;
+- (BOOL)writeContent:(NSData *)content toStream:(NSOutputStream *)stream;
+- (BOOL)writeDataURIForExternalURL:(NSString *)theURL toStream:(NSOutputStream *)stream;
 
-- (void)finishedFetchingExternalResources:(ASINetworkQueue *)queue;
+// Private in ASIHTTPRequest
+- (void)cancelLoad;
+- (NSString *)runLoopMode;
+
+- (BOOL)addToWebArchive:(ASIHTTPRequest *)theRequest;
+- (void)finishedFetchingExternalResources;
 - (void)externalResourceFetchSucceeded:(ASIHTTPRequest *)externalResourceRequest;
 - (void)externalResourceFetchFailed:(ASIHTTPRequest *)externalResourceRequest;
 
 @property (retain, nonatomic) ASINetworkQueue *externalResourceQueue;
 @property (retain, nonatomic) NSMutableDictionary *resourceList;
+@property (retain, nonatomic) NSMutableArray *pendingResourceURLs;
+@property (retain, nonatomic) NSMutableArray *pendingResourceTypes;
+@property (retain, nonatomic) ASICSSTokenizer *cssTokenizer;
+@property (retain, nonatomic) NSString *dataURIPlaceholderPrefix;
+@property (retain, nonatomic) NSMutableArray *dataURIPlaceholders;
+@property (retain, nonatomic) NSMutableDictionary *sharedResources;
+@property (retain, nonatomic) NSMutableArray *outstandingResourceKeys;
 @end
 
+// libxml always stores strings as UTF-8, whatever the encoding of the document
+static NSString *ASIAttributeValue(xmlNodePtr element, const char *attributeName)
+{
+	xmlChar *value = xmlGetNoNsProp(element, (const xmlChar *)attributeName);
+	if (!value) {
+		return nil;
+	}
+	NSString *string = [NSString stringWithUTF8String:(const char *)value];
+	xmlFree(value);
+	return string;
+}
+
+// SAX callbacks used when parsing HTML as it downloads
+// These build the document in the same way as the default handlers, but also look at each element as it is parsed to find external resources
+static void ASIStartElement(void *ctx, const xmlChar *name, const xmlChar **attributes)
+{
+	htmlParserCtxtPtr context = (htmlParserCtxtPtr)ctx;
+	xmlSAX2StartElement(ctx, name, attributes);
+	if (context->node && context->_private) {
+		[(ASIWebPageRequest *)context->_private readResourceURLsFromElement:context->node];
+	}
+}
+
+static void ASIEndElement(void *ctx, const xmlChar *name)
+{
+	htmlParserCtxtPtr context = (htmlParserCtxtPtr)ctx;
+	// We look at the contents of <style> tags when they are closed, as we don't have the whole stylesheet until then
+	if (context->node && context->_private && !xmlStrcasecmp(name, (const xmlChar *)"style") && !xmlStrcasecmp(context->node->name, (const xmlChar *)"style")) {
+		[(ASIWebPageRequest *)context->_private readResourceURLsFromStyleElement:context->node];
+	}
+	xmlSAX2EndElement(ctx, name);
+}
+
 @implementation ASIWebPageRequest
 
 + (void)initialize
 {
 	if (self == [ASIWebPageRequest class]) {
-		xmlParsingLock = [[NSLock alloc] init];
-		requestsUsingXMLParser = [[NSMutableArray alloc] init];
+		// libxml needs to set up its global state before it is used from more than one thread
+		// Once this is done, each request can parse with its own context (and document) on any thread, without taking a lock
+		// We never call xmlCleanupParser(), as there's no safe time to do it while other requests might be parsing
+		xmlInitParser();
+		xmlSAX2InitHtmlDefaultSAXHandler(&incrementalParsingHandler);
+		incrementalParsingHandler.startElement = ASIStartElement;
+		incrementalParsingHandler.endElement = ASIEndElement;
+
+		NSNumber *stylesheet = [NSNumber numberWithInt:ASIStylesheetWebResourceType];
+		NSNumber *frame = [NSNumber numberWithInt:ASIFrameWebResourceType];
+		NSNumber *script = [NSNumber numberWithInt:ASIScriptWebResourceType];
+		NSNumber *font = [NSNumber numberWithInt:ASIFontWebResourceType];
+		NSNumber *image = [NSNumber numberWithInt:ASIImageWebResourceType];
+		NSNumber *media = [NSNumber numberWithInt:ASIMediaWebResourceType];
+		resourceTypesByExtension = [[NSDictionary alloc] initWithObjectsAndKeys:
+			stylesheet,@"css",
+			frame,@"html",frame,@"htm",frame,@"xhtml",
+			script,@"js",
+			font,@"woff",font,@"woff2",font,@"ttf",font,@"otf",font,@"eot",
+			image,@"png",image,@"jpg",image,@"jpeg",image,@"gif",image,@"webp",image,@"svg",image,@"ico",image,@"bmp",image,@"tif",image,@"tiff",
+			media,@"mp4",media,@"m4v",media,@"mov",media,@"mp3",media,@"m4a",media,@"aac",media,@"wav",
+			nil];
 	}
 }
 
+- (id)initWithURL:(NSURL *)newURL
+{
+	self = [super initWithURL:newURL];
+	// Inflate gzipped pages as they arrive, so we can parse them while they download
+	[self setShouldWaitToInflateCompressedResponses:NO];
+	return self;
+}
+
 - (void)dealloc
 {
+	[self discardParserContext];
+	if (doc) {
+		xmlFreeDoc(doc);
+	}
 	[externalResourceQueue cancelAllOperations];
 	[externalResourceQueue release];
 	[resourceList release];
+	[pendingResourceURLs release];
+	[pendingResourceTypes release];
+	[cssTokenizer release];
+	[dataURIPlaceholderPrefix release];
+	[dataURIPlaceholders release];
+	[sharedResources release];
+	[outstandingResourceKeys release];
 	[parentRequest release];
+	[webArchive release];
 	[super dealloc];
 }
 
 // This is a bit of a hack
 // The role of this method in normal ASIHTTPRequests is to tell the queue we are done with the request, and perform some cleanup
-// We override it to stop that happening, and instead do that work in the bottom of finishedFetchingExternalResources:
+// We override it to stop that happening, and instead do that work in the bottom of finishedFetchingExternalResources
+// Requests for external resources are the exception - they share the root request's queue with the requests for their own resources,
+// so they give up their place in it as soon as they have downloaded. Otherwise, a few stylesheets waiting on their images could fill the queue
 - (void)markAsFinished
 {
+	if ([self parentRequest]) {
+		[super markAsFinished];
+	}
+}
+
+- (void)failWithError:(NSError *)theError
+{
+	[super failWithError:theError];
+	if (![self parentRequest]) {
+		[self performSelectorOnMainThread:@selector(releaseSharedResources) withObject:nil waitUntilDone:[NSThread isMainThread]];
+	}
 }
 
 // This method is normally responsible for telling delegates we are done, but it happens to be the most convenient place to parse the responses
-// Again, we call the super implementation in finishedFetchingExternalResources:, or here if this download was not an HTML or CSS file
+// Again, we call the super implementation in finishedFetchingExternalResources, or here if this download was not an HTML or CSS file
 - (void)requestFinished
 {
 	complete = NO;
@@ -72,80 +220,129 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 		return;
 	}
 	webContentType = ASINotParsedWebContentType;
-	NSString *contentType = [[[self responseHeaders] objectForKey:@"Content-Type"] lowercaseString];
-	contentType = [[contentType componentsSeparatedByString:@";"] objectAtIndex:0];
-	if ([contentType isEqualToString:@"text/html"] || [contentType isEqualToString:@"text/xhtml"] || [contentType isEqualToString:@"text/xhtml+xml"] || [contentType isEqualToString:@"application/xhtml+xml"]) {
-		[self parseAsHTML];
+	ASIWebContentType contentType = [self webContentTypeFromHeaders];
+	if (contentType == ASIHTMLWebContentType) {
+		if (parserContext) {
+			[self finishParsingHTML];
+		} else {
+			[self parseAsHTML];
+		}
 		return;
-	} else if ([contentType isEqualToString:@"text/css"]) {
+	} else if (contentType == ASICSSWebContentType) {
 		[self parseAsCSS];
 		return;
 	}
+	if (![self parentRequest] && ![self addToWebArchive:self]) {
+		return;
+	}
 	[super requestFinished];
 	[super markAsFinished];
 }
 
+- (ASIWebContentType)webContentTypeFromHeaders
+{
+	NSString *contentType = [[[self responseHeaders] objectForKey:@"Content-Type"] lowercaseString];
+	contentType = [[contentType componentsSeparatedByString:@";"] objectAtIndex:0];
+	if ([contentType isEqualToString:@"text/html"] || [contentType isEqualToString:@"text/xhtml"] || [contentType isEqualToString:@"text/xhtml+xml"] || [contentType isEqualToString:@"application/xhtml+xml"]) {
+		return ASIHTMLWebContentType;
+	} else if ([contentType isEqualToString:@"text/css"]) {
+		return ASICSSWebContentType;
+	}
+	return ASINotParsedWebContentType;
+}
+
+// Stylesheets we read as they downloaded have already been through the tokenizer, otherwise we read the whole response now
 - (void)parseAsCSS
 {
 	webContentType = ASICSSWebContentType;
 
-	NSString *responseCSS = nil;
-	NSError *err = nil;
-	if ([self downloadDestinationPath]) {
-		responseCSS = [NSString stringWithContentsOfFile:[self downloadDestinationPath] encoding:[self responseEncoding] error:&err];
-	} else {
-		responseCSS = [self responseString];
+	if (![self cssTokenizer]) {
+		NSData *responseCSS = nil;
+		if ([self downloadDestinationPath]) {
+			responseCSS = [NSData dataWithContentsOfMappedFile:[self downloadDestinationPath]];
+		} else {
+			responseCSS = [self responseData];
+		}
+		if (!responseCSS) {
+			[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:100 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Unable to read CSS from response",NSLocalizedDescriptionKey,nil]]];
+			return;
+		}
+		// The tokenizer only understands encodings where ASCII characters are single bytes, so anything else is converted to UTF-8 first
+		if (![self canTokenizeResponseBytes]) {
+			NSString *css = [[[NSString alloc] initWithData:responseCSS encoding:[self responseEncoding]] autorelease];
+			if (!css) {
+				[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:100 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Unable to read CSS from response",NSLocalizedDescriptionKey,nil]]];
+				return;
+			}
+			responseCSS = [css dataUsingEncoding:NSUTF8StringEncoding];
+		}
+		[self setCssTokenizer:[[[ASICSSTokenizer alloc] init] autorelease]];
+		[[self cssTokenizer] tokenizeBytes:(const unsigned char *)[responseCSS bytes] length:[responseCSS length]];
 	}
-	if (err) {
-		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:100 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Unable to read HTML string from response",NSLocalizedDescriptionKey,err,NSUnderlyingErrorKey,nil]]];
-		return;
-	} else if (!responseCSS) {
-		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:100 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Unable to read HTML string from response",NSLocalizedDescriptionKey,nil]]];
-		return;
+	[[self cssTokenizer] finish];
+	if (![self pendingResourceURLs]) {
+		[self resetPendingResources];
 	}
-	NSArray *urls = [[self class] CSSURLsFromString:responseCSS];
+	[self addPendingResourceURLs:[[self cssTokenizer] takeURLs] type:ASIUnknownWebResourceType];
+	[self setCssTokenizer:nil];
 
-	[self setResourceList:[NSMutableDictionary dictionary]];
+	[self fetchPendingResources];
+	[self performSelectorOnMainThread:@selector(didFinishParsing) withObject:nil waitUntilDone:[NSThread isMainThread]];
+}
 
-	for (NSString *theURL in urls) {
-		[self addURLToFetch:theURL];
-	}
-	if (![[self resourceList] count]) {
-		[super requestFinished];
-		[super markAsFinished];
-		return;
+// Returns NO for UTF-16 and UTF-32 responses, where we can't look for urls in the raw bytes
+- (BOOL)canTokenizeResponseBytes
+{
+	switch ([self responseEncoding]) {
+		case NSUnicodeStringEncoding:
+		case NSUTF16BigEndianStringEncoding:
+		case NSUTF16LittleEndianStringEncoding:
+		case NSUTF32StringEncoding:
+		case NSUTF32BigEndianStringEncoding:
+		case NSUTF32LittleEndianStringEncoding:
+			return NO;
+		default:
+			return YES;
 	}
+}
 
-	// Create a new request for every item in the queue
+// Only used by the root request
+- (void)createExternalResourceQueue
+{
 	[[self externalResourceQueue] cancelAllOperations];
 	[self setExternalResourceQueue:[ASINetworkQueue queue]];
 	[[self externalResourceQueue] setDelegate:self];
 	[[self externalResourceQueue] setShowAccurateProgress:[self showAccurateProgress]];
-	[[self externalResourceQueue] setQueueDidFinishSelector:@selector(finishedFetchingExternalResources:)];
 	[[self externalResourceQueue] setRequestDidFinishSelector:@selector(externalResourceFetchSucceeded:)];
 	[[self externalResourceQueue] setRequestDidFailSelector:@selector(externalResourceFetchFailed:)];
-	for (NSString *theURL in [[self resourceList] keyEnumerator]) {
-		ASIWebPageRequest *externalResourceRequest = [ASIWebPageRequest requestWithURL:[NSURL URLWithString:theURL relativeToURL:[self url]]];
-		[externalResourceRequest setRequestHeaders:[self requestHeaders]];
-		[externalResourceRequest setDownloadCache:[self downloadCache]];
-		[externalResourceRequest setCachePolicy:[self cachePolicy]];
-		[externalResourceRequest setCacheStoragePolicy:[self cacheStoragePolicy]];
-		[externalResourceRequest setUserInfo:[NSDictionary dictionaryWithObject:theURL forKey:@"Path"]];
-		[externalResourceRequest setParentRequest:self];
-		[externalResourceRequest setUrlReplacementMode:[self urlReplacementMode]];
-		[externalResourceRequest setShouldResetDownloadProgress:NO];
-		[externalResourceRequest setDelegate:self];
-		[externalResourceRequest setUploadProgressDelegate:self];
-		[externalResourceRequest setDownloadProgressDelegate:self];
-		if ([self downloadDestinationPath]) {
-			[externalResourceRequest setDownloadDestinationPath:[self cachePathForRequest:externalResourceRequest]];
-		}
-		[[self externalResourceQueue] addOperation:externalResourceRequest];
+}
+
+- (ASIWebPageRequest *)requestForExternalResource:(NSString *)theURL
+{
+	ASIWebPageRequest *externalResourceRequest = [ASIWebPageRequest requestWithURL:[NSURL URLWithString:theURL relativeToURL:[self url]]];
+	[externalResourceRequest setRequestHeaders:[self requestHeaders]];
+	[externalResourceRequest setDownloadCache:[self downloadCache]];
+	[externalResourceRequest setCachePolicy:[self cachePolicy]];
+	[externalResourceRequest setCacheStoragePolicy:[self cacheStoragePolicy]];
+	[externalResourceRequest setParentRequest:self];
+	[externalResourceRequest setUrlReplacementMode:[self urlReplacementMode]];
+	[externalResourceRequest setWebArchive:[self webArchive]];
+	[externalResourceRequest setShouldResetDownloadProgress:NO];
+	[externalResourceRequest setDelegate:self];
+	[externalResourceRequest setUploadProgressDelegate:self];
+	[externalResourceRequest setDownloadProgressDelegate:self];
+	if ([self downloadDestinationPath]) {
+		[externalResourceRequest setDownloadDestinationPath:[self cachePathForRequest:externalResourceRequest]];
 	}
-	[[self externalResourceQueue] go];
+	return externalResourceRequest;
 }
 
 - (const char *)encodingName
+{
+	return xmlGetCharEncodingName([self characterEncoding]);
+}
+
+- (xmlCharEncoding)characterEncoding
 {
 	xmlCharEncoding encoding = XML_CHAR_ENCODING_NONE;
 	switch ([self responseEncoding])
@@ -193,22 +390,13 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 			encoding = XML_CHAR_ENCODING_ERROR;
 			break;
 	}
-	return xmlGetCharEncodingName(encoding);
+	return encoding;
 }
 
 - (void)parseAsHTML
 {
 	webContentType = ASIHTMLWebContentType;
 
-	// Only allow parsing of a single document at a time
-	[xmlParsingLock lock];
-
-	if (![requestsUsingXMLParser count]) {
-		xmlInitParser();
-	}
-	[requestsUsingXMLParser addObject:self];
-
-
     /* Load XML document */
 	if ([self downloadDestinationPath]) {
 		doc = htmlReadFile([[self downloadDestinationPath] cStringUsingEncoding:NSUTF8StringEncoding], [self encodingName], HTML_PARSE_NONET | HTML_PARSE_NOWARNING | HTML_PARSE_NOERROR);
@@ -220,67 +408,474 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:101 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Error: unable to parse reponse XML",NSLocalizedDescriptionKey,nil]]];
 		return;
     }
-	
-	[self setResourceList:[NSMutableDictionary dictionary]];
+
+	[self resetPendingResources];
 
     // Populate the list of URLS to download
     [self readResourceURLs];
 
-	if ([self error] || ![[self resourceList] count]) {
-		[requestsUsingXMLParser removeObject:self];
+	if ([self error]) {
 		xmlFreeDoc(doc);
 		doc = NULL;
+		return;
 	}
+	[self fetchPendingResources];
+	[self performSelectorOnMainThread:@selector(didFinishParsing) withObject:nil waitUntilDone:[NSThread isMainThread]];
+}
+
+#pragma mark parsing HTML and CSS as it downloads
 
-	[xmlParsingLock unlock];
+// Decides if we can parse this response while it downloads, as soon as we have its headers
+- (void)readResponseHeaders
+{
+	[super readResponseHeaders];
+	if (![self responseHeaders]) {
+		return;
+	}
+	if ([self parentRequest] && [[self rootRequest] maxResourceSize] && contentLength > [[self rootRequest] maxResourceSize] && !needsRedirect) {
+		[self cancelResourceOverMaxSize];
+		return;
+	}
+	[self discardParserContext];
+	[self setCssTokenizer:nil];
+	parsedWhileDownloading = NO;
+	finishedParsing = NO;
+
+	// We only parse as we go when we'll be reading the whole body of a successful response from the server
+	// Anything else (eg a resumed download, or a response we can't inflate as it arrives) is parsed in one go when it has finished downloading
+	if ([self mainRequest] || [self complete] || needsRedirect || [self partialDownloadSize] || [self responseStatusCode] < 200 || [self responseStatusCode] > 299) {
+		return;
+	}
+	if ([self isResponseCompressed] && [self shouldWaitToInflateCompressedResponses]) {
+		return;
+	}
+	ASIWebContentType contentType = [self webContentTypeFromHeaders];
+	if (contentType == ASIHTMLWebContentType) {
+		[self startParsingHTML];
+	} else if (contentType == ASICSSWebContentType && [self canTokenizeResponseBytes]) {
+		[self startParsingCSS];
+	}
+}
+
+- (void)startParsingHTML
+{
+	// If we don't know the encoding yet, libxml will try to work it out from the document
+	xmlCharEncoding encoding = [self characterEncoding];
+	if (encoding == XML_CHAR_ENCODING_ERROR) {
+		encoding = XML_CHAR_ENCODING_NONE;
+	}
+	parserContext = htmlCreatePushParserCtxt(&incrementalParsingHandler, NULL, NULL, 0, NULL, encoding);
+	if (!parserContext) {
+		return;
+	}
+	htmlCtxtUseOptions(parserContext, HTML_PARSE_NONET | HTML_PARSE_NOWARNING | HTML_PARSE_NOERROR);
+	parserContext->_private = self;
+	[self resetPendingResources];
+	parsedWhileDownloading = YES;
+}
+
+- (void)startParsingCSS
+{
+	[self setCssTokenizer:[[[ASICSSTokenizer alloc] init] autorelease]];
+	[self resetPendingResources];
+	parsedWhileDownloading = YES;
+}
+
+- (void)didReceiveResponseBytes:(const void *)bytes length:(NSUInteger)length
+{
+	if (parserContext) {
+		[self parseHTMLBytes:bytes length:length];
+	} else if ([self cssTokenizer]) {
+		[[self cssTokenizer] tokenizeBytes:(const unsigned char *)bytes length:length];
+		[self addPendingResourceURLs:[[self cssTokenizer] takeURLs] type:ASIUnknownWebResourceType];
+	} else {
+		return;
+	}
+	[self fetchPendingResources];
+}
+
+// Responses for external resources that don't tell us their size up front are checked against maxResourceSize as they arrive
+- (void)handleBytesAvailable
+{
+	[super handleBytesAvailable];
+	if ([self parentRequest] && ![self complete] && [[self rootRequest] maxResourceSize] && [self totalBytesRead] > [[self rootRequest] maxResourceSize]) {
+		[self cancelResourceOverMaxSize];
+	}
+}
+
+- (void)cancelResourceOverMaxSize
+{
+	exceededMaxResourceSize = YES;
+	[self cancelLoad];
+	[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:101 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Error: external resource is larger than maxResourceSize",NSLocalizedDescriptionKey,nil]]];
+}
+
+- (BOOL)exceededMaxResourceSize
+{
+	return exceededMaxResourceSize;
+}
+
+- (void)parseHTMLBytes:(const void *)bytes length:(NSUInteger)length
+{
+	htmlParseChunk(parserContext, (const char *)bytes, (int)length, 0);
+}
 
+// Called when the whole response has been read, to parse anything left in the parser's buffer and take the finished document
+- (void)finishParsingHTML
+{
+	webContentType = ASIHTMLWebContentType;
+
+	htmlParseChunk(parserContext, NULL, 0, 1);
+
+	doc = parserContext->myDoc;
+	parserContext->myDoc = NULL;
+	[self discardParserContext];
+
+	if (doc == NULL) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:101 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Error: unable to parse reponse XML",NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	[self fetchPendingResources];
+	[self performSelectorOnMainThread:@selector(didFinishParsing) withObject:nil waitUntilDone:[NSThread isMainThread]];
+}
+
+- (void)discardParserContext
+{
+	if (parserContext) {
+		if (parserContext->myDoc) {
+			xmlFreeDoc(parserContext->myDoc);
+		}
+		htmlFreeParserCtxt(parserContext);
+		parserContext = NULL;
+	}
+}
+
+// Runs on the main thread once we've parsed the whole response, after any resources found in it have been passed to fetchExternalResources:
+- (void)didFinishParsing
+{
+	finishedParsing = YES;
 	if ([self error]) {
 		return;
-	} else if (![[self resourceList] count]) {
+	}
+	if (![[self resourceList] count]) {
+		if (doc) {
+			xmlFreeDoc(doc);
+			doc = NULL;
+		}
+		if (![self parentRequest] && ![self addToWebArchive:self]) {
+			return;
+		}
 		[super requestFinished];
 		[super markAsFinished];
+
+	// All the resources we found were fetched before we reached the end of the response (or had already been fetched for another part of the page)
+	} else if (![[self outstandingResourceKeys] count]) {
+		[self finishedFetchingExternalResources];
+	}
+}
+
+- (void)readResourceURLsFromElement:(xmlNodePtr)element
+{
+	const char *name = (const char *)element->name;
+	NSString *value = nil;
+	ASIWebResourceType resourceType = ASIUnknownWebResourceType;
+
+	// We're only interested in <link> elements for stylesheets
+	if (!strcasecmp(name, "link")) {
+		if ([[ASIAttributeValue(element, "rel") lowercaseString] isEqualToString:@"stylesheet"]) {
+			value = ASIAttributeValue(element, "href");
+			resourceType = ASIStylesheetWebResourceType;
+		}
+	} else if (!strcasecmp(name, "script")) {
+		value = ASIAttributeValue(element, "src");
+		resourceType = ASIScriptWebResourceType;
+	} else if (!strcasecmp(name, "img")) {
+		value = ASIAttributeValue(element, "src");
+		resourceType = ASIImageWebResourceType;
+	} else if (!strcasecmp(name, "frame") || !strcasecmp(name, "iframe")) {
+		value = ASIAttributeValue(element, "src");
+		resourceType = ASIFrameWebResourceType;
+	} else if (!strcasecmp(name, "video")) {
+		value = ASIAttributeValue(element, "poster");
+		resourceType = ASIImageWebResourceType;
+
+	// As with readResourceURLs, we don't download .webm, .ogv and .ogg files
+	} else if (!strcasecmp(name, "source") || !strcasecmp(name, "audio")) {
+		value = ASIAttributeValue(element, "src");
+		resourceType = ASIMediaWebResourceType;
+		NSString *fileExtension = [[value pathExtension] lowercaseString];
+		if ([fileExtension isEqualToString:@"ogg"] || [fileExtension isEqualToString:@"ogv"] || [fileExtension isEqualToString:@"webm"]) {
+			value = nil;
+		}
+	}
+	if (value) {
+		[self addPendingResourceURL:value type:resourceType];
+	}
+
+	// Look for external images or stylesheets in style attributes
+	NSString *style = ASIAttributeValue(element, "style");
+	if (style) {
+		[self addPendingResourceURLs:[[self class] CSSURLsFromString:style] type:ASIUnknownWebResourceType];
+	}
+}
+
+- (void)readResourceURLsFromStyleElement:(xmlNodePtr)element
+{
+	xmlChar *content = xmlNodeGetContent(element);
+	if (!content) {
 		return;
 	}
-	
-	// Create a new request for every item in the queue
-	[[self externalResourceQueue] cancelAllOperations];
-	[self setExternalResourceQueue:[ASINetworkQueue queue]];
-	[[self externalResourceQueue] setDelegate:self];
-	[[self externalResourceQueue] setShowAccurateProgress:[self showAccurateProgress]];
-	[[self externalResourceQueue] setQueueDidFinishSelector:@selector(finishedFetchingExternalResources:)];
-	[[self externalResourceQueue] setRequestDidFinishSelector:@selector(externalResourceFetchSucceeded:)];
-	[[self externalResourceQueue] setRequestDidFailSelector:@selector(externalResourceFetchFailed:)];
-	for (NSString *theURL in [[self resourceList] keyEnumerator]) {
-		ASIWebPageRequest *externalResourceRequest = [ASIWebPageRequest requestWithURL:[NSURL URLWithString:theURL relativeToURL:[self url]]];
-		[externalResourceRequest setRequestHeaders:[self requestHeaders]];
-		[externalResourceRequest setDownloadCache:[self downloadCache]];
-		[externalResourceRequest setCachePolicy:[self cachePolicy]];
-		[externalResourceRequest setCacheStoragePolicy:[self cacheStoragePolicy]];
-		[externalResourceRequest setUserInfo:[NSDictionary dictionaryWithObject:theURL forKey:@"Path"]];
-		[externalResourceRequest setParentRequest:self];
-		[externalResourceRequest setUrlReplacementMode:[self urlReplacementMode]];
-		[externalResourceRequest setShouldResetDownloadProgress:NO];
-		[externalResourceRequest setDelegate:self];
-		[externalResourceRequest setUploadProgressDelegate:self];
-		[externalResourceRequest setDownloadProgressDelegate:self];
-		if ([self downloadDestinationPath]) {
-			[externalResourceRequest setDownloadDestinationPath:[self cachePathForRequest:externalResourceRequest]];
+	NSString *css = [NSString stringWithUTF8String:(const char *)content];
+	xmlFree(content);
+	if (css) {
+		[self addPendingResourceURLs:[[self class] CSSURLsFromString:css] type:ASIUnknownWebResourceType];
+	}
+}
+
+- (void)resetPendingResources
+{
+	[self setPendingResourceURLs:[NSMutableArray array]];
+	[self setPendingResourceTypes:[NSMutableArray array]];
+}
+
+- (void)addPendingResourceURL:(NSString *)theURL type:(ASIWebResourceType)resourceType
+{
+	[[self pendingResourceURLs] addObject:theURL];
+	[[self pendingResourceTypes] addObject:[NSNumber numberWithInt:resourceType]];
+}
+
+- (void)addPendingResourceURLs:(NSArray *)urls type:(ASIWebResourceType)resourceType
+{
+	for (NSString *theURL in urls) {
+		[self addPendingResourceURL:theURL type:resourceType];
+	}
+}
+
+// Hands resources found in the last chunk of HTML (or in a whole stylesheet) over to the main thread
+// The resource lists and the root request's queue are only touched on the main thread, since that's where the queue tells us about finished requests
+- (void)fetchPendingResources
+{
+	if (![[self pendingResourceURLs] count]) {
+		return;
+	}
+	NSDictionary *resources = [NSDictionary dictionaryWithObjectsAndKeys:[NSArray arrayWithArray:[self pendingResourceURLs]],@"URLs",[NSArray arrayWithArray:[self pendingResourceTypes]],@"Types",nil];
+	[[self pendingResourceURLs] removeAllObjects];
+	[[self pendingResourceTypes] removeAllObjects];
+	[self performSelectorOnMainThread:@selector(fetchExternalResources:) withObject:resources waitUntilDone:[NSThread isMainThread]];
+}
+
+- (void)fetchExternalResources:(NSDictionary *)resources
+{
+	if ([self error] || [self isCancelled]) {
+		return;
+	}
+	if (![self resourceList]) {
+		[self setResourceList:[NSMutableDictionary dictionary]];
+	}
+	NSArray *urls = [resources objectForKey:@"URLs"];
+	NSArray *types = [resources objectForKey:@"Types"];
+	NSUInteger i;
+	for (i=0; i<[urls count]; i++) {
+		NSString *path = [self addURLToFetch:[urls objectAtIndex:i]];
+		if (path) {
+			ASIWebResourceType resourceType = (ASIWebResourceType)[[types objectAtIndex:i] intValue];
+			if (resourceType == ASIUnknownWebResourceType) {
+				resourceType = [[self class] resourceTypeForURL:path];
+			}
+			[[self rootRequest] fetchResourceAtPath:path type:resourceType forRequest:self];
+		}
+	}
+}
+
+#pragma mark fetching external resources
+
+- (ASIWebPageRequest *)rootRequest
+{
+	ASIWebPageRequest *theRequest = self;
+	while ([theRequest parentRequest]) {
+		theRequest = [theRequest parentRequest];
+	}
+	return theRequest;
+}
+
+// Called on the root request (on the main thread) when theRequest finds a resource it needs
+// The root request keeps a single list of every resource fetched for the page and the stylesheets, frames etc it includes, so each one is only fetched once
+// Each entry in sharedResources holds the request that fetches the resource, and the requests that are waiting for it along with the paths they used to refer to it
+// New resources are added to the queue with a priority based on their type, so stylesheets found late in a page don't wait behind all its images
+- (void)fetchResourceAtPath:(NSString *)path type:(ASIWebResourceType)resourceType forRequest:(ASIWebPageRequest *)theRequest
+{
+	NSString *key = [[[NSURL URLWithString:path relativeToURL:[theRequest url]] absoluteURL] absoluteString];
+	if (![self sharedResources]) {
+		[self setSharedResources:[NSMutableDictionary dictionary]];
+	}
+	NSMutableDictionary *resource = [[self sharedResources] objectForKey:key];
+	NSDictionary *reference = [NSDictionary dictionaryWithObjectsAndKeys:theRequest,@"Request",path,@"Path",nil];
+
+	// Nobody has asked for this resource yet, so we'll fetch it, unless that would take us over one of our limits
+	if (!resource) {
+		if (([self maxResourceDepth] && [theRequest resourceDepth] >= [self maxResourceDepth]) || ([self maxTotalResourceSize] && fetchedResourceBytes >= [self maxTotalResourceSize])) {
+			[[theRequest resourceList] removeObjectForKey:path];
+			return;
+		}
+		ASIWebPageRequest *externalResourceRequest = [theRequest requestForExternalResource:path];
+		[externalResourceRequest setUserInfo:[NSDictionary dictionaryWithObjectsAndKeys:path,@"Path",key,@"ResourceKey",nil]];
+		[externalResourceRequest setQueuePriority:[[self class] queuePriorityForResourceType:resourceType]];
+		resource = [NSMutableDictionary dictionaryWithObjectsAndKeys:externalResourceRequest,@"Request",[NSMutableArray arrayWithObject:reference],@"References",nil];
+		[[self sharedResources] setObject:resource forKey:key];
+		[theRequest waitForResourceWithKey:key];
+		if (![self externalResourceQueue]) {
+			[self createExternalResourceQueue];
+			[[self externalResourceQueue] go];
 		}
 		[[self externalResourceQueue] addOperation:externalResourceRequest];
+
+	// Already fetched for another part of the page
+	} else if ([[resource objectForKey:@"Finished"] boolValue]) {
+		[theRequest useExternalResource:[resource objectForKey:@"Request"] forPath:path];
+
+	// Still being fetched, so we'll wait for it to finish
+	// The exception is when the resource is waiting on theRequest itself (eg a stylesheet that imports a stylesheet that imports the first one)
+	// Waiting would mean neither ever finished, so we leave the url alone instead
+	} else if (![self resourceWithKey:key isWaitingOnRequest:theRequest]) {
+		[[resource objectForKey:@"References"] addObject:reference];
+		[theRequest waitForResourceWithKey:key];
+	} else {
+		[[theRequest resourceList] removeObjectForKey:path];
 	}
-	[[self externalResourceQueue] go];
 }
 
+// The main page is at depth 0, the resources it refers to are at depth 1, and so on
+- (NSUInteger)resourceDepth
+{
+	NSUInteger depth = 0;
+	ASIWebPageRequest *theRequest = [self parentRequest];
+	while (theRequest) {
+		depth++;
+		theRequest = [theRequest parentRequest];
+	}
+	return depth;
+}
+
++ (ASIWebResourceType)resourceTypeForURL:(NSString *)theURL
+{
+	NSString *fileExtension = [[[[NSURL URLWithString:theURL] path] pathExtension] lowercaseString];
+	if (!fileExtension) {
+		return ASIUnknownWebResourceType;
+	}
+	return (ASIWebResourceType)[[resourceTypesByExtension objectForKey:fileExtension] intValue];
+}
+
++ (NSOperationQueuePriority)queuePriorityForResourceType:(ASIWebResourceType)resourceType
+{
+	switch (resourceType) {
+		case ASIStylesheetWebResourceType:
+		case ASIFrameWebResourceType:
+			return NSOperationQueuePriorityVeryHigh;
+		case ASIScriptWebResourceType:
+		case ASIFontWebResourceType:
+			return NSOperationQueuePriorityHigh;
+		case ASIMediaWebResourceType:
+			return NSOperationQueuePriorityLow;
+		default:
+			return NSOperationQueuePriorityNormal;
+	}
+}
+
+// Returns YES if the request fetching the resource with this key is theRequest, or is waiting on it (directly or indirectly)
+- (BOOL)resourceWithKey:(NSString *)key isWaitingOnRequest:(ASIWebPageRequest *)theRequest
+{
+	NSMutableArray *keysToCheck = [NSMutableArray arrayWithObject:key];
+	NSMutableSet *checkedKeys = [NSMutableSet set];
+	while ([keysToCheck count]) {
+		NSString *theKey = [keysToCheck lastObject];
+		[keysToCheck removeLastObject];
+		if ([checkedKeys containsObject:theKey]) {
+			continue;
+		}
+		[checkedKeys addObject:theKey];
+		ASIWebPageRequest *fetchRequest = [[[self sharedResources] objectForKey:theKey] objectForKey:@"Request"];
+		if (fetchRequest == theRequest) {
+			return YES;
+		}
+		[keysToCheck addObjectsFromArray:[fetchRequest outstandingResourceKeys]];
+	}
+	return NO;
+}
+
+- (void)waitForResourceWithKey:(NSString *)key
+{
+	if (![self outstandingResourceKeys]) {
+		[self setOutstandingResourceKeys:[NSMutableArray array]];
+	}
+	if (![[self outstandingResourceKeys] containsObject:key]) {
+		[[self outstandingResourceKeys] addObject:key];
+	}
+}
+
+- (void)finishedWaitingForResourceWithKey:(NSString *)key
+{
+	if (![[self outstandingResourceKeys] containsObject:key]) {
+		return;
+	}
+	[[self outstandingResourceKeys] removeObject:key];
+	if (finishedParsing && ![[self outstandingResourceKeys] count] && ![self error]) {
+		[self finishedFetchingExternalResources];
+	}
+}
+
+// Called by the root request's queue
 - (void)externalResourceFetchSucceeded:(ASIHTTPRequest *)externalResourceRequest
 {
-	NSString *originalPath = [[externalResourceRequest userInfo] objectForKey:@"Path"];
-	NSMutableDictionary *requestResponse = [[self resourceList] objectForKey:originalPath];
+	fetchedResourceBytes += [externalResourceRequest totalBytesRead];
+	if (![externalResourceRequest error] && ![self addToWebArchive:externalResourceRequest]) {
+		return;
+	}
+
+	NSString *key = [[externalResourceRequest userInfo] objectForKey:@"ResourceKey"];
+	NSMutableDictionary *resource = [[self sharedResources] objectForKey:key];
+	NSArray *references = [[[resource objectForKey:@"References"] retain] autorelease];
+	[resource setObject:[NSNumber numberWithBool:YES] forKey:@"Finished"];
+	[resource removeObjectForKey:@"References"];
+
+	// Tell everyone where to find the content before we tell them we're done, in case one request referred to it by more than one path
+	for (NSDictionary *reference in references) {
+		[[reference objectForKey:@"Request"] useExternalResource:externalResourceRequest forPath:[reference objectForKey:@"Path"]];
+	}
+	for (NSDictionary *reference in references) {
+		[[reference objectForKey:@"Request"] finishedWaitingForResourceWithKey:key];
+	}
+}
+
+- (void)externalResourceFetchFailed:(ASIHTTPRequest *)externalResourceRequest
+{
+	// Resources we gave up on because they were too large don't cause the page to fail, their urls are left alone instead
+	if ([(ASIWebPageRequest *)externalResourceRequest exceededMaxResourceSize]) {
+		[self externalResourceFetchSucceeded:externalResourceRequest];
+		return;
+	}
+	NSString *key = [[externalResourceRequest userInfo] objectForKey:@"ResourceKey"];
+	NSMutableDictionary *resource = [[self sharedResources] objectForKey:key];
+	NSArray *references = [[[resource objectForKey:@"References"] retain] autorelease];
+	[resource setObject:[NSNumber numberWithBool:YES] forKey:@"Finished"];
+	[resource removeObjectForKey:@"References"];
+	for (NSDictionary *reference in references) {
+		[[reference objectForKey:@"Request"] externalResourceFailed:externalResourceRequest];
+	}
+}
+
+- (void)useExternalResource:(ASIHTTPRequest *)externalResourceRequest forPath:(NSString *)path
+{
+	if ([externalResourceRequest error]) {
+		[[self resourceList] removeObjectForKey:path];
+		return;
+	}
+	NSMutableDictionary *requestResponse = [[self resourceList] objectForKey:path];
 	NSString *contentType = [[externalResourceRequest responseHeaders] objectForKey:@"Content-Type"];
 	if (!contentType) {
 		contentType = @"application/octet-stream";
 	}
 	[requestResponse setObject:contentType forKey:@"ContentType"];
-	if ([self downloadDestinationPath]) {
+	if ([externalResourceRequest downloadDestinationPath]) {
 		[requestResponse setObject:[externalResourceRequest downloadDestinationPath] forKey:@"DataPath"];
 	} else {
 		NSData *data = [externalResourceRequest responseData];
@@ -290,14 +885,57 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 	}
 }
 
-- (void)externalResourceFetchFailed:(ASIHTTPRequest *)externalResourceRequest
+- (void)externalResourceFailed:(ASIHTTPRequest *)externalResourceRequest
 {
+	// If we're still downloading the page, it needs to be stopped on its own thread
+	if (parsedWhileDownloading && !finishedParsing) {
+		[self performSelector:@selector(cancelLoadAndFailWithError:) onThread:[[self class] threadForRequest:self] withObject:[externalResourceRequest error] waitUntilDone:NO modes:[NSArray arrayWithObject:[self runLoopMode]]];
+		return;
+	}
 	[self failWithError:[externalResourceRequest error]];
 }
 
-- (void)finishedFetchingExternalResources:(ASINetworkQueue *)queue
+// Stops a page that is still downloading when one of its resources fails
+// Like cancelResourceOverMaxSize, we stop the download before failing, and we stop fetching the other resources first so none of them finish after the page has failed
+- (void)cancelLoadAndFailWithError:(NSError *)theError
+{
+	if ([self complete]) {
+		return;
+	}
+	[[self externalResourceQueue] cancelAllOperations];
+	[self cancelLoad];
+	[self failWithError:theError];
+}
+
+// Called on the root request when it has finished or failed
+// Breaks the retain cycles between the root request and the requests it holds in sharedResources
+- (void)releaseSharedResources
+{
+	[[self externalResourceQueue] cancelAllOperations];
+	[self setSharedResources:nil];
+}
+
+// Called on the root request to store theRequest's response when using ASIStoreResourcesInWebArchive
+// Once a resource is in the archive, we don't need the file it was downloaded to (unless it belongs to the download cache)
+- (BOOL)addToWebArchive:(ASIHTTPRequest *)theRequest
 {
-	if ([self urlReplacementMode] != ASIDontModifyURLs) {
+	if ([self urlReplacementMode] != ASIStoreResourcesInWebArchive || ![self webArchive]) {
+		return YES;
+	}
+	NSError *err = nil;
+	if (![[self webArchive] addResponseForRequest:theRequest error:&err]) {
+		[self failWithError:err];
+		return NO;
+	}
+	if (theRequest != self && [theRequest downloadDestinationPath] && ![theRequest downloadCache]) {
+		[[[[NSFileManager alloc] init] autorelease] removeItemAtPath:[theRequest downloadDestinationPath] error:NULL];
+	}
+	return YES;
+}
+
+- (void)finishedFetchingExternalResources
+{
+	if ([self urlReplacementMode] != ASIDontModifyURLs && [self urlReplacementMode] != ASIStoreResourcesInWebArchive) {
 		if (webContentType == ASICSSWebContentType) {
 			NSMutableString *parsedResponse;
 			NSError *err = nil;
@@ -313,7 +951,7 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 			if (![self error]) {
 				for (NSString *resource in [[self resourceList] keyEnumerator]) {
 					if ([parsedResponse rangeOfString:resource].location != NSNotFound) {
-						NSString *newURL = [self contentForExternalURL:resource];
+						NSString *newURL = [self replacementForExternalURL:resource];
 						if (newURL) {
 							[parsedResponse replaceOccurrencesOfString:resource withString:newURL options:0 range:NSMakeRange(0, [parsedResponse length])];
 						}
@@ -329,9 +967,11 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 			} else {
 				[self setRawResponseData:(id)[parsedResponse dataUsingEncoding:[self responseEncoding]]];
 			}
+			if (![self replaceDataURIPlaceholders]) {
+				[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:101 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Error: unable to write external resources into response CSS",NSLocalizedDescriptionKey,nil]]];
+				return;
+			}
 		} else {
-			[xmlParsingLock lock];
-
 			[self updateResourceURLs];
 
 			if (![self error]) {
@@ -367,6 +1007,11 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 	#endif
 				}
 
+				if (![self replaceDataURIPlaceholders]) {
+					[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:101 userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Error: unable to write external resources into response HTML",NSLocalizedDescriptionKey,nil]]];
+					return;
+				}
+
 				// Strip the content encoding if the original response was gzipped
 				if ([self isResponseCompressed]) {
 					NSMutableDictionary *headers = [[self responseHeaders] mutableCopy];
@@ -374,17 +1019,14 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 					[self setResponseHeaders:headers];
 				}
 			}
-
-			xmlFreeDoc(doc);
-			doc = nil;
-
-			[requestsUsingXMLParser removeObject:self];
-			if (![requestsUsingXMLParser count]) {
-				xmlCleanupParser();
-			}
-			[xmlParsingLock unlock];
 		}
 	}
+
+	// We're done with the document, whether or not we rewrote it
+	if (doc) {
+		xmlFreeDoc(doc);
+		doc = NULL;
+	}
 	if (![self parentRequest]) {
 		[[self class] updateProgressIndicator:&downloadProgressDelegate withProgress:contentLength ofTotal:contentLength];
 	}
@@ -394,10 +1036,16 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 	[self setResponseHeaders:newHeaders];
 
 	// Write the parsed content back to the cache
-	if ([self urlReplacementMode] != ASIDontModifyURLs) {
+	if ([self urlReplacementMode] != ASIDontModifyURLs && [self urlReplacementMode] != ASIStoreResourcesInWebArchive) {
 		[[self downloadCache] storeResponseForRequest:self maxAge:[self secondsToCache]];
 	}
 
+	if (![self parentRequest]) {
+		[self releaseSharedResources];
+		if (![self addToWebArchive:self]) {
+			return;
+		}
+	}
 	[super requestFinished];
 	[super markAsFinished];
 }
@@ -432,6 +1080,9 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 		xmlChar *nodeValue = xmlNodeGetContent(nodes->nodeTab[i]);
 		NSString *value = [NSString stringWithCString:(char *)nodeValue encoding:[self responseEncoding]];
 		xmlFree(nodeValue);
+		if (!value) {
+			value = @"";
+		}
 
 		// Our xpath query matched all <link> elements, but we're only interested in stylesheets
 		// We do the work here rather than in the xPath query because the query is case-sensitive, and we want to match on 'stylesheet', 'StyleSHEEt' etc
@@ -441,28 +1092,31 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 				NSString *rel = [NSString stringWithCString:(char *)relAttribute encoding:[self responseEncoding]];
 				xmlFree(relAttribute);
 				if ([[rel lowercaseString] isEqualToString:@"stylesheet"]) {
-					[self addURLToFetch:value];
+					[self addPendingResourceURL:value type:ASIStylesheetWebResourceType];
 				}
 			}
 
 		// Parse the content of <style> tags and style attributes to find external image urls or external css files
 		} else if ([[nodeName lowercaseString] isEqualToString:@"style"]) {
-			NSArray *externalResources = [[self class] CSSURLsFromString:value];
-			for (NSString *theURL in externalResources) {
-				[self addURLToFetch:theURL];
-			}
+			[self addPendingResourceURLs:[[self class] CSSURLsFromString:value] type:ASIUnknownWebResourceType];
 
 		// Parse the content of <source src=""> tags (HTML 5 audio + video)
 		// We explictly disable the download of files with .webm, .ogv and .ogg extensions, since it's highly likely they won't be useful to us
 		} else if ([[parentName lowercaseString] isEqualToString:@"source"] || [[parentName lowercaseString] isEqualToString:@"audio"]) {
 			NSString *fileExtension = [[value pathExtension] lowercaseString];
 			if (![fileExtension isEqualToString:@"ogg"] && ![fileExtension isEqualToString:@"ogv"] && ![fileExtension isEqualToString:@"webm"]) {
-				[self addURLToFetch:value];
+				[self addPendingResourceURL:value type:ASIMediaWebResourceType];
 			}
 
 		// For all other elements matched by our xpath query (except hyperlinks), add the content as an external url to fetch
 		} else if (![[parentName lowercaseString] isEqualToString:@"a"]) {
-			[self addURLToFetch:value];
+			ASIWebResourceType resourceType = ASIImageWebResourceType;
+			if ([[parentName lowercaseString] isEqualToString:@"script"]) {
+				resourceType = ASIScriptWebResourceType;
+			} else if ([[parentName lowercaseString] isEqualToString:@"frame"] || [[parentName lowercaseString] isEqualToString:@"iframe"]) {
+				resourceType = ASIFrameWebResourceType;
+			}
+			[self addPendingResourceURL:value type:resourceType];
 		}
 		if (nodes->nodeTab[i]->type != XML_NAMESPACE_DECL) {
 			nodes->nodeTab[i] = NULL;
@@ -473,7 +1127,8 @@ static NSMutableArray *requestsUsingXMLParser = nil;
     xmlXPathFreeContext(xpathCtx); 
 }
 
-- (void)addURLToFetch:(NSString *)newURL
+// Returns the url as it was added to the resource list, or nil if it was already there or is not something we can fetch
+- (NSString *)addURLToFetch:(NSString *)newURL
 {
 	// Get rid of any surrounding whitespace
 	newURL = [newURL stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
@@ -484,10 +1139,12 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 			if (theURL) {
 				if (![[self resourceList] objectForKey:newURL]) {
 					[[self resourceList] setObject:[NSMutableDictionary dictionary] forKey:newURL];
+					return newURL;
 				}
 			}
 		}
 	}
+	return nil;
 }
 
 
@@ -526,7 +1183,7 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 			NSArray *externalResources = [[self class] CSSURLsFromString:value];
 			for (NSString *theURL in externalResources) {
 				if ([value rangeOfString:theURL].location != NSNotFound) {
-					NSString *newURL = [self contentForExternalURL:theURL];
+					NSString *newURL = [self replacementForExternalURL:theURL];
 					if (newURL) {
 						value = [value stringByReplacingOccurrencesOfString:theURL withString:newURL];
 					}
@@ -543,7 +1200,7 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 
 		// Replace all other external resource urls
 		} else {
-			NSString *newURL = [self contentForExternalURL:value];
+			NSString *newURL = [self replacementForExternalURL:value];
 			if (newURL) {
 				xmlNodeSetContent(nodes->nodeTab[i], (xmlChar *)[newURL cStringUsingEncoding:[self responseEncoding]]);
 			}
@@ -605,27 +1262,10 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 	}
 }
 
-// A quick and dirty way to build a list of external resource urls from a css string
+// Builds a list of external resource urls (url() values and @import rules) from a css string
 + (NSArray *)CSSURLsFromString:(NSString *)string
 {
-	NSMutableArray *urls = [NSMutableArray array];
-	NSScanner *scanner = [NSScanner scannerWithString:string];
-	[scanner setCaseSensitive:NO];
-	while (1) {
-		NSString *theURL = nil;
-		[scanner scanUpToString:@"url(" intoString:NULL];
-		[scanner scanString:@"url(" intoString:NULL];
-		[scanner scanUpToString:@")" intoString:&theURL];
-		if (!theURL) {
-			break;
-		}
-		// Remove any quotes or whitespace around the url
-		theURL = [theURL stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-		theURL = [theURL stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"\"'"]];
-		theURL = [theURL stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-		[urls addObject:theURL];
-	}
-	return urls;
+	return [ASICSSTokenizer URLsInData:[string dataUsingEncoding:NSUTF8StringEncoding]];
 }
 
 // Returns a relative file path from sourcePath to destinationPath (eg ../../foo/bar.txt)
@@ -677,6 +1317,163 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 	return nil;
 }
 
+#pragma mark writing data uris
+
+// Returns the string that should replace theURL in the page
+// Rather than building a data uri in memory, we return a placeholder, and write the data uri in its place when the page is written out
+// Subclasses that override contentForExternalURL: get the content they return, as before
+- (NSString *)replacementForExternalURL:(NSString *)theURL
+{
+	if ([self urlReplacementMode] != ASIReplaceExternalResourcesWithData || ![self canTokenizeResponseBytes] || [self methodForSelector:@selector(contentForExternalURL:)] != [ASIWebPageRequest instanceMethodForSelector:@selector(contentForExternalURL:)]) {
+		return [self contentForExternalURL:theURL];
+	}
+	NSDictionary *resource = [[self resourceList] objectForKey:theURL];
+	if (![resource objectForKey:@"ContentType"]) {
+		return nil;
+	}
+	if ([resource objectForKey:@"DataPath"]) {
+		if (![[[[NSFileManager alloc] init] autorelease] fileExistsAtPath:[resource objectForKey:@"DataPath"]]) {
+			return nil;
+		}
+	} else if (![resource objectForKey:@"Data"]) {
+		return nil;
+	}
+	if (![self dataURIPlaceholders]) {
+		NSString *uniqueString = [[[NSProcessInfo processInfo] globallyUniqueString] stringByReplacingOccurrencesOfString:@"-" withString:@""];
+		[self setDataURIPlaceholderPrefix:[NSString stringWithFormat:@"asidatauri%@",uniqueString]];
+		[self setDataURIPlaceholders:[NSMutableArray array]];
+	}
+	[[self dataURIPlaceholders] addObject:theURL];
+	return [NSString stringWithFormat:@"%@%08lx",[self dataURIPlaceholderPrefix],(unsigned long)[[self dataURIPlaceholders] count]-1];
+}
+
+// Writes the page again, with data uris in place of any placeholders we added
+// The page itself is read from a memory mapped copy, and each resource is encoded a chunk at a time, so only a small amount is in memory at once
+- (BOOL)replaceDataURIPlaceholders
+{
+	if (![[self dataURIPlaceholders] count]) {
+		return YES;
+	}
+	BOOL success = NO;
+	if ([self downloadDestinationPath]) {
+		NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+		NSString *tempPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+		if ([fileManager moveItemAtPath:[self downloadDestinationPath] toPath:tempPath error:NULL]) {
+			NSData *content = [NSData dataWithContentsOfMappedFile:tempPath];
+			NSOutputStream *stream = [NSOutputStream outputStreamToFileAtPath:[self downloadDestinationPath] append:NO];
+			[stream open];
+			success = (content && [self writeContent:content toStream:stream]);
+			[stream close];
+			[fileManager removeItemAtPath:tempPath error:NULL];
+		}
+	} else {
+		NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+		[stream open];
+		success = [self writeContent:[self rawResponseData] toStream:stream];
+		[self setRawResponseData:(id)[stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey]];
+		[stream close];
+	}
+	[self setDataURIPlaceholders:nil];
+	[self setDataURIPlaceholderPrefix:nil];
+	return success;
+}
+
+static BOOL ASIWriteBytes(NSOutputStream *stream, const uint8_t *bytes, NSUInteger length)
+{
+	while (length > 0) {
+		NSInteger written = [stream write:bytes maxLength:length];
+		if (written <= 0) {
+			return NO;
+		}
+		bytes += written;
+		length -= (NSUInteger)written;
+	}
+	return YES;
+}
+
+// Copies content to stream, writing a data uri in place of each placeholder
+- (BOOL)writeContent:(NSData *)content toStream:(NSOutputStream *)stream
+{
+	const uint8_t *bytes = (const uint8_t *)[content bytes];
+	NSUInteger length = [content length];
+	const char *prefix = [[self dataURIPlaceholderPrefix] UTF8String];
+	NSUInteger prefixLength = strlen(prefix);
+	NSUInteger placeholderLength = prefixLength+dataURIPlaceholderIndexLength;
+
+	NSUInteger written = 0;
+	NSUInteger position = 0;
+	while (position+placeholderLength <= length) {
+		const uint8_t *match = memchr(bytes+position, prefix[0], length-placeholderLength-position+1);
+		if (!match) {
+			break;
+		}
+		position = (NSUInteger)(match-bytes);
+		if (memcmp(match, prefix, prefixLength) != 0) {
+			position++;
+			continue;
+		}
+		char indexString[16];
+		memcpy(indexString, match+prefixLength, dataURIPlaceholderIndexLength);
+		indexString[dataURIPlaceholderIndexLength] = '\0';
+		char *end = NULL;
+		unsigned long placeholderIndex = strtoul(indexString, &end, 16);
+		if (end != indexString+dataURIPlaceholderIndexLength || placeholderIndex >= [[self dataURIPlaceholders] count]) {
+			position++;
+			continue;
+		}
+		if (!ASIWriteBytes(stream, bytes+written, position-written)) {
+			return NO;
+		}
+		if (![self writeDataURIForExternalURL:[[self dataURIPlaceholders] objectAtIndex:placeholderIndex] toStream:stream]) {
+			return NO;
+		}
+		position += placeholderLength;
+		written = position;
+	}
+	return ASIWriteBytes(stream, bytes+written, length-written);
+}
+
+// Base64 encodes the resource a chunk at a time, straight from the file it was downloaded to if it has one
+- (BOOL)writeDataURIForExternalURL:(NSString *)theURL toStream:(NSOutputStream *)stream
+{
+	NSDictionary *resource = [[self resourceList] objectForKey:theURL];
+	NSData *header = [[NSString stringWithFormat:@"data:%@;base64,",[resource objectForKey:@"ContentType"]] dataUsingEncoding:NSUTF8StringEncoding];
+	if (!ASIWriteBytes(stream, [header bytes], [header length])) {
+		return NO;
+	}
+	NSFileHandle *fileHandle = nil;
+	NSData *data = nil;
+	if ([resource objectForKey:@"DataPath"]) {
+		fileHandle = [NSFileHandle fileHandleForReadingAtPath:[resource objectForKey:@"DataPath"]];
+		if (!fileHandle) {
+			return NO;
+		}
+	} else {
+		data = [resource objectForKey:@"Data"];
+	}
+	BOOL success = YES;
+	NSUInteger offset = 0;
+	while (success) {
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		NSData *chunk;
+		if (fileHandle) {
+			chunk = [fileHandle readDataOfLength:dataURIChunkSize];
+		} else {
+			chunk = [data subdataWithRange:NSMakeRange(offset, MIN(dataURIChunkSize, [data length]-offset))];
+			offset += [chunk length];
+		}
+		if (![chunk length]) {
+			[pool release];
+			break;
+		}
+		const char *encoded = [[ASIHTTPRequest base64forData:chunk] UTF8String];
+		success = ASIWriteBytes(stream, (const uint8_t *)encoded, strlen(encoded));
+		[pool release];
+	}
+	[fileHandle closeFile];
+	return success;
+}
+
 - (NSString *)cachePathForRequest:(ASIWebPageRequest *)theRequest
 {
 	// If we're using a download cache (and its a good idea to do so when using ASIWebPageRequest), ask it for the location to store this file
@@ -698,6 +1495,15 @@ static NSMutableArray *requestsUsingXMLParser = nil;
 
 @synthesize externalResourceQueue;
 @synthesize resourceList;
+@synthesize pendingResourceURLs;
+@synthesize pendingResourceTypes;
+@synthesize cssTokenizer;
+@synthesize dataURIPlaceholderPrefix;
+@synthesize dataURIPlaceholders;
 @synthesize parentRequest;
 @synthesize urlReplacementMode;
+@synthesize webArchive;
+@synthesize maxResourceDepth;
+@synthesize maxResourceSize;
+@synthesize maxTotalResourceSize;
 @end
@@ -0,0 +1,41 @@
+//
+//  ASIXMLPushParser.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Parses XML a chunk at a time as it is downloaded, using a libxml push parser
+//  Parsing events are passed on to an NSXMLParser delegate, so the same delegate methods can be used whether a response is parsed as it arrives or all at once
+//  The parser passed to the delegate methods is always nil. Strings are always decoded as UTF-8, as that is what libxml gives us, whatever the encoding of the document
+//  Used by ASIS3Request and ASICloudFilesRequest to parse large listings while they download
+
+#import <Foundation/Foundation.h>
+
+@class ASIHTTPRequest;
+
+@interface ASIXMLPushParser : NSObject {
+
+	// Receives the parsing events (not retained)
+	id delegate;
+
+	// Events stop being sent once this request has an error (not retained)
+	ASIHTTPRequest *request;
+
+	struct _xmlParserCtxt *parserContext;
+}
+
+// Returns nil if libxml couldn't create a parser
++ (id)parserForRequest:(ASIHTTPRequest *)request delegate:(id)delegate;
+
+// Parses the next chunk of the document
+// Returns an error in NSXMLParserErrorDomain if the XML is malformed, or nil
+- (NSError *)parseBytes:(const void *)bytes length:(NSUInteger)length;
+
+// Call when the whole document has been passed to parseBytes:length:
+// Returns an error in NSXMLParserErrorDomain if the document ended early, or nil
+- (NSError *)finishParsing;
+
+@property (assign, readonly) id delegate;
+@property (assign, readonly) ASIHTTPRequest *request;
+@end
@@ -0,0 +1,121 @@
+//
+//  ASIXMLPushParser.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIXMLPushParser.h"
+#import "ASIHTTPRequest.h"
+#import <libxml/parser.h>
+
+static xmlSAXHandler pushParsingHandler;
+
+// SAX callbacks, these pass each event on to the delegate's NSXMLParser delegate methods
+static void ASIXMLPushParserStartElement(void *ctx, const xmlChar *name, const xmlChar **attributes)
+{
+	ASIXMLPushParser *parser = (ASIXMLPushParser *)ctx;
+	if ([[parser request] error]) {
+		return;
+	}
+	NSMutableDictionary *attributeDict = [NSMutableDictionary dictionary];
+	if (attributes) {
+		int i;
+		for (i=0; attributes[i]; i+=2) {
+			[attributeDict setObject:(attributes[i+1] ? [NSString stringWithUTF8String:(const char *)attributes[i+1]] : @"") forKey:[NSString stringWithUTF8String:(const char *)attributes[i]]];
+		}
+	}
+	NSString *elementName = [NSString stringWithUTF8String:(const char *)name];
+	[[parser delegate] parser:nil didStartElement:elementName namespaceURI:nil qualifiedName:elementName attributes:attributeDict];
+}
+
+static void ASIXMLPushParserEndElement(void *ctx, const xmlChar *name)
+{
+	ASIXMLPushParser *parser = (ASIXMLPushParser *)ctx;
+	if ([[parser request] error]) {
+		return;
+	}
+	NSString *elementName = [NSString stringWithUTF8String:(const char *)name];
+	[[parser delegate] parser:nil didEndElement:elementName namespaceURI:nil qualifiedName:elementName];
+}
+
+static void ASIXMLPushParserCharacters(void *ctx, const xmlChar *characters, int length)
+{
+	ASIXMLPushParser *parser = (ASIXMLPushParser *)ctx;
+	if ([[parser request] error]) {
+		return;
+	}
+	NSString *string = [[[NSString alloc] initWithBytes:characters length:(NSUInteger)length encoding:NSUTF8StringEncoding] autorelease];
+	if (string) {
+		[[parser delegate] parser:nil foundCharacters:string];
+	}
+}
+
+@interface ASIXMLPushParser ()
+- (id)initWithRequest:(ASIHTTPRequest *)newRequest delegate:(id)newDelegate;
+@end
+
+@implementation ASIXMLPushParser
+
++ (void)initialize
+{
+	if (self == [ASIXMLPushParser class]) {
+		// libxml needs to set up its global state before it is used from more than one thread
+		xmlInitParser();
+		memset(&pushParsingHandler, 0, sizeof(xmlSAXHandler));
+		pushParsingHandler.startElement = ASIXMLPushParserStartElement;
+		pushParsingHandler.endElement = ASIXMLPushParserEndElement;
+		pushParsingHandler.characters = ASIXMLPushParserCharacters;
+		pushParsingHandler.cdataBlock = ASIXMLPushParserCharacters;
+	}
+}
+
++ (id)parserForRequest:(ASIHTTPRequest *)request delegate:(id)delegate
+{
+	return [[[self alloc] initWithRequest:request delegate:delegate] autorelease];
+}
+
+- (id)initWithRequest:(ASIHTTPRequest *)newRequest delegate:(id)newDelegate
+{
+	self = [super init];
+	request = newRequest;
+	delegate = newDelegate;
+	parserContext = xmlCreatePushParserCtxt(&pushParsingHandler, self, NULL, 0, NULL);
+	if (!parserContext) {
+		[self release];
+		return nil;
+	}
+	xmlCtxtUseOptions(parserContext, XML_PARSE_NONET);
+	return self;
+}
+
+- (void)dealloc
+{
+	if (parserContext) {
+		xmlFreeParserCtxt(parserContext);
+	}
+	[super dealloc];
+}
+
+- (NSError *)parseBytes:(const void *)bytes length:(NSUInteger)length
+{
+	int result = xmlParseChunk(parserContext, (const char *)bytes, (int)length, 0);
+	if (result != 0) {
+		return [NSError errorWithDomain:NSXMLParserErrorDomain code:result userInfo:nil];
+	}
+	return nil;
+}
+
+- (NSError *)finishParsing
+{
+	int result = xmlParseChunk(parserContext, NULL, 0, 1);
+	if (result != 0) {
+		return [NSError errorWithDomain:NSXMLParserErrorDomain code:result userInfo:nil];
+	}
+	return nil;
+}
+
+@synthesize delegate;
+@synthesize request;
+@end
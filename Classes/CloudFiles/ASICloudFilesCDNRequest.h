@@ -3,6 +3,8 @@
 //
 //  Created by Michael Mayo on 1/6/10.
 //
+//  When a PUT or POST request succeeds, the CDN info for its container is removed from the shared ASICloudFilesContainerInfoCache
+//
 
 #import "ASICloudFilesRequest.h"
 
@@ -6,6 +6,7 @@
 
 #import "ASICloudFilesCDNRequest.h"
 #import "ASICloudFilesContainerXMLParserDelegate.h"
+#import "ASICloudFilesContainerInfoCache.h"
 
 
 @implementation ASICloudFilesCDNRequest
@@ -134,6 +135,18 @@
 	return request;
 }
 
+#pragma mark -
+#pragma mark Keeping the container info cache up to date
+
+// Successful PUT and POST requests change a container's CDN settings, so the shared cache shouldn't use what it knew about them before
+- (void)requestFinished {
+	int status = [self responseStatusCode];
+	if (status >= 200 && status < 300 && [self containerName] && ([[self requestMethod] isEqualToString:@"PUT"] || [[self requestMethod] isEqualToString:@"POST"])) {
+		[[ASICloudFilesContainerInfoCache sharedCache] removeInfoForContainer:[self containerName]];
+	}
+	[super requestFinished];
+}
+
 #pragma mark -
 #pragma mark Memory Management
 
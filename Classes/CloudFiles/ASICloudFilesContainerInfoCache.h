@@ -0,0 +1,73 @@
+//
+//  ASICloudFilesContainerInfoCache.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  An ASICloudFilesContainerInfoCache keeps the results of container HEAD requests for a while, so you don't need to make one every time you need a container's CDN URI
+//
+//  Container info (object count and bytes used) comes from the storage service, CDN info (whether the container is CDN-enabled, its CDN URI and TTL) from the CDN management service
+//  Each is fetched the first time you ask for it, and kept for timeToLive seconds
+//  When several threads ask for info that isn't in the cache, only one request is made, and the others wait for it
+//  A container that has never been CDN-enabled is cached as not enabled, rather than as an error
+//
+//  ASICloudFilesCDNRequest PUT and POST requests remove the CDN info for their container from the shared cache when they succeed, so the next lookup sees the change
+//  Object counts aren't updated when you upload or delete objects, so they may be up to timeToLive seconds out of date
+//
+//  The lookup methods wait for a request if the info isn't cached, so you'll generally want to call them on a background thread
+//  The containers they return are shared by everyone using the cache, don't modify them
+//
+//  NSError *error = nil;
+//  ASICloudFilesContainer *container = [[ASICloudFilesContainerInfoCache sharedCache] CDNInfoForContainer:@"photos" error:&error];
+//  if ([container cdnEnabled]) {
+//  	NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"%@/%@",[container cdnURL],@"beach.jpg"]];
+//  	...
+//  }
+
+#import <Foundation/Foundation.h>
+
+@class ASICloudFilesContainer;
+
+@interface ASICloudFilesContainerInfoCache : NSObject {
+
+	// How long info is kept, in seconds. Defaults to 300
+	NSTimeInterval timeToLive;
+
+	// Maps keys (the URL the info is fetched from) to an array of [ASICloudFilesContainer, expiry date]
+	NSMutableDictionary *entries;
+
+	// Maps keys to the error from the last attempt to fetch them, so threads that were waiting for it can fail too
+	NSMutableDictionary *fetchErrors;
+
+	// Keys we are currently fetching
+	NSMutableSet *keysBeingFetched;
+
+	// Keys that were removed while they were being fetched, so the results shouldn't be stored
+	NSMutableSet *invalidatedKeys;
+
+	// Protects everything above. Threads waiting for another thread to fetch info wait on it
+	NSCondition *condition;
+
+	// Number of lookups answered from the cache, and the number that needed a request
+	NSUInteger hitCount;
+	NSUInteger missCount;
+}
+
+// The cache used by ASICloudFilesCDNRequest to invalidate info
++ (id)sharedCache;
+
+// Returns info for containerName with the object count and bytes used filled in, or nil if it couldn't be fetched
+- (ASICloudFilesContainer *)containerInfoForContainer:(NSString *)containerName error:(NSError **)theError;
+
+// Returns info for containerName with cdnEnabled, cdnURL and ttl filled in, or nil if it couldn't be fetched
+- (ASICloudFilesContainer *)CDNInfoForContainer:(NSString *)containerName error:(NSError **)theError;
+
+// Throw away cached info for a container, or for everything
+- (void)removeInfoForContainer:(NSString *)containerName;
+- (void)removeAllInfo;
+
+@property (assign) NSTimeInterval timeToLive;
+@property (assign, readonly) NSUInteger hitCount;
+@property (assign, readonly) NSUInteger missCount;
+@end
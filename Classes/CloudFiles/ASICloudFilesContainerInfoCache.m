@@ -0,0 +1,229 @@
+//
+//  ASICloudFilesContainerInfoCache.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASICloudFilesContainerInfoCache.h"
+#import "ASICloudFilesContainer.h"
+#import "ASICloudFilesCDNRequest.h"
+#import "ASICloudFilesObjectRequest.h"
+
+static ASICloudFilesContainerInfoCache *sharedCache = nil;
+
+// Private stuff
+@interface ASICloudFilesContainerInfoCache ()
+- (ASICloudFilesContainer *)infoForContainer:(NSString *)containerName fromCDN:(BOOL)fromCDN error:(NSError **)theError;
+- (ASICloudFilesContainer *)containerFromRequest:(ASICloudFilesRequest *)request containerName:(NSString *)containerName error:(NSError **)theError;
++ (NSString *)containerInfoKeyForContainer:(NSString *)containerName;
++ (NSString *)CDNInfoKeyForContainer:(NSString *)containerName;
+
+@property (retain, nonatomic) NSMutableDictionary *entries;
+@property (retain, nonatomic) NSMutableDictionary *fetchErrors;
+@property (retain, nonatomic) NSMutableSet *keysBeingFetched;
+@property (retain, nonatomic) NSMutableSet *invalidatedKeys;
+@property (retain, nonatomic) NSCondition *condition;
+@end
+
+@implementation ASICloudFilesContainerInfoCache
+
++ (id)sharedCache
+{
+	@synchronized (self) {
+		if (!sharedCache) {
+			sharedCache = [[self alloc] init];
+		}
+	}
+	return sharedCache;
+}
+
+- (id)init
+{
+	self = [super init];
+	[self setTimeToLive:300];
+	[self setEntries:[NSMutableDictionary dictionary]];
+	[self setFetchErrors:[NSMutableDictionary dictionary]];
+	[self setKeysBeingFetched:[NSMutableSet set]];
+	[self setInvalidatedKeys:[NSMutableSet set]];
+	[self setCondition:[[[NSCondition alloc] init] autorelease]];
+	return self;
+}
+
+- (void)dealloc
+{
+	[entries release];
+	[fetchErrors release];
+	[keysBeingFetched release];
+	[invalidatedKeys release];
+	[condition release];
+	[super dealloc];
+}
+
+#pragma mark looking up info
+
+- (ASICloudFilesContainer *)containerInfoForContainer:(NSString *)containerName error:(NSError **)theError
+{
+	return [self infoForContainer:containerName fromCDN:NO error:theError];
+}
+
+- (ASICloudFilesContainer *)CDNInfoForContainer:(NSString *)containerName error:(NSError **)theError
+{
+	return [self infoForContainer:containerName fromCDN:YES error:theError];
+}
+
+- (ASICloudFilesContainer *)infoForContainer:(NSString *)containerName fromCDN:(BOOL)fromCDN error:(NSError **)theError
+{
+	NSString *key = (fromCDN ? [[self class] CDNInfoKeyForContainer:containerName] : [[self class] containerInfoKeyForContainer:containerName]);
+
+	[[self condition] lock];
+	BOOL waited = NO;
+	while (1) {
+		NSArray *entry = [[self entries] objectForKey:key];
+		if (entry && [[entry objectAtIndex:1] timeIntervalSinceNow] > 0) {
+			hitCount++;
+			ASICloudFilesContainer *container = [[[entry objectAtIndex:0] retain] autorelease];
+			[[self condition] unlock];
+			return container;
+		}
+
+		// If another thread was fetching this info for us and failed, we fail too, rather than trying again straight away
+		if (waited && ![[self keysBeingFetched] containsObject:key] && [[self fetchErrors] objectForKey:key]) {
+			if (theError) {
+				*theError = [[[[self fetchErrors] objectForKey:key] retain] autorelease];
+			}
+			[[self condition] unlock];
+			return nil;
+		}
+		if (![[self keysBeingFetched] containsObject:key]) {
+			break;
+		}
+		waited = YES;
+		[[self condition] wait];
+	}
+	missCount++;
+	[[self keysBeingFetched] addObject:key];
+	[[self fetchErrors] removeObjectForKey:key];
+	[[self condition] unlock];
+
+	// The lock isn't held while the request runs, so lookups for other containers aren't held up
+	ASICloudFilesRequest *request;
+	if (fromCDN) {
+		request = [ASICloudFilesCDNRequest containerInfoRequest:containerName];
+	} else {
+		request = [ASICloudFilesObjectRequest containerInfoRequest:containerName];
+	}
+	[request startSynchronous];
+	NSError *err = nil;
+	ASICloudFilesContainer *container = [self containerFromRequest:request containerName:containerName error:&err];
+
+	[[self condition] lock];
+	[[self keysBeingFetched] removeObject:key];
+	if (container) {
+		if ([[self invalidatedKeys] containsObject:key]) {
+			[[self invalidatedKeys] removeObject:key];
+		} else {
+			[[self entries] setObject:[NSArray arrayWithObjects:container,[NSDate dateWithTimeIntervalSinceNow:[self timeToLive]],nil] forKey:key];
+		}
+	} else {
+		[[self invalidatedKeys] removeObject:key];
+		[[self fetchErrors] setObject:err forKey:key];
+	}
+	[[self condition] broadcast];
+	[[self condition] unlock];
+
+	if (!container && theError) {
+		*theError = err;
+	}
+	return container;
+}
+
+- (ASICloudFilesContainer *)containerFromRequest:(ASICloudFilesRequest *)request containerName:(NSString *)containerName error:(NSError **)theError
+{
+	if ([request error]) {
+		*theError = [request error];
+		return nil;
+	}
+	BOOL isCDNRequest = [request isKindOfClass:[ASICloudFilesCDNRequest class]];
+	int status = [request responseStatusCode];
+
+	// The CDN management service returns 404 for containers that have never been CDN-enabled
+	if (status != 204 && status != 200 && !(isCDNRequest && status == 404)) {
+		*theError = [NSError errorWithDomain:NetworkRequestErrorDomain code:ASICloudFilesResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Unable to fetch info for container '%@' (Cloud Files returned status %i)",containerName,status],NSLocalizedDescriptionKey,nil]];
+		return nil;
+	}
+	ASICloudFilesContainer *container = [ASICloudFilesContainer container];
+	[container setName:containerName];
+	if (isCDNRequest) {
+		if (status != 404) {
+			ASICloudFilesCDNRequest *CDNRequest = (ASICloudFilesCDNRequest *)request;
+			[container setCdnEnabled:[CDNRequest cdnEnabled]];
+			[container setCdnURL:[CDNRequest cdnURI]];
+			[container setTtl:[CDNRequest cdnTTL]];
+		}
+	} else {
+		ASICloudFilesObjectRequest *objectRequest = (ASICloudFilesObjectRequest *)request;
+		[container setCount:[objectRequest containerObjectCount]];
+		[container setBytes:[objectRequest containerBytesUsed]];
+	}
+	return container;
+}
+
+#pragma mark removing info
+
+// Info is keyed on the URL it is fetched from, so info for different accounts is kept apart
++ (NSString *)containerInfoKeyForContainer:(NSString *)containerName
+{
+	return [NSString stringWithFormat:@"%@/%@",[ASICloudFilesRequest storageURL],containerName];
+}
+
++ (NSString *)CDNInfoKeyForContainer:(NSString *)containerName
+{
+	return [NSString stringWithFormat:@"%@/%@",[ASICloudFilesRequest cdnManagementURL],containerName];
+}
+
+- (void)removeInfoForContainer:(NSString *)containerName
+{
+	NSArray *keys = [NSArray arrayWithObjects:[[self class] containerInfoKeyForContainer:containerName],[[self class] CDNInfoKeyForContainer:containerName],nil];
+	[[self condition] lock];
+	for (NSString *key in keys) {
+		[[self entries] removeObjectForKey:key];
+		if ([[self keysBeingFetched] containsObject:key]) {
+			[[self invalidatedKeys] addObject:key];
+		}
+	}
+	[[self condition] unlock];
+}
+
+- (void)removeAllInfo
+{
+	[[self condition] lock];
+	[[self entries] removeAllObjects];
+	[[self invalidatedKeys] unionSet:[self keysBeingFetched]];
+	[[self condition] unlock];
+}
+
+- (NSUInteger)hitCount
+{
+	[[self condition] lock];
+	NSUInteger count = hitCount;
+	[[self condition] unlock];
+	return count;
+}
+
+- (NSUInteger)missCount
+{
+	[[self condition] lock];
+	NSUInteger count = missCount;
+	[[self condition] unlock];
+	return count;
+}
+
+@synthesize timeToLive;
+@synthesize entries;
+@synthesize fetchErrors;
+@synthesize keysBeingFetched;
+@synthesize invalidatedKeys;
+@synthesize condition;
+@end
@@ -68,10 +68,11 @@
 	}
 	
 	if (marker != nil) {
-		queryString = [queryString stringByAppendingString:[NSString stringWithFormat:@"&marker=%@", marker]];
+		queryString = [queryString stringByAppendingString:[NSString stringWithFormat:@"&marker=%@", [marker stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]]];
 	}
 	
 	ASICloudFilesContainerRequest *request = [ASICloudFilesContainerRequest storageRequestWithMethod:@"GET" queryString:queryString];
+	[request setShouldParseResponseAsItArrives:YES];
 	return request;
 }
 
@@ -80,9 +81,25 @@
 + (id)listRequest {
 	ASICloudFilesContainerRequest *request = [ASICloudFilesContainerRequest storageRequestWithMethod:@"GET" 
 																			queryString:@"?format=xml"];
+	[request setShouldParseResponseAsItArrives:YES];
 	return request;
 }
 
+// Containers are parsed as they arrive with the same parser delegate
+- (id)responseParserDelegate {
+	if (xmlParserDelegate == nil) {
+		xmlParserDelegate = [[ASICloudFilesContainerXMLParserDelegate alloc] init];
+	}
+	return xmlParserDelegate;
+}
+
+// Throw away anything we parsed from an earlier response (eg when the request is retried after timing out)
+- (void)readResponseHeaders {
+	[self setXmlParserDelegate:nil];
+	[super readResponseHeaders];
+}
+
+// When the listing was parsed as it arrived, containers will already be here
 - (NSArray *)containers {
 	if (xmlParserDelegate.containerObjects) {
 		return xmlParserDelegate.containerObjects;
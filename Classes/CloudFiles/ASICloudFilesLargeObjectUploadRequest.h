@@ -0,0 +1,98 @@
+//
+//  ASICloudFilesLargeObjectUploadRequest.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Use an ASICloudFilesLargeObjectUploadRequest to upload a file that is too big to store as a single Cloud Files object, or to upload a big file using several connections at once
+//
+//  The file is split into segments of segmentSize bytes, and up to maxConcurrentSegmentUploads segments are uploaded at once
+//  Each segment is read straight from its range of the file, so no temporary copies are made
+//  Segments are stored as separate objects named <objectPath>/<modification date>/<file size>/<segment size>/<segment number>, in segmentContainerName (which defaults to the same container)
+//  Each segment is sent with the MD5 of its range in an ETag header, so Cloud Files refuses a segment that was corrupted on the way
+//  A segment that fails, or whose data didn't arrive intact, is retried on its own, rather than restarting the whole upload
+//  Once every segment has been uploaded, the request itself sends the manifest object, an empty object with an X-Object-Manifest header pointing at the segments
+//  Downloading the manifest object gets you the segments joined back together
+//
+//  Upload progress for all the segments is reported to the request's uploadProgressDelegate (and queue) as if it were a single upload
+//  If the request fails or is cancelled, segments that were already uploaded are left in place. Uploading the same unmodified file again will replace them
+//  As with ASIS3MultipartUploadRequest, you cannot use startSynchronous with an ASICloudFilesLargeObjectUploadRequest
+//
+//  ASICloudFilesLargeObjectUploadRequest *request = [ASICloudFilesLargeObjectUploadRequest putObjectRequestWithContainer:@"videos" objectPath:@"movie.mov" contentType:@"video/quicktime" file:@"/path/to/movie.mov" metadata:nil];
+//  [request setDelegate:self];
+//  [request setUploadProgressDelegate:progressIndicator];
+//  [request startAsynchronous];
+
+#import <Foundation/Foundation.h>
+#import "ASICloudFilesObjectRequest.h"
+
+@class ASINetworkQueue;
+@class ASIPartProgressTracker;
+
+// Cloud Files won't store an object bigger than this, so segments can't be any bigger
+extern const unsigned long long ASICloudFilesMaximumObjectSize;
+
+@interface ASICloudFilesLargeObjectUploadRequest : ASICloudFilesObjectRequest {
+
+	// The file we are uploading
+	NSString *filePath;
+
+	// The name of the manifest object
+	NSString *objectPath;
+
+	// The container to store the segments in. Defaults to the same container as the manifest
+	NSString *segmentContainerName;
+
+	// The size of each segment in bytes (the last segment may be smaller). Defaults to 100MB, values above ASICloudFilesMaximumObjectSize are rounded down
+	unsigned long long segmentSize;
+
+	// How many segments to upload at once. Defaults to 4
+	NSInteger maxConcurrentSegmentUploads;
+
+	// How many times to retry a segment that fails because of a connection problem or a server error, before giving up on the whole upload. Defaults to 3
+	int numberOfTimesToRetrySegment;
+
+	// Segments are named with this prefix followed by the segment number
+	NSString *segmentPrefix;
+
+	// Size of the file when we started uploading segments
+	unsigned long long fileSize;
+
+	// Number of segments the file was split into
+	NSUInteger segmentCount;
+
+	// Uploads the segments, up to maxConcurrentSegmentUploads at a time
+	ASINetworkQueue *segmentQueue;
+
+	// Maps segment numbers to the ETag Cloud Files returned when the segment was uploaded (which matches the MD5 of the segment)
+	NSMutableDictionary *segmentETags;
+
+	// Progress reported so far by the current request for each segment, used to take back a failed segment's progress before it is retried
+	ASIPartProgressTracker *segmentProgress;
+
+	// Total reported by the requests for all the segments so far
+	unsigned long long segmentBytesSent;
+	long long segmentUploadSize;
+
+	// Set to YES while segments are being uploaded
+	// The request has started as far as its queue is concerned, but doesn't send the manifest until they have all been uploaded
+	BOOL uploadingSegments;
+
+	// Set to YES once all the segments have been uploaded, so the manifest can be sent
+	BOOL haveUploadedSegments;
+}
+
+// Create a request to upload the file at filePath in segments, and create a manifest object called objectPath in containerName for them
++ (id)putObjectRequestWithContainer:(NSString *)containerName objectPath:(NSString *)objectPath contentType:(NSString *)contentType file:(NSString *)filePath metadata:(NSDictionary *)metadata;
+
+@property (retain, nonatomic) NSString *filePath;
+@property (retain, nonatomic) NSString *objectPath;
+@property (retain, nonatomic) NSString *segmentContainerName;
+@property (assign, nonatomic) unsigned long long segmentSize;
+@property (assign, nonatomic) NSInteger maxConcurrentSegmentUploads;
+@property (assign, nonatomic) int numberOfTimesToRetrySegment;
+@property (retain, readonly) NSString *segmentPrefix;
+@property (assign, readonly) NSUInteger segmentCount;
+@property (retain, readonly) NSMutableDictionary *segmentETags;
+@end
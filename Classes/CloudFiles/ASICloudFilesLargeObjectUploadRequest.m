@@ -0,0 +1,404 @@
+//
+//  ASICloudFilesLargeObjectUploadRequest.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASICloudFilesLargeObjectUploadRequest.h"
+#import "ASINetworkQueue.h"
+#import "ASIPartProgressTracker.h"
+#import <CommonCrypto/CommonDigest.h>
+
+const unsigned long long ASICloudFilesMaximumObjectSize = 5ULL*1024*1024*1024;
+
+// Uploads one segment, sending the MD5 of its range of the file in an ETag header
+// Cloud Files refuses to store a segment whose body doesn't match it, so a segment corrupted on the way is retried rather than joined into the object
+@interface ASICloudFilesSegmentRequest : ASICloudFilesObjectRequest {
+	NSString *segmentMD5;
+}
+@property (retain) NSString *segmentMD5;
+@end
+
+@implementation ASICloudFilesSegmentRequest
+
+- (void)dealloc
+{
+	[segmentMD5 release];
+	[super dealloc];
+}
+
+// The MD5 is worked out with the body, so it happens on the request's thread before it starts sending, rather than on the thread that created it
+- (void)buildPostBody
+{
+	if ([self haveBuiltPostBody]) {
+		return;
+	}
+	[super buildPostBody];
+	if (![self haveBuiltPostBody]) {
+		return;
+	}
+	NSFileHandle *fileHandle = [NSFileHandle fileHandleForReadingAtPath:[self postBodyFilePath]];
+	if (!fileHandle) {
+		return;
+	}
+	CC_MD5_CTX context;
+	CC_MD5_Init(&context);
+	[fileHandle seekToFileOffset:[self postBodyFileOffset]];
+	unsigned long long bytesRemaining = [self postBodyFileLength];
+	while (bytesRemaining > 0) {
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		NSData *chunk = [fileHandle readDataOfLength:(NSUInteger)MIN(bytesRemaining, 1024*1024)];
+		NSUInteger chunkLength = [chunk length];
+		CC_MD5_Update(&context, [chunk bytes], (CC_LONG)chunkLength);
+		[pool release];
+		if (!chunkLength) {
+			break;
+		}
+		bytesRemaining -= chunkLength;
+	}
+	[fileHandle closeFile];
+
+	unsigned char digest[CC_MD5_DIGEST_LENGTH];
+	CC_MD5_Final(digest, &context);
+	NSMutableString *md5 = [NSMutableString stringWithCapacity:CC_MD5_DIGEST_LENGTH*2];
+	NSUInteger i;
+	for (i=0; i<CC_MD5_DIGEST_LENGTH; i++) {
+		[md5 appendFormat:@"%02x",digest[i]];
+	}
+	[self setSegmentMD5:md5];
+	[self addRequestHeader:@"ETag" value:md5];
+}
+
+@synthesize segmentMD5;
+@end
+
+// Private stuff
+@interface ASICloudFilesLargeObjectUploadRequest ()
+- (void)startUploadingSegments;
+- (ASICloudFilesObjectRequest *)requestForSegmentNumber:(NSUInteger)segmentNumber attempt:(int)attempt;
+- (NSString *)segmentPathForSegmentNumber:(NSUInteger)segmentNumber;
+- (void)segmentUploadFinished:(ASIHTTPRequest *)segmentRequest;
+- (void)segmentUploadFailed:(ASIHTTPRequest *)segmentRequest;
+- (void)retrySegment:(ASIHTTPRequest *)segmentRequest;
+- (void)reportSegmentBytesSent:(long long)bytes sizeChange:(long long)sizeChange;
+- (void)stopUploadingSegments;
+
+@property (retain) NSString *segmentPrefix;
+@property (assign) NSUInteger segmentCount;
+@property (retain) NSMutableDictionary *segmentETags;
+@property (retain, nonatomic) ASINetworkQueue *segmentQueue;
+@property (retain, nonatomic) ASIPartProgressTracker *segmentProgress;
+@end
+
+@implementation ASICloudFilesLargeObjectUploadRequest
+
+- (id)initWithURL:(NSURL *)newURL
+{
+	self = [super initWithURL:newURL];
+	[self setSegmentSize:100*1024*1024];
+	[self setMaxConcurrentSegmentUploads:4];
+	[self setNumberOfTimesToRetrySegment:3];
+	return self;
+}
+
++ (id)putObjectRequestWithContainer:(NSString *)containerName objectPath:(NSString *)objectPath contentType:(NSString *)contentType file:(NSString *)filePath metadata:(NSDictionary *)metadata
+{
+	NSString *urlString = [NSString stringWithFormat:@"%@/%@/%@", [ASICloudFilesRequest storageURL], containerName, objectPath];
+	ASICloudFilesLargeObjectUploadRequest *request = [[[self alloc] initWithURL:[NSURL URLWithString:urlString]] autorelease];
+	[request setRequestMethod:@"PUT"];
+	[request addRequestHeader:@"X-Auth-Token" value:[ASICloudFilesRequest authToken]];
+	[request setContainerName:containerName];
+	[request setObjectPath:objectPath];
+	[request setFilePath:filePath];
+	[request addRequestHeader:@"Content-Type" value:contentType];
+
+	// Metadata is stored on the manifest
+	if (metadata) {
+		for (NSString *key in [metadata keyEnumerator]) {
+			[request addRequestHeader:[NSString stringWithFormat:@"X-Object-Meta-%@", key] value:[metadata objectForKey:key]];
+		}
+	}
+	return request;
+}
+
+- (void)dealloc
+{
+	[segmentQueue reset];
+	[segmentQueue release];
+	[segmentETags release];
+	[segmentProgress release];
+	[segmentPrefix release];
+	[segmentContainerName release];
+	[objectPath release];
+	[filePath release];
+	[super dealloc];
+}
+
+#pragma mark sending the manifest
+
+// The first time we start, we upload the segments on the main thread instead of sending the manifest
+// Once they have all been uploaded, we start again, and this time the manifest is sent
+- (void)main
+{
+	if (haveUploadedSegments) {
+		[super main];
+		return;
+	}
+	if (uploadingSegments || [self isCancelled]) {
+		return;
+	}
+	uploadingSegments = YES;
+	[self performSelectorOnMainThread:@selector(startUploadingSegments) withObject:nil waitUntilDone:[NSThread isMainThread]];
+}
+
+- (void)buildRequestHeaders
+{
+	if (![self haveBuiltRequestHeaders]) {
+		NSString *container = [self segmentContainerName] ? [self segmentContainerName] : [self containerName];
+		[self addRequestHeader:@"X-Object-Manifest" value:[NSString stringWithFormat:@"%@/%@",container,[self segmentPrefix]]];
+		[self addRequestHeader:@"Content-Length" value:@"0"];
+	}
+	[super buildRequestHeaders];
+}
+
+// Cloud Files returns 201 when the manifest has been created
+- (void)requestFinished
+{
+	if (![self error] && [self responseStatusCode] != 201) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASICloudFilesResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Unable to create manifest object (Cloud Files returned status %i)",[self responseStatusCode]],NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	[super requestFinished];
+}
+
+- (void)failWithError:(NSError *)theError
+{
+	BOOL wasUploadingSegments = uploadingSegments;
+	uploadingSegments = NO;
+	[super failWithError:theError];
+	if (wasUploadingSegments) {
+		[self performSelectorOnMainThread:@selector(stopUploadingSegments) withObject:nil waitUntilDone:[NSThread isMainThread]];
+	}
+}
+
+#pragma mark uploading segments
+
+- (void)startUploadingSegments
+{
+	if (!uploadingSegments) {
+		return;
+	}
+	NSError *err = nil;
+	NSDictionary *attributes = [[[[NSFileManager alloc] init] autorelease] attributesOfItemAtPath:[self filePath] error:&err];
+	if (!attributes) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to get attributes for file at path '%@'",[self filePath]],NSLocalizedDescriptionKey,err,NSUnderlyingErrorKey,nil]]];
+		return;
+	}
+	fileSize = [attributes fileSize];
+
+	unsigned long long size = [self segmentSize];
+	if (size > ASICloudFilesMaximumObjectSize) {
+		size = ASICloudFilesMaximumObjectSize;
+	} else if (size < 1) {
+		size = 1;
+	}
+	[self setSegmentSize:size];
+	[self setSegmentCount:(NSUInteger)((fileSize+size-1)/size)];
+
+	// An empty file is uploaded as a single empty segment
+	if (![self segmentCount]) {
+		[self setSegmentCount:1];
+	}
+
+	// Naming the segments after the file's size and modification date means an upload of a file that has changed won't mix its segments with ones from an earlier version
+	[self setSegmentPrefix:[NSString stringWithFormat:@"%@/%.6f/%llu/%llu/",[self objectPath],[[attributes fileModificationDate] timeIntervalSince1970],fileSize,size]];
+
+	[self setSegmentETags:[NSMutableDictionary dictionaryWithCapacity:[self segmentCount]]];
+	[self setSegmentProgress:[ASIPartProgressTracker trackerWithCapacity:[self segmentCount]]];
+	segmentBytesSent = 0;
+	segmentUploadSize = (long long)fileSize;
+	[self incrementUploadSizeBy:(long long)fileSize];
+
+	[[self segmentQueue] reset];
+	[self setSegmentQueue:[ASINetworkQueue queue]];
+	[[self segmentQueue] setDelegate:self];
+	[[self segmentQueue] setShowAccurateProgress:YES];
+	[[self segmentQueue] setShouldCancelAllRequestsOnFailure:NO];
+	[[self segmentQueue] setMaxConcurrentOperationCount:[self maxConcurrentSegmentUploads]];
+	[[self segmentQueue] setRequestDidFinishSelector:@selector(segmentUploadFinished:)];
+	[[self segmentQueue] setRequestDidFailSelector:@selector(segmentUploadFailed:)];
+
+	NSUInteger i;
+	for (i=0; i<[self segmentCount]; i++) {
+		[[self segmentQueue] addOperation:[self requestForSegmentNumber:i attempt:0]];
+	}
+	[[self segmentQueue] go];
+}
+
+// Segments are numbered from 0, and zero-padded so Cloud Files lists them in order when it joins them together
+- (NSString *)segmentPathForSegmentNumber:(NSUInteger)segmentNumber
+{
+	return [NSString stringWithFormat:@"%@%08lu",[self segmentPrefix],(unsigned long)segmentNumber];
+}
+
+// Each segment is streamed straight from its range of the file
+- (ASICloudFilesObjectRequest *)requestForSegmentNumber:(NSUInteger)segmentNumber attempt:(int)attempt
+{
+	unsigned long long offset = segmentNumber*[self segmentSize];
+	unsigned long long length = fileSize-offset;
+	if (length > [self segmentSize]) {
+		length = [self segmentSize];
+	}
+	NSString *container = [self segmentContainerName] ? [self segmentContainerName] : [self containerName];
+	NSString *urlString = [NSString stringWithFormat:@"%@/%@/%@", [ASICloudFilesRequest storageURL], container, [self segmentPathForSegmentNumber:segmentNumber]];
+	ASICloudFilesSegmentRequest *segmentRequest = [[[ASICloudFilesSegmentRequest alloc] initWithURL:[NSURL URLWithString:urlString]] autorelease];
+	[segmentRequest setRequestMethod:@"PUT"];
+	[segmentRequest addRequestHeader:@"X-Auth-Token" value:[ASICloudFilesRequest authToken]];
+	[segmentRequest setContainerName:container];
+	[segmentRequest addRequestHeader:@"Content-Type" value:@"application/octet-stream"];
+	[segmentRequest setPostBodyFilePath:[self filePath]];
+	[segmentRequest setShouldStreamPostDataFromDisk:YES];
+	[segmentRequest setPostBodyFileOffset:offset];
+	[segmentRequest setPostBodyFileLength:length];
+	[segmentRequest setTimeOutSeconds:[self timeOutSeconds]];
+	[segmentRequest setValidatesSecureCertificate:[self validatesSecureCertificate]];
+	[segmentRequest setUploadProgressDelegate:self];
+	[segmentRequest setUserInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithUnsignedInteger:segmentNumber],@"segmentNumber",[NSNumber numberWithInt:attempt],@"attempt",nil]];
+	return segmentRequest;
+}
+
+// Cloud Files doesn't treat a segment as uploaded unless it returns 201 with an ETag matching the MD5 we sent
+// It returns 422 when the body it got doesn't match the MD5, this is retried like a server error or a connection problem, anything else means the upload can't work
+- (void)segmentUploadFinished:(ASIHTTPRequest *)segmentRequest
+{
+	if (!uploadingSegments) {
+		return;
+	}
+	NSNumber *segmentNumber = [[segmentRequest userInfo] objectForKey:@"segmentNumber"];
+	int status = [segmentRequest responseStatusCode];
+	NSString *eTag = [[[segmentRequest responseHeaders] objectForKey:@"Etag"] stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"\""]];
+	NSString *md5 = [(ASICloudFilesSegmentRequest *)segmentRequest segmentMD5];
+	if (status >= 500 || status == 422 || (status == 201 && eTag && md5 && [eTag caseInsensitiveCompare:md5] != NSOrderedSame)) {
+		[self retrySegment:segmentRequest];
+		return;
+	}
+	if (status != 201 || !eTag) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASICloudFilesResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Unable to upload segment %@ (Cloud Files returned status %i)",segmentNumber,[segmentRequest responseStatusCode]],NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	[[self segmentETags] setObject:eTag forKey:segmentNumber];
+	if ([[self segmentETags] count] == [self segmentCount]) {
+		uploadingSegments = NO;
+		haveUploadedSegments = YES;
+		[self setSegmentQueue:nil];
+		[self performSelector:@selector(main) onThread:[[self class] threadForRequest:self] withObject:nil waitUntilDone:NO];
+	}
+}
+
+- (void)segmentUploadFailed:(ASIHTTPRequest *)segmentRequest
+{
+	if (!uploadingSegments) {
+		return;
+	}
+	// Cloud Files error types share their codes with ASIConnectionFailureErrorType and ASIRequestTimedOutErrorType, so we only trust the code when there was no response
+	NSInteger code = [[segmentRequest error] code];
+	if ([segmentRequest responseStatusCode] == 0 && (code == ASIConnectionFailureErrorType || code == ASIRequestTimedOutErrorType)) {
+		[self retrySegment:segmentRequest];
+	} else {
+		[self failWithError:[segmentRequest error]];
+	}
+}
+
+- (void)retrySegment:(ASIHTTPRequest *)segmentRequest
+{
+	NSNumber *segmentNumber = [[segmentRequest userInfo] objectForKey:@"segmentNumber"];
+	int attempt = [[[segmentRequest userInfo] objectForKey:@"attempt"] intValue];
+	if (attempt >= [self numberOfTimesToRetrySegment]) {
+		if ([segmentRequest error]) {
+			[self failWithError:[segmentRequest error]];
+		} else if ([segmentRequest responseStatusCode] == 201 || [segmentRequest responseStatusCode] == 422) {
+			[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASICloudFilesResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Unable to upload segment %@ (the data Cloud Files received didn't match the segment's MD5)",segmentNumber],NSLocalizedDescriptionKey,nil]]];
+		} else {
+			[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASICloudFilesResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Unable to upload segment %@ (Cloud Files returned status %i)",segmentNumber,[segmentRequest responseStatusCode]],NSLocalizedDescriptionKey,nil]]];
+		}
+		return;
+	}
+
+	// Take back the progress the failed request reported, the new one will report it again
+	long long bytes, sizeChange;
+	[[self segmentProgress] startAttempt:attempt+1 forPart:segmentNumber bytesToTakeBack:&bytes sizeChangeToTakeBack:&sizeChange];
+	[self reportSegmentBytesSent:bytes sizeChange:sizeChange];
+	[[self segmentQueue] addOperation:[self requestForSegmentNumber:[segmentNumber unsignedIntegerValue] attempt:attempt+1]];
+}
+
+- (void)stopUploadingSegments
+{
+	for (ASIHTTPRequest *segmentRequest in [[self segmentQueue] operations]) {
+		[segmentRequest clearDelegatesAndCancel];
+	}
+	[[self segmentQueue] reset];
+	[self setSegmentQueue:nil];
+}
+
+#pragma mark progress
+
+// Segments report their progress to us, and we pass it on as our own
+- (void)request:(ASIHTTPRequest *)segmentRequest didSendBytes:(long long)bytes
+{
+	if ([[self segmentProgress] recordBytes:bytes sizeChange:0 forPart:[[segmentRequest userInfo] objectForKey:@"segmentNumber"] attempt:[[[segmentRequest userInfo] objectForKey:@"attempt"] intValue]]) {
+		[self reportSegmentBytesSent:bytes sizeChange:0];
+	}
+}
+
+- (void)request:(ASIHTTPRequest *)segmentRequest incrementUploadSizeBy:(long long)newLength
+{
+	if ([[self segmentProgress] recordBytes:0 sizeChange:newLength forPart:[[segmentRequest userInfo] objectForKey:@"segmentNumber"] attempt:[[[segmentRequest userInfo] objectForKey:@"attempt"] intValue]]) {
+		[self reportSegmentBytesSent:0 sizeChange:newLength];
+	}
+}
+
+- (void)reportSegmentBytesSent:(long long)bytes sizeChange:(long long)sizeChange
+{
+	if (sizeChange) {
+		segmentUploadSize += sizeChange;
+		[self incrementUploadSizeBy:sizeChange];
+	}
+	if (bytes) {
+		segmentBytesSent += bytes;
+		[ASIHTTPRequest performSelector:@selector(request:didSendBytes:) onTarget:&queue withObject:self amount:&bytes callerToRetain:self];
+		[ASIHTTPRequest performSelector:@selector(request:didSendBytes:) onTarget:&uploadProgressDelegate withObject:self amount:&bytes callerToRetain:self];
+	}
+	if (segmentUploadSize > 0) {
+		[ASIHTTPRequest updateProgressIndicator:&uploadProgressDelegate withProgress:segmentBytesSent ofTotal:(unsigned long long)segmentUploadSize];
+	}
+}
+
+#pragma mark NSCopying
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	ASICloudFilesLargeObjectUploadRequest *newRequest = [super copyWithZone:zone];
+	[newRequest setContainerName:[self containerName]];
+	[newRequest setObjectPath:[self objectPath]];
+	[newRequest setFilePath:[self filePath]];
+	[newRequest setSegmentContainerName:[self segmentContainerName]];
+	[newRequest setSegmentSize:[self segmentSize]];
+	[newRequest setMaxConcurrentSegmentUploads:[self maxConcurrentSegmentUploads]];
+	[newRequest setNumberOfTimesToRetrySegment:[self numberOfTimesToRetrySegment]];
+	return newRequest;
+}
+
+@synthesize filePath;
+@synthesize objectPath;
+@synthesize segmentContainerName;
+@synthesize segmentSize;
+@synthesize maxConcurrentSegmentUploads;
+@synthesize numberOfTimesToRetrySegment;
+@synthesize segmentPrefix;
+@synthesize segmentCount;
+@synthesize segmentETags;
+@synthesize segmentQueue;
+@synthesize segmentProgress;
+@end
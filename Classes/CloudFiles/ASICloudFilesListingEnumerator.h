@@ -0,0 +1,70 @@
+//
+//  ASICloudFilesListingEnumerator.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Use an ASICloudFilesListingEnumerator to go through every container in your account, or every object in a container, however many pages the listing is split into
+//  Each page is fetched with a list request for pageSize items, starting after the name of the last item on the page before
+//  While you work through one page, the next is already being fetched, and only those two pages are kept in memory, so you can list very large containers
+//  Pages are parsed as they arrive, rather than once they have been downloaded
+//
+//  nextObject waits for the next page if it hasn't arrived yet, so you'll generally want to use an enumerator on a background thread
+//  If fetching a page fails, nextObject returns nil, and error will tell you what went wrong
+//
+//  ASICloudFilesListingEnumerator *enumerator = [ASICloudFilesListingEnumerator enumeratorWithContainer:@"photos" prefix:@"2026/"];
+//  for (ASICloudFilesObject *object in enumerator) {
+//  	...
+//  }
+//  if ([enumerator error]) {
+//  	...
+//  }
+
+#import <Foundation/Foundation.h>
+
+@class ASICloudFilesRequest;
+
+@interface ASICloudFilesListingEnumerator : NSEnumerator {
+
+	// The container to list objects in, or nil to list containers
+	NSString *containerName;
+
+	// Only objects whose names start with this are listed
+	NSString *prefix;
+
+	// Only objects nested in this pseudo-directory are listed
+	NSString *path;
+
+	// How many items to ask for in each page
+	NSUInteger pageSize;
+
+	// The request for the next page, started as soon as we know there is one
+	ASICloudFilesRequest *pageRequest;
+
+	// Containers or objects from the page we are working through
+	NSArray *currentItems;
+	NSUInteger nextItemIndex;
+
+	// Number of pages fetched so far
+	NSUInteger pageCount;
+
+	NSError *error;
+}
+
+// Create an enumerator that returns an ASICloudFilesContainer for each container in the account
++ (id)containerEnumerator;
+
+// Create an enumerator that returns an ASICloudFilesObject for each object in containerName whose name starts with prefix (pass nil for all of them)
++ (id)enumeratorWithContainer:(NSString *)containerName prefix:(NSString *)prefix;
+
+// Pass 0 for pageSize to use the default of 1000
+- (id)initWithContainer:(NSString *)containerName prefix:(NSString *)prefix path:(NSString *)path pageSize:(NSUInteger)pageSize;
+
+@property (retain, readonly) NSString *containerName;
+@property (retain, readonly) NSString *prefix;
+@property (retain, readonly) NSString *path;
+@property (assign, readonly) NSUInteger pageSize;
+@property (assign, readonly) NSUInteger pageCount;
+@property (retain, readonly) NSError *error;
+@end
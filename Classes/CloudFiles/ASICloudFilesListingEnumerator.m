@@ -0,0 +1,129 @@
+//
+//  ASICloudFilesListingEnumerator.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASICloudFilesListingEnumerator.h"
+#import "ASICloudFilesContainerRequest.h"
+#import "ASICloudFilesObjectRequest.h"
+#import "ASICloudFilesContainer.h"
+#import "ASICloudFilesObject.h"
+
+// Private stuff
+@interface ASICloudFilesListingEnumerator ()
+- (void)startRequestForPageAfterMarker:(NSString *)marker;
+- (NSArray *)itemsForRequest:(ASICloudFilesRequest *)request;
+
+@property (retain, nonatomic) NSString *containerName;
+@property (retain, nonatomic) NSString *prefix;
+@property (retain, nonatomic) NSString *path;
+@property (assign, nonatomic) NSUInteger pageSize;
+@property (retain, nonatomic) ASICloudFilesRequest *pageRequest;
+@property (retain, nonatomic) NSArray *currentItems;
+@property (assign) NSUInteger pageCount;
+@property (retain) NSError *error;
+@end
+
+@implementation ASICloudFilesListingEnumerator
+
++ (id)containerEnumerator
+{
+	return [[[self alloc] initWithContainer:nil prefix:nil path:nil pageSize:0] autorelease];
+}
+
++ (id)enumeratorWithContainer:(NSString *)theContainerName prefix:(NSString *)thePrefix
+{
+	return [[[self alloc] initWithContainer:theContainerName prefix:thePrefix path:nil pageSize:0] autorelease];
+}
+
+- (id)initWithContainer:(NSString *)theContainerName prefix:(NSString *)thePrefix path:(NSString *)thePath pageSize:(NSUInteger)thePageSize
+{
+	self = [super init];
+	[self setContainerName:theContainerName];
+	[self setPrefix:thePrefix];
+	[self setPath:thePath];
+	[self setPageSize:(thePageSize ? thePageSize : 1000)];
+	[self startRequestForPageAfterMarker:nil];
+	return self;
+}
+
+- (void)dealloc
+{
+	[pageRequest clearDelegatesAndCancel];
+	[pageRequest release];
+	[containerName release];
+	[prefix release];
+	[path release];
+	[currentItems release];
+	[error release];
+	[super dealloc];
+}
+
+- (void)startRequestForPageAfterMarker:(NSString *)marker
+{
+	ASICloudFilesRequest *request;
+	if ([self containerName]) {
+		request = [ASICloudFilesObjectRequest listRequestWithContainer:[self containerName] limit:[self pageSize] marker:marker prefix:[self prefix] path:[self path]];
+	} else {
+		request = [ASICloudFilesContainerRequest listRequestWithLimit:[self pageSize] marker:marker];
+	}
+	[self setPageRequest:request];
+	[request startAsynchronous];
+}
+
+- (NSArray *)itemsForRequest:(ASICloudFilesRequest *)request
+{
+	if ([self containerName]) {
+		return [(ASICloudFilesObjectRequest *)request objects];
+	}
+	return [(ASICloudFilesContainerRequest *)request containers];
+}
+
+- (id)nextObject
+{
+	while (nextItemIndex >= [[self currentItems] count]) {
+		[self setCurrentItems:nil];
+		if (![self pageRequest]) {
+			return nil;
+		}
+		ASICloudFilesRequest *request = [[[self pageRequest] retain] autorelease];
+		[request waitUntilFinished];
+		[self setPageRequest:nil];
+		if ([request error]) {
+			[self setError:[request error]];
+			return nil;
+		}
+
+		// Cloud Files returns 204 for an empty listing
+		if ([request responseStatusCode] == 204) {
+			return nil;
+		}
+		if ([request responseStatusCode] != 200) {
+			[self setError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASICloudFilesResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Unable to fetch listing (Cloud Files returned status %i)",[request responseStatusCode]],NSLocalizedDescriptionKey,nil]]];
+			return nil;
+		}
+		[self setPageCount:[self pageCount]+1];
+
+		// A full page means there may be more, so start fetching the next page before we hand out the items from this one
+		NSArray *items = [self itemsForRequest:request];
+		if ([items count] >= [self pageSize]) {
+			[self startRequestForPageAfterMarker:[[items lastObject] name]];
+		}
+		[self setCurrentItems:items];
+		nextItemIndex = 0;
+	}
+	return [[self currentItems] objectAtIndex:nextItemIndex++];
+}
+
+@synthesize containerName;
+@synthesize prefix;
+@synthesize path;
+@synthesize pageSize;
+@synthesize pageRequest;
+@synthesize currentItems;
+@synthesize pageCount;
+@synthesize error;
+@end
@@ -33,6 +33,9 @@
 @property (retain) ASICloudFilesObject *currentObject;
 
 
+// Create a request for an object in the storage service, sending the current auth token
++ (id)storageRequestWithMethod:(NSString *)method containerName:(NSString *)containerName objectPath:(NSString *)objectPath;
+
 // HEAD /<api version>/<account>/<container>
 // HEAD operations against an account are performed to retrieve the number of Containers and the total bytes stored in Cloud Files for the account. This information is returned in two custom headers, X-Account-Container-Count and X-Account-Bytes-Used.
 + (id)containerInfoRequest:(NSString *)containerName;
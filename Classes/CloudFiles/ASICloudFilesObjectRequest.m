@@ -79,6 +79,9 @@
 	if (marker) {
 		queryString = [queryString stringByAppendingString:[NSString stringWithFormat:@"&marker=%@", [marker stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]]];
 	}
+	if (prefix) {
+		queryString = [queryString stringByAppendingString:[NSString stringWithFormat:@"&prefix=%@", [prefix stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]]];
+	}
 	if (path) {
 		queryString = [queryString stringByAppendingString:[NSString stringWithFormat:@"&path=%@", [path stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]]];
 	}
@@ -89,6 +92,7 @@
 + (id)listRequestWithContainer:(NSString *)containerName limit:(NSUInteger)limit marker:(NSString *)marker prefix:(NSString *)prefix path:(NSString *)path {
 	NSString *queryString = [ASICloudFilesObjectRequest queryStringWithContainer:containerName limit:limit marker:marker prefix:prefix path:path];
 	ASICloudFilesObjectRequest *request = [ASICloudFilesObjectRequest storageRequestWithMethod:@"GET" containerName:containerName queryString:queryString];
+	[request setShouldParseResponseAsItArrives:YES];
 	return request;
 }
 
@@ -96,11 +100,12 @@
 	return [ASICloudFilesObjectRequest listRequestWithContainer:containerName limit:0 marker:nil prefix:nil path:nil];
 }
 
+// When the listing was parsed as it arrived, objects will already be here
 - (NSArray *)objects {
 	if (objects) {
 		return objects;
 	}
-	objects = [[[NSMutableArray alloc] init] autorelease];
+	objects = [[NSMutableArray alloc] init];
 	
 	NSXMLParser *parser = [[[NSXMLParser alloc] initWithData:[self responseData]] autorelease];
 	[parser setDelegate:self];
@@ -215,6 +220,17 @@
 #pragma mark -
 #pragma mark XML Parser Delegate
 
+- (id)responseParserDelegate {
+	return self;
+}
+
+// Throw away anything we parsed from an earlier response (eg when the request is retried after timing out)
+- (void)readResponseHeaders {
+	[objects release];
+	objects = nil;
+	[super readResponseHeaders];
+}
+
 - (void)parser:(NSXMLParser *)parser didStartElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName attributes:(NSDictionary *)attributeDict {
 	[self setCurrentElement:elementName];
 	
@@ -237,6 +253,9 @@
 		[self currentObject].lastModified = [self dateFromString:[self currentContent]];
 	} else if ([elementName isEqualToString:@"object"]) {
 		// we're done with this object.  time to move on to the next
+		if (objects == nil) {
+			objects = [[NSMutableArray alloc] init];
+		}
 		[objects addObject:currentObject];
 		[self setCurrentObject:nil];
 	}
@@ -250,6 +269,7 @@
 #pragma mark Memory Management
 
 - (void)dealloc {
+	[objects release];
 	[currentElement release];
 	[currentContent release];
 	[currentObject release];
@@ -16,8 +16,25 @@
 #import <Foundation/Foundation.h>
 #import "ASIHTTPRequest.h"
 
+@class ASIXMLPushParser;
+
+typedef enum _ASICloudFilesErrorType {
+	ASICloudFilesResponseParsingFailedType = 1,
+	ASICloudFilesResponseErrorType = 2 // Cloud Files returned a status we didn't expect, in requests that check it
+} ASICloudFilesErrorType;
 
 @interface ASICloudFilesRequest : ASIHTTPRequest {
+
+	// Set once this request has been sent again after getting a 401, so a second 401 fails the request
+	BOOL hasRetriedAfterAuthentication;
+
+	// When YES, successful XML responses are parsed as they arrive, rather than when you first ask for the results
+	// The parsing events are sent to the NSXMLParser delegate returned by responseParserDelegate, though the parser they are passed will be nil
+	// Default is NO, list requests turn this on so large listings are parsed while they download
+	BOOL shouldParseResponseAsItArrives;
+
+	// Internally used when parsing the response as it arrives
+	ASIXMLPushParser *responseParser;
 }
 
 + (NSString *)storageURL;
@@ -26,8 +43,37 @@
 
 #pragma mark Rackspace Cloud Authentication
 
+// Requests that send an X-Auth-Token header send the current auth token when they start, rather than the one we had when they were created
+// When one of them gets a 401, it waits while we authenticate again in the background, then is sent again with the new token
+// Only one authentication request runs at a time, however many requests are waiting for it
+// Requests that start when the token is about to expire start authenticating in the background, so a new token is usually ready before the old one stops working
+
 + (id)authenticationRequest;
+
+// Authenticates, and waits for it to finish. If we are already authenticating, waits for that to finish instead of starting again
+// Returns nil if authentication succeeded
 + (NSError *)authenticate;
+
+// Starts authenticating in the background, unless we already are, and returns straight away
++ (void)startAuthentication;
+
+// When we expect the auth token to stop working, or nil if we haven't authenticated
++ (NSDate *)authTokenExpiryDate;
+
+// How long an auth token lasts, when the authentication response doesn't tell us (with an X-Auth-Token-Expires header)
+// Defaults to 23 hours, Cloud Files tokens last for 24
++ (NSTimeInterval)authTokenLifetime;
++ (void)setAuthTokenLifetime:(NSTimeInterval)newLifetime;
+
+// How long before the auth token expires we start getting a new one. Defaults to 5 minutes
++ (NSTimeInterval)authTokenRefreshInterval;
++ (void)setAuthTokenRefreshInterval:(NSTimeInterval)newInterval;
+
+// Use to authenticate with a Swift-compatible server instead of Rackspace (eg a local stand-in for testing)
+// Pass nil to go back to using Rackspace
++ (NSString *)authenticationURL;
++ (void)setAuthenticationURL:(NSString *)newURL;
+
 + (NSString *)username;
 + (void)setUsername:(NSString *)username;
 + (NSString *)apiKey;
@@ -36,5 +82,10 @@
 // helper to parse dates in the format returned by Cloud Files
 -(NSDate *)dateFromString:(NSString *)dateString;
 
+// Subclasses that parse XML responses return the object that should be sent parsing events when parsing the response as it arrives
+// The default implementation returns nil, meaning the response isn't parsed as it arrives
+- (id)responseParserDelegate;
+
+@property (assign) BOOL shouldParseResponseAsItArrives;
 
 @end
@@ -12,6 +12,7 @@
 // http://docs.rackspacecloud.com/servers/api/cs-devguide-latest.pdf
 
 #import "ASICloudFilesRequest.h"
+#import "ASIXMLPushParser.h"
 
 static NSString *username = nil;
 static NSString *apiKey = nil;
@@ -19,31 +20,115 @@ static NSString *authToken = nil;
 static NSString *storageURL = nil;
 static NSString *cdnManagementURL = nil;
 static NSString *rackspaceCloudAuthURL = @"https://auth.api.rackspacecloud.com/v1.0";
+static NSString *authenticationURL = nil;
+static NSDate *authTokenExpiryDate = nil;
+static NSTimeInterval authTokenLifetime = 23*60*60;
+static NSTimeInterval authTokenRefreshInterval = 5*60;
 
+// Protects the access details above. It is only ever held briefly, never while waiting for a request
 static NSRecursiveLock *accessDetailsLock = nil;
 
+// The authentication request that is running, if there is one, and the requests waiting for it to finish
+// These are protected by authenticationCondition, which callers of authenticate wait on until authenticationCount goes up
+// When both locks are needed, authenticationCondition is taken first
+static NSCondition *authenticationCondition = nil;
+static ASIHTTPRequest *runningAuthenticationRequest = nil;
+static NSMutableArray *requestsWaitingForAuthentication = nil;
+static NSUInteger authenticationCount = 0;
+static NSError *lastAuthenticationError = nil;
+
+// Authentication requests run in their own queue
+// Requests waiting for a new token are still running as far as the shared queue is concerned, so if we used it, they could stop the authentication request from starting
+static NSOperationQueue *authenticationQueue = nil;
+
+// Tells ASICloudFilesRequest when authentication has finished
+// This happens on the thread the request runs on rather than the main thread, so waiting for authentication on the main thread doesn't deadlock
+@interface ASICloudFilesAuthenticationRequest : ASIHTTPRequest {
+}
+@end
+
+// ASIHTTPRequest methods we need to send a request again after a 401
+@interface ASIHTTPRequest (ASICloudFilesRequest)
+- (void)cancelLoad;
+- (void)setLastActivityTime:(NSDate *)date;
+- (NSString *)runLoopMode;
+@end
+
+// Private stuff
+@interface ASICloudFilesRequest ()
++ (ASIHTTPRequest *)newAuthenticationRequestIfNeeded;
++ (void)authenticationRequestFinished:(ASIHTTPRequest *)request;
+- (void)retryAfterAuthentication:(NSError *)authenticationError;
+- (void)finishParsingResponse;
+@property (retain, nonatomic) ASIXMLPushParser *responseParser;
+@end
+
+@implementation ASICloudFilesAuthenticationRequest
+
+- (void)requestFinished
+{
+	[super requestFinished];
+	[ASICloudFilesRequest authenticationRequestFinished:self];
+}
+
+- (void)failWithError:(NSError *)theError
+{
+	[super failWithError:theError];
+	[ASICloudFilesRequest authenticationRequestFinished:self];
+}
+
+// A 401 means the username or api key is wrong, there's no point asking for other credentials
+- (void)attemptToApplyCredentialsAndResume
+{
+	if ([self error] || [self isCancelled]) {
+		return;
+	}
+	[self cancelLoad];
+	[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIAuthenticationErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Authentication failed, check your username and api key",NSLocalizedDescriptionKey,nil]]];
+}
+
+@end
+
 @implementation ASICloudFilesRequest
 
 + (void)initialize
 {
 	if (self == [ASICloudFilesRequest class]) {
 		accessDetailsLock = [[NSRecursiveLock alloc] init];
+		authenticationCondition = [[NSCondition alloc] init];
+		requestsWaitingForAuthentication = [[NSMutableArray alloc] init];
+		authenticationQueue = [[NSOperationQueue alloc] init];
 	}
 }
 
+- (void)dealloc
+{
+	[responseParser release];
+	[super dealloc];
+}
+
 #pragma mark -
 #pragma mark Attributes and Service URLs
 
 + (NSString *)authToken {
-	return authToken;
+	[accessDetailsLock lock];
+	NSString *token = [[authToken retain] autorelease];
+	[accessDetailsLock unlock];
+	return token;
 }
 
 + (NSString *)storageURL {
-	return storageURL;
+	[accessDetailsLock lock];
+	NSString *url = [[storageURL retain] autorelease];
+	[accessDetailsLock unlock];
+	return url;
 }
 
 + (NSString *)cdnManagementURL {
-	return cdnManagementURL;
+	[accessDetailsLock lock];
+	NSString *url = [[cdnManagementURL retain] autorelease];
+	[accessDetailsLock unlock];
+	return url;
 }
 
 #pragma mark -
@@ -52,7 +137,7 @@ static NSRecursiveLock *accessDetailsLock = nil;
 + (id)authenticationRequest
 {
 	[accessDetailsLock lock];
-	ASIHTTPRequest *request = [[[ASIHTTPRequest alloc] initWithURL:[NSURL URLWithString:rackspaceCloudAuthURL]] autorelease];
+	ASIHTTPRequest *request = [[[ASIHTTPRequest alloc] initWithURL:[NSURL URLWithString:(authenticationURL ? authenticationURL : rackspaceCloudAuthURL)]] autorelease];
 	[request addRequestHeader:@"X-Auth-User" value:username];
 	[request addRequestHeader:@"X-Auth-Key" value:apiKey];
 	[accessDetailsLock unlock];
@@ -61,18 +146,230 @@ static NSRecursiveLock *accessDetailsLock = nil;
 
 + (NSError *)authenticate
 {
+	[authenticationCondition lock];
+	NSUInteger count = authenticationCount;
+	ASIHTTPRequest *request = [self newAuthenticationRequestIfNeeded];
+	[authenticationCondition unlock];
+
+	// Added to the queue without the lock held, because it may finish before addOperation: returns
+	if (request) {
+		[authenticationQueue addOperation:request];
+		[request release];
+	}
+
+	[authenticationCondition lock];
+	while (authenticationCount == count) {
+		[authenticationCondition wait];
+	}
+	NSError *theError = [[lastAuthenticationError retain] autorelease];
+	[authenticationCondition unlock];
+	return theError;
+}
+
++ (void)startAuthentication
+{
+	[authenticationCondition lock];
+	ASIHTTPRequest *request = [self newAuthenticationRequestIfNeeded];
+	[authenticationCondition unlock];
+	if (request) {
+		[authenticationQueue addOperation:request];
+		[request release];
+	}
+}
+
+// Returns a new authentication request for the caller to start, or nil if one is already running
+// Must be called with authenticationCondition locked
++ (ASIHTTPRequest *)newAuthenticationRequestIfNeeded
+{
+	if (runningAuthenticationRequest) {
+		return nil;
+	}
 	[accessDetailsLock lock];
-	ASIHTTPRequest *request = [ASICloudFilesRequest authenticationRequest];
-	[request startSynchronous];
-	
-	if (![request error]) {
-		NSDictionary *responseHeaders = [request responseHeaders];
-		authToken = [responseHeaders objectForKey:@"X-Auth-Token"];
-		storageURL = [responseHeaders objectForKey:@"X-Storage-Url"];
-		cdnManagementURL = [responseHeaders objectForKey:@"X-Cdn-Management-Url"];
+	ASIHTTPRequest *request = [[ASICloudFilesAuthenticationRequest alloc] initWithURL:[NSURL URLWithString:(authenticationURL ? authenticationURL : rackspaceCloudAuthURL)]];
+	[request addRequestHeader:@"X-Auth-User" value:username];
+	[request addRequestHeader:@"X-Auth-Key" value:apiKey];
+	[accessDetailsLock unlock];
+	runningAuthenticationRequest = [request retain];
+	return request;
+}
+
++ (void)authenticationRequestFinished:(ASIHTTPRequest *)request
+{
+	NSError *theError = [request error];
+	NSDictionary *responseHeaders = [request responseHeaders];
+	if (!theError && ![responseHeaders objectForKey:@"X-Auth-Token"]) {
+		theError = [NSError errorWithDomain:NetworkRequestErrorDomain code:ASIAuthenticationErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Authentication failed (status %i)",[request responseStatusCode]],NSLocalizedDescriptionKey,nil]];
+	}
+
+	[authenticationCondition lock];
+	if (request != runningAuthenticationRequest) {
+		[authenticationCondition unlock];
+		return;
+	}
+	if (!theError) {
+		[accessDetailsLock lock];
+		[authToken release];
+		authToken = [[responseHeaders objectForKey:@"X-Auth-Token"] retain];
+		[storageURL release];
+		storageURL = [[responseHeaders objectForKey:@"X-Storage-Url"] retain];
+		[cdnManagementURL release];
+		cdnManagementURL = [[responseHeaders objectForKey:@"X-Cdn-Management-Url"] retain];
+		NSTimeInterval lifetime = authTokenLifetime;
+		if ([responseHeaders objectForKey:@"X-Auth-Token-Expires"]) {
+			lifetime = [[responseHeaders objectForKey:@"X-Auth-Token-Expires"] doubleValue];
+		}
+		[authTokenExpiryDate release];
+		authTokenExpiryDate = [[NSDate alloc] initWithTimeIntervalSinceNow:lifetime];
+		[accessDetailsLock unlock];
 	}
+	[lastAuthenticationError release];
+	lastAuthenticationError = [theError retain];
+	authenticationCount++;
+	NSArray *waitingRequests = [requestsWaitingForAuthentication autorelease];
+	requestsWaitingForAuthentication = [[NSMutableArray alloc] init];
+	[runningAuthenticationRequest autorelease];
+	runningAuthenticationRequest = nil;
+	[authenticationCondition broadcast];
+	[authenticationCondition unlock];
+
+	// Only asynchronous requests are parked, so they are running on the shared network thread
+	// We use the run loop mode the request runs in, so the retry happens even if that isn't the default mode
+	for (ASICloudFilesRequest *waitingRequest in waitingRequests) {
+		[waitingRequest performSelector:@selector(retryAfterAuthentication:) onThread:[[waitingRequest class] threadForRequest:waitingRequest] withObject:theError waitUntilDone:NO modes:[NSArray arrayWithObject:[waitingRequest runLoopMode]]];
+	}
+}
+
++ (NSDate *)authTokenExpiryDate
+{
+	[accessDetailsLock lock];
+	NSDate *date = [[authTokenExpiryDate retain] autorelease];
 	[accessDetailsLock unlock];
-	return [request error];
+	return date;
+}
+
++ (NSTimeInterval)authTokenLifetime
+{
+	[accessDetailsLock lock];
+	NSTimeInterval lifetime = authTokenLifetime;
+	[accessDetailsLock unlock];
+	return lifetime;
+}
+
++ (void)setAuthTokenLifetime:(NSTimeInterval)newLifetime
+{
+	[accessDetailsLock lock];
+	authTokenLifetime = newLifetime;
+	[accessDetailsLock unlock];
+}
+
++ (NSTimeInterval)authTokenRefreshInterval
+{
+	[accessDetailsLock lock];
+	NSTimeInterval interval = authTokenRefreshInterval;
+	[accessDetailsLock unlock];
+	return interval;
+}
+
++ (void)setAuthTokenRefreshInterval:(NSTimeInterval)newInterval
+{
+	[accessDetailsLock lock];
+	authTokenRefreshInterval = newInterval;
+	[accessDetailsLock unlock];
+}
+
++ (NSString *)authenticationURL
+{
+	[accessDetailsLock lock];
+	NSString *url = [[(authenticationURL ? authenticationURL : rackspaceCloudAuthURL) retain] autorelease];
+	[accessDetailsLock unlock];
+	return url;
+}
+
++ (void)setAuthenticationURL:(NSString *)newURL
+{
+	[accessDetailsLock lock];
+	[authenticationURL release];
+	authenticationURL = [newURL retain];
+	[accessDetailsLock unlock];
+}
+
+#pragma mark -
+#pragma mark Sending requests with the current auth token
+
+- (void)buildRequestHeaders
+{
+	if (![self haveBuiltRequestHeaders] && [[self requestHeaders] objectForKey:@"X-Auth-Token"]) {
+		[accessDetailsLock lock];
+		NSString *currentToken = [[authToken retain] autorelease];
+		BOOL shouldRefreshToken = (authTokenExpiryDate && [authTokenExpiryDate timeIntervalSinceNow] < authTokenRefreshInterval);
+		[accessDetailsLock unlock];
+		if (currentToken) {
+			[self addRequestHeader:@"X-Auth-Token" value:currentToken];
+		}
+		if (shouldRefreshToken) {
+			[[self class] startAuthentication];
+		}
+	}
+	[super buildRequestHeaders];
+}
+
+- (void)attemptToApplyCredentialsAndResume
+{
+	NSString *sentToken = [[self requestHeaders] objectForKey:@"X-Auth-Token"];
+	if ([self authenticationNeeded] != ASIHTTPAuthenticationNeeded || !sentToken || [self error] || [self isCancelled]) {
+		[super attemptToApplyCredentialsAndResume];
+		return;
+	}
+	if (hasRetriedAfterAuthentication) {
+		[self cancelLoad];
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIAuthenticationErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"The auth token was rejected",NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	hasRetriedAfterAuthentication = YES;
+
+	// If another request has already got a new token, we can use it straight away
+	[accessDetailsLock lock];
+	BOOL tokenHasChanged = (authToken && ![authToken isEqualToString:sentToken]);
+	[accessDetailsLock unlock];
+	if (tokenHasChanged) {
+		[self retryAfterAuthentication:nil];
+		return;
+	}
+
+	// A synchronous request is already blocking the thread it runs on, so it can wait for the new token right here
+	// (It couldn't be called back later, because that thread is only running its run loop in ASIHTTPRequestRunLoopMode)
+	if (isSynchronous) {
+		[self setLastActivityTime:nil];
+		[self retryAfterAuthentication:[[self class] authenticate]];
+		return;
+	}
+
+	// Otherwise wait for a new one, without timing out while we do
+	[self setLastActivityTime:nil];
+	[authenticationCondition lock];
+	[requestsWaitingForAuthentication addObject:self];
+	ASIHTTPRequest *request = [[self class] newAuthenticationRequestIfNeeded];
+	[authenticationCondition unlock];
+	if (request) {
+		[authenticationQueue addOperation:request];
+		[request release];
+	}
+}
+
+// Called on the request's thread once authentication has finished
+- (void)retryAfterAuthentication:(NSError *)authenticationError
+{
+	if ([self error] || [self isCancelled]) {
+		return;
+	}
+	[self cancelLoad];
+	if (authenticationError) {
+		[self failWithError:authenticationError];
+		return;
+	}
+	// Go back to the beginning, so the headers are built again with the new token
+	[self setHaveBuiltRequestHeaders:NO];
+	[self main];
 }
 
 + (NSString *)username
@@ -100,6 +397,70 @@ static NSRecursiveLock *accessDetailsLock = nil;
 	[accessDetailsLock unlock];
 }
 
+#pragma mark -
+#pragma mark Parsing the response as it arrives
+
+- (id)responseParserDelegate
+{
+	return nil;
+}
+
+// A new response means starting again (eg when the request is sent again with a new auth token)
+- (void)readResponseHeaders
+{
+	[self setResponseParser:nil];
+	[super readResponseHeaders];
+}
+
+// Only successful XML responses are parsed as they arrive
+- (void)didReceiveResponseBytes:(const void *)bytes length:(NSUInteger)length
+{
+	if (![self shouldParseResponseAsItArrives] || [self error]) {
+		return;
+	}
+	if (![self responseParser]) {
+		if ([self responseStatusCode] != 200 || ![[[self responseHeaders] objectForKey:@"Content-Type"] hasPrefix:@"application/xml"] || ![self responseParserDelegate]) {
+			return;
+		}
+		[self setResponseParser:[ASIXMLPushParser parserForRequest:self delegate:[self responseParserDelegate]]];
+		if (![self responseParser]) {
+			return;
+		}
+	}
+	NSError *parseError = [[self responseParser] parseBytes:bytes length:length];
+	if (parseError && ![self error]) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASICloudFilesResponseParsingFailedType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Parsing the response failed",NSLocalizedDescriptionKey,parseError,NSUnderlyingErrorKey,nil]]];
+	}
+}
+
+- (void)finishParsingResponse
+{
+	if (![self responseParser]) {
+		return;
+	}
+	NSError *parseError = [[self responseParser] finishParsing];
+	[self setResponseParser:nil];
+	if (parseError && ![self error]) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASICloudFilesResponseParsingFailedType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Parsing the response failed",NSLocalizedDescriptionKey,parseError,NSUnderlyingErrorKey,nil]]];
+	}
+}
+
+- (void)requestFinished
+{
+	[self finishParsingResponse];
+	if ([self error]) {
+		return;
+	}
+	[super requestFinished];
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	ASICloudFilesRequest *newRequest = [super copyWithZone:zone];
+	[newRequest setShouldParseResponseAsItArrives:[self shouldParseResponseAsItArrives]];
+	return newRequest;
+}
+
 #pragma mark -
 #pragma mark Date Parser
 
@@ -120,4 +481,6 @@ static NSRecursiveLock *accessDetailsLock = nil;
 	return [dateFormatter dateFromString:dateString];
 }
 
+@synthesize shouldParseResponseAsItArrives;
+@synthesize responseParser;
 @end
@@ -0,0 +1,54 @@
+//
+//  ASIS3BucketEnumerator.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Use an ASIS3BucketEnumerator to go through every object in a bucket listing, however many pages S3 splits it into
+//  Pass it a request set up the way you want (prefix, delimiter, maxResultCount, credentials etc), and it will fetch each page for you, using copies of the request
+//  While you work through one page, the next is already being fetched, and only those two pages are kept in memory, so you can list millions of objects
+//
+//  nextObject waits for the next page if it hasn't arrived yet, so you'll generally want to use an enumerator on a background thread
+//  If fetching a page fails, nextObject returns nil, and error will tell you what went wrong
+//  error is also set if S3 cuts a page short without telling us where the next one starts, in which case nextObject returns nil once the objects it did send run out
+//  Only objects are returned - when you set a delimiter, the 'folders' for each page are skipped
+//
+//  ASIS3BucketRequest *listRequest = [ASIS3BucketRequest requestWithBucket:@"mybucket"];
+//  [listRequest setPrefix:@"images/"];
+//  ASIS3BucketEnumerator *enumerator = [ASIS3BucketEnumerator enumeratorWithRequest:listRequest];
+//  for (ASIS3BucketObject *object in enumerator) {
+//  	...
+//  }
+//  if ([enumerator error]) {
+//  	...
+//  }
+
+#import <Foundation/Foundation.h>
+
+@class ASIS3BucketRequest;
+
+@interface ASIS3BucketEnumerator : NSEnumerator {
+
+	// Each page is fetched with a copy of this request
+	ASIS3BucketRequest *templateRequest;
+
+	// The request for the next page, started as soon as we know there is one
+	ASIS3BucketRequest *pageRequest;
+
+	// Objects from the page we are working through
+	NSArray *currentObjects;
+	NSUInteger nextObjectIndex;
+
+	// Number of pages fetched so far
+	NSUInteger pageCount;
+
+	NSError *error;
+}
+
++ (id)enumeratorWithRequest:(ASIS3BucketRequest *)request;
+- (id)initWithRequest:(ASIS3BucketRequest *)request;
+
+@property (assign, readonly) NSUInteger pageCount;
+@property (retain, readonly) NSError *error;
+@end
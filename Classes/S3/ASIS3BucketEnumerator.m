@@ -0,0 +1,105 @@
+//
+//  ASIS3BucketEnumerator.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIS3BucketEnumerator.h"
+#import "ASIS3BucketRequest.h"
+#import "ASIS3BucketObject.h"
+
+// Private stuff
+@interface ASIS3BucketEnumerator ()
+- (void)startRequestForPageAfterMarker:(NSString *)marker;
+
+@property (retain, nonatomic) ASIS3BucketRequest *templateRequest;
+@property (retain, nonatomic) ASIS3BucketRequest *pageRequest;
+@property (retain, nonatomic) NSArray *currentObjects;
+@property (assign) NSUInteger pageCount;
+@property (retain) NSError *error;
+@end
+
+@implementation ASIS3BucketEnumerator
+
++ (id)enumeratorWithRequest:(ASIS3BucketRequest *)request
+{
+	return [[[self alloc] initWithRequest:request] autorelease];
+}
+
+- (id)initWithRequest:(ASIS3BucketRequest *)request
+{
+	self = [super init];
+	[self setTemplateRequest:[[request copy] autorelease]];
+	[self startRequestForPageAfterMarker:[request marker]];
+	return self;
+}
+
+- (void)dealloc
+{
+	[pageRequest clearDelegatesAndCancel];
+	[pageRequest release];
+	[templateRequest release];
+	[currentObjects release];
+	[error release];
+	[super dealloc];
+}
+
+- (void)startRequestForPageAfterMarker:(NSString *)marker
+{
+	ASIS3BucketRequest *request = [[[self templateRequest] copy] autorelease];
+	[request setDelegate:nil];
+	[request setMarker:marker];
+	// The template may already have built a URL, which would be for the wrong page
+	[request setURL:nil];
+	[self setPageRequest:request];
+	[request startAsynchronous];
+}
+
+- (id)nextObject
+{
+	while (nextObjectIndex >= [[self currentObjects] count]) {
+		[self setCurrentObjects:nil];
+		if (![self pageRequest]) {
+			return nil;
+		}
+		ASIS3BucketRequest *request = [[[self pageRequest] retain] autorelease];
+		[request waitUntilFinished];
+		[self setPageRequest:nil];
+		if ([request error]) {
+			[self setError:[request error]];
+			return nil;
+		}
+		[self setPageCount:[self pageCount]+1];
+
+		// Start fetching the next page before we hand out the objects from this one
+		if ([request isTruncated]) {
+			NSString *marker = [request nextMarker];
+			if (!marker) {
+				// S3 only sends NextMarker when we use a delimiter, otherwise the next page starts after the last key or common prefix on this one, whichever comes later
+				marker = [[[request objects] lastObject] key];
+				NSString *lastPrefix = [[request commonPrefixes] lastObject];
+				if (lastPrefix && (!marker || [lastPrefix compare:marker options:NSLiteralSearch] == NSOrderedDescending)) {
+					marker = lastPrefix;
+				}
+			}
+			if (marker) {
+				[self startRequestForPageAfterMarker:marker];
+			} else {
+				// We'd have no way to ask for the rest of the listing, so make sure the caller knows it is incomplete
+				[self setError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"S3 returned a truncated page of the listing for '%@' without saying where the next page starts",[request bucket]],NSLocalizedDescriptionKey,nil]]];
+			}
+		}
+		[self setCurrentObjects:[request objects]];
+		nextObjectIndex = 0;
+	}
+	return [[self currentObjects] objectAtIndex:nextObjectIndex++];
+}
+
+@synthesize templateRequest;
+@synthesize pageRequest;
+@synthesize currentObjects;
+@synthesize pageCount;
+@synthesize error;
+@end
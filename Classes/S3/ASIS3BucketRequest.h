@@ -6,6 +6,8 @@
 //  Copyright 2010 All-Seeing Interactive. All rights reserved.
 //
 //  Use this class to create buckets, fetch a list of their contents, and delete buckets
+//  Listings are parsed as they download. To go through every object in a large bucket without fetching each page yourself, use an ASIS3BucketEnumerator
+//  To list a very large bucket using several connections at once, use an ASIS3PartitionedBucketEnumerator
 
 #import <Foundation/Foundation.h>
 #import "ASIS3Request.h"
@@ -39,6 +41,10 @@
 	
 	// Will be true if this request did not return all the results matching the query (use maxResultCount to configure the number of results to return)
 	BOOL isTruncated;
+
+	// When the results were truncated, the marker to use to fetch the next page
+	// S3 only returns this when a delimiter is set, otherwise use the key of the last object
+	NSString *nextMarker;
 }
 
 // Fetch a bucket
@@ -69,4 +75,5 @@
 @property (retain, readonly) NSMutableArray *objects;
 @property (retain, readonly) NSMutableArray *commonPrefixes;
 @property (assign, readonly) BOOL isTruncated;
+@property (retain, readonly) NSString *nextMarker;
 @end
@@ -16,6 +16,7 @@
 @property (retain) NSMutableArray *objects;
 @property (retain) NSMutableArray *commonPrefixes;
 @property (assign) BOOL isTruncated;
+@property (retain) NSString *nextMarker;
 @end
 
 @implementation ASIS3BucketRequest
@@ -25,6 +26,7 @@
 	self = [super initWithURL:newURL];
 	[self setObjects:[[[NSMutableArray alloc] init] autorelease]];
 	[self setCommonPrefixes:[[[NSMutableArray alloc] init] autorelease]];
+	[self setShouldParseResponseAsItArrives:YES];
 	return self;
 }
 
@@ -63,6 +65,7 @@
 	[currentObject release];
 	[objects release];
 	[commonPrefixes release];
+	[nextMarker release];
 	[prefix release];
 	[marker release];
 	[delimiter release];
@@ -141,6 +144,8 @@
 		[[self commonPrefixes] addObject:[self currentXMLElementContent]];
 	} else if ([elementName isEqualToString:@"IsTruncated"]) {
 		[self setIsTruncated:[[self currentXMLElementContent] isEqualToString:@"true"]];
+	} else if ([elementName isEqualToString:@"NextMarker"]) {
+		[self setNextMarker:[self currentXMLElementContent]];
 	} else {
 		// Let ASIS3Request look for error messages
 		[super parser:parser didEndElement:elementName namespaceURI:namespaceURI qualifiedName:qName];
@@ -171,5 +176,6 @@
 @synthesize maxResultCount;
 @synthesize delimiter;
 @synthesize isTruncated;
+@synthesize nextMarker;
 
 @end
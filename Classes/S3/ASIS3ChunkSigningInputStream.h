@@ -0,0 +1,42 @@
+//
+//  ASIS3ChunkSigningInputStream.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  An ASIInputStream that sends the request body using the aws-chunked encoding, signing each chunk as it is read
+//  See http://docs.aws.amazon.com/AmazonS3/latest/API/sigv4-streaming.html
+//
+//  ASIS3Request uses this to upload files signed with signature version 4 without hashing the whole file before the request starts
+//  You shouldn't need to use it yourself
+
+#import <Foundation/Foundation.h>
+#import "ASIInputStream.h"
+
+// Size of each chunk of the body (apart from the last two). S3 needs at least 8KB
+extern const NSUInteger ASIS3ChunkSigningChunkSize;
+
+@interface ASIS3ChunkSigningInputStream : ASIInputStream {
+
+	// Signature of the chunk we sent last, each chunk's signature depends on the one before
+	// Before we send the first chunk, this is the signature from the request's Authorization header
+	NSString *previousSignature;
+
+	// Data read from the file for the current chunk
+	NSMutableData *chunkData;
+
+	// The current chunk, with its header and signature, and how much of it has been read so far
+	NSMutableData *encodedChunk;
+	NSUInteger encodedChunkOffset;
+
+	// Set to YES once we've encoded the empty chunk that ends the body
+	BOOL encodedFinalChunk;
+}
+
+// Returns the number of bytes that will be sent for length bytes of data, once it has been split into chunks and signed
+// ASIS3Request uses this for the Content-Length header
++ (unsigned long long)encodedLengthForLength:(unsigned long long)length;
+
+@property (retain, nonatomic) NSString *previousSignature;
+@end
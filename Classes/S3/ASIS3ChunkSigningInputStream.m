@@ -0,0 +1,133 @@
+//
+//  ASIS3ChunkSigningInputStream.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIS3ChunkSigningInputStream.h"
+#import "ASIS3Request.h"
+
+const NSUInteger ASIS3ChunkSigningChunkSize = 64*1024;
+
+// Each chunk looks like this: <size in hex>;chunk-signature=<64 hex digits>\r\n<data>\r\n
+static const char *ASIS3ChunkSignatureLabel = ";chunk-signature=";
+
+static unsigned long long ASIS3EncodedChunkLength(unsigned long long length)
+{
+	unsigned long long hexDigits = 1;
+	unsigned long long remaining = length;
+	while (remaining >= 16) {
+		remaining /= 16;
+		hexDigits++;
+	}
+	return hexDigits+strlen(ASIS3ChunkSignatureLabel)+64+2+length+2;
+}
+
+// Private stuff
+@interface ASIS3ChunkSigningInputStream ()
+- (BOOL)encodeNextChunk;
+@end
+
+@implementation ASIS3ChunkSigningInputStream
+
++ (unsigned long long)encodedLengthForLength:(unsigned long long)length
+{
+	unsigned long long fullChunks = length/ASIS3ChunkSigningChunkSize;
+	unsigned long long lastChunkLength = length%ASIS3ChunkSigningChunkSize;
+	unsigned long long encodedLength = fullChunks*ASIS3EncodedChunkLength(ASIS3ChunkSigningChunkSize);
+	if (lastChunkLength) {
+		encodedLength += ASIS3EncodedChunkLength(lastChunkLength);
+	}
+	return encodedLength+ASIS3EncodedChunkLength(0);
+}
+
+- (void)dealloc
+{
+	[previousSignature release];
+	[chunkData release];
+	[encodedChunk release];
+	[super dealloc];
+}
+
+// Hands out the current chunk, reading and signing the next one when we run out
+- (NSInteger)read:(uint8_t *)buffer maxLength:(NSUInteger)len
+{
+	if (encodedChunkOffset == [encodedChunk length]) {
+		if (encodedFinalChunk) {
+			return 0;
+		}
+		if (![self encodeNextChunk]) {
+			return -1;
+		}
+	}
+	NSUInteger bytesToCopy = [encodedChunk length]-encodedChunkOffset;
+	if (bytesToCopy > len) {
+		bytesToCopy = len;
+	}
+	memcpy(buffer, (const uint8_t *)[encodedChunk bytes]+encodedChunkOffset, bytesToCopy);
+	encodedChunkOffset += bytesToCopy;
+	return (NSInteger)bytesToCopy;
+}
+
+// Fills a chunk from the file (ASIInputStream takes care of throttling and stopping at the end of the part we're sending)
+// An empty chunk marks the end of the body
+- (BOOL)encodeNextChunk
+{
+	if (!chunkData) {
+		chunkData = [[NSMutableData alloc] initWithLength:ASIS3ChunkSigningChunkSize];
+		encodedChunk = [[NSMutableData alloc] initWithCapacity:ASIS3EncodedChunkLength(ASIS3ChunkSigningChunkSize)];
+	}
+	if (![self previousSignature]) {
+		[self setPreviousSignature:[(ASIS3Request *)[self request] seedSignature]];
+	}
+	[chunkData setLength:ASIS3ChunkSigningChunkSize];
+	NSUInteger chunkLength = 0;
+	while (chunkLength < ASIS3ChunkSigningChunkSize) {
+		NSInteger bytesRead = [super read:(uint8_t *)[chunkData mutableBytes]+chunkLength maxLength:ASIS3ChunkSigningChunkSize-chunkLength];
+		if (bytesRead < 0) {
+			return NO;
+		}
+		if (bytesRead == 0) {
+			break;
+		}
+		chunkLength += (NSUInteger)bytesRead;
+	}
+	if (chunkLength == 0) {
+		encodedFinalChunk = YES;
+	}
+
+	NSString *signature = [(ASIS3Request *)[self request] signatureForChunk:[chunkData bytes] length:chunkLength previousSignature:[self previousSignature]];
+	[self setPreviousSignature:signature];
+
+	char header[128];
+	int headerLength = snprintf(header, sizeof(header), "%lx%s%s\r\n", (unsigned long)chunkLength, ASIS3ChunkSignatureLabel, [signature UTF8String]);
+	[encodedChunk setLength:0];
+	[encodedChunk appendBytes:header length:(NSUInteger)headerLength];
+	[encodedChunk appendBytes:[chunkData bytes] length:chunkLength];
+	[encodedChunk appendBytes:"\r\n" length:2];
+	encodedChunkOffset = 0;
+	return YES;
+}
+
+- (BOOL)hasBytesAvailable
+{
+	return (!encodedFinalChunk || encodedChunkOffset < [encodedChunk length]);
+}
+
+// The file may have been read to the end while we still have chunks to send
+- (NSStreamStatus)streamStatus
+{
+	NSStreamStatus status = [super streamStatus];
+	if (status == NSStreamStatusAtEnd && [self hasBytesAvailable]) {
+		return NSStreamStatusOpen;
+	}
+	if (status == NSStreamStatusOpen && ![self hasBytesAvailable]) {
+		return NSStreamStatusAtEnd;
+	}
+	return status;
+}
+
+@synthesize previousSignature;
+@end
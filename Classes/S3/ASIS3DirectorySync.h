@@ -0,0 +1,111 @@
+//
+//  ASIS3DirectorySync.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Use an ASIS3DirectorySync to mirror a local directory to a prefix in a bucket, or a prefix in a bucket to a local directory
+//
+//  Pass it a request set up with the bucket, prefix (which should end in a '/'), credentials and any other settings you want
+//  The local directory is walked while the first page of the listing is being fetched, then the files and objects are compared in key order as the rest of the listing arrives
+//  A file and an object are treated as the same when they are the same size and:
+//  - the manifest says the file hasn't been modified since it was last synced with an object with that ETag (so unchanged files don't need to be read), or
+//  - the object's ETag is the MD5 of the file, or
+//  - for objects whose ETag isn't an MD5 (eg ones uploaded in parts), the file is no newer than the object when uploading, or no older when downloading
+//  Anything else is uploaded (or downloaded), using up to maxConcurrentTransfers requests at once
+//  Files and objects that only exist at the destination are left alone, as are hidden files and folders
+//
+//  Downloads go to a hidden file next to the destination, which replaces the existing file only once the whole object has arrived
+//
+//  synchronize: waits for the sync to finish, so you'll want to use it on a background thread
+//  A file that fails to transfer doesn't stop the others, check failedKeys afterwards to see what went wrong
+//
+//  ASIS3BucketRequest *request = [ASIS3BucketRequest requestWithBucket:@"mybucket"];
+//  [request setPrefix:@"photos/"];
+//  ASIS3DirectorySync *sync = [ASIS3DirectorySync syncWithRequest:request localPath:@"/Users/ben/Pictures" direction:ASIS3SyncUpload];
+//  [sync setManifestPath:@"/Users/ben/Library/Application Support/MyApp/photos.plist"];
+//  NSError *error = nil;
+//  if ([sync synchronize:&error]) {
+//  	NSLog(@"Uploaded %llu bytes (%.0f bytes/sec), skipped %llu bytes",[sync bytesTransferred],[sync throughput],[sync bytesSkipped]);
+//  }
+
+#import <Foundation/Foundation.h>
+
+@class ASIS3BucketRequest;
+@class ASINetworkQueue;
+
+typedef enum _ASIS3SyncDirection {
+	ASIS3SyncUpload = 0, // Make the bucket match the local directory
+	ASIS3SyncDownload = 1 // Make the local directory match the bucket
+} ASIS3SyncDirection;
+
+@interface ASIS3DirectorySync : NSObject {
+
+	// Used to list the bucket, its settings are also used for the transfers
+	ASIS3BucketRequest *templateRequest;
+
+	// The directory to sync
+	NSString *localPath;
+
+	ASIS3SyncDirection direction;
+
+	// How many uploads or downloads to run at once. All the transfers go to the same host, so this is also the number of connections to it. Defaults to 4
+	NSInteger maxConcurrentTransfers;
+
+	// When set, the size, modification date and ETag of each file that matches its object is stored in a property list at this path
+	// On the next sync, files that haven't changed since can be compared without being read
+	NSString *manifestPath;
+
+	// The manifest from the last sync, and the one we are building for this one
+	NSDictionary *previousManifest;
+	NSMutableDictionary *manifest;
+
+	// Runs the transfers
+	ASINetworkQueue *queue;
+
+	// Transfers that have been started, oldest first
+	NSMutableArray *runningRequests;
+
+	// Results of the last sync
+	NSUInteger filesTransferred;
+	unsigned long long bytesTransferred;
+	NSUInteger filesSkipped;
+	unsigned long long bytesSkipped;
+
+	// Number of files we had to read to compare them with their objects
+	NSUInteger filesHashed;
+
+	// How long the last sync took
+	NSTimeInterval elapsedTime;
+
+	// Maps the keys of objects that failed to transfer to the error for each one
+	NSMutableDictionary *failedKeys;
+
+	// Set when the sync couldn't be completed, because the bucket couldn't be listed or the local directory couldn't be read
+	NSError *error;
+}
+
++ (id)syncWithRequest:(ASIS3BucketRequest *)request localPath:(NSString *)path direction:(ASIS3SyncDirection)direction;
+- (id)initWithRequest:(ASIS3BucketRequest *)request localPath:(NSString *)path direction:(ASIS3SyncDirection)direction;
+
+// Runs the sync, and waits for it to finish
+// Returns NO if the sync couldn't be completed, or any file failed to transfer. In the latter case, theError is the error for the first of the failed keys
+- (BOOL)synchronize:(NSError **)theError;
+
+// Bytes transferred per second by the last sync
+- (double)throughput;
+
+@property (retain, readonly) NSString *localPath;
+@property (assign, readonly) ASIS3SyncDirection direction;
+@property (assign, nonatomic) NSInteger maxConcurrentTransfers;
+@property (retain, nonatomic) NSString *manifestPath;
+@property (assign, readonly) NSUInteger filesTransferred;
+@property (assign, readonly) unsigned long long bytesTransferred;
+@property (assign, readonly) NSUInteger filesSkipped;
+@property (assign, readonly) unsigned long long bytesSkipped;
+@property (assign, readonly) NSUInteger filesHashed;
+@property (assign, readonly) NSTimeInterval elapsedTime;
+@property (retain, readonly) NSMutableDictionary *failedKeys;
+@property (retain, readonly) NSError *error;
+@end
@@ -0,0 +1,516 @@
+//
+//  ASIS3DirectorySync.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIS3DirectorySync.h"
+#import "ASIS3BucketRequest.h"
+#import "ASIS3BucketEnumerator.h"
+#import "ASIS3BucketObject.h"
+#import "ASIS3ObjectRequest.h"
+#import "ASINetworkQueue.h"
+#import <CommonCrypto/CommonDigest.h>
+
+// Keys for manifest entries
+static NSString *ASIS3SyncManifestSizeKey = @"Size";
+static NSString *ASIS3SyncManifestModificationDateKey = @"ModificationDate";
+static NSString *ASIS3SyncManifestETagKey = @"ETag";
+
+// S3 lists keys in order of their UTF-8 bytes, so we sort the local files the same way to compare them with the listing
+static NSInteger ASIS3CompareKeys(id key1, id key2, void *context)
+{
+	int result = strcmp([key1 UTF8String], [key2 UTF8String]);
+	if (result < 0) {
+		return NSOrderedAscending;
+	} else if (result > 0) {
+		return NSOrderedDescending;
+	}
+	return NSOrderedSame;
+}
+
+// ETags for objects uploaded in a single PUT are the MD5 of the object
+static BOOL ASIS3ETagIsMD5(NSString *eTag)
+{
+	if ([eTag length] != CC_MD5_DIGEST_LENGTH*2) {
+		return NO;
+	}
+	return [[eTag stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdefABCDEF"]] length] == 0;
+}
+
+static NSString *ASIS3ETagWithoutQuotes(NSString *eTag)
+{
+	return [eTag stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"\""]];
+}
+
+// Returns nil if the file can't be read
+static NSString *ASIS3MD5ForFileAtPath(NSString *path)
+{
+	NSFileHandle *fileHandle = [NSFileHandle fileHandleForReadingAtPath:path];
+	if (!fileHandle) {
+		return nil;
+	}
+	CC_MD5_CTX md5Context;
+	CC_MD5_Init(&md5Context);
+	while (1) {
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		NSData *chunk = [fileHandle readDataOfLength:1024*1024];
+		NSUInteger length = [chunk length];
+		if (length) {
+			CC_MD5_Update(&md5Context, [chunk bytes], (CC_LONG)length);
+		}
+		[pool release];
+		if (!length) {
+			break;
+		}
+	}
+	[fileHandle closeFile];
+	unsigned char digest[CC_MD5_DIGEST_LENGTH];
+	CC_MD5_Final(digest, &md5Context);
+	NSMutableString *md5 = [NSMutableString stringWithCapacity:CC_MD5_DIGEST_LENGTH*2];
+	int i;
+	for (i=0; i<CC_MD5_DIGEST_LENGTH; i++) {
+		[md5 appendFormat:@"%02x",digest[i]];
+	}
+	return md5;
+}
+
+// Private stuff
+@interface ASIS3DirectorySync ()
+- (NSDictionary *)localFiles;
+- (ASIS3BucketObject *)nextObjectFromEnumerator:(ASIS3BucketEnumerator *)enumerator;
+- (BOOL)fileAtPath:(NSString *)path withAttributes:(NSDictionary *)attributes matchesObject:(ASIS3BucketObject *)object;
+- (void)uploadFileAtPath:(NSString *)path withAttributes:(NSDictionary *)attributes;
+- (void)downloadObject:(ASIS3BucketObject *)object toPath:(NSString *)path;
+- (void)startTransfer:(ASIS3ObjectRequest *)request;
+- (void)finishTransfersLeaving:(NSUInteger)count;
+- (void)transferFinished:(ASIS3ObjectRequest *)request;
+- (void)addManifestEntryForPath:(NSString *)path size:(unsigned long long)size modificationDate:(NSDate *)date ETag:(NSString *)eTag;
+
+@property (retain, nonatomic) ASIS3BucketRequest *templateRequest;
+@property (retain) NSString *localPath;
+@property (assign) ASIS3SyncDirection direction;
+@property (retain, nonatomic) NSDictionary *previousManifest;
+@property (retain, nonatomic) NSMutableDictionary *manifest;
+@property (retain, nonatomic) ASINetworkQueue *queue;
+@property (retain, nonatomic) NSMutableArray *runningRequests;
+@property (assign) NSUInteger filesTransferred;
+@property (assign) unsigned long long bytesTransferred;
+@property (assign) NSUInteger filesSkipped;
+@property (assign) unsigned long long bytesSkipped;
+@property (assign) NSUInteger filesHashed;
+@property (assign) NSTimeInterval elapsedTime;
+@property (retain) NSMutableDictionary *failedKeys;
+@property (retain) NSError *error;
+@end
+
+@implementation ASIS3DirectorySync
+
++ (id)syncWithRequest:(ASIS3BucketRequest *)request localPath:(NSString *)path direction:(ASIS3SyncDirection)newDirection
+{
+	return [[[self alloc] initWithRequest:request localPath:path direction:newDirection] autorelease];
+}
+
+- (id)initWithRequest:(ASIS3BucketRequest *)request localPath:(NSString *)path direction:(ASIS3SyncDirection)newDirection
+{
+	self = [super init];
+	[self setTemplateRequest:[[request copy] autorelease]];
+	[self setLocalPath:path];
+	[self setDirection:newDirection];
+	[self setMaxConcurrentTransfers:4];
+	return self;
+}
+
+- (void)dealloc
+{
+	for (ASIHTTPRequest *request in runningRequests) {
+		[request clearDelegatesAndCancel];
+	}
+	[queue reset];
+	[queue release];
+	[runningRequests release];
+	[templateRequest release];
+	[localPath release];
+	[manifestPath release];
+	[previousManifest release];
+	[manifest release];
+	[failedKeys release];
+	[error release];
+	[super dealloc];
+}
+
+- (BOOL)synchronize:(NSError **)theError
+{
+	NSDate *startDate = [NSDate date];
+	[self setFilesTransferred:0];
+	[self setBytesTransferred:0];
+	[self setFilesSkipped:0];
+	[self setBytesSkipped:0];
+	[self setFilesHashed:0];
+	[self setFailedKeys:[NSMutableDictionary dictionary]];
+	[self setError:nil];
+	[self setPreviousManifest:nil];
+	if ([self manifestPath]) {
+		[self setPreviousManifest:[NSDictionary dictionaryWithContentsOfFile:[self manifestPath]]];
+	}
+	[self setManifest:[NSMutableDictionary dictionary]];
+
+	[self setQueue:[ASINetworkQueue queue]];
+	[[self queue] setMaxConcurrentOperationCount:([self maxConcurrentTransfers] > 0 ? [self maxConcurrentTransfers] : 1)];
+	[[self queue] setShouldCancelAllRequestsOnFailure:NO];
+	[[self queue] go];
+	[self setRunningRequests:[NSMutableArray array]];
+
+	// Creating the enumerator starts fetching the first page of the listing, so we read the local directory while we wait for it
+	ASIS3BucketEnumerator *enumerator = [ASIS3BucketEnumerator enumeratorWithRequest:[self templateRequest]];
+	NSDictionary *localFiles = [self localFiles];
+	NSArray *localPaths = [[localFiles allKeys] sortedArrayUsingFunction:ASIS3CompareKeys context:NULL];
+	NSUInteger localCount = [localPaths count];
+	NSUInteger localIndex = 0;
+	NSUInteger prefixLength = [[[self templateRequest] prefix] length];
+
+	ASIS3BucketObject *object = nil;
+	if (localFiles) {
+		object = [[self nextObjectFromEnumerator:enumerator] retain];
+		if ([enumerator error]) {
+			[self setError:[enumerator error]];
+		}
+	}
+	while (![self error] && (localIndex < localCount || object)) {
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+		NSString *path = (localIndex < localCount ? [localPaths objectAtIndex:localIndex] : nil);
+		NSString *objectPath = [[object key] substringFromIndex:prefixLength];
+		NSComparisonResult order;
+		if (!object) {
+			order = NSOrderedAscending;
+		} else if (!path) {
+			order = NSOrderedDescending;
+		} else {
+			order = ASIS3CompareKeys(path, objectPath, NULL);
+		}
+
+		// Only the file exists
+		if (order == NSOrderedAscending) {
+			if ([self direction] == ASIS3SyncUpload) {
+				[self uploadFileAtPath:path withAttributes:[localFiles objectForKey:path]];
+			}
+			localIndex++;
+
+		// Only the object exists
+		} else if (order == NSOrderedDescending) {
+			if ([self direction] == ASIS3SyncDownload) {
+				[self downloadObject:object toPath:objectPath];
+			}
+
+		// Both exist
+		} else {
+			NSDictionary *attributes = [localFiles objectForKey:path];
+			if ([self fileAtPath:path withAttributes:attributes matchesObject:object]) {
+				[self setFilesSkipped:[self filesSkipped]+1];
+				[self setBytesSkipped:[self bytesSkipped]+[object size]];
+			} else if ([self direction] == ASIS3SyncUpload) {
+				[self uploadFileAtPath:path withAttributes:attributes];
+			} else {
+				[self downloadObject:object toPath:objectPath];
+			}
+			localIndex++;
+		}
+
+		if (order != NSOrderedAscending) {
+			[object release];
+			object = [[self nextObjectFromEnumerator:enumerator] retain];
+			// When a page fails, the enumerator looks like it has run out of objects
+			// We have to stop, otherwise we'd treat all the files after this point as if they had no object
+			if ([enumerator error]) {
+				[self setError:[enumerator error]];
+			}
+		}
+
+		// Keep enough transfers queued to keep the queue busy, without holding on to a request for every file
+		[self finishTransfersLeaving:[[self queue] maxConcurrentOperationCount]*2];
+
+		[pool release];
+	}
+	[object release];
+
+	[self finishTransfersLeaving:0];
+	[self setQueue:nil];
+
+	// If we didn't get through everything, keep what we knew about the files we didn't get to
+	if ([self error]) {
+		for (NSString *path in [self previousManifest]) {
+			if (![[self manifest] objectForKey:path]) {
+				[[self manifest] setObject:[[self previousManifest] objectForKey:path] forKey:path];
+			}
+		}
+	}
+	if ([self manifestPath]) {
+		[[self manifest] writeToFile:[self manifestPath] atomically:YES];
+	}
+	[self setPreviousManifest:nil];
+	[self setManifest:nil];
+
+	[self setElapsedTime:[[NSDate date] timeIntervalSinceDate:startDate]];
+
+	if ([self error]) {
+		if (theError) {
+			*theError = [self error];
+		}
+		return NO;
+	}
+	if ([[self failedKeys] count]) {
+		if (theError) {
+			NSString *firstKey = [[[[self failedKeys] allKeys] sortedArrayUsingFunction:ASIS3CompareKeys context:NULL] objectAtIndex:0];
+			*theError = [[self failedKeys] objectForKey:firstKey];
+		}
+		return NO;
+	}
+	return YES;
+}
+
+- (double)throughput
+{
+	if ([self elapsedTime] <= 0) {
+		return 0;
+	}
+	return [self bytesTransferred]/[self elapsedTime];
+}
+
+// Returns a dictionary of attributes for every file under localPath, keyed on the path relative to localPath
+// Returns nil if the directory can't be read
+- (NSDictionary *)localFiles
+{
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	BOOL isDirectory = NO;
+	if (![fileManager fileExistsAtPath:[self localPath] isDirectory:&isDirectory]) {
+		// When downloading, we'll create the directory
+		if ([self direction] == ASIS3SyncDownload) {
+			NSError *err = nil;
+			if ([fileManager createDirectoryAtPath:[self localPath] withIntermediateDirectories:YES attributes:nil error:&err]) {
+				return [NSDictionary dictionary];
+			}
+			[self setError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to create directory at path '%@'",[self localPath]],NSLocalizedDescriptionKey,err,NSUnderlyingErrorKey,nil]]];
+			return nil;
+		}
+	}
+	if (!isDirectory) {
+		[self setError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"There is no directory at path '%@'",[self localPath]],NSLocalizedDescriptionKey,nil]]];
+		return nil;
+	}
+
+	NSString *standardizedManifestPath = [[self manifestPath] stringByStandardizingPath];
+	NSMutableDictionary *files = [NSMutableDictionary dictionary];
+	NSDirectoryEnumerator *directoryEnumerator = [fileManager enumeratorAtPath:[self localPath]];
+	for (NSString *path in directoryEnumerator) {
+		NSDictionary *attributes = [directoryEnumerator fileAttributes];
+		if ([[path lastPathComponent] hasPrefix:@"."]) {
+			if ([[attributes fileType] isEqualToString:NSFileTypeDirectory]) {
+				[directoryEnumerator skipDescendents];
+			}
+			continue;
+		}
+		if (![[attributes fileType] isEqualToString:NSFileTypeRegular]) {
+			continue;
+		}
+		// Don't sync the manifest if it lives in the directory
+		if (standardizedManifestPath && [[[[self localPath] stringByAppendingPathComponent:path] stringByStandardizingPath] isEqualToString:standardizedManifestPath]) {
+			continue;
+		}
+		[files setObject:attributes forKey:path];
+	}
+	return files;
+}
+
+// Skips the empty objects some tools create to represent folders
+- (ASIS3BucketObject *)nextObjectFromEnumerator:(ASIS3BucketEnumerator *)enumerator
+{
+	ASIS3BucketObject *object;
+	while ((object = [enumerator nextObject])) {
+		if (![[object key] hasSuffix:@"/"]) {
+			break;
+		}
+	}
+	return object;
+}
+
+- (BOOL)fileAtPath:(NSString *)path withAttributes:(NSDictionary *)attributes matchesObject:(ASIS3BucketObject *)object
+{
+	if ([attributes fileSize] != [object size]) {
+		return NO;
+	}
+	NSString *eTag = ASIS3ETagWithoutQuotes([object ETag]);
+	NSDate *modificationDate = [attributes fileModificationDate];
+
+	// If the file hasn't changed since we last saw it match an object with this ETag, we don't need to read it
+	NSDictionary *entry = [[self previousManifest] objectForKey:path];
+	if ([[entry objectForKey:ASIS3SyncManifestSizeKey] unsignedLongLongValue] == [object size] && [[entry objectForKey:ASIS3SyncManifestModificationDateKey] doubleValue] == [modificationDate timeIntervalSinceReferenceDate] && [[entry objectForKey:ASIS3SyncManifestETagKey] isEqualToString:eTag]) {
+		[[self manifest] setObject:entry forKey:path];
+		return YES;
+	}
+
+	BOOL matches;
+	if (ASIS3ETagIsMD5(eTag)) {
+		[self setFilesHashed:[self filesHashed]+1];
+		NSString *md5 = ASIS3MD5ForFileAtPath([[self localPath] stringByAppendingPathComponent:path]);
+		matches = (md5 && [md5 caseInsensitiveCompare:eTag] == NSOrderedSame);
+	} else {
+		NSComparisonResult order = [modificationDate compare:[object lastModified]];
+		if ([self direction] == ASIS3SyncUpload) {
+			matches = (order != NSOrderedDescending);
+		} else {
+			matches = (order != NSOrderedAscending);
+		}
+	}
+	if (matches) {
+		[self addManifestEntryForPath:path size:[object size] modificationDate:modificationDate ETag:eTag];
+	}
+	return matches;
+}
+
+- (void)uploadFileAtPath:(NSString *)path withAttributes:(NSDictionary *)attributes
+{
+	NSString *key = [([[self templateRequest] prefix] ? [[self templateRequest] prefix] : @"") stringByAppendingString:path];
+	ASIS3ObjectRequest *request = [ASIS3ObjectRequest PUTRequestForFile:[[self localPath] stringByAppendingPathComponent:path] withBucket:[[self templateRequest] bucket] key:key];
+	[request setUserInfo:[NSDictionary dictionaryWithObjectsAndKeys:path,@"path",[NSNumber numberWithUnsignedLongLong:[attributes fileSize]],@"size",[attributes fileModificationDate],@"modificationDate",nil]];
+	[self startTransfer:request];
+}
+
+- (void)downloadObject:(ASIS3BucketObject *)object toPath:(NSString *)path
+{
+	NSString *filePath = [[self localPath] stringByAppendingPathComponent:path];
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	NSError *err = nil;
+	if (![fileManager createDirectoryAtPath:[filePath stringByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:&err]) {
+		[[self failedKeys] setObject:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to create directory at path '%@'",[filePath stringByDeletingLastPathComponent]],NSLocalizedDescriptionKey,err,NSUnderlyingErrorKey,nil]] forKey:[object key]];
+		return;
+	}
+	ASIS3ObjectRequest *request = [ASIS3ObjectRequest requestWithBucket:[[self templateRequest] bucket] key:[object key]];
+
+	// We download to a hidden file next to the real one, and only move it into place if we get the object
+	// Otherwise an error response would overwrite the copy we already have
+	// The download file is in the same folder so the move is a rename, and it is hidden so the directory walk ignores it
+	NSString *downloadPath = [[filePath stringByDeletingLastPathComponent] stringByAppendingPathComponent:[NSString stringWithFormat:@".%@.download",[filePath lastPathComponent]]];
+	[request setDownloadDestinationPath:downloadPath];
+	// Make sure we get the version of the object we listed, so the size and ETag we store in the manifest are right
+	if ([object ETag]) {
+		[request addRequestHeader:@"If-Match" value:[object ETag]];
+	}
+	[request setUserInfo:[NSDictionary dictionaryWithObjectsAndKeys:path,@"path",filePath,@"filePath",[NSNumber numberWithUnsignedLongLong:[object size]],@"size",[object lastModified],@"modificationDate",ASIS3ETagWithoutQuotes([object ETag]),@"ETag",nil]];
+	[self startTransfer:request];
+}
+
+- (void)startTransfer:(ASIS3ObjectRequest *)request
+{
+	ASIS3BucketRequest *template = [self templateRequest];
+	[request setAccessKey:[template accessKey]];
+	[request setSecretAccessKey:[template secretAccessKey]];
+	[request setSignatureVersion:[template signatureVersion]];
+	[request setRegion:[template region]];
+	[request setRequestScheme:[template requestScheme]];
+	[request setTimeOutSeconds:[template timeOutSeconds]];
+	[request setValidatesSecureCertificate:[template validatesSecureCertificate]];
+	[[self runningRequests] addObject:request];
+	[[self queue] addOperation:request];
+}
+
+// Deals with finished transfers, then waits for the oldest ones until no more than count are left
+- (void)finishTransfersLeaving:(NSUInteger)count
+{
+	NSUInteger i = 0;
+	while (i < [[self runningRequests] count]) {
+		ASIS3ObjectRequest *request = [[self runningRequests] objectAtIndex:i];
+		if ([request isFinished]) {
+			[self transferFinished:request];
+			[[self runningRequests] removeObjectAtIndex:i];
+		} else {
+			i++;
+		}
+	}
+	while ([[self runningRequests] count] > count) {
+		ASIS3ObjectRequest *request = [[self runningRequests] objectAtIndex:0];
+		[request waitUntilFinished];
+		[self transferFinished:request];
+		[[self runningRequests] removeObjectAtIndex:0];
+	}
+}
+
+- (void)transferFinished:(ASIS3ObjectRequest *)request
+{
+	NSDictionary *info = [request userInfo];
+	NSString *path = [info objectForKey:@"path"];
+	unsigned long long size = [[info objectForKey:@"size"] unsignedLongLongValue];
+
+	NSError *transferError = [request error];
+	if (!transferError && [request responseStatusCode] != 200) {
+		transferError = [NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"S3 returned status %i",[request responseStatusCode]],NSLocalizedDescriptionKey,nil]];
+	}
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	if (transferError) {
+		[[self failedKeys] setObject:transferError forKey:[request key]];
+		// Throw away whatever we downloaded (eg the body of an error response), the file we already had is left alone
+		if ([self direction] == ASIS3SyncDownload) {
+			[fileManager removeItemAtPath:[request downloadDestinationPath] error:NULL];
+		}
+		return;
+	}
+
+	// Now we know we have the object, we can replace the old copy of the file with it
+	if ([self direction] == ASIS3SyncDownload) {
+		NSString *filePath = [info objectForKey:@"filePath"];
+		NSError *err = nil;
+		if ([fileManager fileExistsAtPath:filePath]) {
+			[fileManager removeItemAtPath:filePath error:&err];
+		}
+		if (err || ![fileManager moveItemAtPath:[request downloadDestinationPath] toPath:filePath error:&err]) {
+			[[self failedKeys] setObject:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to move downloaded file to path '%@'",filePath],NSLocalizedDescriptionKey,err,NSUnderlyingErrorKey,nil]] forKey:[request key]];
+			[fileManager removeItemAtPath:[request downloadDestinationPath] error:NULL];
+			return;
+		}
+	}
+
+	if ([self direction] == ASIS3SyncUpload) {
+		[self addManifestEntryForPath:path size:size modificationDate:[info objectForKey:@"modificationDate"] ETag:ASIS3ETagWithoutQuotes([[request responseHeaders] objectForKey:@"Etag"])];
+	} else {
+		// Give the file the object's modification date, so it won't look newer than the object if we later sync in the other direction
+		NSString *filePath = [info objectForKey:@"filePath"];
+		if ([info objectForKey:@"modificationDate"]) {
+			[fileManager setAttributes:[NSDictionary dictionaryWithObject:[info objectForKey:@"modificationDate"] forKey:NSFileModificationDate] ofItemAtPath:filePath error:NULL];
+		}
+		// The file system may not store the date as precisely as S3 does, so we store what we read back
+		NSDictionary *attributes = [fileManager attributesOfItemAtPath:filePath error:NULL];
+		[self addManifestEntryForPath:path size:size modificationDate:[attributes fileModificationDate] ETag:[info objectForKey:@"ETag"]];
+	}
+	[self setFilesTransferred:[self filesTransferred]+1];
+	[self setBytesTransferred:[self bytesTransferred]+size];
+}
+
+// Dates are stored as numbers rather than NSDates, because dates in XML property lists lose anything less than a second
+- (void)addManifestEntryForPath:(NSString *)path size:(unsigned long long)size modificationDate:(NSDate *)date ETag:(NSString *)eTag
+{
+	if (!date || !eTag) {
+		return;
+	}
+	[[self manifest] setObject:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithUnsignedLongLong:size],ASIS3SyncManifestSizeKey,[NSNumber numberWithDouble:[date timeIntervalSinceReferenceDate]],ASIS3SyncManifestModificationDateKey,eTag,ASIS3SyncManifestETagKey,nil] forKey:path];
+}
+
+@synthesize templateRequest;
+@synthesize localPath;
+@synthesize direction;
+@synthesize maxConcurrentTransfers;
+@synthesize manifestPath;
+@synthesize previousManifest;
+@synthesize manifest;
+@synthesize queue;
+@synthesize runningRequests;
+@synthesize filesTransferred;
+@synthesize bytesTransferred;
+@synthesize filesSkipped;
+@synthesize bytesSkipped;
+@synthesize filesHashed;
+@synthesize elapsedTime;
+@synthesize failedKeys;
+@synthesize error;
+@end
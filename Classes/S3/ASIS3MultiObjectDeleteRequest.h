@@ -0,0 +1,66 @@
+//
+//  ASIS3MultiObjectDeleteRequest.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Use an ASIS3MultiObjectDeleteRequest to delete up to 1000 objects from a bucket with a single request
+//  See http://docs.aws.amazon.com/AmazonS3/latest/API/multiobjectdeleteapi.html
+//
+//  S3 may delete some of the objects and fail to delete others. This doesn't make the request fail - check failedKeys when it finishes
+//  The request only fails if S3 rejects it altogether (eg because the credentials are wrong)
+//
+//  To delete everything in a listing (eg every object with a particular prefix), use deleteObjectsListedByRequest:maxConcurrentRequests:failedKeys:error:
+//  This lists and deletes at the same time, so purging a prefix with 100,000 objects takes around 100 listing requests and 100 delete requests, rather than 100,000 DELETEs
+//
+//  ASIS3BucketRequest *listRequest = [ASIS3BucketRequest requestWithBucket:@"mybucket"];
+//  [listRequest setPrefix:@"logs/2009/"];
+//  NSError *error = nil;
+//  NSUInteger count = [ASIS3MultiObjectDeleteRequest deleteObjectsListedByRequest:listRequest maxConcurrentRequests:4 failedKeys:nil error:&error];
+
+#import <Foundation/Foundation.h>
+#import "ASIS3BucketRequest.h"
+
+// S3 won't accept more than this many keys in a single request
+extern const NSUInteger ASIS3MultiObjectDeleteMaximumKeyCount;
+
+@interface ASIS3MultiObjectDeleteRequest : ASIS3BucketRequest {
+
+	// The keys of the objects to delete
+	NSArray *keys;
+
+	// When YES (the default), S3 only tells us about the keys it failed to delete, so deletedKeys will be empty
+	BOOL quiet;
+
+	// The keys S3 told us it deleted (only when quiet is NO)
+	NSMutableArray *deletedKeys;
+
+	// Maps keys S3 failed to delete to an NSError explaining why
+	// The S3 error code (eg AccessDenied) is in the error's userInfo under the key @"Code"
+	NSMutableDictionary *failedKeys;
+
+	// Internally used while parsing the response
+	NSString *currentKey;
+	NSString *currentErrorCode;
+	NSString *currentErrorMessage;
+}
+
+// Create a request to delete the objects with these keys (no more than ASIS3MultiObjectDeleteMaximumKeyCount of them)
++ (id)requestWithBucket:(NSString *)bucket keys:(NSArray *)keys;
+
+// Splits keys into batches of ASIS3MultiObjectDeleteMaximumKeyCount, and returns a request for each batch
++ (NSArray *)requestsWithBucket:(NSString *)bucket keys:(NSArray *)keys;
+
+// Deletes every object listed by listRequest (which is never started itself, it's used to set up the listing), running up to maxConcurrentRequests delete requests at once
+// Objects are deleted in batches as the listing arrives, and the credentials and settings for the delete requests are copied from listRequest
+// This method doesn't return until everything has been deleted, so you'll want to call it on a background thread
+// Returns the number of objects deleted. Keys S3 failed to delete are added to failedKeys, if you pass a dictionary
+// If a listing or delete request fails, we stop, and return the error in error
++ (NSUInteger)deleteObjectsListedByRequest:(ASIS3BucketRequest *)listRequest maxConcurrentRequests:(NSInteger)maxConcurrentRequests failedKeys:(NSMutableDictionary *)failedKeys error:(NSError **)error;
+
+@property (retain, nonatomic) NSArray *keys;
+@property (assign, nonatomic) BOOL quiet;
+@property (retain, readonly) NSMutableArray *deletedKeys;
+@property (retain, readonly) NSMutableDictionary *failedKeys;
+@end
@@ -0,0 +1,295 @@
+//
+//  ASIS3MultiObjectDeleteRequest.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIS3MultiObjectDeleteRequest.h"
+#import "ASIS3BucketEnumerator.h"
+#import "ASIS3BucketObject.h"
+#import "ASINetworkQueue.h"
+#import <CommonCrypto/CommonDigest.h>
+
+const NSUInteger ASIS3MultiObjectDeleteMaximumKeyCount = 1000;
+
+// Appends string to xml, replacing characters that can't appear in element content
+static void ASIS3AppendXMLEscapedString(NSMutableString *xml, NSString *string)
+{
+	static NSCharacterSet *charactersToEscape = nil;
+	if (!charactersToEscape) {
+		charactersToEscape = [[NSCharacterSet characterSetWithCharactersInString:@"&<>\"'"] retain];
+	}
+	NSUInteger length = [string length];
+	NSRange searchRange = NSMakeRange(0, length);
+	while (searchRange.length) {
+		NSRange range = [string rangeOfCharacterFromSet:charactersToEscape options:NSLiteralSearch range:searchRange];
+		if (range.location == NSNotFound) {
+			[xml appendString:[string substringWithRange:searchRange]];
+			break;
+		}
+		[xml appendString:[string substringWithRange:NSMakeRange(searchRange.location, range.location-searchRange.location)]];
+		switch ([string characterAtIndex:range.location]) {
+			case '&': [xml appendString:@"&amp;"]; break;
+			case '<': [xml appendString:@"&lt;"]; break;
+			case '>': [xml appendString:@"&gt;"]; break;
+			case '"': [xml appendString:@"&quot;"]; break;
+			default: [xml appendString:@"&apos;"]; break;
+		}
+		searchRange = NSMakeRange(range.location+1, length-range.location-1);
+	}
+}
+
+// Private stuff
+@interface ASIS3MultiObjectDeleteRequest ()
+- (void)buildDeleteBody;
++ (void)addResultsOfRequest:(ASIS3MultiObjectDeleteRequest *)request toDeletedCount:(NSUInteger *)deletedCount failedKeys:(NSMutableDictionary *)failedKeys;
+
+@property (retain) NSMutableArray *deletedKeys;
+@property (retain) NSMutableDictionary *failedKeys;
+@property (retain, nonatomic) NSString *currentKey;
+@property (retain, nonatomic) NSString *currentErrorCode;
+@property (retain, nonatomic) NSString *currentErrorMessage;
+@end
+
+@implementation ASIS3MultiObjectDeleteRequest
+
+- (id)initWithURL:(NSURL *)newURL
+{
+	self = [super initWithURL:newURL];
+	[self setQuiet:YES];
+	[self setDeletedKeys:[NSMutableArray array]];
+	[self setFailedKeys:[NSMutableDictionary dictionary]];
+	return self;
+}
+
++ (id)requestWithBucket:(NSString *)theBucket keys:(NSArray *)theKeys
+{
+	ASIS3MultiObjectDeleteRequest *request = [self requestWithBucket:theBucket subResource:@"delete"];
+	[request setRequestMethod:@"POST"];
+	[request setKeys:theKeys];
+	return request;
+}
+
++ (NSArray *)requestsWithBucket:(NSString *)theBucket keys:(NSArray *)theKeys
+{
+	NSMutableArray *requests = [NSMutableArray array];
+	NSUInteger offset;
+	for (offset=0; offset<[theKeys count]; offset+=ASIS3MultiObjectDeleteMaximumKeyCount) {
+		NSUInteger count = MIN(ASIS3MultiObjectDeleteMaximumKeyCount, [theKeys count]-offset);
+		[requests addObject:[self requestWithBucket:theBucket keys:[theKeys subarrayWithRange:NSMakeRange(offset, count)]]];
+	}
+	return requests;
+}
+
+- (void)dealloc
+{
+	[keys release];
+	[deletedKeys release];
+	[failedKeys release];
+	[currentKey release];
+	[currentErrorCode release];
+	[currentErrorMessage release];
+	[super dealloc];
+}
+
+#pragma mark building the request
+
+// S3 insists on a Content-MD5 header for this request, so we build the body as soon as we need to sign it
+- (void)buildDeleteBody
+{
+	if ([self postBody]) {
+		return;
+	}
+	NSMutableString *xml = [NSMutableString stringWithCapacity:[[self keys] count]*64+128];
+	[xml appendString:@"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<Delete>"];
+	if ([self quiet]) {
+		[xml appendString:@"<Quiet>true</Quiet>"];
+	}
+	for (NSString *objectKey in [self keys]) {
+		[xml appendString:@"<Object><Key>"];
+		ASIS3AppendXMLEscapedString(xml, objectKey);
+		[xml appendString:@"</Key></Object>"];
+	}
+	[xml appendString:@"</Delete>"];
+	NSData *body = [xml dataUsingEncoding:NSUTF8StringEncoding];
+	[self appendPostData:body];
+
+	unsigned char digest[CC_MD5_DIGEST_LENGTH];
+	CC_MD5([body bytes], (CC_LONG)[body length], digest);
+	[self addRequestHeader:@"Content-MD5" value:[ASIHTTPRequest base64forData:[NSData dataWithBytes:digest length:CC_MD5_DIGEST_LENGTH]]];
+	[self addRequestHeader:@"Content-Type" value:@"application/xml"];
+}
+
+- (void)buildPostBody
+{
+	if ([[self keys] count] > ASIS3MultiObjectDeleteMaximumKeyCount) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIInternalErrorWhileBuildingRequestType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"S3 can't delete more than %lu objects in a single request",(unsigned long)ASIS3MultiObjectDeleteMaximumKeyCount],NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	[self buildDeleteBody];
+	[super buildPostBody];
+}
+
+- (void)buildRequestHeaders
+{
+	[self buildDeleteBody];
+	[super buildRequestHeaders];
+}
+
+- (NSString *)stringToSignForHeaders:(NSString *)canonicalizedAmzHeaders resource:(NSString *)canonicalizedResource
+{
+	return [NSString stringWithFormat:@"%@\n%@\n%@\n%@\n%@%@",[self requestMethod],[[self requestHeaders] objectForKey:@"Content-MD5"],[[self requestHeaders] objectForKey:@"Content-Type"],[self dateString],canonicalizedAmzHeaders,canonicalizedResource];
+}
+
+- (NSString *)contentTypeForSigning
+{
+	return @"application/xml";
+}
+
+#pragma mark parsing the response
+
+// The response has a <Deleted> element for each object that was deleted, and an <Error> element for each one that wasn't
+// If S3 rejected the whole request, the response is a normal S3 error, which ASIS3Request will handle
+- (void)parser:(NSXMLParser *)parser didEndElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName
+{
+	NSArray *stack = [self currentXMLElementStack];
+	NSString *parent = ([stack count] > 1 ? [stack objectAtIndex:[stack count]-2] : nil);
+	BOOL inDeleteResult = ([stack count] > 2 && [[stack objectAtIndex:[stack count]-3] isEqualToString:@"DeleteResult"]);
+
+	if (inDeleteResult && ([parent isEqualToString:@"Deleted"] || [parent isEqualToString:@"Error"])) {
+		if ([elementName isEqualToString:@"Key"]) {
+			[self setCurrentKey:[self currentXMLElementContent]];
+		} else if ([elementName isEqualToString:@"Code"]) {
+			[self setCurrentErrorCode:[self currentXMLElementContent]];
+		} else if ([elementName isEqualToString:@"Message"]) {
+			[self setCurrentErrorMessage:[self currentXMLElementContent]];
+		}
+		// Don't let ASIS3Request treat the message as an error for the whole request
+		[[self currentXMLElementStack] removeLastObject];
+		return;
+	}
+	if ([parent isEqualToString:@"DeleteResult"] && [self currentKey]) {
+		if ([elementName isEqualToString:@"Deleted"]) {
+			[[self deletedKeys] addObject:[self currentKey]];
+		} else if ([elementName isEqualToString:@"Error"]) {
+			NSString *description = [self currentErrorMessage];
+			if (!description) {
+				description = [NSString stringWithFormat:@"S3 failed to delete '%@'",[self currentKey]];
+			}
+			NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:description forKey:NSLocalizedDescriptionKey];
+			if ([self currentErrorCode]) {
+				[userInfo setObject:[self currentErrorCode] forKey:@"Code"];
+			}
+			[[self failedKeys] setObject:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:userInfo] forKey:[self currentKey]];
+		}
+		[self setCurrentKey:nil];
+		[self setCurrentErrorCode:nil];
+		[self setCurrentErrorMessage:nil];
+	}
+	[super parser:parser didEndElement:elementName namespaceURI:namespaceURI qualifiedName:qName];
+}
+
+#pragma mark deleting a whole listing
+
++ (NSUInteger)deleteObjectsListedByRequest:(ASIS3BucketRequest *)listRequest maxConcurrentRequests:(NSInteger)maxConcurrentRequests failedKeys:(NSMutableDictionary *)failedKeys error:(NSError **)error
+{
+	if (maxConcurrentRequests < 1) {
+		maxConcurrentRequests = 1;
+	}
+	ASINetworkQueue *queue = [ASINetworkQueue queue];
+	[queue setMaxConcurrentOperationCount:maxConcurrentRequests];
+	[queue setShouldCancelAllRequestsOnFailure:NO];
+	[queue go];
+
+	NSMutableArray *runningRequests = [NSMutableArray array];
+	NSMutableArray *batch = [NSMutableArray arrayWithCapacity:ASIS3MultiObjectDeleteMaximumKeyCount];
+	ASIS3BucketEnumerator *enumerator = [ASIS3BucketEnumerator enumeratorWithRequest:listRequest];
+	NSUInteger deletedCount = 0;
+	NSError *firstError = nil;
+	BOOL listingComplete = NO;
+
+	while (!listingComplete && !firstError) {
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+		ASIS3BucketObject *object = [enumerator nextObject];
+		if (object) {
+			[batch addObject:[object key]];
+		} else {
+			listingComplete = YES;
+		}
+
+		if ([batch count] == ASIS3MultiObjectDeleteMaximumKeyCount || (listingComplete && [batch count])) {
+			ASIS3MultiObjectDeleteRequest *request = [self requestWithBucket:[listRequest bucket] keys:[[batch copy] autorelease]];
+			[request setAccessKey:[listRequest accessKey]];
+			[request setSecretAccessKey:[listRequest secretAccessKey]];
+			[request setSignatureVersion:[listRequest signatureVersion]];
+			[request setRegion:[listRequest region]];
+			[request setRequestScheme:[listRequest requestScheme]];
+			[request setTimeOutSeconds:[listRequest timeOutSeconds]];
+			[request setValidatesSecureCertificate:[listRequest validatesSecureCertificate]];
+			[runningRequests addObject:request];
+			[queue addOperation:request];
+			[batch removeAllObjects];
+		}
+
+		// Once enough batches are running, wait for the oldest to finish before reading any more of the listing
+		// This keeps the number of keys we hold on to bounded, however big the listing is
+		while ([runningRequests count] && ([runningRequests count] >= (NSUInteger)maxConcurrentRequests || listingComplete)) {
+			ASIS3MultiObjectDeleteRequest *request = [runningRequests objectAtIndex:0];
+			[request waitUntilFinished];
+			if ([request error]) {
+				firstError = [[request error] retain];
+				break;
+			}
+			[self addResultsOfRequest:request toDeletedCount:&deletedCount failedKeys:failedKeys];
+			[runningRequests removeObjectAtIndex:0];
+		}
+		[pool release];
+	}
+	[firstError autorelease];
+
+	if (!firstError && [enumerator error]) {
+		firstError = [enumerator error];
+	}
+	if (firstError) {
+		[queue cancelAllOperations];
+		// Count what the other batches managed before they were stopped
+		for (ASIS3MultiObjectDeleteRequest *request in runningRequests) {
+			[request waitUntilFinished];
+			if (![request error]) {
+				[self addResultsOfRequest:request toDeletedCount:&deletedCount failedKeys:failedKeys];
+			}
+		}
+		if (error) {
+			*error = firstError;
+		}
+	}
+	return deletedCount;
+}
+
++ (void)addResultsOfRequest:(ASIS3MultiObjectDeleteRequest *)request toDeletedCount:(NSUInteger *)deletedCount failedKeys:(NSMutableDictionary *)failedKeys
+{
+	*deletedCount += [[request keys] count]-[[request failedKeys] count];
+	[failedKeys addEntriesFromDictionary:[request failedKeys]];
+}
+
+#pragma mark NSCopying
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	ASIS3MultiObjectDeleteRequest *newRequest = [super copyWithZone:zone];
+	[newRequest setKeys:[self keys]];
+	[newRequest setQuiet:[self quiet]];
+	return newRequest;
+}
+
+@synthesize keys;
+@synthesize quiet;
+@synthesize deletedKeys;
+@synthesize failedKeys;
+@synthesize currentKey;
+@synthesize currentErrorCode;
+@synthesize currentErrorMessage;
+@end
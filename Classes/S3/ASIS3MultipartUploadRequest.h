@@ -0,0 +1,89 @@
+//
+//  ASIS3MultipartUploadRequest.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Use an ASIS3MultipartUploadRequest to upload a large file to S3 in parts, using several connections at once
+//  See http://docs.amazonwebservices.com/AmazonS3/latest/dev/mpuoverview.html for more about multipart uploads
+//
+//  The request itself initiates the upload. Once S3 has given us an upload id, the file is split into parts of partSize bytes,
+//  and up to maxConcurrentPartUploads parts are uploaded at once. Each part is read straight from its range of the file, so no temporary copies are made
+//  A part that fails is retried on its own, rather than restarting the whole upload
+//  Once every part has been uploaded, the upload is completed and the request finishes, with the response S3 sent when completing the upload
+//  If the request fails or is cancelled after the upload was initiated, the upload is aborted, so S3 doesn't keep the parts we already sent
+//
+//  Upload progress for all the parts is reported to the request's uploadProgressDelegate (and queue) as if it were a single upload
+//  Known issue: as with ASIWebPageRequest, you cannot use startSynchronous with an ASIS3MultipartUploadRequest
+//
+//  ASIS3MultipartUploadRequest *request = [ASIS3MultipartUploadRequest PUTRequestForFile:@"/path/to/movie.mov" withBucket:@"mybucket" key:@"movie.mov"];
+//  [request setDelegate:self];
+//  [request setUploadProgressDelegate:progressIndicator];
+//  [request startAsynchronous];
+
+#import <Foundation/Foundation.h>
+#import "ASIS3ObjectRequest.h"
+
+@class ASINetworkQueue;
+@class ASIPartProgressTracker;
+
+// S3 won't accept parts smaller than this (apart from the last one), or more than this many parts
+extern const unsigned long long ASIS3MultipartUploadMinimumPartSize;
+extern const NSUInteger ASIS3MultipartUploadMaximumPartCount;
+
+@interface ASIS3MultipartUploadRequest : ASIS3ObjectRequest {
+
+	// The file we are uploading
+	NSString *filePath;
+
+	// The size of each part in bytes (the last part may be smaller). Defaults to 8MB
+	// Values below ASIS3MultipartUploadMinimumPartSize are rounded up, and the size is increased if the file would need more than ASIS3MultipartUploadMaximumPartCount parts
+	unsigned long long partSize;
+
+	// How many parts to upload at once. Defaults to 4
+	NSInteger maxConcurrentPartUploads;
+
+	// How many times to retry a part that fails because of a connection problem or a server error, before giving up on the whole upload. Defaults to 3
+	int numberOfTimesToRetryPart;
+
+	// The upload id S3 gave us when we initiated the upload
+	NSString *uploadId;
+
+	// Size of the file when we started uploading parts
+	unsigned long long fileSize;
+
+	// Number of parts the file was split into
+	NSUInteger partCount;
+
+	// Uploads the parts, up to maxConcurrentPartUploads at a time
+	ASINetworkQueue *partQueue;
+
+	// Maps part numbers to the ETag S3 returned when the part was uploaded
+	NSMutableDictionary *partETags;
+
+	// Progress reported so far by the current request for each part, used to take back a failed part's progress before it is retried
+	ASIPartProgressTracker *partProgress;
+
+	// Total reported by the requests for all the parts so far
+	unsigned long long partBytesSent;
+	long long partUploadSize;
+
+	// Sent when all the parts have been uploaded
+	ASIS3ObjectRequest *completeRequest;
+
+	// Set to YES once the upload has been initiated, until it has been completed or has failed
+	// While this is YES, the request stays in its queue (if it has one) even though the initiate request has finished
+	BOOL uploadingParts;
+}
+
+// Create a request to upload the file at filePath in parts
++ (id)PUTRequestForFile:(NSString *)filePath withBucket:(NSString *)bucket key:(NSString *)key;
+
+@property (retain, nonatomic) NSString *filePath;
+@property (assign, nonatomic) unsigned long long partSize;
+@property (assign, nonatomic) NSInteger maxConcurrentPartUploads;
+@property (assign, nonatomic) int numberOfTimesToRetryPart;
+@property (retain, readonly) NSString *uploadId;
+@property (assign, readonly) NSUInteger partCount;
+@end
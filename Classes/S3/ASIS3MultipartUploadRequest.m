@@ -0,0 +1,369 @@
+//
+//  ASIS3MultipartUploadRequest.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIS3MultipartUploadRequest.h"
+#import "ASINetworkQueue.h"
+#import "ASIPartProgressTracker.h"
+
+const unsigned long long ASIS3MultipartUploadMinimumPartSize = 5*1024*1024;
+const NSUInteger ASIS3MultipartUploadMaximumPartCount = 10000;
+
+// Private stuff
+@interface ASIS3MultipartUploadRequest ()
+- (void)startUploadingParts;
+- (ASIS3ObjectRequest *)requestForSubResource:(NSString *)theSubResource;
+- (ASIS3ObjectRequest *)requestForPartNumber:(NSUInteger)partNumber attempt:(int)attempt;
+- (void)partUploadSucceeded:(ASIHTTPRequest *)partRequest;
+- (void)partUploadFailed:(ASIHTTPRequest *)partRequest;
+- (void)reportPartBytesSent:(long long)bytes sizeChange:(long long)sizeChange;
+- (void)completeUpload;
+- (void)uploadCompleted:(ASIHTTPRequest *)request;
+- (void)uploadCompletionFailed:(ASIHTTPRequest *)request;
+- (void)abortUpload;
+
+@property (retain) NSString *uploadId;
+@property (assign) NSUInteger partCount;
+@property (retain, nonatomic) ASINetworkQueue *partQueue;
+@property (retain, nonatomic) NSMutableDictionary *partETags;
+@property (retain, nonatomic) ASIPartProgressTracker *partProgress;
+@property (retain, nonatomic) ASIS3ObjectRequest *completeRequest;
+@end
+
+@implementation ASIS3MultipartUploadRequest
+
+- (id)initWithURL:(NSURL *)newURL
+{
+	self = [super initWithURL:newURL];
+	[self setPartSize:8*1024*1024];
+	[self setMaxConcurrentPartUploads:4];
+	[self setNumberOfTimesToRetryPart:3];
+	return self;
+}
+
++ (id)PUTRequestForFile:(NSString *)theFilePath withBucket:(NSString *)theBucket key:(NSString *)theKey
+{
+	ASIS3MultipartUploadRequest *newRequest = [self requestWithBucket:theBucket key:theKey subResource:@"uploads"];
+	[newRequest setFilePath:theFilePath];
+	[newRequest setRequestMethod:@"POST"];
+	[newRequest setMimeType:[ASIHTTPRequest mimeTypeForFileAtPath:theFilePath]];
+	[newRequest addRequestHeader:@"Content-Length" value:@"0"];
+	return newRequest;
+}
+
+- (void)dealloc
+{
+	[partQueue reset];
+	[partQueue release];
+	[completeRequest clearDelegatesAndCancel];
+	[completeRequest release];
+	[partETags release];
+	[partProgress release];
+	[uploadId release];
+	[filePath release];
+	[super dealloc];
+}
+
+// We send the content type when initiating the upload, S3 will use it for the finished object
+- (NSString *)stringToSignForHeaders:(NSString *)canonicalizedAmzHeaders resource:(NSString *)canonicalizedResource
+{
+	[self addRequestHeader:@"Content-Type" value:[self mimeType]];
+	return [NSString stringWithFormat:@"%@\n\n%@\n%@\n%@%@",[self requestMethod],[self mimeType],[self dateString],canonicalizedAmzHeaders,canonicalizedResource];
+}
+
+- (NSString *)contentTypeForSigning
+{
+	return [self mimeType];
+}
+
+#pragma mark initiating the upload
+
+// Called when S3 responds to our request to initiate the upload
+// Rather than finishing, we start uploading the parts on the main thread, and stay in our queue until the upload has been completed
+- (void)requestFinished
+{
+	if ([self error]) {
+		return;
+	}
+	[self parseResponseXML];
+	if ([self error]) {
+		return;
+	}
+	if (![self uploadId]) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Unable to initiate multipart upload (S3 returned status %i)",[self responseStatusCode]],NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	complete = NO;
+	uploadingParts = YES;
+	[self performSelectorOnMainThread:@selector(startUploadingParts) withObject:nil waitUntilDone:[NSThread isMainThread]];
+}
+
+- (void)parser:(NSXMLParser *)parser didEndElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName
+{
+	if ([elementName isEqualToString:@"UploadId"]) {
+		[self setUploadId:[self currentXMLElementContent]];
+	} else {
+		[super parser:parser didEndElement:elementName namespaceURI:namespaceURI qualifiedName:qName];
+	}
+}
+
+// While we're uploading parts, we don't want to tell our queue we've finished
+- (void)markAsFinished
+{
+	if (!uploadingParts) {
+		[super markAsFinished];
+	}
+}
+
+- (void)failWithError:(NSError *)theError
+{
+	BOOL wasUploadingParts = uploadingParts;
+	uploadingParts = NO;
+	[super failWithError:theError];
+	if (wasUploadingParts) {
+		[self performSelectorOnMainThread:@selector(abortUpload) withObject:nil waitUntilDone:[NSThread isMainThread]];
+	}
+}
+
+#pragma mark uploading parts
+
+- (void)startUploadingParts
+{
+	if (!uploadingParts) {
+		return;
+	}
+	NSError *err = nil;
+	NSDictionary *attributes = [[[[NSFileManager alloc] init] autorelease] attributesOfItemAtPath:[self filePath] error:&err];
+	if (!attributes) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to get attributes for file at path '%@'",[self filePath]],NSLocalizedDescriptionKey,err,NSUnderlyingErrorKey,nil]]];
+		return;
+	}
+	fileSize = [attributes fileSize];
+
+	unsigned long long size = [self partSize];
+	if (size < ASIS3MultipartUploadMinimumPartSize) {
+		size = ASIS3MultipartUploadMinimumPartSize;
+	}
+	if (fileSize > size*ASIS3MultipartUploadMaximumPartCount) {
+		size = (fileSize+ASIS3MultipartUploadMaximumPartCount-1)/ASIS3MultipartUploadMaximumPartCount;
+	}
+	[self setPartSize:size];
+	[self setPartCount:(NSUInteger)((fileSize+size-1)/size)];
+
+	// An empty file is uploaded as a single empty part
+	if (![self partCount]) {
+		[self setPartCount:1];
+	}
+
+	[self setPartETags:[NSMutableDictionary dictionaryWithCapacity:[self partCount]]];
+	[self setPartProgress:[ASIPartProgressTracker trackerWithCapacity:[self partCount]]];
+	partBytesSent = 0;
+	partUploadSize = (long long)fileSize;
+	[self incrementUploadSizeBy:(long long)fileSize];
+
+	[[self partQueue] reset];
+	[self setPartQueue:[ASINetworkQueue queue]];
+	[[self partQueue] setDelegate:self];
+	[[self partQueue] setShowAccurateProgress:YES];
+	[[self partQueue] setShouldCancelAllRequestsOnFailure:NO];
+	[[self partQueue] setMaxConcurrentOperationCount:[self maxConcurrentPartUploads]];
+	[[self partQueue] setRequestDidFinishSelector:@selector(partUploadSucceeded:)];
+	[[self partQueue] setRequestDidFailSelector:@selector(partUploadFailed:)];
+
+	NSUInteger i;
+	for (i=1; i<=[self partCount]; i++) {
+		[[self partQueue] addOperation:[self requestForPartNumber:i attempt:0]];
+	}
+	[[self partQueue] go];
+}
+
+// Creates a request for the same object with the same credentials and settings as this one
+- (ASIS3ObjectRequest *)requestForSubResource:(NSString *)theSubResource
+{
+	ASIS3ObjectRequest *newRequest = [ASIS3ObjectRequest requestWithBucket:[self bucket] key:[self key] subResource:theSubResource];
+	[newRequest setAccessKey:[self accessKey]];
+	[newRequest setSecretAccessKey:[self secretAccessKey]];
+	[newRequest setSignatureVersion:[self signatureVersion]];
+	[newRequest setRegion:[self region]];
+	[newRequest setShouldSignRequestBodyInChunks:[self shouldSignRequestBodyInChunks]];
+	[newRequest setRequestScheme:[self requestScheme]];
+	[newRequest setTimeOutSeconds:[self timeOutSeconds]];
+	[newRequest setValidatesSecureCertificate:[self validatesSecureCertificate]];
+	return newRequest;
+}
+
+// Each part is streamed straight from its range of the file
+- (ASIS3ObjectRequest *)requestForPartNumber:(NSUInteger)partNumber attempt:(int)attempt
+{
+	unsigned long long offset = (partNumber-1)*[self partSize];
+	unsigned long long length = fileSize-offset;
+	if (length > [self partSize]) {
+		length = [self partSize];
+	}
+	ASIS3ObjectRequest *partRequest = [self requestForSubResource:[NSString stringWithFormat:@"partNumber=%lu&uploadId=%@",(unsigned long)partNumber,[self uploadId]]];
+	[partRequest setRequestMethod:@"PUT"];
+	[partRequest setPostBodyFilePath:[self filePath]];
+	[partRequest setShouldStreamPostDataFromDisk:YES];
+	[partRequest setPostBodyFileOffset:offset];
+	[partRequest setPostBodyFileLength:length];
+	[partRequest setUploadProgressDelegate:self];
+	[partRequest setUserInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithUnsignedInteger:partNumber],@"partNumber",[NSNumber numberWithInt:attempt],@"attempt",nil]];
+	return partRequest;
+}
+
+- (void)partUploadSucceeded:(ASIHTTPRequest *)partRequest
+{
+	if (!uploadingParts) {
+		return;
+	}
+	NSString *eTag = [[partRequest responseHeaders] objectForKey:@"Etag"];
+	if (!eTag) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"S3 did not return an ETag for part %@",[[partRequest userInfo] objectForKey:@"partNumber"]],NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	[[self partETags] setObject:eTag forKey:[[partRequest userInfo] objectForKey:@"partNumber"]];
+	if ([[self partETags] count] == [self partCount]) {
+		[self completeUpload];
+	}
+}
+
+// Parts that failed because of a connection problem or a server error are retried on their own
+// Anything else (eg a signature S3 didn't like) would fail again, so we give up on the whole upload
+- (void)partUploadFailed:(ASIHTTPRequest *)partRequest
+{
+	if (!uploadingParts) {
+		return;
+	}
+	NSNumber *partNumber = [[partRequest userInfo] objectForKey:@"partNumber"];
+	int attempt = [[[partRequest userInfo] objectForKey:@"attempt"] intValue];
+	BOOL canRetry = ([[partRequest error] code] != ASIRequestCancelledErrorType && ([partRequest responseStatusCode] == 0 || [partRequest responseStatusCode] >= 500));
+	if (!canRetry || attempt >= [self numberOfTimesToRetryPart]) {
+		[self failWithError:[partRequest error]];
+		return;
+	}
+
+	// Take back the progress the failed request reported, the new one will report it again
+	long long bytes, sizeChange;
+	[[self partProgress] startAttempt:attempt+1 forPart:partNumber bytesToTakeBack:&bytes sizeChangeToTakeBack:&sizeChange];
+	[self reportPartBytesSent:bytes sizeChange:sizeChange];
+	[[self partQueue] addOperation:[self requestForPartNumber:[partNumber unsignedIntegerValue] attempt:attempt+1]];
+}
+
+#pragma mark progress
+
+// Parts report their progress to us, and we pass it on as our own
+- (void)request:(ASIHTTPRequest *)partRequest didSendBytes:(long long)bytes
+{
+	if ([[self partProgress] recordBytes:bytes sizeChange:0 forPart:[[partRequest userInfo] objectForKey:@"partNumber"] attempt:[[[partRequest userInfo] objectForKey:@"attempt"] intValue]]) {
+		[self reportPartBytesSent:bytes sizeChange:0];
+	}
+}
+
+- (void)request:(ASIHTTPRequest *)partRequest incrementUploadSizeBy:(long long)newLength
+{
+	if ([[self partProgress] recordBytes:0 sizeChange:newLength forPart:[[partRequest userInfo] objectForKey:@"partNumber"] attempt:[[[partRequest userInfo] objectForKey:@"attempt"] intValue]]) {
+		[self reportPartBytesSent:0 sizeChange:newLength];
+	}
+}
+
+- (void)reportPartBytesSent:(long long)bytes sizeChange:(long long)sizeChange
+{
+	if (sizeChange) {
+		partUploadSize += sizeChange;
+		[self incrementUploadSizeBy:sizeChange];
+	}
+	if (bytes) {
+		partBytesSent += bytes;
+		[ASIHTTPRequest performSelector:@selector(request:didSendBytes:) onTarget:&queue withObject:self amount:&bytes callerToRetain:self];
+		[ASIHTTPRequest performSelector:@selector(request:didSendBytes:) onTarget:&uploadProgressDelegate withObject:self amount:&bytes callerToRetain:self];
+	}
+	if (partUploadSize > 0) {
+		[ASIHTTPRequest updateProgressIndicator:&uploadProgressDelegate withProgress:partBytesSent ofTotal:(unsigned long long)partUploadSize];
+	}
+}
+
+#pragma mark completing the upload
+
+- (void)completeUpload
+{
+	NSMutableString *body = [NSMutableString stringWithString:@"<CompleteMultipartUpload>"];
+	NSUInteger i;
+	for (i=1; i<=[self partCount]; i++) {
+		[body appendFormat:@"<Part><PartNumber>%lu</PartNumber><ETag>%@</ETag></Part>",(unsigned long)i,[[self partETags] objectForKey:[NSNumber numberWithUnsignedInteger:i]]];
+	}
+	[body appendString:@"</CompleteMultipartUpload>"];
+
+	ASIS3ObjectRequest *request = [self requestForSubResource:[NSString stringWithFormat:@"uploadId=%@",[self uploadId]]];
+	[request setRequestMethod:@"POST"];
+	[request appendPostData:[body dataUsingEncoding:NSUTF8StringEncoding]];
+	[request setDelegate:self];
+	[request setDidFinishSelector:@selector(uploadCompleted:)];
+	[request setDidFailSelector:@selector(uploadCompletionFailed:)];
+	[self setCompleteRequest:request];
+	[request startAsynchronous];
+}
+
+// S3 can report an error after it has started sending a successful response to a complete request
+// ASIS3Request will have spotted that when parsing the response, so if we get here, the object is in place
+- (void)uploadCompleted:(ASIHTTPRequest *)request
+{
+	if (!uploadingParts) {
+		return;
+	}
+	uploadingParts = NO;
+	[self setCompleteRequest:nil];
+	[self setResponseHeaders:[request responseHeaders]];
+	[self setRawResponseData:[request rawResponseData]];
+	complete = YES;
+	[super requestFinished];
+	[super markAsFinished];
+}
+
+- (void)uploadCompletionFailed:(ASIHTTPRequest *)request
+{
+	[self failWithError:[request error]];
+}
+
+// Stops uploading parts and tells S3 to throw away the ones we already sent
+- (void)abortUpload
+{
+	for (ASIHTTPRequest *partRequest in [[self partQueue] operations]) {
+		[partRequest clearDelegatesAndCancel];
+	}
+	[[self partQueue] reset];
+	[[self completeRequest] clearDelegatesAndCancel];
+	[self setCompleteRequest:nil];
+
+	ASIS3ObjectRequest *abortRequest = [self requestForSubResource:[NSString stringWithFormat:@"uploadId=%@",[self uploadId]]];
+	[abortRequest setRequestMethod:@"DELETE"];
+	[abortRequest startAsynchronous];
+}
+
+#pragma mark NSCopying
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	ASIS3MultipartUploadRequest *newRequest = [super copyWithZone:zone];
+	[newRequest setSubResource:[self subResource]];
+	[newRequest setFilePath:[self filePath]];
+	[newRequest setPartSize:[self partSize]];
+	[newRequest setMaxConcurrentPartUploads:[self maxConcurrentPartUploads]];
+	[newRequest setNumberOfTimesToRetryPart:[self numberOfTimesToRetryPart]];
+	return newRequest;
+}
+
+@synthesize filePath;
+@synthesize partSize;
+@synthesize maxConcurrentPartUploads;
+@synthesize numberOfTimesToRetryPart;
+@synthesize uploadId;
+@synthesize partCount;
+@synthesize partQueue;
+@synthesize partETags;
+@synthesize partProgress;
+@synthesize completeRequest;
+@end
@@ -0,0 +1,59 @@
+//
+//  ASIS3ObjectInfoEnumerator.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Use an ASIS3ObjectInfoEnumerator to fetch the size, ETag and modification date of a list of objects, using a HEAD request for each one
+//  Up to maxConcurrentRequests HEAD requests run ahead of the object you are looking at, so checking many objects isn't limited by the round-trip time for each one
+//
+//  Pass it a request set up with the bucket, credentials and any other settings you want, and the keys to look up
+//  Objects are returned as ASIS3BucketObjects, in the same order as the keys
+//  Keys for objects that don't exist are skipped, and added to missingKeys
+//  nextObject waits for the next HEAD request to finish, so you'll generally want to use an enumerator on a background thread
+//  If a request fails (for anything other than a missing object), nextObject returns nil, and error will tell you what went wrong
+//
+//  ASIS3ObjectRequest *request = [ASIS3ObjectRequest requestWithBucket:@"mybucket" key:nil];
+//  ASIS3ObjectInfoEnumerator *enumerator = [ASIS3ObjectInfoEnumerator enumeratorWithRequest:request keys:keysToCheck];
+//  [enumerator setMaxConcurrentRequests:16];
+//  for (ASIS3BucketObject *object in enumerator) {
+//  	...
+//  }
+
+#import <Foundation/Foundation.h>
+
+@class ASIS3ObjectRequest;
+@class ASINetworkQueue;
+
+@interface ASIS3ObjectInfoEnumerator : NSEnumerator {
+
+	// Each HEAD request is a copy of this request, with the key changed
+	ASIS3ObjectRequest *templateRequest;
+
+	// The keys we haven't started a request for yet
+	NSEnumerator *keyEnumerator;
+
+	// How many HEAD requests to run at once. Defaults to 8
+	// Changing this once you have started enumerating has no effect
+	NSInteger maxConcurrentRequests;
+
+	// Runs the HEAD requests
+	ASINetworkQueue *queue;
+
+	// Requests that have been started, in the same order as their keys
+	NSMutableArray *runningRequests;
+
+	// Keys for objects that don't exist
+	NSMutableArray *missingKeys;
+
+	NSError *error;
+}
+
++ (id)enumeratorWithRequest:(ASIS3ObjectRequest *)request keys:(NSArray *)keys;
+- (id)initWithRequest:(ASIS3ObjectRequest *)request keys:(NSArray *)keys;
+
+@property (assign, nonatomic) NSInteger maxConcurrentRequests;
+@property (retain, readonly) NSMutableArray *missingKeys;
+@property (retain, readonly) NSError *error;
+@end
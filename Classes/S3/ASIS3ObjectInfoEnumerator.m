@@ -0,0 +1,121 @@
+//
+//  ASIS3ObjectInfoEnumerator.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIS3ObjectInfoEnumerator.h"
+#import "ASIS3ObjectRequest.h"
+#import "ASIS3BucketObject.h"
+#import "ASINetworkQueue.h"
+
+// Private stuff
+@interface ASIS3ObjectInfoEnumerator ()
+- (void)startRequests;
+
+@property (retain, nonatomic) ASIS3ObjectRequest *templateRequest;
+@property (retain, nonatomic) NSEnumerator *keyEnumerator;
+@property (retain, nonatomic) ASINetworkQueue *queue;
+@property (retain, nonatomic) NSMutableArray *runningRequests;
+@property (retain) NSMutableArray *missingKeys;
+@property (retain) NSError *error;
+@end
+
+@implementation ASIS3ObjectInfoEnumerator
+
++ (id)enumeratorWithRequest:(ASIS3ObjectRequest *)request keys:(NSArray *)keys
+{
+	return [[[self alloc] initWithRequest:request keys:keys] autorelease];
+}
+
+- (id)initWithRequest:(ASIS3ObjectRequest *)request keys:(NSArray *)keys
+{
+	self = [super init];
+	[self setTemplateRequest:[[request copy] autorelease]];
+	[self setKeyEnumerator:[keys objectEnumerator]];
+	[self setMaxConcurrentRequests:8];
+	[self setRunningRequests:[NSMutableArray array]];
+	[self setMissingKeys:[NSMutableArray array]];
+	return self;
+}
+
+- (void)dealloc
+{
+	for (ASIHTTPRequest *request in runningRequests) {
+		[request clearDelegatesAndCancel];
+	}
+	[queue reset];
+	[queue release];
+	[runningRequests release];
+	[templateRequest release];
+	[keyEnumerator release];
+	[missingKeys release];
+	[error release];
+	[super dealloc];
+}
+
+// Keeps maxConcurrentRequests requests going
+- (void)startRequests
+{
+	if (![self queue]) {
+		[self setQueue:[ASINetworkQueue queue]];
+		[[self queue] setMaxConcurrentOperationCount:[self maxConcurrentRequests]];
+		[[self queue] setShouldCancelAllRequestsOnFailure:NO];
+		[[self queue] go];
+	}
+	while ([[self runningRequests] count] < (NSUInteger)[self maxConcurrentRequests]) {
+		NSString *key = [[self keyEnumerator] nextObject];
+		if (!key) {
+			return;
+		}
+		ASIS3ObjectRequest *request = [[[self templateRequest] copy] autorelease];
+		[request setDelegate:nil];
+		[request setKey:key];
+		[request setRequestMethod:@"HEAD"];
+		[request setURL:nil];
+		[[self runningRequests] addObject:request];
+		[[self queue] addOperation:request];
+	}
+}
+
+- (id)nextObject
+{
+	while (![self error]) {
+		[self startRequests];
+		if (![[self runningRequests] count]) {
+			return nil;
+		}
+		ASIS3ObjectRequest *request = [[[[self runningRequests] objectAtIndex:0] retain] autorelease];
+		[request waitUntilFinished];
+		[[self runningRequests] removeObjectAtIndex:0];
+
+		if ([request error]) {
+			[self setError:[request error]];
+		} else if ([request responseStatusCode] == 404) {
+			[[self missingKeys] addObject:[request key]];
+		} else if ([request responseStatusCode] != 200) {
+			[self setError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"S3 returned status %i for '%@'",[request responseStatusCode],[request key]],NSLocalizedDescriptionKey,nil]]];
+		} else {
+			NSDictionary *headers = [request responseHeaders];
+			ASIS3BucketObject *object = [ASIS3BucketObject objectWithBucket:[request bucket]];
+			[object setKey:[request key]];
+			[object setETag:[headers objectForKey:@"Etag"]];
+			[object setSize:(unsigned long long)[[headers objectForKey:@"Content-Length"] longLongValue]];
+			[object setLastModified:[ASIHTTPRequest dateFromRFC1123String:[headers objectForKey:@"Last-Modified"]]];
+			return object;
+		}
+	}
+	[[self queue] cancelAllOperations];
+	return nil;
+}
+
+@synthesize templateRequest;
+@synthesize keyEnumerator;
+@synthesize maxConcurrentRequests;
+@synthesize queue;
+@synthesize runningRequests;
+@synthesize missingKeys;
+@synthesize error;
+@end
@@ -152,6 +152,14 @@ NSString *const ASIS3StorageClassReducedRedundancy = @"REDUCED_REDUNDANCY";
 	return [super stringToSignForHeaders:canonicalizedAmzHeaders resource:canonicalizedResource];
 }
 
+- (NSString *)contentTypeForSigning
+{
+	if ([[self requestMethod] isEqualToString:@"PUT"] && ![self sourceKey]) {
+		return [self mimeType];
+	}
+	return nil;
+}
+
 @synthesize bucket;
 @synthesize key;
 @synthesize sourceBucket;
@@ -0,0 +1,88 @@
+//
+//  ASIS3ParallelDownloadRequest.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Use an ASIS3ParallelDownloadRequest to download a large object from S3 to a file, using several connections at once
+//
+//  The request itself is a HEAD request for the object. Once we know how big the object is, a file of that size is created next to downloadDestinationPath,
+//  the object is split into ranges, and up to maxConcurrentRangeDownloads ranged GET requests write their part of the object straight into the file at the right offset
+//  Every range is fetched with an If-Match header for the ETag we got from the HEAD request, so S3 will refuse to send a range from a different version of the object
+//  A range that fails is retried on its own, rather than restarting the whole download
+//
+//  When shouldVerifyDownload is YES (the default), the downloaded data is checked against the object's ETag before the file is moved into place:
+//  - For objects uploaded in a single PUT, the ETag is the MD5 of the object, so the whole file is checked once all the ranges have arrived (on a background thread)
+//  - For objects uploaded in parts, the ETag is the MD5 of the MD5s of the parts. In this case we download the object one part at a time (ignoring partSize), work out each part's MD5 as it arrives, and check them all together at the end
+//  - Objects with other kinds of ETags (eg ones encrypted with SSE-KMS) can't be checked
+//
+//  Download progress for all the ranges is reported to the request's downloadProgressDelegate (and queue) as if it were a single download
+//  Known issue: as with ASIS3MultipartUploadRequest, you cannot use startSynchronous with an ASIS3ParallelDownloadRequest
+//
+//  ASIS3ParallelDownloadRequest *request = [ASIS3ParallelDownloadRequest GETRequestWithBucket:@"mybucket" key:@"movie.mov" downloadDestinationPath:@"/path/to/movie.mov"];
+//  [request setDelegate:self];
+//  [request setDownloadProgressDelegate:progressIndicator];
+//  [request startAsynchronous];
+
+#import <Foundation/Foundation.h>
+#import "ASIS3ObjectRequest.h"
+
+@class ASINetworkQueue;
+@class ASIPartProgressTracker;
+
+@interface ASIS3ParallelDownloadRequest : ASIS3ObjectRequest {
+
+	// The size of each range in bytes (the last range may be smaller). Defaults to 8MB
+	unsigned long long partSize;
+
+	// How many ranges to download at once. Defaults to 4
+	NSInteger maxConcurrentRangeDownloads;
+
+	// How many times to retry a range that fails because of a connection problem or a server error, before giving up on the whole download. Defaults to 3
+	int numberOfTimesToRetryRange;
+
+	// When YES, the downloaded data is checked against the object's ETag (see above). Defaults to YES
+	BOOL shouldVerifyDownload;
+
+	// Size of the object, and its ETag (without the quotes), from the HEAD request
+	unsigned long long objectSize;
+	NSString *objectETag;
+
+	// Number of ranges the object was split into
+	NSUInteger rangeCount;
+
+	// Set to YES when we are downloading the parts of an object uploaded in parts, rather than ranges of partSize bytes
+	BOOL downloadingByPartNumber;
+
+	// The file the ranges are written to, it's moved to downloadDestinationPath once the download is complete
+	NSString *rangeFilePath;
+
+	// Downloads the ranges, up to maxConcurrentRangeDownloads at a time
+	ASINetworkQueue *rangeQueue;
+
+	// Maps range numbers to an array of [offset, length, MD5] for each range that has been downloaded
+	NSMutableDictionary *completedRanges;
+
+	// Progress reported so far by the current request for each range, used to take back a failed range's progress before it is retried
+	ASIPartProgressTracker *rangeProgress;
+
+	// Total reported by the requests for all the ranges so far
+	unsigned long long rangeBytesReceived;
+
+	// Set to YES once we've read the response to the HEAD request, until the download has been completed or has failed
+	// While this is YES, the request stays in its queue (if it has one) even though the HEAD request has finished
+	BOOL downloadingRanges;
+}
+
+// Create a request to download the object to the file at downloadDestinationPath
++ (id)GETRequestWithBucket:(NSString *)bucket key:(NSString *)key downloadDestinationPath:(NSString *)path;
+
+@property (assign, nonatomic) unsigned long long partSize;
+@property (assign, nonatomic) NSInteger maxConcurrentRangeDownloads;
+@property (assign, nonatomic) int numberOfTimesToRetryRange;
+@property (assign, nonatomic) BOOL shouldVerifyDownload;
+@property (assign, readonly) unsigned long long objectSize;
+@property (retain, readonly) NSString *objectETag;
+@property (assign, readonly) NSUInteger rangeCount;
+@end
@@ -0,0 +1,670 @@
+//
+//  ASIS3ParallelDownloadRequest.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIS3ParallelDownloadRequest.h"
+#import "ASINetworkQueue.h"
+#import "ASIPartProgressTracker.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <errno.h>
+
+static NSString *ASIS3HexStringForMD5Digest(const unsigned char *digest)
+{
+	NSMutableString *hex = [NSMutableString stringWithCapacity:CC_MD5_DIGEST_LENGTH*2];
+	int i;
+	for (i=0; i<CC_MD5_DIGEST_LENGTH; i++) {
+		[hex appendFormat:@"%02x",digest[i]];
+	}
+	return hex;
+}
+
+// ETags for objects uploaded in a single PUT are the MD5 of the object
+static BOOL ASIS3ETagIsMD5(NSString *eTag)
+{
+	if ([eTag length] != CC_MD5_DIGEST_LENGTH*2) {
+		return NO;
+	}
+	return [[eTag stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdefABCDEF"]] length] == 0;
+}
+
+// ETags for objects uploaded in parts look like '<MD5 of the MD5s of the parts>-<number of parts>'
+// Returns 0 for any other kind of ETag
+static NSUInteger ASIS3PartCountForETag(NSString *eTag)
+{
+	NSArray *components = [eTag componentsSeparatedByString:@"-"];
+	if ([components count] != 2 || !ASIS3ETagIsMD5([components objectAtIndex:0])) {
+		return 0;
+	}
+	NSInteger count = [[components objectAtIndex:1] integerValue];
+	if (count < 1 || ![[NSString stringWithFormat:@"%ld",(long)count] isEqualToString:[components objectAtIndex:1]]) {
+		return 0;
+	}
+	return (NSUInteger)count;
+}
+
+// Fetches one range of an object, writing it straight into the file at the right offset rather than keeping it in memory
+@interface ASIS3RangeRequest : ASIS3ObjectRequest {
+	NSString *rangeFilePath;
+	unsigned long long rangeOffset;
+	unsigned long long rangeLength;
+	unsigned long long objectSize;
+	NSString *expectedETag;
+
+	// When YES, we find out which range we are getting from the Content-Range header (used when downloading by part number)
+	BOOL takesRangeFromResponse;
+
+	BOOL shouldCalculateMD5;
+	NSData *rangeMD5;
+
+	int fileDescriptor;
+	unsigned long long bytesWritten;
+	CC_MD5_CTX md5Context;
+}
+- (NSError *)openRangeFile;
+- (void)closeRangeFile;
+- (NSError *)errorWithDescription:(NSString *)description;
+
+@property (retain, nonatomic) NSString *rangeFilePath;
+@property (assign, nonatomic) unsigned long long rangeOffset;
+@property (assign, nonatomic) unsigned long long rangeLength;
+@property (assign, nonatomic) unsigned long long objectSize;
+@property (retain, nonatomic) NSString *expectedETag;
+@property (assign, nonatomic) BOOL takesRangeFromResponse;
+@property (assign, nonatomic) BOOL shouldCalculateMD5;
+@property (retain) NSData *rangeMD5;
+@end
+
+@implementation ASIS3RangeRequest
+
+- (id)initWithURL:(NSURL *)newURL
+{
+	self = [super initWithURL:newURL];
+	fileDescriptor = -1;
+	return self;
+}
+
+- (void)dealloc
+{
+	[self closeRangeFile];
+	[rangeFilePath release];
+	[expectedETag release];
+	[rangeMD5 release];
+	[super dealloc];
+}
+
+// We want the bytes exactly as S3 stored them, even if the object was stored with a Content-Encoding
+- (BOOL)isResponseCompressed
+{
+	return NO;
+}
+
+// Called every time we get a response (including when the request is retried on a new connection)
+- (void)readResponseHeaders
+{
+	[super readResponseHeaders];
+	[self closeRangeFile];
+
+	// S3 errors are handled as usual
+	if ([self responseStatusCode] < 200 || [self responseStatusCode] >= 300) {
+		return;
+	}
+	NSError *err = [self openRangeFile];
+	if (err) {
+		[self failWithError:err];
+		return;
+	}
+	// The body goes straight into the file, so there's no need to keep it in memory as well
+	[self setRawResponseData:nil];
+}
+
+// Makes sure S3 is sending the range we asked for, of the object we expect, then opens the file at the start of the range
+- (NSError *)openRangeFile
+{
+	if ([self responseStatusCode] != 206) {
+		return [self errorWithDescription:[NSString stringWithFormat:@"Expected a partial response, but S3 returned status %i",[self responseStatusCode]]];
+	}
+	if ([self expectedETag]) {
+		NSString *eTag = [[[self responseHeaders] objectForKey:@"Etag"] stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"\""]];
+		if (![eTag isEqualToString:[self expectedETag]]) {
+			return [self errorWithDescription:@"The object changed while it was being downloaded"];
+		}
+	}
+
+	// Content-Range looks like 'bytes 0-99/1000'
+	long long first = 0, last = 0, total = 0;
+	NSScanner *scanner = [NSScanner scannerWithString:[[self responseHeaders] objectForKey:@"Content-Range"]];
+	BOOL valid = ([scanner scanString:@"bytes" intoString:NULL] && [scanner scanLongLong:&first] && [scanner scanString:@"-" intoString:NULL] && [scanner scanLongLong:&last] && [scanner scanString:@"/" intoString:NULL] && [scanner scanLongLong:&total]);
+	if (!valid || first < 0 || last < first || (unsigned long long)total != [self objectSize] || last >= total) {
+		return [self errorWithDescription:[NSString stringWithFormat:@"S3 returned an invalid Content-Range: '%@'",[[self responseHeaders] objectForKey:@"Content-Range"]]];
+	}
+	if ([self takesRangeFromResponse]) {
+		[self setRangeOffset:(unsigned long long)first];
+		[self setRangeLength:(unsigned long long)(last-first+1)];
+	} else if ((unsigned long long)first != [self rangeOffset] || (unsigned long long)(last-first+1) != [self rangeLength]) {
+		return [self errorWithDescription:[NSString stringWithFormat:@"S3 returned the wrong range: '%@'",[[self responseHeaders] objectForKey:@"Content-Range"]]];
+	}
+
+	fileDescriptor = open([[self rangeFilePath] fileSystemRepresentation], O_WRONLY);
+	if (fileDescriptor < 0) {
+		return [NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to open file at path '%@' (%s)",[self rangeFilePath],strerror(errno)],NSLocalizedDescriptionKey,nil]];
+	}
+	bytesWritten = 0;
+	if ([self shouldCalculateMD5]) {
+		CC_MD5_Init(&md5Context);
+	}
+	return nil;
+}
+
+- (void)didReceiveResponseBytes:(const void *)bytes length:(NSUInteger)length
+{
+	if (fileDescriptor < 0) {
+		return;
+	}
+	if (bytesWritten+length > [self rangeLength]) {
+		[self closeRangeFile];
+		[self failWithError:[self errorWithDescription:@"S3 sent more data than we asked for"]];
+		return;
+	}
+	NSUInteger written = 0;
+	while (written < length) {
+		ssize_t result = pwrite(fileDescriptor, (const char *)bytes+written, length-written, (off_t)([self rangeOffset]+bytesWritten+written));
+		if (result < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to write to file at path '%@' (%s)",[self rangeFilePath],strerror(errno)],NSLocalizedDescriptionKey,nil]]];
+			[self closeRangeFile];
+			return;
+		}
+		written += (NSUInteger)result;
+	}
+	if ([self shouldCalculateMD5]) {
+		CC_MD5_Update(&md5Context, bytes, (CC_LONG)length);
+	}
+	bytesWritten += length;
+}
+
+- (void)requestFinished
+{
+	BOOL wroteRange = (fileDescriptor >= 0);
+	[self closeRangeFile];
+	if (wroteRange && ![self error]) {
+		if (bytesWritten != [self rangeLength]) {
+			[self failWithError:[self errorWithDescription:[NSString stringWithFormat:@"S3 sent %llu bytes of a %llu byte range",bytesWritten,[self rangeLength]]]];
+			return;
+		}
+		if ([self shouldCalculateMD5]) {
+			unsigned char digest[CC_MD5_DIGEST_LENGTH];
+			CC_MD5_Final(digest, &md5Context);
+			[self setRangeMD5:[NSData dataWithBytes:digest length:CC_MD5_DIGEST_LENGTH]];
+		}
+	}
+	[super requestFinished];
+}
+
+- (void)failWithError:(NSError *)theError
+{
+	[self closeRangeFile];
+	[super failWithError:theError];
+}
+
+- (void)closeRangeFile
+{
+	if (fileDescriptor >= 0) {
+		close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+}
+
+- (NSError *)errorWithDescription:(NSString *)description
+{
+	return [NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:description,NSLocalizedDescriptionKey,nil]];
+}
+
+@synthesize rangeFilePath;
+@synthesize rangeOffset;
+@synthesize rangeLength;
+@synthesize objectSize;
+@synthesize expectedETag;
+@synthesize takesRangeFromResponse;
+@synthesize shouldCalculateMD5;
+@synthesize rangeMD5;
+@end
+
+
+// Private stuff
+@interface ASIS3ParallelDownloadRequest ()
+- (void)startDownloadingRanges;
+- (ASIS3RangeRequest *)requestForRange:(NSUInteger)rangeNumber attempt:(int)attempt;
+- (void)rangeDownloadSucceeded:(ASIS3RangeRequest *)rangeRequest;
+- (void)rangeDownloadFailed:(ASIS3RangeRequest *)rangeRequest;
+- (void)reportRangeBytesReceived:(long long)bytes;
+- (void)rangesDownloaded;
+- (void)calculateMD5OfDownloadedFile;
+- (void)downloadedFileMD5Calculated:(NSString *)md5;
+- (void)moveFileIntoPlace;
+- (void)stopDownloadingRanges;
+- (NSError *)verificationErrorWithDescription:(NSString *)description;
+
+@property (assign) unsigned long long objectSize;
+@property (retain) NSString *objectETag;
+@property (assign) NSUInteger rangeCount;
+@property (retain) NSString *rangeFilePath;
+@property (retain, nonatomic) ASINetworkQueue *rangeQueue;
+@property (retain, nonatomic) NSMutableDictionary *completedRanges;
+@property (retain, nonatomic) ASIPartProgressTracker *rangeProgress;
+@end
+
+@implementation ASIS3ParallelDownloadRequest
+
+- (id)initWithURL:(NSURL *)newURL
+{
+	self = [super initWithURL:newURL];
+	[self setPartSize:8*1024*1024];
+	[self setMaxConcurrentRangeDownloads:4];
+	[self setNumberOfTimesToRetryRange:3];
+	[self setShouldVerifyDownload:YES];
+	return self;
+}
+
++ (id)GETRequestWithBucket:(NSString *)theBucket key:(NSString *)theKey downloadDestinationPath:(NSString *)thePath
+{
+	ASIS3ParallelDownloadRequest *newRequest = [self requestWithBucket:theBucket key:theKey];
+	[newRequest setRequestMethod:@"HEAD"];
+	[newRequest setDownloadDestinationPath:thePath];
+	return newRequest;
+}
+
+- (void)dealloc
+{
+	[rangeQueue reset];
+	[rangeQueue release];
+	[completedRanges release];
+	[rangeProgress release];
+	[rangeFilePath release];
+	[objectETag release];
+	[super dealloc];
+}
+
+#pragma mark finding out about the object
+
+// Called when S3 responds to our HEAD request
+// Rather than finishing, we start downloading the ranges on the main thread, and stay in our queue until the download has been completed
+- (void)requestFinished
+{
+	if ([self error]) {
+		return;
+	}
+	if ([self responseStatusCode] != 200) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Unable to get the details of the object (S3 returned status %i)",[self responseStatusCode]],NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	if (![self downloadDestinationPath]) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"No downloadDestinationPath was set",NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	[self setObjectSize:[self contentLength]];
+	[self setObjectETag:[[[self responseHeaders] objectForKey:@"Etag"] stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"\""]]];
+	complete = NO;
+	downloadingRanges = YES;
+	[self performSelectorOnMainThread:@selector(startDownloadingRanges) withObject:nil waitUntilDone:[NSThread isMainThread]];
+}
+
+// While we're downloading ranges, we don't want to tell our queue we've finished
+- (void)markAsFinished
+{
+	if (!downloadingRanges) {
+		[super markAsFinished];
+	}
+}
+
+- (void)failWithError:(NSError *)theError
+{
+	BOOL wasDownloadingRanges = downloadingRanges;
+	downloadingRanges = NO;
+	[super failWithError:theError];
+	if (wasDownloadingRanges) {
+		[self performSelectorOnMainThread:@selector(stopDownloadingRanges) withObject:nil waitUntilDone:[NSThread isMainThread]];
+	}
+}
+
+#pragma mark downloading ranges
+
+- (void)startDownloadingRanges
+{
+	if (!downloadingRanges) {
+		return;
+	}
+
+	// Create a file the size of the object for the ranges to be written into
+	[self setRangeFilePath:[[self downloadDestinationPath] stringByAppendingString:@".download"]];
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	NSFileHandle *fileHandle = nil;
+	if ([fileManager createFileAtPath:[self rangeFilePath] contents:nil attributes:nil]) {
+		fileHandle = [NSFileHandle fileHandleForWritingAtPath:[self rangeFilePath]];
+	}
+	if (!fileHandle) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to create file at path '%@'",[self rangeFilePath]],NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	[fileHandle truncateFileAtOffset:[self objectSize]];
+	[fileHandle closeFile];
+
+	// To check an object uploaded in parts, we need the MD5 of each part, so we download it one part at a time
+	NSUInteger partsInETag = ASIS3PartCountForETag([self objectETag]);
+	downloadingByPartNumber = ([self shouldVerifyDownload] && partsInETag && [self objectSize]);
+	if (downloadingByPartNumber) {
+		[self setRangeCount:partsInETag];
+	} else {
+		if (![self partSize]) {
+			[self setPartSize:[self objectSize]];
+		}
+		[self setRangeCount:(NSUInteger)(([self objectSize]+[self partSize]-1)/[self partSize])];
+	}
+
+	[self setCompletedRanges:[NSMutableDictionary dictionaryWithCapacity:[self rangeCount]]];
+	[self setRangeProgress:[ASIPartProgressTracker trackerWithCapacity:[self rangeCount]]];
+	rangeBytesReceived = 0;
+
+	if (![self rangeCount]) {
+		[self rangesDownloaded];
+		return;
+	}
+
+	[[self rangeQueue] reset];
+	[self setRangeQueue:[ASINetworkQueue queue]];
+	[[self rangeQueue] setDelegate:self];
+	[[self rangeQueue] setShowAccurateProgress:YES];
+	[[self rangeQueue] setShouldCancelAllRequestsOnFailure:NO];
+	[[self rangeQueue] setMaxConcurrentOperationCount:[self maxConcurrentRangeDownloads]];
+	[[self rangeQueue] setRequestDidFinishSelector:@selector(rangeDownloadSucceeded:)];
+	[[self rangeQueue] setRequestDidFailSelector:@selector(rangeDownloadFailed:)];
+
+	// We start the queue before adding the ranges, otherwise it would send a HEAD request for each one to find out how big it is
+	[[self rangeQueue] go];
+	NSUInteger i;
+	for (i=1; i<=[self rangeCount]; i++) {
+		[[self rangeQueue] addOperation:[self requestForRange:i attempt:0]];
+	}
+}
+
+// Creates a request for a range of the object, with the same credentials and settings as this one
+- (ASIS3RangeRequest *)requestForRange:(NSUInteger)rangeNumber attempt:(int)attempt
+{
+	ASIS3RangeRequest *rangeRequest = nil;
+	if (downloadingByPartNumber) {
+		rangeRequest = [ASIS3RangeRequest requestWithBucket:[self bucket] key:[self key] subResource:[NSString stringWithFormat:@"partNumber=%lu",(unsigned long)rangeNumber]];
+		[rangeRequest setTakesRangeFromResponse:YES];
+		[rangeRequest setShouldCalculateMD5:YES];
+	} else {
+		unsigned long long offset = (rangeNumber-1)*[self partSize];
+		unsigned long long length = [self objectSize]-offset;
+		if (length > [self partSize]) {
+			length = [self partSize];
+		}
+		rangeRequest = [ASIS3RangeRequest requestWithBucket:[self bucket] key:[self key]];
+		[rangeRequest setRangeOffset:offset];
+		[rangeRequest setRangeLength:length];
+		[rangeRequest addRequestHeader:@"Range" value:[NSString stringWithFormat:@"bytes=%llu-%llu",offset,offset+length-1]];
+	}
+	if ([self objectETag]) {
+		[rangeRequest setExpectedETag:[self objectETag]];
+		[rangeRequest addRequestHeader:@"If-Match" value:[NSString stringWithFormat:@"\"%@\"",[self objectETag]]];
+	}
+	[rangeRequest setObjectSize:[self objectSize]];
+	[rangeRequest setRangeFilePath:[self rangeFilePath]];
+	[rangeRequest setAccessKey:[self accessKey]];
+	[rangeRequest setSecretAccessKey:[self secretAccessKey]];
+	[rangeRequest setSignatureVersion:[self signatureVersion]];
+	[rangeRequest setRegion:[self region]];
+	[rangeRequest setRequestScheme:[self requestScheme]];
+	[rangeRequest setTimeOutSeconds:[self timeOutSeconds]];
+	[rangeRequest setValidatesSecureCertificate:[self validatesSecureCertificate]];
+	[rangeRequest setDownloadProgressDelegate:self];
+	[rangeRequest setUserInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithUnsignedInteger:rangeNumber],@"rangeNumber",[NSNumber numberWithInt:attempt],@"attempt",nil]];
+	return rangeRequest;
+}
+
+- (void)rangeDownloadSucceeded:(ASIS3RangeRequest *)rangeRequest
+{
+	if (!downloadingRanges) {
+		return;
+	}
+	// S3 errors that weren't sent as XML
+	if ([rangeRequest responseStatusCode] != 206) {
+		[self rangeDownloadFailed:rangeRequest];
+		return;
+	}
+	id md5 = [rangeRequest rangeMD5];
+	if (!md5) {
+		md5 = [NSNull null];
+	}
+	[[self completedRanges] setObject:[NSArray arrayWithObjects:[NSNumber numberWithUnsignedLongLong:[rangeRequest rangeOffset]],[NSNumber numberWithUnsignedLongLong:[rangeRequest rangeLength]],md5,nil] forKey:[[rangeRequest userInfo] objectForKey:@"rangeNumber"]];
+	if ([[self completedRanges] count] == [self rangeCount]) {
+		[self rangesDownloaded];
+	}
+}
+
+// Ranges that failed because of a connection problem or a server error are retried on their own
+// Anything else (eg the object changing while we download it) would fail again, so we give up on the whole download
+- (void)rangeDownloadFailed:(ASIS3RangeRequest *)rangeRequest
+{
+	if (!downloadingRanges) {
+		return;
+	}
+	NSNumber *rangeNumber = [[rangeRequest userInfo] objectForKey:@"rangeNumber"];
+	int attempt = [[[rangeRequest userInfo] objectForKey:@"attempt"] intValue];
+	NSError *rangeError = [rangeRequest error];
+	if (!rangeError) {
+		rangeError = [NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Unable to download range %@ of the object (S3 returned status %i)",rangeNumber,[rangeRequest responseStatusCode]],NSLocalizedDescriptionKey,nil]];
+	}
+	// We decide from the status rather than the error code, as ASIS3ResponseErrorType has the same code as ASIRequestTimedOutErrorType
+	// No status at all means the request failed before we got a response (eg it timed out or the connection dropped)
+	int status = [rangeRequest responseStatusCode];
+	BOOL connectionProblem = (status == 0 && [rangeRequest error] && [[rangeRequest error] code] != ASIRequestCancelledErrorType);
+	BOOL canRetry = (connectionProblem || status >= 500);
+	if (!canRetry || attempt >= [self numberOfTimesToRetryRange]) {
+		[self failWithError:rangeError];
+		return;
+	}
+
+	// Take back the progress the failed request reported, the new one will report it again
+	long long bytes, sizeChange;
+	[[self rangeProgress] startAttempt:attempt+1 forPart:rangeNumber bytesToTakeBack:&bytes sizeChangeToTakeBack:&sizeChange];
+	[self reportRangeBytesReceived:bytes];
+	[[self rangeQueue] addOperation:[self requestForRange:[rangeNumber unsignedIntegerValue] attempt:attempt+1]];
+}
+
+#pragma mark progress
+
+// Ranges report their progress to us, and we pass it on as our own
+// We already added the size of the whole object to our download size when we read the response to the HEAD request
+- (void)request:(ASIHTTPRequest *)rangeRequest didReceiveBytes:(long long)bytes
+{
+	if ([[self rangeProgress] recordBytes:bytes sizeChange:0 forPart:[[rangeRequest userInfo] objectForKey:@"rangeNumber"] attempt:[[[rangeRequest userInfo] objectForKey:@"attempt"] intValue]]) {
+		[self reportRangeBytesReceived:bytes];
+	}
+}
+
+- (void)request:(ASIHTTPRequest *)rangeRequest incrementDownloadSizeBy:(long long)newLength
+{
+}
+
+- (void)reportRangeBytesReceived:(long long)bytes
+{
+	if (!bytes || ![self showAccurateProgress]) {
+		return;
+	}
+	rangeBytesReceived += bytes;
+	[ASIHTTPRequest performSelector:@selector(request:didReceiveBytes:) onTarget:&queue withObject:self amount:&bytes callerToRetain:self];
+	[ASIHTTPRequest performSelector:@selector(request:didReceiveBytes:) onTarget:&downloadProgressDelegate withObject:self amount:&bytes callerToRetain:self];
+	if ([self objectSize]) {
+		[ASIHTTPRequest updateProgressIndicator:&downloadProgressDelegate withProgress:rangeBytesReceived ofTotal:[self objectSize]];
+	}
+}
+
+#pragma mark checking the download
+
+- (void)rangesDownloaded
+{
+	// Make sure the ranges we got cover the whole object, with no gaps or overlaps
+	unsigned long long expectedOffset = 0;
+	NSUInteger i;
+	for (i=1; i<=[self rangeCount]; i++) {
+		NSArray *range = [[self completedRanges] objectForKey:[NSNumber numberWithUnsignedInteger:i]];
+		if ([[range objectAtIndex:0] unsignedLongLongValue] != expectedOffset) {
+			[self failWithError:[self verificationErrorWithDescription:[NSString stringWithFormat:@"Range %lu of the object did not start where the previous one finished",(unsigned long)i]]];
+			return;
+		}
+		expectedOffset += [[range objectAtIndex:1] unsignedLongLongValue];
+	}
+	if (expectedOffset != [self objectSize]) {
+		[self failWithError:[self verificationErrorWithDescription:@"The ranges we downloaded did not cover the whole object"]];
+		return;
+	}
+
+	if (![self shouldVerifyDownload]) {
+		[self moveFileIntoPlace];
+
+	// The ETag of an object uploaded in parts is the MD5 of the MD5s of the parts, followed by the number of parts
+	} else if (downloadingByPartNumber) {
+		CC_MD5_CTX md5Context;
+		CC_MD5_Init(&md5Context);
+		for (i=1; i<=[self rangeCount]; i++) {
+			NSData *partMD5 = [[[self completedRanges] objectForKey:[NSNumber numberWithUnsignedInteger:i]] objectAtIndex:2];
+			CC_MD5_Update(&md5Context, [partMD5 bytes], (CC_LONG)[partMD5 length]);
+		}
+		unsigned char digest[CC_MD5_DIGEST_LENGTH];
+		CC_MD5_Final(digest, &md5Context);
+		NSString *eTag = [NSString stringWithFormat:@"%@-%lu",ASIS3HexStringForMD5Digest(digest),(unsigned long)[self rangeCount]];
+		if ([eTag caseInsensitiveCompare:[self objectETag]] != NSOrderedSame) {
+			[self failWithError:[self verificationErrorWithDescription:@"The downloaded parts did not match the ETag of the object"]];
+			return;
+		}
+		[self moveFileIntoPlace];
+
+	// Calculating the MD5 of a large file takes a while, so we don't do it on the main thread
+	} else if (ASIS3ETagIsMD5([self objectETag])) {
+		[self performSelectorInBackground:@selector(calculateMD5OfDownloadedFile) withObject:nil];
+
+	} else {
+		[self moveFileIntoPlace];
+	}
+}
+
+- (void)calculateMD5OfDownloadedFile
+{
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	NSString *md5 = nil;
+	NSFileHandle *fileHandle = [NSFileHandle fileHandleForReadingAtPath:[self rangeFilePath]];
+	if (fileHandle) {
+		CC_MD5_CTX md5Context;
+		CC_MD5_Init(&md5Context);
+		while (1) {
+			NSAutoreleasePool *chunkPool = [[NSAutoreleasePool alloc] init];
+			NSData *chunk = [fileHandle readDataOfLength:1024*1024];
+			NSUInteger length = [chunk length];
+			if (length) {
+				CC_MD5_Update(&md5Context, [chunk bytes], (CC_LONG)length);
+			}
+			[chunkPool release];
+			if (!length) {
+				break;
+			}
+		}
+		[fileHandle closeFile];
+		unsigned char digest[CC_MD5_DIGEST_LENGTH];
+		CC_MD5_Final(digest, &md5Context);
+		md5 = ASIS3HexStringForMD5Digest(digest);
+	}
+	[self performSelectorOnMainThread:@selector(downloadedFileMD5Calculated:) withObject:md5 waitUntilDone:NO];
+	[pool release];
+}
+
+- (void)downloadedFileMD5Calculated:(NSString *)md5
+{
+	if (!downloadingRanges) {
+		return;
+	}
+	if (!md5) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to read file at path '%@'",[self rangeFilePath]],NSLocalizedDescriptionKey,nil]]];
+		return;
+	}
+	if ([md5 caseInsensitiveCompare:[self objectETag]] != NSOrderedSame) {
+		[self failWithError:[self verificationErrorWithDescription:@"The downloaded data did not match the ETag of the object"]];
+		return;
+	}
+	[self moveFileIntoPlace];
+}
+
+- (NSError *)verificationErrorWithDescription:(NSString *)description
+{
+	return [NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseErrorType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:description,NSLocalizedDescriptionKey,nil]];
+}
+
+#pragma mark finishing the download
+
+- (void)moveFileIntoPlace
+{
+	NSError *err = nil;
+	if (![[self class] removeFileAtPath:[self downloadDestinationPath] error:&err]) {
+		[self failWithError:err];
+		return;
+	}
+	NSError *moveError = nil;
+	[[[[NSFileManager alloc] init] autorelease] moveItemAtPath:[self rangeFilePath] toPath:[self downloadDestinationPath] error:&moveError];
+	if (moveError) {
+		[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIFileManagementError userInfo:[NSDictionary dictionaryWithObjectsAndKeys:[NSString stringWithFormat:@"Failed to move file from '%@' to '%@'",[self rangeFilePath],[self downloadDestinationPath]],NSLocalizedDescriptionKey,moveError,NSUnderlyingErrorKey,nil]]];
+		return;
+	}
+	downloadingRanges = NO;
+	[self setRangeFilePath:nil];
+	[self setRangeQueue:nil];
+	complete = YES;
+	[super requestFinished];
+	[super markAsFinished];
+}
+
+// Stops downloading ranges and removes the partly downloaded file
+- (void)stopDownloadingRanges
+{
+	for (ASIHTTPRequest *rangeRequest in [[self rangeQueue] operations]) {
+		[rangeRequest clearDelegatesAndCancel];
+	}
+	[[self rangeQueue] reset];
+	if ([self rangeFilePath]) {
+		[[self class] removeFileAtPath:[self rangeFilePath] error:NULL];
+		[self setRangeFilePath:nil];
+	}
+}
+
+#pragma mark NSCopying
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	ASIS3ParallelDownloadRequest *newRequest = [super copyWithZone:zone];
+	[newRequest setPartSize:[self partSize]];
+	[newRequest setMaxConcurrentRangeDownloads:[self maxConcurrentRangeDownloads]];
+	[newRequest setNumberOfTimesToRetryRange:[self numberOfTimesToRetryRange]];
+	[newRequest setShouldVerifyDownload:[self shouldVerifyDownload]];
+	return newRequest;
+}
+
+@synthesize partSize;
+@synthesize maxConcurrentRangeDownloads;
+@synthesize numberOfTimesToRetryRange;
+@synthesize shouldVerifyDownload;
+@synthesize objectSize;
+@synthesize objectETag;
+@synthesize rangeCount;
+@synthesize rangeFilePath;
+@synthesize rangeQueue;
+@synthesize completedRanges;
+@synthesize rangeProgress;
+@end
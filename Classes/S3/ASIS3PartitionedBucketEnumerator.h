@@ -0,0 +1,105 @@
+//
+//  ASIS3PartitionedBucketEnumerator.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Use an ASIS3PartitionedBucketEnumerator to list a very large bucket faster than an ASIS3BucketEnumerator can
+//  Paging through a listing with a marker means waiting for each page before we can ask for the next one
+//  Instead, this class splits the keys into partitions, and lists several partitions at once
+//
+//  With ASIS3ListingPartitionByKeyRange (the default), the listing starts as a single partition
+//  Whenever all the partitions being listed are waiting for a page and there is a connection to spare, the range of keys left in the biggest partition is split in two at a key halfway between its last key and its end
+//  So a listing spreads out over more connections the bigger it turns out to be, and partitions that are nearly empty don't cost much
+//  With ASIS3ListingPartitionByDelimiter, the bucket is first listed with partitionDelimiter, and each common prefix (eg each 'folder') becomes a partition
+//  These partitions can then be split by key range in the same way
+//
+//  The number of requests running at once starts small and goes up by one for each page that arrives, up to maxConcurrentRequests
+//  When S3 returns a server error (eg 503 Slow Down) or a request times out, the number is halved and the page is retried
+//
+//  When shouldReturnObjectsInKeyOrder is YES (the default), objects are returned in the same order as an ASIS3BucketEnumerator would return them
+//  Set it to NO to get objects from any partition as soon as they arrive
+//  Each partition keeps no more than two pages of objects waiting to be returned, so memory use depends on the number of partitions, not the size of the bucket
+//
+//  As with ASIS3BucketEnumerator, nextObject waits for pages to arrive, so you'll generally want to use an enumerator on a background thread
+//  If fetching a page fails, nextObject returns nil, and error will tell you what went wrong
+//  The template request's delimiter is ignored, only objects are returned
+//
+//  ASIS3BucketRequest *listRequest = [ASIS3BucketRequest requestWithBucket:@"mybucket"];
+//  [listRequest setPrefix:@"logs/"];
+//  ASIS3PartitionedBucketEnumerator *enumerator = [ASIS3PartitionedBucketEnumerator enumeratorWithRequest:listRequest];
+//  [enumerator setShouldReturnObjectsInKeyOrder:NO];
+//  for (ASIS3BucketObject *object in enumerator) {
+//  	...
+//  }
+
+#import <Foundation/Foundation.h>
+
+@class ASIS3BucketRequest;
+@class ASINetworkQueue;
+
+typedef enum _ASIS3ListingPartitionMode {
+	ASIS3ListingPartitionByKeyRange = 0,
+	ASIS3ListingPartitionByDelimiter = 1
+} ASIS3ListingPartitionMode;
+
+@interface ASIS3PartitionedBucketEnumerator : NSEnumerator {
+
+	// Each page is fetched with a copy of this request
+	ASIS3BucketRequest *templateRequest;
+
+	// How to work out the first partitions. Defaults to ASIS3ListingPartitionByKeyRange
+	ASIS3ListingPartitionMode partitionMode;
+
+	// The delimiter used to find partitions with ASIS3ListingPartitionByDelimiter. Defaults to @"/"
+	NSString *partitionDelimiter;
+
+	// When NO, objects are returned as soon as they arrive, rather than in key order. Defaults to YES
+	BOOL shouldReturnObjectsInKeyOrder;
+
+	// The most requests to run at once. Defaults to 16
+	NSInteger maxConcurrentRequests;
+
+	// How many times to retry a page that fails because of a server error or a connection problem, before giving up. Defaults to 3
+	int numberOfTimesToRetryPage;
+
+	// The number of requests we are currently allowed to run at once
+	NSInteger concurrency;
+
+	// Partitions we haven't finished returning objects from, in key order
+	NSMutableArray *partitions;
+
+	// Requests that have been started, oldest first
+	NSMutableArray *runningRequests;
+
+	ASINetworkQueue *queue;
+
+	// Number of partitions the listing has been split into so far
+	NSUInteger partitionCount;
+
+	// Number of pages fetched so far
+	NSUInteger pageCount;
+
+	NSError *error;
+}
+
++ (id)enumeratorWithRequest:(ASIS3BucketRequest *)request;
+- (id)initWithRequest:(ASIS3BucketRequest *)request;
+
+// Returns a key that sorts after lowKey and before highKey (pass nil for highKey when there is no upper limit), or nil if there isn't a usable one
+// Used to split partitions, you shouldn't normally need to use this yourself
++ (NSString *)keyBetweenKey:(NSString *)lowKey andKey:(NSString *)highKey;
+
+// Changing these once you have started enumerating has no effect
+@property (assign, nonatomic) ASIS3ListingPartitionMode partitionMode;
+@property (retain, nonatomic) NSString *partitionDelimiter;
+@property (assign, nonatomic) BOOL shouldReturnObjectsInKeyOrder;
+@property (assign, nonatomic) NSInteger maxConcurrentRequests;
+@property (assign, nonatomic) int numberOfTimesToRetryPage;
+
+@property (assign, readonly) NSInteger concurrency;
+@property (assign, readonly) NSUInteger partitionCount;
+@property (assign, readonly) NSUInteger pageCount;
+@property (retain, readonly) NSError *error;
+@end
@@ -0,0 +1,485 @@
+//
+//  ASIS3PartitionedBucketEnumerator.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIS3PartitionedBucketEnumerator.h"
+#import "ASIS3BucketRequest.h"
+#import "ASIS3BucketObject.h"
+#import "ASINetworkQueue.h"
+
+// S3 keys can't be longer than this many bytes, so there's no point making a longer key to split a partition
+static const NSUInteger ASIS3MaximumKeyLength = 1024;
+
+// S3 lists keys in order of their UTF-8 bytes
+static NSInteger ASIS3CompareKeys(NSString *key1, NSString *key2)
+{
+	int result = strcmp([key1 UTF8String], [key2 UTF8String]);
+	if (result < 0) {
+		return NSOrderedAscending;
+	} else if (result > 0) {
+		return NSOrderedDescending;
+	}
+	return NSOrderedSame;
+}
+
+static NSInteger ASIS3CompareListingEntries(id entry1, id entry2, void *context)
+{
+	NSString *key1 = ([entry1 isKindOfClass:[NSString class]] ? entry1 : [entry1 key]);
+	NSString *key2 = ([entry2 isKindOfClass:[NSString class]] ? entry2 : [entry2 key]);
+	return ASIS3CompareKeys(key1, key2);
+}
+
+// A range of keys that are listed one page at a time
+// Covers keys that start with prefix, that sort after marker (if there is one), up to and including endKey (if there is one)
+@interface ASIS3ListingPartition : NSObject {
+	NSString *prefix;
+	NSString *marker;
+	NSString *endKey;
+
+	// When YES, this partition lists the rest of the bucket with a delimiter to find more partitions, rather than listing objects
+	BOOL isDiscovery;
+
+	// Objects that haven't been returned yet
+	NSMutableArray *objects;
+
+	// The request for the next page, while it is running
+	ASIS3BucketRequest *request;
+
+	BOOL isComplete;
+	NSUInteger pageCount;
+	int failureCount;
+}
+@property (retain, nonatomic) NSString *prefix;
+@property (retain, nonatomic) NSString *marker;
+@property (retain, nonatomic) NSString *endKey;
+@property (assign, nonatomic) BOOL isDiscovery;
+@property (retain, nonatomic) NSMutableArray *objects;
+@property (retain, nonatomic) ASIS3BucketRequest *request;
+@property (assign, nonatomic) BOOL isComplete;
+@property (assign, nonatomic) NSUInteger pageCount;
+@property (assign, nonatomic) int failureCount;
+@end
+
+@implementation ASIS3ListingPartition
+
+- (id)init
+{
+	self = [super init];
+	[self setObjects:[NSMutableArray array]];
+	return self;
+}
+
+- (void)dealloc
+{
+	[prefix release];
+	[marker release];
+	[endKey release];
+	[objects release];
+	[request release];
+	[super dealloc];
+}
+
+@synthesize prefix;
+@synthesize marker;
+@synthesize endKey;
+@synthesize isDiscovery;
+@synthesize objects;
+@synthesize request;
+@synthesize isComplete;
+@synthesize pageCount;
+@synthesize failureCount;
+@end
+
+
+// Private stuff
+@interface ASIS3PartitionedBucketEnumerator ()
+- (void)startRequests;
+- (BOOL)splitPartition;
+- (void)startRequestForPartition:(ASIS3ListingPartition *)partition;
+- (void)finishRequests;
+- (void)requestFinished:(ASIS3BucketRequest *)request;
+- (void)addPartitionsFromDiscoveryRequest:(ASIS3BucketRequest *)request forPartition:(ASIS3ListingPartition *)partition;
+- (ASIS3ListingPartition *)addPartitionWithPrefix:(NSString *)prefix atIndex:(NSUInteger)index;
+
+@property (retain, nonatomic) ASIS3BucketRequest *templateRequest;
+@property (assign) NSInteger concurrency;
+@property (retain, nonatomic) NSMutableArray *partitions;
+@property (retain, nonatomic) NSMutableArray *runningRequests;
+@property (retain, nonatomic) ASINetworkQueue *queue;
+@property (assign) NSUInteger partitionCount;
+@property (assign) NSUInteger pageCount;
+@property (retain) NSError *error;
+@end
+
+@implementation ASIS3PartitionedBucketEnumerator
+
++ (id)enumeratorWithRequest:(ASIS3BucketRequest *)request
+{
+	return [[[self alloc] initWithRequest:request] autorelease];
+}
+
+- (id)initWithRequest:(ASIS3BucketRequest *)request
+{
+	self = [super init];
+	[self setTemplateRequest:[[request copy] autorelease]];
+	[self setPartitionDelimiter:@"/"];
+	[self setShouldReturnObjectsInKeyOrder:YES];
+	[self setMaxConcurrentRequests:16];
+	[self setNumberOfTimesToRetryPage:3];
+	return self;
+}
+
+- (void)dealloc
+{
+	for (ASIHTTPRequest *request in runningRequests) {
+		[request clearDelegatesAndCancel];
+	}
+	[queue reset];
+	[queue release];
+	[runningRequests release];
+	[partitions release];
+	[templateRequest release];
+	[partitionDelimiter release];
+	[error release];
+	[super dealloc];
+}
+
+- (id)nextObject
+{
+	// Start with a single partition covering the whole listing
+	if (![self partitions]) {
+		if ([self maxConcurrentRequests] < 1) {
+			[self setMaxConcurrentRequests:1];
+		}
+		[self setConcurrency:([self maxConcurrentRequests] < 2 ? [self maxConcurrentRequests] : 2)];
+		[self setPartitions:[NSMutableArray array]];
+		[self setRunningRequests:[NSMutableArray array]];
+		[self setQueue:[ASINetworkQueue queue]];
+		[[self queue] setMaxConcurrentOperationCount:[self maxConcurrentRequests]];
+		[[self queue] setShouldCancelAllRequestsOnFailure:NO];
+		[[self queue] go];
+		ASIS3ListingPartition *partition = [self addPartitionWithPrefix:[[self templateRequest] prefix] atIndex:0];
+		[partition setMarker:[[self templateRequest] marker]];
+		[partition setIsDiscovery:([self partitionMode] == ASIS3ListingPartitionByDelimiter)];
+	}
+
+	while (![self error]) {
+		[self finishRequests];
+		if ([self error]) {
+			break;
+		}
+
+		NSUInteger i = 0;
+		while (i < [[self partitions] count]) {
+			ASIS3ListingPartition *partition = [[self partitions] objectAtIndex:i];
+			if ([[partition objects] count]) {
+				id object = [[[[partition objects] objectAtIndex:0] retain] autorelease];
+				[[partition objects] removeObjectAtIndex:0];
+				[self startRequests];
+				return object;
+			}
+			if ([partition isComplete]) {
+				[[self partitions] removeObjectAtIndex:i];
+				continue;
+			}
+			// Objects from later partitions have to wait until we've returned everything from this one
+			if ([self shouldReturnObjectsInKeyOrder]) {
+				break;
+			}
+			i++;
+		}
+		if (![[self partitions] count]) {
+			return nil;
+		}
+		[self startRequests];
+
+		// Wait for the page we need next, or when order doesn't matter, for the oldest request
+		ASIS3BucketRequest *request = nil;
+		if ([self shouldReturnObjectsInKeyOrder]) {
+			request = [[[self partitions] objectAtIndex:0] request];
+		}
+		if (!request && [[self runningRequests] count]) {
+			request = [[self runningRequests] objectAtIndex:0];
+		}
+		[request waitUntilFinished];
+	}
+	return nil;
+}
+
+// Starts requests for partitions that need one, until we are running as many as we're allowed
+// Earlier partitions get requests first, so the objects we need to return next are fetched first
+- (void)startRequests
+{
+	NSUInteger pageSize = ([[self templateRequest] maxResultCount] > 0 ? (NSUInteger)[[self templateRequest] maxResultCount] : 1000);
+	while ((NSInteger)[[self runningRequests] count] < [self concurrency]) {
+		ASIS3ListingPartition *nextPartition = nil;
+		for (ASIS3ListingPartition *partition in [self partitions]) {
+			if (![partition isComplete] && ![partition request] && [[partition objects] count] < pageSize*2) {
+				nextPartition = partition;
+				break;
+			}
+		}
+		if (!nextPartition) {
+			if (![self splitPartition]) {
+				break;
+			}
+			continue;
+		}
+		[self startRequestForPartition:nextPartition];
+	}
+}
+
+// Splits the remaining keys in the partition that has returned the most pages, so we can use a spare connection
+// We only split when every partition that isn't finished is waiting for a page - when some partitions are waiting for us to return objects instead, more connections won't help
+// Partitions that haven't returned a page yet may be nearly empty, so we don't split them
+- (BOOL)splitPartition
+{
+	ASIS3ListingPartition *biggestPartition = nil;
+	for (ASIS3ListingPartition *partition in [self partitions]) {
+		if ([partition isComplete]) {
+			continue;
+		}
+		if (![partition request]) {
+			return NO;
+		}
+		if (![partition isDiscovery] && [partition pageCount] && (!biggestPartition || [partition pageCount] > [biggestPartition pageCount])) {
+			biggestPartition = partition;
+		}
+	}
+	if (!biggestPartition) {
+		return NO;
+	}
+
+	// Keys are split on the part after the partition's prefix, otherwise we might split at a key that doesn't have the prefix
+	NSString *prefix = ([biggestPartition prefix] ? [biggestPartition prefix] : @"");
+	NSString *low = ([[biggestPartition marker] hasPrefix:prefix] ? [[biggestPartition marker] substringFromIndex:[prefix length]] : @"");
+	NSString *high = [[biggestPartition endKey] substringFromIndex:[prefix length]];
+	NSString *splitKey = [[self class] keyBetweenKey:low andKey:high];
+	if (!splitKey) {
+		return NO;
+	}
+	splitKey = [prefix stringByAppendingString:splitKey];
+
+	// The new partition takes the keys after splitKey, any of them returned by the request that is still running for the old one will be ignored
+	ASIS3ListingPartition *newPartition = [self addPartitionWithPrefix:[biggestPartition prefix] atIndex:[[self partitions] indexOfObjectIdenticalTo:biggestPartition]+1];
+	[newPartition setMarker:splitKey];
+	[newPartition setEndKey:[biggestPartition endKey]];
+	[biggestPartition setEndKey:splitKey];
+	return YES;
+}
+
+- (ASIS3ListingPartition *)addPartitionWithPrefix:(NSString *)prefix atIndex:(NSUInteger)index
+{
+	ASIS3ListingPartition *partition = [[[ASIS3ListingPartition alloc] init] autorelease];
+	[partition setPrefix:prefix];
+	[[self partitions] insertObject:partition atIndex:index];
+	[self setPartitionCount:[self partitionCount]+1];
+	return partition;
+}
+
+- (void)startRequestForPartition:(ASIS3ListingPartition *)partition
+{
+	ASIS3BucketRequest *request = [[[self templateRequest] copy] autorelease];
+	[request setDelegate:nil];
+	[request setPrefix:[partition prefix]];
+	[request setMarker:[partition marker]];
+	[request setDelimiter:([partition isDiscovery] ? [self partitionDelimiter] : nil)];
+	// The template may already have built a URL, which would be for the wrong page
+	[request setURL:nil];
+	[partition setRequest:request];
+	[[self runningRequests] addObject:request];
+	[[self queue] addOperation:request];
+}
+
+// Deals with any requests that have finished, without waiting for the others
+- (void)finishRequests
+{
+	NSUInteger i = 0;
+	while (i < [[self runningRequests] count] && ![self error]) {
+		ASIS3BucketRequest *request = [[self runningRequests] objectAtIndex:i];
+		if ([request isFinished]) {
+			[[request retain] autorelease];
+			[[self runningRequests] removeObjectAtIndex:i];
+			[self requestFinished:request];
+		} else {
+			i++;
+		}
+	}
+}
+
+- (void)requestFinished:(ASIS3BucketRequest *)request
+{
+	ASIS3ListingPartition *partition = nil;
+	for (ASIS3ListingPartition *aPartition in [self partitions]) {
+		if ([aPartition request] == request) {
+			partition = aPartition;
+			break;
+		}
+	}
+	[partition setRequest:nil];
+
+	if ([request error]) {
+		// Back off when S3 is struggling, and try again
+		// ASIS3ResponseErrorType has the same code as ASIRequestTimedOutErrorType, so we only look at the error code when we got no response at all
+		// Other S3 errors (eg AccessDenied or NoSuchBucket) would just fail again
+		int status = [request responseStatusCode];
+		NSInteger code = [[request error] code];
+		BOOL connectionProblem = (status == 0 && [[[request error] domain] isEqualToString:NetworkRequestErrorDomain] && (code == ASIRequestTimedOutErrorType || code == ASIConnectionFailureErrorType));
+		BOOL shouldRetry = (status >= 500 || connectionProblem);
+		if (shouldRetry && [partition failureCount] < [self numberOfTimesToRetryPage]) {
+			[partition setFailureCount:[partition failureCount]+1];
+			[self setConcurrency:([self concurrency] > 1 ? [self concurrency]/2 : 1)];
+			return;
+		}
+		[self setError:[request error]];
+		for (ASIHTTPRequest *runningRequest in [self runningRequests]) {
+			[runningRequest clearDelegatesAndCancel];
+		}
+		[self setRunningRequests:[NSMutableArray array]];
+		return;
+	}
+
+	[self setPageCount:[self pageCount]+1];
+	[partition setPageCount:[partition pageCount]+1];
+	[partition setFailureCount:0];
+	if ([self concurrency] < [self maxConcurrentRequests]) {
+		[self setConcurrency:[self concurrency]+1];
+	}
+
+	if ([partition isDiscovery]) {
+		[self addPartitionsFromDiscoveryRequest:request forPartition:partition];
+		return;
+	}
+
+	NSString *lastKey = nil;
+	BOOL passedEndKey = NO;
+	for (ASIS3BucketObject *object in [request objects]) {
+		if ([partition endKey] && ASIS3CompareKeys([object key], [partition endKey]) == NSOrderedDescending) {
+			passedEndKey = YES;
+			break;
+		}
+		[[partition objects] addObject:object];
+		lastKey = [object key];
+	}
+	if (passedEndKey || ![request isTruncated] || !lastKey || [lastKey isEqualToString:[partition endKey]]) {
+		[partition setIsComplete:YES];
+	} else {
+		[partition setMarker:lastKey];
+	}
+}
+
+// Replaces a discovery partition with a partition for each of the common prefixes it found
+// Objects that aren't under a common prefix go in partitions of their own, that are already complete
+- (void)addPartitionsFromDiscoveryRequest:(ASIS3BucketRequest *)request forPartition:(ASIS3ListingPartition *)partition
+{
+	NSMutableArray *entries = [NSMutableArray arrayWithArray:[request objects]];
+	[entries addObjectsFromArray:[request commonPrefixes]];
+	[entries sortUsingFunction:ASIS3CompareListingEntries context:NULL];
+
+	NSUInteger index = [[self partitions] indexOfObjectIdenticalTo:partition];
+	ASIS3ListingPartition *objectPartition = nil;
+	for (id entry in entries) {
+		if ([entry isKindOfClass:[NSString class]]) {
+			[self addPartitionWithPrefix:entry atIndex:index++];
+			objectPartition = nil;
+		} else {
+			if (!objectPartition) {
+				objectPartition = [self addPartitionWithPrefix:[partition prefix] atIndex:index++];
+				[objectPartition setIsComplete:YES];
+			}
+			[[objectPartition objects] addObject:entry];
+		}
+	}
+
+	// The discovery partition stays after the partitions it found, to find the rest
+	id lastEntry = [entries lastObject];
+	NSString *nextMarker = [request nextMarker];
+	if (!nextMarker) {
+		nextMarker = ([lastEntry isKindOfClass:[NSString class]] ? lastEntry : [lastEntry key]);
+	}
+	if ([request isTruncated] && nextMarker) {
+		[partition setMarker:nextMarker];
+	} else {
+		[partition setIsComplete:YES];
+	}
+}
+
++ (NSString *)keyBetweenKey:(NSString *)lowKey andKey:(NSString *)highKey
+{
+	// Work with code points, which sort in the same order as UTF-8 bytes
+	NSData *lowData = [lowKey dataUsingEncoding:NSUTF32LittleEndianStringEncoding];
+	NSData *highData = [highKey dataUsingEncoding:NSUTF32LittleEndianStringEncoding];
+	const uint32_t *lowCharacters = [lowData bytes];
+	const uint32_t *highCharacters = [highData bytes];
+	NSUInteger lowLength = [lowData length]/sizeof(uint32_t);
+	NSUInteger highLength = [highData length]/sizeof(uint32_t);
+	BOOL isBounded = (highKey != nil);
+
+	NSMutableData *key = [NSMutableData data];
+	NSUInteger i;
+	for (i=0; i<ASIS3MaximumKeyLength; i++) {
+		// -1 means we've run out of lowKey, so any character will do
+		int64_t a = (i < lowLength ? (int64_t)CFSwapInt32LittleToHost(lowCharacters[i]) : -1);
+		// We try not to make keys with control characters in them
+		int64_t lowerLimit = (a > 0x1F ? a : 0x1F);
+		uint32_t character;
+		if (isBounded) {
+			if (i >= highLength) {
+				return nil;
+			}
+			int64_t b = CFSwapInt32LittleToHost(highCharacters[i]);
+			if (b < a) {
+				return nil;
+			}
+			if (b > lowerLimit+1) {
+				int64_t middle = lowerLimit+(b-lowerLimit)/2;
+				// Avoid the code points reserved for UTF-16 surrogates, which can't be encoded
+				if (middle >= 0xD800 && middle <= 0xDFFF) {
+					middle = (a < 0xD7FF ? 0xD7FF : 0xE000);
+				}
+				if (middle > a && middle < b) {
+					character = CFSwapInt32HostToLittle((uint32_t)middle);
+					[key appendBytes:&character length:sizeof(uint32_t)];
+					break;
+				}
+			}
+			if (a < 0) {
+				return nil;
+			}
+			// Anything that starts with this character sorts before highKey, so from here on we only need to stay after lowKey
+			if (b != a) {
+				isBounded = NO;
+			}
+		} else if (lowerLimit <= 0x7D) {
+			// Pick something in the middle of the printable ASCII characters
+			character = CFSwapInt32HostToLittle((uint32_t)(lowerLimit+(0x7F-lowerLimit)/2));
+			[key appendBytes:&character length:sizeof(uint32_t)];
+			break;
+		}
+		character = CFSwapInt32HostToLittle((uint32_t)a);
+		[key appendBytes:&character length:sizeof(uint32_t)];
+	}
+	if (i == ASIS3MaximumKeyLength) {
+		return nil;
+	}
+	return [[[NSString alloc] initWithData:key encoding:NSUTF32LittleEndianStringEncoding] autorelease];
+}
+
+@synthesize templateRequest;
+@synthesize partitionMode;
+@synthesize partitionDelimiter;
+@synthesize shouldReturnObjectsInKeyOrder;
+@synthesize maxConcurrentRequests;
+@synthesize numberOfTimesToRetryPage;
+@synthesize concurrency;
+@synthesize partitions;
+@synthesize runningRequests;
+@synthesize queue;
+@synthesize partitionCount;
+@synthesize pageCount;
+@synthesize error;
+@end
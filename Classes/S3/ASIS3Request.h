@@ -15,6 +15,8 @@
 #import "ASINSXMLParserCompat.h"
 #endif
 
+@class ASIXMLPushParser;
+
 // See http://docs.amazonwebservices.com/AmazonS3/2006-03-01/index.html?RESTAccessPolicy.html for what these mean
 extern NSString *const ASIS3AccessPolicyPrivate; // This is the default in S3 when no access policy header is provided
 extern NSString *const ASIS3AccessPolicyPublicRead;
@@ -34,6 +36,14 @@ typedef enum _ASIS3ErrorType {
     ASIS3ResponseErrorType = 2
 } ASIS3ErrorType;
 
+// Constants for signatureVersion
+// See http://docs.aws.amazon.com/AmazonS3/latest/API/sig-v4-authenticating-requests.html for version 4
+typedef enum _ASIS3SignatureVersion {
+	ASIS3SignatureVersionDefault = 0, // Use the shared signature version
+	ASIS3SignatureVersion2 = 2,
+	ASIS3SignatureVersion4 = 4
+} ASIS3SignatureVersion;
+
 
 
 @interface ASIS3Request : ASIHTTPRequest <NSCopying, NSXMLParserDelegate> {
@@ -53,9 +63,42 @@ typedef enum _ASIS3ErrorType {
 	// The access policy to use when PUTting a file (see the string constants at the top ASIS3Request.h for details on what the possible options are)
 	NSString *accessPolicy;
 
+	// The scheme used to sign the request. When this is ASIS3SignatureVersionDefault, the shared signature version is used (which is ASIS3SignatureVersion2 unless you change it with [ASIS3Request setSharedSignatureVersion:])
+	// Regions opened since 2014 (eg eu-central-1) only accept requests signed with ASIS3SignatureVersion4
+	ASIS3SignatureVersion signatureVersion;
+
+	// The region the bucket is in (eg @"eu-west-1"), only used when signing with ASIS3SignatureVersion4
+	// When this is nil, the shared region is used (@"us-east-1" unless you change it with [ASIS3Request setSharedRegion:])
+	NSString *region;
+
+	// The date the request is signed with, set by setDate:
+	NSDate *signingDate;
+
+	// When YES (the default), bodies streamed from disk are signed one chunk at a time as they are sent when using ASIS3SignatureVersion4
+	// This means uploads can start straight away, and the file is only read once. When NO, the whole file is hashed before the request starts
+	// The body is sent with the aws-chunked content encoding, turn this off if your S3-compatible server doesn't support it
+	BOOL shouldSignRequestBodyInChunks;
+
+	// Internally used when signing the request body in chunks
+	NSData *chunkSigningKey;
+	NSString *chunkStringToSignPrefix;
+	NSString *seedSignature;
+
+	// Internally used to keep the SHA-256 of the request body, which is worked out when the body is built
+	NSString *payloadHash;
+
+	// When YES, successful XML responses are parsed as they arrive, rather than all at once when the request finishes
+	// Subclasses see the same NSXMLParser delegate callbacks either way, though the parser they are passed will be nil
+	// Default is NO, ASIS3BucketRequest turns this on so large listings are parsed while they download
+	BOOL shouldParseResponseAsItArrives;
+
 	// Internally used while parsing errors
-	NSString *currentXMLElementContent;
+	// Text is appended to a single buffer as it is found, reading currentXMLElementContent returns a copy of the text so far
+	NSMutableString *currentXMLElementContent;
 	NSMutableArray *currentXMLElementStack;
+
+	// Internally used when parsing the response as it arrives
+	ASIXMLPushParser *responseParser;
 }
 
 // Uses the supplied date to create a Date header string
@@ -69,6 +112,14 @@ typedef enum _ASIS3ErrorType {
 // Is overridden in ASIS3ObjectRequest
 - (NSString *)stringToSignForHeaders:(NSString *)canonicalizedAmzHeaders resource:(NSString *)canonicalizedResource;
 
+// Returns the Content-Type header to send and sign with requests signed with ASIS3SignatureVersion4, or nil to send none
+// Is overridden in ASIS3ObjectRequest
+- (NSString *)contentTypeForSigning;
+
+// Returns the signature for a chunk of the request body, when the body is being signed in chunks (see shouldSignRequestBodyInChunks)
+// Used by ASIS3ChunkSigningInputStream, you shouldn't need to call this yourself
+- (NSString *)signatureForChunk:(const void *)bytes length:(NSUInteger)length previousSignature:(NSString *)previousSignature;
+
 // Parses the response to work out if S3 returned an error	
 - (void)parseResponseXML;
 
@@ -80,6 +131,12 @@ typedef enum _ASIS3ErrorType {
 + (NSString *)sharedSecretAccessKey;
 + (void)setSharedSecretAccessKey:(NSString *)newAccessKey;
 
+// Get and set the signature version and region used for all requests they haven't been set for
++ (ASIS3SignatureVersion)sharedSignatureVersion;
++ (void)setSharedSignatureVersion:(ASIS3SignatureVersion)newSignatureVersion;
++ (NSString *)sharedRegion;
++ (void)setSharedRegion:(NSString *)newRegion;
+
 # pragma mark helpers
 	
 // Returns a date formatter than can be used to parse a date from S3
@@ -96,6 +153,11 @@ typedef enum _ASIS3ErrorType {
 // Returns a string for the hostname used for S3 requests. You shouldn't ever need to change this.
 + (NSString *)S3Host;
 
+// Use to send requests to an S3-compatible server instead of Amazon (eg a local stand-in for testing)
+// The server must accept virtual-hosted style requests, where the bucket is part of the hostname (eg mybucket.s3.local:9000)
+// Pass nil to go back to using Amazon
++ (void)setS3Host:(NSString *)newHost;
+
 // This is called automatically before the request starts to build the request URL (if one has not been manually set already)
 - (void)buildURL;
 
@@ -106,4 +168,12 @@ typedef enum _ASIS3ErrorType {
 @property (retain) NSString *currentXMLElementContent;
 @property (retain) NSMutableArray *currentXMLElementStack;
 @property (retain) NSString *requestScheme;
+@property (assign) BOOL shouldParseResponseAsItArrives;
+@property (assign) ASIS3SignatureVersion signatureVersion;
+@property (retain) NSString *region;
+@property (retain) NSDate *signingDate;
+@property (assign) BOOL shouldSignRequestBodyInChunks;
+
+// The signature from the Authorization header, which the first chunk of the body is signed with. Nil unless the body is being signed in chunks
+@property (retain, readonly) NSString *seedSignature;
 @end
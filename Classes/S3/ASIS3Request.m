@@ -7,7 +7,11 @@
 //
 
 #import "ASIS3Request.h"
+#import "ASIS3ChunkSigningInputStream.h"
 #import <CommonCrypto/CommonHMAC.h>
+#import <CommonCrypto/CommonDigest.h>
+#import "ASIXMLPushParser.h"
+#import <time.h>
 
 NSString *const ASIS3AccessPolicyPrivate = @"private";
 NSString *const ASIS3AccessPolicyPublicRead = @"public-read";
@@ -21,26 +25,132 @@ NSString *const ASIS3RequestSchemeHTTPS = @"https";
 
 static NSString *sharedAccessKey = nil;
 static NSString *sharedSecretAccessKey = nil;
+static NSString *S3Host = nil;
+static ASIS3SignatureVersion sharedSignatureVersion = ASIS3SignatureVersion2;
+static NSString *sharedRegion = nil;
+
+// Signing keys for signature version 4 are derived from the secret access key, the date, and the region
+// They only change once a day, so we keep them around rather than running four HMACs for every request
+// The cache is keyed on region and secret access key, and is emptied whenever a request is signed with a different date
+static NSMutableDictionary *signingKeyCache = nil;
+static NSString *signingKeyCacheDateStamp = nil;
+static NSLock *signingKeyCacheLock = nil;
+
+static const char *ASIS3DayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char *ASIS3MonthNames[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// SHA-256 of an empty request body
+static NSString *const ASIS3EmptyPayloadHash = @"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+
+// ASIHTTPRequest methods we need to hash compressed request bodies
+@interface ASIHTTPRequest (ASIS3Request)
+- (NSData *)compressedPostBody;
+- (NSString *)compressedPostBodyFilePath;
+@end
 
 // Private stuff
 @interface ASIS3Request ()
 	+ (NSData *)HMACSHA1withKey:(NSString *)key forString:(NSString *)string;
+	+ (NSData *)signingKeyForSecretAccessKey:(NSString *)secret dateStamp:(NSString *)dateStamp region:(NSString *)region;
+	- (void)buildSignatureVersion2Headers;
+	- (void)buildSignatureVersion4Headers;
+	- (NSString *)payloadHashForSigning;
+	- (BOOL)canSignRequestBodyInChunks;
+	- (BOOL)usesSignatureVersion4;
+	@property (retain, nonatomic) NSData *chunkSigningKey;
+	@property (retain, nonatomic) NSString *chunkStringToSignPrefix;
+	@property (retain) NSString *seedSignature;
+	@property (retain) NSString *payloadHash;
+	@property (retain, nonatomic) ASIXMLPushParser *responseParser;
+	- (void)finishParsingResponse;
 @end
 
+// Appends the hex representation of some bytes (eg a digest) to a string
+static void ASIS3AppendHexString(NSMutableString *string, const unsigned char *bytes, size_t length)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+	char *hex = malloc(length*2+1);
+	size_t i;
+	for (i=0; i<length; i++) {
+		hex[i*2] = hexDigits[bytes[i] >> 4];
+		hex[i*2+1] = hexDigits[bytes[i] & 0x0F];
+	}
+	hex[length*2] = '\0';
+	CFStringAppendCString((CFMutableStringRef)string, hex, kCFStringEncodingASCII);
+	free(hex);
+}
+
+// Appends a string to a canonical request, URI-encoded the way signature version 4 expects
+// Everything apart from unreserved characters is percent-encoded, '/' is left alone when encodeSlash is NO (for paths)
+static void ASIS3AppendURIEncodedString(NSMutableString *string, NSString *unencodedString, BOOL encodeSlash)
+{
+	static const char hexDigits[] = "0123456789ABCDEF";
+	const unsigned char *bytes = (const unsigned char *)[unencodedString UTF8String];
+	if (!bytes) {
+		return;
+	}
+	size_t length = strlen((const char *)bytes);
+	char *encoded = malloc(length*3+1);
+	size_t i, j = 0;
+	for (i=0; i<length; i++) {
+		unsigned char c = bytes[i];
+		if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' || c == '~' || (c == '/' && !encodeSlash)) {
+			encoded[j++] = (char)c;
+		} else {
+			encoded[j++] = '%';
+			encoded[j++] = hexDigits[c >> 4];
+			encoded[j++] = hexDigits[c & 0x0F];
+		}
+	}
+	encoded[j] = '\0';
+	CFStringAppendCString((CFMutableStringRef)string, encoded, kCFStringEncodingASCII);
+	free(encoded);
+}
+
+// Removes percent-escapes from part of a url, so it can be encoded again in canonical form
+static NSString *ASIS3StringByRemovingPercentEscapes(NSString *string)
+{
+	NSString *unescapedString = [(NSString *)CFURLCreateStringByReplacingPercentEscapesUsingEncoding(kCFAllocatorDefault, (CFStringRef)string, CFSTR(""), kCFStringEncodingUTF8) autorelease];
+	if (!unescapedString) {
+		return string;
+	}
+	return unescapedString;
+}
+
+// Sorts [name, value] pairs from the query string by name, then value
+static NSInteger ASIS3CompareQueryParameters(id parameter1, id parameter2, void *context)
+{
+	NSComparisonResult result = [[parameter1 objectAtIndex:0] compare:[parameter2 objectAtIndex:0] options:NSLiteralSearch];
+	if (result == NSOrderedSame) {
+		result = [[parameter1 objectAtIndex:1] compare:[parameter2 objectAtIndex:1] options:NSLiteralSearch];
+	}
+	return result;
+}
+
 @implementation ASIS3Request
 
++ (void)initialize
+{
+	if (self == [ASIS3Request class]) {
+		signingKeyCache = [[NSMutableDictionary alloc] init];
+		signingKeyCacheLock = [[NSLock alloc] init];
+	}
+}
+
 - (id)initWithURL:(NSURL *)newURL
 {
 	self = [super initWithURL:newURL];
 	// After a bit of experimentation/guesswork, this number seems to reduce the chance of a 'RequestTimeout' error
 	[self setPersistentConnectionTimeoutSeconds:20];
 	[self setRequestScheme:ASIS3RequestSchemeHTTP];
+	[self setShouldSignRequestBodyInChunks:YES];
 	return self;
 }
 
 
 - (void)dealloc
 {
+	[responseParser release];
 	[currentXMLElementContent release];
 	[currentXMLElementStack release];
 	[dateString release];
@@ -48,13 +158,26 @@ static NSString *sharedSecretAccessKey = nil;
 	[secretAccessKey release];
 	[accessPolicy release];
 	[requestScheme release];
+	[region release];
+	[signingDate release];
+	[chunkSigningKey release];
+	[chunkStringToSignPrefix release];
+	[seedSignature release];
+	[payloadHash release];
 	[super dealloc];
 }
 
 
+// Formatted by hand, because looking up an NSDateFormatter and using it for every request is surprisingly expensive
 - (void)setDate:(NSDate *)date
 {
-	[self setDateString:[[ASIS3Request S3RequestDateFormatter] stringFromDate:date]];	
+	[self setSigningDate:date];
+	time_t seconds = (time_t)floor([date timeIntervalSince1970]);
+	struct tm components;
+	gmtime_r(&seconds, &components);
+	char formattedDate[40];
+	snprintf(formattedDate, sizeof(formattedDate), "%s, %d %s %04d %02d:%02d:%02d +0000", ASIS3DayNames[components.tm_wday], components.tm_mday, ASIS3MonthNames[components.tm_mon], components.tm_year+1900, components.tm_hour, components.tm_min, components.tm_sec);
+	[self setDateString:[NSString stringWithUTF8String:formattedDate]];
 }
 
 - (ASIHTTPRequest *)HEADRequest
@@ -62,6 +185,8 @@ static NSString *sharedSecretAccessKey = nil;
 	ASIS3Request *headRequest = (ASIS3Request *)[super HEADRequest];
 	[headRequest setAccessKey:[self accessKey]];
 	[headRequest setSecretAccessKey:[self secretAccessKey]];
+	[headRequest setSignatureVersion:[self signatureVersion]];
+	[headRequest setRegion:[self region]];
 	return headRequest;
 }
 
@@ -92,6 +217,11 @@ static NSString *sharedSecretAccessKey = nil;
 	return [NSString stringWithFormat:@"%@\n\n\n%@\n%@%@",[self requestMethod],[self dateString],canonicalizedAmzHeaders,canonicalizedResource];
 }
 
+- (NSString *)contentTypeForSigning
+{
+	return nil;
+}
+
 - (void)buildRequestHeaders
 {
 	if (![self url]) {
@@ -106,6 +236,37 @@ static NSString *sharedSecretAccessKey = nil;
 	if (![self secretAccessKey]) {
 		[self setSecretAccessKey:[ASIS3Request sharedSecretAccessKey]];
 	}
+	if ([self usesSignatureVersion4]) {
+		[self buildSignatureVersion4Headers];
+	} else {
+		[self buildSignatureVersion2Headers];
+	}
+}
+
+- (BOOL)usesSignatureVersion4
+{
+	ASIS3SignatureVersion version = [self signatureVersion];
+	if (version == ASIS3SignatureVersionDefault) {
+		version = [ASIS3Request sharedSignatureVersion];
+	}
+	return (version == ASIS3SignatureVersion4);
+}
+
+// Signature version 4 needs a hash of the body, so we work it out as soon as the body has been built
+// This happens before the request takes its lock to build the headers, so cancelling a request doesn't have to wait while a large file is read
+- (void)buildPostBody
+{
+	if ([self haveBuiltPostBody]) {
+		return;
+	}
+	[super buildPostBody];
+	if ([self haveBuiltPostBody] && [self usesSignatureVersion4] && ![self canSignRequestBodyInChunks]) {
+		[self setPayloadHash:[self payloadHashForSigning]];
+	}
+}
+
+- (void)buildSignatureVersion2Headers
+{
 	// If a date string hasn't been set, we'll create one from the current time
 	if (![self dateString]) {
 		[self setDate:[NSDate date]];
@@ -116,10 +277,19 @@ static NSString *sharedSecretAccessKey = nil;
 	NSString *canonicalizedResource = [self canonicalizedResource];
 	
 	// Add a header for the access policy if one was set, otherwise we won't add one (and S3 will default to private)
+	// The amz headers must be signed in order of their (lowercase) names
 	NSMutableDictionary *amzHeaders = [self S3Headers];
-	NSString *canonicalizedAmzHeaders = @"";
-	for (NSString *header in [amzHeaders keysSortedByValueUsingSelector:@selector(compare:)]) {
-		canonicalizedAmzHeaders = [NSString stringWithFormat:@"%@%@:%@\n",canonicalizedAmzHeaders,[header lowercaseString],[amzHeaders objectForKey:header]];
+	NSMutableDictionary *lowercaseNames = [NSMutableDictionary dictionaryWithCapacity:[amzHeaders count]];
+	for (NSString *header in amzHeaders) {
+		[lowercaseNames setObject:header forKey:[header lowercaseString]];
+	}
+	NSMutableString *canonicalizedAmzHeaders = [NSMutableString string];
+	for (NSString *lowercaseName in [[lowercaseNames allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+		NSString *header = [lowercaseNames objectForKey:lowercaseName];
+		[canonicalizedAmzHeaders appendString:lowercaseName];
+		[canonicalizedAmzHeaders appendString:@":"];
+		[canonicalizedAmzHeaders appendString:[amzHeaders objectForKey:header]];
+		[canonicalizedAmzHeaders appendString:@"\n"];
 		[self addRequestHeader:header value:[amzHeaders objectForKey:header]];
 	}
 	
@@ -128,13 +298,249 @@ static NSString *sharedSecretAccessKey = nil;
 	NSString *signature = [ASIHTTPRequest base64forData:[ASIS3Request HMACSHA1withKey:[self secretAccessKey] forString:stringToSign]];
 	NSString *authorizationString = [NSString stringWithFormat:@"AWS %@:%@",[self accessKey],signature];
 	[self addRequestHeader:@"Authorization" value:authorizationString];
-	
-	
+}
+
+// See http://docs.aws.amazon.com/general/latest/gr/sigv4-create-canonical-request.html
+- (void)buildSignatureVersion4Headers
+{
+	if (![self signingDate]) {
+		[self setDate:[NSDate date]];
+	}
+	time_t seconds = (time_t)floor([[self signingDate] timeIntervalSince1970]);
+	struct tm components;
+	gmtime_r(&seconds, &components);
+	char formattedDate[20];
+	snprintf(formattedDate, sizeof(formattedDate), "%04d%02d%02dT%02d%02d%02dZ", components.tm_year+1900, components.tm_mon+1, components.tm_mday, components.tm_hour, components.tm_min, components.tm_sec);
+	NSString *amzDate = [NSString stringWithUTF8String:formattedDate];
+	NSString *dateStamp = [amzDate substringToIndex:8];
+
+	NSString *signingRegion = [self region];
+	if (!signingRegion) {
+		signingRegion = [ASIS3Request sharedRegion];
+	}
+
+	[self addRequestHeader:@"x-amz-date" value:amzDate];
+
+	// When signing the body in chunks, the Content-Length we send includes the chunk headers, and S3 needs to be told the size of the file separately
+	BOOL signInChunks = [self canSignRequestBodyInChunks];
+	if (signInChunks) {
+		unsigned long long decodedLength = [self postBodyFileLength];
+		if (!decodedLength) {
+			decodedLength = [[[[[NSFileManager alloc] init] autorelease] attributesOfItemAtPath:[self postBodyFilePath] error:NULL] fileSize];
+		}
+		[self setPostLength:[ASIS3ChunkSigningInputStream encodedLengthForLength:decodedLength]];
+		[self addRequestHeader:@"Content-Encoding" value:@"aws-chunked"];
+		[self addRequestHeader:@"Content-Length" value:[NSString stringWithFormat:@"%llu",[self postLength]]];
+		[self addRequestHeader:@"x-amz-decoded-content-length" value:[NSString stringWithFormat:@"%llu",decodedLength]];
+		[self addRequestHeader:@"x-amz-content-sha256" value:@"STREAMING-AWS4-HMAC-SHA256-PAYLOAD"];
+	} else {
+		// A redirect may have turned this into a GET with no body since we hashed it
+		NSString *hash = [self payloadHash];
+		if ([self haveBuiltPostBody] && ![self postLength]) {
+			hash = ASIS3EmptyPayloadHash;
+		} else if (!hash) {
+			hash = [self payloadHashForSigning];
+		}
+		[self addRequestHeader:@"x-amz-content-sha256" value:hash];
+	}
+	NSMutableDictionary *amzHeaders = [self S3Headers];
+	for (NSString *header in amzHeaders) {
+		[self addRequestHeader:header value:[amzHeaders objectForKey:header]];
+	}
+	if ([self contentTypeForSigning]) {
+		[self addRequestHeader:@"Content-Type" value:[self contentTypeForSigning]];
+	}
+
+	// We sign the host, any x-amz- headers, and the standard headers that describe the body
+	NSURL *requestURL = [self url];
+	NSMutableDictionary *headersToSign = [NSMutableDictionary dictionary];
+	NSString *host = [requestURL host];
+	if ([requestURL port]) {
+		host = [NSString stringWithFormat:@"%@:%@",host,[requestURL port]];
+	}
+	[headersToSign setObject:host forKey:@"host"];
+	for (NSString *header in [self requestHeaders]) {
+		NSString *name = [header lowercaseString];
+		if ([name hasPrefix:@"x-amz-"] || [name isEqualToString:@"content-type"] || [name isEqualToString:@"content-md5"] || [name isEqualToString:@"content-encoding"] || [name isEqualToString:@"content-length"] || [name isEqualToString:@"range"]) {
+			[headersToSign setObject:[[[self requestHeaders] objectForKey:header] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] forKey:name];
+		}
+	}
+	NSArray *signedHeaderNames = [[headersToSign allKeys] sortedArrayUsingSelector:@selector(compare:)];
+	NSString *signedHeaders = [signedHeaderNames componentsJoinedByString:@";"];
+
+	// The whole canonical request is built up in a single buffer
+	NSMutableString *canonicalRequest = [NSMutableString stringWithCapacity:512];
+	[canonicalRequest appendString:[self requestMethod]];
+	[canonicalRequest appendString:@"\n"];
+
+	// CFURLCopyPath gives us the path without removing escapes, and with any trailing slash intact
+	NSString *path = [(NSString *)CFURLCopyPath((CFURLRef)requestURL) autorelease];
+	if (![path length]) {
+		path = @"/";
+	}
+	ASIS3AppendURIEncodedString(canonicalRequest, ASIS3StringByRemovingPercentEscapes(path), NO);
+	[canonicalRequest appendString:@"\n"];
+
+	NSString *query = [(NSString *)CFURLCopyQueryString((CFURLRef)requestURL, NULL) autorelease];
+	NSMutableArray *parameters = [NSMutableArray array];
+	for (NSString *parameter in [query componentsSeparatedByString:@"&"]) {
+		if (![parameter length]) {
+			continue;
+		}
+		NSRange separator = [parameter rangeOfString:@"="];
+		if (separator.location == NSNotFound) {
+			[parameters addObject:[NSArray arrayWithObjects:ASIS3StringByRemovingPercentEscapes(parameter),@"",nil]];
+		} else {
+			[parameters addObject:[NSArray arrayWithObjects:ASIS3StringByRemovingPercentEscapes([parameter substringToIndex:separator.location]),ASIS3StringByRemovingPercentEscapes([parameter substringFromIndex:separator.location+1]),nil]];
+		}
+	}
+	BOOL firstParameter = YES;
+	for (NSArray *parameter in [parameters sortedArrayUsingFunction:ASIS3CompareQueryParameters context:NULL]) {
+		if (!firstParameter) {
+			[canonicalRequest appendString:@"&"];
+		}
+		firstParameter = NO;
+		ASIS3AppendURIEncodedString(canonicalRequest, [parameter objectAtIndex:0], YES);
+		[canonicalRequest appendString:@"="];
+		ASIS3AppendURIEncodedString(canonicalRequest, [parameter objectAtIndex:1], YES);
+	}
+	[canonicalRequest appendString:@"\n"];
+
+	for (NSString *name in signedHeaderNames) {
+		[canonicalRequest appendString:name];
+		[canonicalRequest appendString:@":"];
+		[canonicalRequest appendString:[headersToSign objectForKey:name]];
+		[canonicalRequest appendString:@"\n"];
+	}
+	[canonicalRequest appendString:@"\n"];
+	[canonicalRequest appendString:signedHeaders];
+	[canonicalRequest appendString:@"\n"];
+	[canonicalRequest appendString:[[self requestHeaders] objectForKey:@"x-amz-content-sha256"]];
+
+	NSData *canonicalRequestData = [canonicalRequest dataUsingEncoding:NSUTF8StringEncoding];
+	unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+	CC_SHA256([canonicalRequestData bytes], (CC_LONG)[canonicalRequestData length], digest);
+
+	NSString *scope = [NSString stringWithFormat:@"%@/%@/s3/aws4_request",dateStamp,signingRegion];
+	NSMutableString *stringToSign = [NSMutableString stringWithCapacity:160];
+	[stringToSign appendString:@"AWS4-HMAC-SHA256\n"];
+	[stringToSign appendString:amzDate];
+	[stringToSign appendString:@"\n"];
+	[stringToSign appendString:scope];
+	[stringToSign appendString:@"\n"];
+	ASIS3AppendHexString(stringToSign, digest, CC_SHA256_DIGEST_LENGTH);
+
+	NSData *signingKey = [ASIS3Request signingKeyForSecretAccessKey:[self secretAccessKey] dateStamp:dateStamp region:signingRegion];
+	NSData *stringToSignData = [stringToSign dataUsingEncoding:NSUTF8StringEncoding];
+	CCHmac(kCCHmacAlgSHA256, [signingKey bytes], [signingKey length], [stringToSignData bytes], [stringToSignData length], digest);
+
+	NSMutableString *authorizationString = [NSMutableString stringWithCapacity:256];
+	[authorizationString appendFormat:@"AWS4-HMAC-SHA256 Credential=%@/%@, SignedHeaders=%@, Signature=",[self accessKey],scope,signedHeaders];
+	ASIS3AppendHexString(authorizationString, digest, CC_SHA256_DIGEST_LENGTH);
+	[self addRequestHeader:@"Authorization" value:authorizationString];
+
+	// Keep what we need to sign the chunks of the body as they are sent
+	if (signInChunks) {
+		NSMutableString *signature = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH*2];
+		ASIS3AppendHexString(signature, digest, CC_SHA256_DIGEST_LENGTH);
+		[self setSeedSignature:signature];
+		[self setChunkSigningKey:signingKey];
+		[self setChunkStringToSignPrefix:[NSString stringWithFormat:@"AWS4-HMAC-SHA256-PAYLOAD\n%@\n%@\n",amzDate,scope]];
+	} else {
+		[self setSeedSignature:nil];
+		[self setChunkSigningKey:nil];
+		[self setChunkStringToSignPrefix:nil];
+	}
+}
+
+// Only bodies streamed from disk are signed in chunks, small bodies in memory are cheap to hash up front
+- (BOOL)canSignRequestBodyInChunks
+{
+	return ([self shouldSignRequestBodyInChunks] && [self shouldStreamPostDataFromDisk] && [self postBodyFilePath] && ![self shouldCompressRequestBody]);
+}
+
+// See http://docs.aws.amazon.com/AmazonS3/latest/API/sigv4-streaming.html
+- (NSString *)signatureForChunk:(const void *)bytes length:(NSUInteger)length previousSignature:(NSString *)previousSignature
+{
+	unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+	CC_SHA256(bytes, (CC_LONG)length, digest);
+
+	NSMutableString *stringToSign = [NSMutableString stringWithCapacity:256];
+	[stringToSign appendString:[self chunkStringToSignPrefix]];
+	[stringToSign appendString:previousSignature];
+	[stringToSign appendString:@"\n"];
+	[stringToSign appendString:ASIS3EmptyPayloadHash];
+	[stringToSign appendString:@"\n"];
+	ASIS3AppendHexString(stringToSign, digest, CC_SHA256_DIGEST_LENGTH);
+
+	NSData *stringToSignData = [stringToSign dataUsingEncoding:NSUTF8StringEncoding];
+	CCHmac(kCCHmacAlgSHA256, [[self chunkSigningKey] bytes], [[self chunkSigningKey] length], [stringToSignData bytes], [stringToSignData length], digest);
+
+	NSMutableString *signature = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH*2];
+	ASIS3AppendHexString(signature, digest, CC_SHA256_DIGEST_LENGTH);
+	return signature;
+}
+
+- (Class)postBodyReadStreamClass
+{
+	if ([self seedSignature]) {
+		return [ASIS3ChunkSigningInputStream class];
+	}
+	return [super postBodyReadStreamClass];
+}
+
+// Signature version 4 includes a SHA-256 of the request body
+// When the body is compressed, we hash what we send, so this only works once buildPostBody has created the compressed body
+- (NSString *)payloadHashForSigning
+{
+	BOOL compressed = [self shouldCompressRequestBody];
+	NSString *path = (compressed ? [self compressedPostBodyFilePath] : [self postBodyFilePath]);
+	NSData *body = (compressed ? [self compressedPostBody] : [self postBody]);
+	if (compressed && ![self haveBuiltPostBody]) {
+		return @"UNSIGNED-PAYLOAD";
+	}
+	CC_SHA256_CTX context;
+	CC_SHA256_Init(&context);
+	if (path) {
+		NSFileHandle *fileHandle = [NSFileHandle fileHandleForReadingAtPath:path];
+		if (!fileHandle) {
+			return @"UNSIGNED-PAYLOAD";
+		}
+		// Compressed bodies are made from the whole file
+		unsigned long long bytesRemaining = ULLONG_MAX;
+		if ([self postBodyFileLength] && !compressed) {
+			[fileHandle seekToFileOffset:[self postBodyFileOffset]];
+			bytesRemaining = [self postBodyFileLength];
+		}
+		while (bytesRemaining > 0) {
+			NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+			NSData *chunk = [fileHandle readDataOfLength:(NSUInteger)MIN(bytesRemaining, 1024*1024)];
+			NSUInteger chunkLength = [chunk length];
+			CC_SHA256_Update(&context, [chunk bytes], (CC_LONG)chunkLength);
+			[pool release];
+			if (!chunkLength) {
+				break;
+			}
+			bytesRemaining -= chunkLength;
+		}
+		[fileHandle closeFile];
+	} else if ([body length]) {
+		CC_SHA256_Update(&context, [body bytes], (CC_LONG)[body length]);
+	} else {
+		return ASIS3EmptyPayloadHash;
+	}
+	unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+	CC_SHA256_Final(digest, &context);
+	NSMutableString *hash = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH*2];
+	ASIS3AppendHexString(hash, digest, CC_SHA256_DIGEST_LENGTH);
+	return hash;
 }
 
 - (void)requestFinished
 {
-	if ([[[self responseHeaders] objectForKey:@"Content-Type"] isEqualToString:@"application/xml"]) {
+	if ([self responseParser]) {
+		[self finishParsingResponse];
+	} else if ([[[self responseHeaders] objectForKey:@"Content-Type"] isEqualToString:@"application/xml"]) {
 		[self parseResponseXML];
 	}
 	if (![self error]) {
@@ -160,6 +566,46 @@ static NSString *sharedSecretAccessKey = nil;
 
 }
 
+#pragma mark Parsing the response as it arrives
+
+// A new response means starting again (eg when the request is retried on a new connection)
+- (void)readResponseHeaders
+{
+	[self setResponseParser:nil];
+	[super readResponseHeaders];
+}
+
+// Errors (and anything other than XML) are parsed when the request finishes, as usual
+- (void)didReceiveResponseBytes:(const void *)bytes length:(NSUInteger)length
+{
+	if (![self shouldParseResponseAsItArrives] || [self error]) {
+		return;
+	}
+	if (![self responseParser]) {
+		if ([self responseStatusCode] != 200 || ![[[self responseHeaders] objectForKey:@"Content-Type"] isEqualToString:@"application/xml"]) {
+			return;
+		}
+		[self setCurrentXMLElementStack:[NSMutableArray array]];
+		[self setResponseParser:[ASIXMLPushParser parserForRequest:self delegate:self]];
+		if (![self responseParser]) {
+			return;
+		}
+	}
+	NSError *parseError = [[self responseParser] parseBytes:bytes length:length];
+	if (parseError && ![self error]) {
+		[self parser:nil parseErrorOccurred:parseError];
+	}
+}
+
+- (void)finishParsingResponse
+{
+	NSError *parseError = [[self responseParser] finishParsing];
+	if (parseError && ![self error]) {
+		[self parser:nil parseErrorOccurred:parseError];
+	}
+	[self setResponseParser:nil];
+}
+
 - (void)parser:(NSXMLParser *)parser parseErrorOccurred:(NSError *)parseError
 {
 	[self failWithError:[NSError errorWithDomain:NetworkRequestErrorDomain code:ASIS3ResponseParsingFailedType userInfo:[NSDictionary dictionaryWithObjectsAndKeys:@"Parsing the resposnse failed",NSLocalizedDescriptionKey,parseError,NSUnderlyingErrorKey,nil]]];
@@ -189,7 +635,24 @@ static NSString *sharedSecretAccessKey = nil;
 
 - (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)string
 {
-	[self setCurrentXMLElementContent:[[self currentXMLElementContent] stringByAppendingString:string]];
+	if (!currentXMLElementContent) {
+		currentXMLElementContent = [[NSMutableString alloc] init];
+	}
+	[currentXMLElementContent appendString:string];
+}
+
+// We copy the text out of the buffer, as it will be reused for the next element
+- (NSString *)currentXMLElementContent
+{
+	return [[currentXMLElementContent copy] autorelease];
+}
+
+- (void)setCurrentXMLElementContent:(NSString *)newContent
+{
+	if (!currentXMLElementContent) {
+		currentXMLElementContent = [[NSMutableString alloc] init];
+	}
+	[currentXMLElementContent setString:(newContent ? newContent : @"")];
 }
 
 - (id)copyWithZone:(NSZone *)zone
@@ -198,6 +661,11 @@ static NSString *sharedSecretAccessKey = nil;
 	[newRequest setAccessKey:[self accessKey]];
 	[newRequest setSecretAccessKey:[self secretAccessKey]];
 	[newRequest setAccessPolicy:[self accessPolicy]];
+	[newRequest setShouldParseResponseAsItArrives:[self shouldParseResponseAsItArrives]];
+	[newRequest setSignatureVersion:[self signatureVersion]];
+	[newRequest setRegion:[self region]];
+	[newRequest setShouldSignRequestBodyInChunks:[self shouldSignRequestBodyInChunks]];
+	[newRequest setPayloadHash:[self payloadHash]];
 	return newRequest;
 }
 
@@ -226,6 +694,33 @@ static NSString *sharedSecretAccessKey = nil;
 	sharedSecretAccessKey = [newAccessKey retain];
 }
 
++ (ASIS3SignatureVersion)sharedSignatureVersion
+{
+	return sharedSignatureVersion;
+}
+
++ (void)setSharedSignatureVersion:(ASIS3SignatureVersion)newSignatureVersion
+{
+	if (newSignatureVersion == ASIS3SignatureVersionDefault) {
+		newSignatureVersion = ASIS3SignatureVersion2;
+	}
+	sharedSignatureVersion = newSignatureVersion;
+}
+
++ (NSString *)sharedRegion
+{
+	if (sharedRegion) {
+		return sharedRegion;
+	}
+	return @"us-east-1";
+}
+
++ (void)setSharedRegion:(NSString *)newRegion
+{
+	[sharedRegion release];
+	sharedRegion = [newRegion copy];
+}
+
 
 #pragma mark helpers
 
@@ -292,11 +787,59 @@ static NSString *sharedSecretAccessKey = nil;
 	return [NSData dataWithBytes:digest length:CC_SHA1_DIGEST_LENGTH];
 }
 
++ (NSData *)signingKeyForSecretAccessKey:(NSString *)secret dateStamp:(NSString *)dateStamp region:(NSString *)theRegion
+{
+	NSString *cacheKey = [NSString stringWithFormat:@"%@\n%@",theRegion,secret];
+
+	[signingKeyCacheLock lock];
+	if (![dateStamp isEqualToString:signingKeyCacheDateStamp]) {
+		[signingKeyCache removeAllObjects];
+		[signingKeyCacheDateStamp release];
+		signingKeyCacheDateStamp = [dateStamp copy];
+	}
+	NSData *signingKey = [[[signingKeyCache objectForKey:cacheKey] retain] autorelease];
+	[signingKeyCacheLock unlock];
+
+	if (signingKey) {
+		return signingKey;
+	}
+
+	// Start with "AWS4" + the secret, then HMAC the date, region, service and terminator in turn, each time using the last result as the key
+	NSData *secretData = [[@"AWS4" stringByAppendingString:secret] dataUsingEncoding:NSUTF8StringEncoding];
+	const char *scopeParts[4] = {[dateStamp UTF8String], [theRegion UTF8String], "s3", "aws4_request"};
+	uint8_t key[CC_SHA256_DIGEST_LENGTH] = {0};
+	uint8_t digest[CC_SHA256_DIGEST_LENGTH] = {0};
+	CCHmac(kCCHmacAlgSHA256, [secretData bytes], [secretData length], scopeParts[0], strlen(scopeParts[0]), digest);
+	int i;
+	for (i=1; i<4; i++) {
+		memcpy(key, digest, CC_SHA256_DIGEST_LENGTH);
+		CCHmac(kCCHmacAlgSHA256, key, CC_SHA256_DIGEST_LENGTH, scopeParts[i], strlen(scopeParts[i]), digest);
+	}
+	signingKey = [NSData dataWithBytes:digest length:CC_SHA256_DIGEST_LENGTH];
+
+	[signingKeyCacheLock lock];
+	if ([dateStamp isEqualToString:signingKeyCacheDateStamp]) {
+		[signingKeyCache setObject:signingKey forKey:cacheKey];
+	}
+	[signingKeyCacheLock unlock];
+
+	return signingKey;
+}
+
 + (NSString *)S3Host
 {
+	if (S3Host) {
+		return S3Host;
+	}
 	return @"s3.amazonaws.com";
 }
 
++ (void)setS3Host:(NSString *)newHost
+{
+	[S3Host release];
+	S3Host = [newHost copy];
+}
+
 - (void)buildURL
 {
 }
@@ -304,8 +847,17 @@ static NSString *sharedSecretAccessKey = nil;
 @synthesize dateString;
 @synthesize accessKey;
 @synthesize secretAccessKey;
-@synthesize currentXMLElementContent;
 @synthesize currentXMLElementStack;
 @synthesize accessPolicy;
 @synthesize requestScheme;
+@synthesize shouldParseResponseAsItArrives;
+@synthesize signatureVersion;
+@synthesize region;
+@synthesize signingDate;
+@synthesize shouldSignRequestBodyInChunks;
+@synthesize chunkSigningKey;
+@synthesize chunkStringToSignPrefix;
+@synthesize seedSignature;
+@synthesize payloadHash;
+@synthesize responseParser;
 @end
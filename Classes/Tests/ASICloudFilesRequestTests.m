@@ -15,11 +15,51 @@
 #import "ASICloudFilesContainerRequest.h"
 #import "ASICloudFilesObjectRequest.h"
 #import "ASICloudFilesCDNRequest.h"
+#import "ASICloudFilesLargeObjectUploadRequest.h"
+#import "ASICloudFilesListingEnumerator.h"
+#import "ASICloudFilesContainerInfoCache.h"
+#import "ASINetworkQueue.h"
+#import <CommonCrypto/CommonDigest.h>
 
 // Fill in these to run the tests that actually connect and manipulate objects on Cloud Files
 static NSString *username = @"";
 static NSString *apiKey = @"";
 
+// Fill in these to run testAuthenticationRefresh, testLargeObjectUpload, testListingEnumerator and testContainerInfoCache against a Swift server using tempauth (eg a Swift all-in-one VM)
+// These tests change the auth token, so it doesn't use your Cloud Files account
+static NSString *standInAuthURL = @""; // eg http://127.0.0.1:8080/auth/v1.0
+static NSString *standInUsername = @""; // eg test:tester
+static NSString *standInApiKey = @""; // eg testing
+
+// Lets us feed a response to a request without a server
+@interface ASICloudFilesRequest (ASICloudFilesRequestTests)
+- (void)setResponseStatusCode:(int)code;
+- (void)finishParsingResponse;
+@end
+
+// Sends a token the server won't accept, so we can check requests are sent again after authenticating
+@interface ASICloudFilesStaleTokenRequest : ASICloudFilesContainerRequest {
+	BOOL alwaysSendStaleToken;
+}
+@property (assign) BOOL alwaysSendStaleToken;
+@end
+
+@implementation ASICloudFilesStaleTokenRequest
+
+- (void)buildRequestHeaders
+{
+	if ([self haveBuiltRequestHeaders]) {
+		return;
+	}
+	[super buildRequestHeaders];
+	if ([self alwaysSendStaleToken] || !hasRetriedAfterAuthentication) {
+		[self addRequestHeader:@"X-Auth-Token" value:@"stale"];
+	}
+}
+
+@synthesize alwaysSendStaleToken;
+@end
+
 @implementation ASICloudFilesRequestTests
 
 @synthesize networkQueue;
@@ -41,6 +81,160 @@ static NSString *apiKey = @"";
 	GHAssertNotNil([ASICloudFilesRequest cdnManagementURL], @"Failed to authenticate and obtain CDN URL");
 }
 
+- (void)testAuthenticationRefresh {
+	BOOL success = ([standInAuthURL length] && [standInUsername length] && [standInApiKey length]);
+	GHAssertTrue(success,@"You need to supply the details of a Swift server to run this test");
+
+	[ASICloudFilesRequest setAuthenticationURL:standInAuthURL];
+	[ASICloudFilesRequest setUsername:standInUsername];
+	[ASICloudFilesRequest setApiKey:standInApiKey];
+
+	NSError *error = [ASICloudFilesRequest authenticate];
+	GHAssertNil(error,@"Failed to authenticate");
+	success = ([[ASICloudFilesRequest authTokenExpiryDate] timeIntervalSinceNow] > 0);
+	GHAssertTrue(success,@"Failed to set a token expiry date");
+
+	// Starting authentication while it is already running should join the running request, rather than starting another
+	[ASICloudFilesRequest startAuthentication];
+	[ASICloudFilesRequest startAuthentication];
+	error = [ASICloudFilesRequest authenticate];
+	GHAssertNil(error,@"Failed to authenticate while already authenticating");
+
+	// A request that starts when the token is about to expire should start getting a new one in the background
+	NSDate *expiryDate = [ASICloudFilesRequest authTokenExpiryDate];
+	[ASICloudFilesRequest setAuthTokenRefreshInterval:60*60*24*365];
+	ASICloudFilesContainerRequest *request = [ASICloudFilesContainerRequest accountInfoRequest];
+	[request startSynchronous];
+	GHAssertNil([request error],@"Request failed");
+	NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:10];
+	while ([[ASICloudFilesRequest authTokenExpiryDate] isEqualToDate:expiryDate] && [timeout timeIntervalSinceNow] > 0) {
+		[[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+	}
+	success = ![[ASICloudFilesRequest authTokenExpiryDate] isEqualToDate:expiryDate];
+	GHAssertTrue(success,@"Failed to refresh the token before it expired");
+	[ASICloudFilesRequest setAuthTokenRefreshInterval:5*60];
+
+	// A request that gets a 401 should be sent again once we have authenticated
+	NSString *oldToken = [ASICloudFilesRequest authToken];
+	request = [ASICloudFilesStaleTokenRequest requestWithURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@?format=xml",[ASICloudFilesRequest storageURL]]]];
+	[request addRequestHeader:@"X-Auth-Token" value:[ASICloudFilesRequest authToken]];
+	[request startSynchronous];
+	GHAssertNil([request error],@"Failed to send the request again after authenticating");
+	success = ([request responseStatusCode] == 200 || [request responseStatusCode] == 204);
+	GHAssertTrue(success,@"Got the wrong status code");
+	success = ![[ASICloudFilesRequest authToken] isEqualToString:oldToken];
+	GHAssertTrue(success,@"Failed to get a new token");
+
+	// But only once
+	request = [ASICloudFilesStaleTokenRequest requestWithURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@?format=xml",[ASICloudFilesRequest storageURL]]]];
+	[request addRequestHeader:@"X-Auth-Token" value:[ASICloudFilesRequest authToken]];
+	[(ASICloudFilesStaleTokenRequest *)request setAlwaysSendStaleToken:YES];
+	[request startSynchronous];
+	success = ([[request error] code] == ASIAuthenticationErrorType);
+	GHAssertTrue(success,@"Failed to generate an error when the new token was rejected too");
+
+	// Authentication failures should be passed on to the caller
+	[ASICloudFilesRequest setApiKey:@"wrong"];
+	error = [ASICloudFilesRequest authenticate];
+	success = ([error code] == ASIAuthenticationErrorType);
+	GHAssertTrue(success,@"Failed to generate an error when authentication failed");
+
+	[ASICloudFilesRequest setAuthenticationURL:nil];
+	[ASICloudFilesRequest setUsername:nil];
+	[ASICloudFilesRequest setApiKey:nil];
+}
+
+- (void)testLargeObjectUpload {
+	BOOL success = ([standInAuthURL length] && [standInUsername length] && [standInApiKey length]);
+	GHAssertTrue(success,@"You need to supply the details of a Swift server to run this test");
+
+	[ASICloudFilesRequest setAuthenticationURL:standInAuthURL];
+	[ASICloudFilesRequest setUsername:standInUsername];
+	[ASICloudFilesRequest setApiKey:standInApiKey];
+	GHAssertNil([ASICloudFilesRequest authenticate],@"Failed to authenticate");
+
+	NSString *container = @"ASICloudFilesLargeObjectTest";
+	ASIHTTPRequest *request = [ASICloudFilesContainerRequest createContainerRequest:container];
+	[request startSynchronous];
+
+	// Enough for three full segments and a short one
+	NSMutableData *data = [NSMutableData dataWithLength:1024*1024*3+12345];
+	unsigned char *bytes = [data mutableBytes];
+	NSUInteger i;
+	for (i=0; i<[data length]; i++) {
+		bytes[i] = (unsigned char)(i%251);
+	}
+	NSString *filePath = [[self filePathForTemporaryTestFiles] stringByAppendingPathComponent:@"large-object-upload.bin"];
+	[data writeToFile:filePath atomically:NO];
+
+	ASICloudFilesLargeObjectUploadRequest *uploadRequest = [ASICloudFilesLargeObjectUploadRequest putObjectRequestWithContainer:container objectPath:@"large.bin" contentType:@"application/octet-stream" file:filePath metadata:[NSDictionary dictionaryWithObject:@"yes" forKey:@"Test"]];
+	[uploadRequest setSegmentSize:1024*1024];
+	[uploadRequest setMaxConcurrentSegmentUploads:3];
+	[uploadRequest setUploadProgressDelegate:self];
+
+	// Large object uploads can't be run synchronously, so we wait on a queue instead
+	progress = 0;
+	[self setNetworkQueue:[ASINetworkQueue queue]];
+	[[self networkQueue] addOperation:uploadRequest];
+	[[self networkQueue] go];
+	[[self networkQueue] waitUntilAllOperationsAreFinished];
+
+	GHAssertNil([uploadRequest error],@"Large object upload failed");
+	success = ([uploadRequest segmentCount] == 4 && [[uploadRequest segmentETags] count] == 4);
+	GHAssertTrue(success,@"Uploaded the wrong number of segments");
+	unsigned char digest[CC_MD5_DIGEST_LENGTH];
+	CC_MD5(bytes, 1024*1024, digest);
+	NSMutableString *md5 = [NSMutableString string];
+	for (i=0; i<CC_MD5_DIGEST_LENGTH; i++) {
+		[md5 appendFormat:@"%02x",digest[i]];
+	}
+	success = ([[[uploadRequest segmentETags] objectForKey:[NSNumber numberWithUnsignedInteger:0]] caseInsensitiveCompare:md5] == NSOrderedSame);
+	GHAssertTrue(success,@"Stored a segment ETag that doesn't match its MD5");
+	success = (progress == 1.0);
+	GHAssertTrue(success,@"Failed to report progress for all the segments as a single upload %f != 1.0",progress);
+
+	request = [ASICloudFilesObjectRequest getObjectRequestWithContainer:container objectPath:@"large.bin"];
+	[request startSynchronous];
+	success = [[request responseData] isEqualToData:data];
+	GHAssertTrue(success,@"Failed to upload the correct content");
+
+	// Clean up the segments and the manifest
+	request = [ASICloudFilesObjectRequest listRequestWithContainer:container limit:0 marker:nil prefix:@"large.bin" path:nil];
+	[request startSynchronous];
+	for (ASICloudFilesObject *object in [(ASICloudFilesObjectRequest *)request objects]) {
+		ASIHTTPRequest *deleteRequest = [ASICloudFilesObjectRequest deleteObjectRequestWithContainer:container objectPath:[object name]];
+		[deleteRequest startSynchronous];
+	}
+
+	// An upload to a container that doesn't exist should fail, rather than leaving the queue waiting
+	uploadRequest = [ASICloudFilesLargeObjectUploadRequest putObjectRequestWithContainer:@"ASICloudFilesMissingContainer" objectPath:@"large.bin" contentType:@"application/octet-stream" file:filePath metadata:nil];
+	[uploadRequest setSegmentSize:1024*1024];
+	[self setNetworkQueue:[ASINetworkQueue queue]];
+	[[self networkQueue] addOperation:uploadRequest];
+	[[self networkQueue] go];
+	[[self networkQueue] waitUntilAllOperationsAreFinished];
+	success = ([[uploadRequest error] code] == ASICloudFilesResponseErrorType);
+	GHAssertTrue(success,@"Failed to generate an error when segments could not be uploaded");
+
+	request = [ASICloudFilesContainerRequest deleteContainerRequest:container];
+	[request startSynchronous];
+
+	[ASICloudFilesRequest setAuthenticationURL:nil];
+	[ASICloudFilesRequest setUsername:nil];
+	[ASICloudFilesRequest setApiKey:nil];
+}
+
+// Will be called on Mac OS
+- (void)setDoubleValue:(double)newProgress;
+{
+	progress = (float)newProgress;
+}
+
+- (void)setProgress:(float)newProgress;
+{
+	progress = newProgress;
+}
+
 - (void)testDateParser {
 	ASICloudFilesRequest *request = [[[ASICloudFilesRequest alloc] init] autorelease];
 	
@@ -150,6 +344,192 @@ static NSString *apiKey = @"";
 	
 }
 
+- (void)testIncrementalListParsing {
+	NSString *xml = @"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		@"<container name=\"photos\">"
+		@"<object>\n\t<name>caf\u00e9 &amp; bar.jpg</name>\n\t<hash>828ef3fdfa96f00ad9f27c383fc9ac7f</hash>\n\t<bytes>142863</bytes>\n\t<content_type>image/jpeg</content_type>\n\t<last_modified>2026-10-18T12:00:00.000000</last_modified>\n</object>"
+		@"<object><name>readme.txt</name><hash>d41d8cd98f00b204e9800998ecf8427e</hash><bytes>0</bytes><content_type>text/plain</content_type><last_modified>2026-10-18T12:00:00.000000</last_modified></object>"
+		@"</container>";
+	NSData *data = [xml dataUsingEncoding:NSUTF8StringEncoding];
+
+	// Feed the response a few bytes at a time, so chunks split elements, entities and multi-byte characters
+	ASICloudFilesObjectRequest *listRequest = [ASICloudFilesObjectRequest listRequestWithContainer:@"photos"];
+	[listRequest setResponseStatusCode:200];
+	[listRequest setResponseHeaders:[NSDictionary dictionaryWithObject:@"application/xml; charset=utf-8" forKey:@"Content-Type"]];
+	NSUInteger i;
+	for (i=0; i<[data length]; i+=3) {
+		NSUInteger length = [data length]-i;
+		if (length > 3) {
+			length = 3;
+		}
+		[listRequest didReceiveResponseBytes:(const char *)[data bytes]+i length:length];
+	}
+	[listRequest finishParsingResponse];
+
+	GHAssertNil([listRequest error],@"Failed to parse a listing as it arrived");
+	BOOL success = ([[listRequest objects] count] == 2);
+	GHAssertTrue(success,@"Failed to parse the right number of objects");
+	ASICloudFilesObject *object = [[listRequest objects] objectAtIndex:0];
+	success = [[object name] isEqualToString:@"caf\u00e9 & bar.jpg"];
+	GHAssertTrue(success,@"Failed to parse a name split across chunks");
+	success = ([object bytes] == 142863);
+	GHAssertTrue(success,@"Failed to parse a size");
+	success = [[[[listRequest objects] objectAtIndex:1] name] isEqualToString:@"readme.txt"];
+	GHAssertTrue(success,@"Failed to parse the second object");
+
+	// Containers too
+	xml = @"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<account name=\"test\"><container><name>photos</name><count>2</count><bytes>142863</bytes></container><container><name>videos</name><count>0</count><bytes>0</bytes></container></account>";
+	data = [xml dataUsingEncoding:NSUTF8StringEncoding];
+	ASICloudFilesContainerRequest *containerListRequest = [ASICloudFilesContainerRequest listRequest];
+	[containerListRequest setResponseStatusCode:200];
+	[containerListRequest setResponseHeaders:[NSDictionary dictionaryWithObject:@"application/xml; charset=utf-8" forKey:@"Content-Type"]];
+	for (i=0; i<[data length]; i+=5) {
+		NSUInteger length = [data length]-i;
+		if (length > 5) {
+			length = 5;
+		}
+		[containerListRequest didReceiveResponseBytes:(const char *)[data bytes]+i length:length];
+	}
+	[containerListRequest finishParsingResponse];
+	success = ([[containerListRequest containers] count] == 2 && [[[[containerListRequest containers] objectAtIndex:1] name] isEqualToString:@"videos"]);
+	GHAssertTrue(success,@"Failed to parse containers as they arrived");
+
+	// Broken XML should give us an error, rather than a partial listing
+	listRequest = [ASICloudFilesObjectRequest listRequestWithContainer:@"photos"];
+	[listRequest setResponseStatusCode:200];
+	[listRequest setResponseHeaders:[NSDictionary dictionaryWithObject:@"application/xml" forKey:@"Content-Type"]];
+	data = [@"<container><object><name>a</object>" dataUsingEncoding:NSUTF8StringEncoding];
+	[listRequest didReceiveResponseBytes:[data bytes] length:[data length]];
+	[listRequest finishParsingResponse];
+	success = ([[listRequest error] code] == ASICloudFilesResponseParsingFailedType);
+	GHAssertTrue(success,@"Failed to generate an error for broken XML");
+}
+
+- (void)testListingEnumerator {
+	BOOL success = ([standInAuthURL length] && [standInUsername length] && [standInApiKey length]);
+	GHAssertTrue(success,@"You need to supply the details of a Swift server to run this test");
+
+	[ASICloudFilesRequest setAuthenticationURL:standInAuthURL];
+	[ASICloudFilesRequest setUsername:standInUsername];
+	[ASICloudFilesRequest setApiKey:standInApiKey];
+	GHAssertNil([ASICloudFilesRequest authenticate],@"Failed to authenticate");
+
+	NSString *container = @"ASICloudFilesListingTest";
+	ASIHTTPRequest *request = [ASICloudFilesContainerRequest createContainerRequest:container];
+	[request startSynchronous];
+
+	// 25 objects, so with 10 to a page the last page is short
+	[self setNetworkQueue:[ASINetworkQueue queue]];
+	NSUInteger i;
+	for (i=0; i<25; i++) {
+		NSString *name = [NSString stringWithFormat:@"list/%02lu \u00e9.txt",(unsigned long)i];
+		[[self networkQueue] addOperation:[ASICloudFilesObjectRequest putObjectRequestWithContainer:container objectPath:[name stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding] contentType:@"text/plain" objectData:[name dataUsingEncoding:NSUTF8StringEncoding] metadata:nil etag:nil]];
+	}
+	[[self networkQueue] addOperation:[ASICloudFilesObjectRequest putObjectRequestWithContainer:container objectPath:@"other.txt" contentType:@"text/plain" objectData:[@"other" dataUsingEncoding:NSUTF8StringEncoding] metadata:nil etag:nil]];
+	[[self networkQueue] go];
+	[[self networkQueue] waitUntilAllOperationsAreFinished];
+
+	ASICloudFilesListingEnumerator *enumerator = [[[ASICloudFilesListingEnumerator alloc] initWithContainer:container prefix:@"list/" path:nil pageSize:10] autorelease];
+	NSUInteger count = 0;
+	for (ASICloudFilesObject *object in enumerator) {
+		success = [[object name] isEqualToString:[NSString stringWithFormat:@"list/%02lu \u00e9.txt",(unsigned long)count]];
+		GHAssertTrue(success,@"Got the wrong object, or got objects in the wrong order");
+		count++;
+	}
+	GHAssertNil([enumerator error],@"Enumerating the listing failed");
+	success = (count == 25 && [enumerator pageCount] == 3);
+	GHAssertTrue(success,@"Failed to list every object");
+
+	success = NO;
+	for (ASICloudFilesContainer *theContainer in [ASICloudFilesListingEnumerator containerEnumerator]) {
+		if ([[theContainer name] isEqualToString:container]) {
+			success = YES;
+		}
+	}
+	GHAssertTrue(success,@"Failed to list containers");
+
+	// Clean up
+	enumerator = [ASICloudFilesListingEnumerator enumeratorWithContainer:container prefix:nil];
+	[self setNetworkQueue:[ASINetworkQueue queue]];
+	for (ASICloudFilesObject *object in enumerator) {
+		[[self networkQueue] addOperation:[ASICloudFilesObjectRequest deleteObjectRequestWithContainer:container objectPath:[[object name] stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]]];
+	}
+	[[self networkQueue] go];
+	[[self networkQueue] waitUntilAllOperationsAreFinished];
+	request = [ASICloudFilesContainerRequest deleteContainerRequest:container];
+	[request startSynchronous];
+
+	[ASICloudFilesRequest setAuthenticationURL:nil];
+	[ASICloudFilesRequest setUsername:nil];
+	[ASICloudFilesRequest setApiKey:nil];
+}
+
+- (void)testContainerInfoCache {
+	BOOL success = ([standInAuthURL length] && [standInUsername length] && [standInApiKey length]);
+	GHAssertTrue(success,@"You need to supply the details of a Swift server to run this test");
+
+	[ASICloudFilesRequest setAuthenticationURL:standInAuthURL];
+	[ASICloudFilesRequest setUsername:standInUsername];
+	[ASICloudFilesRequest setApiKey:standInApiKey];
+	GHAssertNil([ASICloudFilesRequest authenticate],@"Failed to authenticate");
+
+	NSString *container = @"ASICloudFilesInfoCacheTest";
+	ASIHTTPRequest *request = [ASICloudFilesContainerRequest createContainerRequest:container];
+	[request startSynchronous];
+	request = [ASICloudFilesObjectRequest putObjectRequestWithContainer:container objectPath:@"file.txt" contentType:@"text/plain" objectData:[@"this is a test" dataUsingEncoding:NSUTF8StringEncoding] metadata:nil etag:nil];
+	[request startSynchronous];
+
+	ASICloudFilesContainerInfoCache *cache = [[[ASICloudFilesContainerInfoCache alloc] init] autorelease];
+	NSError *error = nil;
+	ASICloudFilesContainer *info = [cache containerInfoForContainer:container error:&error];
+	GHAssertNil(error,@"Failed to fetch container info");
+	success = ([info count] == 1 && [info bytes] == 14);
+	GHAssertTrue(success,@"Got the wrong container info");
+
+	// The second lookup should come from the cache
+	info = [cache containerInfoForContainer:container error:&error];
+	success = (info && [cache hitCount] == 1 && [cache missCount] == 1);
+	GHAssertTrue(success,@"Failed to use cached info");
+
+	// Lots of threads asking for the same info at once should only make one request
+	[cache removeInfoForContainer:container];
+	NSOperationQueue *queue = [[[NSOperationQueue alloc] init] autorelease];
+	[queue setMaxConcurrentOperationCount:8];
+	NSUInteger i;
+	for (i=0; i<8; i++) {
+		[queue addOperation:[[[NSInvocationOperation alloc] initWithTarget:self selector:@selector(lookUpContainerInfo:) object:[NSArray arrayWithObjects:cache,container,nil]] autorelease]];
+	}
+	[queue waitUntilAllOperationsAreFinished];
+	success = ([cache missCount] == 2 && [cache hitCount] == 8);
+	GHAssertTrue(success,@"Made more than one request for the same info");
+
+	// Expired info should be fetched again
+	[cache setTimeToLive:0];
+	[cache removeAllInfo];
+	[cache containerInfoForContainer:container error:NULL];
+	[cache containerInfoForContainer:container error:NULL];
+	success = ([cache missCount] == 4);
+	GHAssertTrue(success,@"Used info that had expired");
+
+	// Failures should be reported, not cached
+	info = [cache containerInfoForContainer:@"ASICloudFilesMissingContainer" error:&error];
+	success = (!info && [error code] == ASICloudFilesResponseErrorType);
+	GHAssertTrue(success,@"Failed to generate an error for a container that doesn't exist");
+
+	request = [ASICloudFilesObjectRequest deleteObjectRequestWithContainer:container objectPath:@"file.txt"];
+	[request startSynchronous];
+	request = [ASICloudFilesContainerRequest deleteContainerRequest:container];
+	[request startSynchronous];
+
+	[ASICloudFilesRequest setAuthenticationURL:nil];
+	[ASICloudFilesRequest setUsername:nil];
+	[ASICloudFilesRequest setApiKey:nil];
+}
+
+- (void)lookUpContainerInfo:(NSArray *)cacheAndContainer {
+	[[cacheAndContainer objectAtIndex:0] containerInfoForContainer:[cacheAndContainer objectAtIndex:1] error:NULL];
+}
+
 - (void)testObjectList {
 	[self authenticate];
 	
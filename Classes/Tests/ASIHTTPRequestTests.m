@@ -855,7 +855,35 @@
 	GHAssertTrue(success,@"Failed to properly increment upload progress %f != 1.0",progress);
 	
 	success = [[request responseString] isEqualToString:requestBody];
-	GHAssertTrue(success,@"Failed upload the correct request body");		
+	GHAssertTrue(success,@"Failed upload the correct request body");
+
+	// Test sending only part of the file
+	progress = 0;
+	request = [[[ASIHTTPRequest alloc] initWithURL:url] autorelease];
+	[request setRequestMethod:@"PUT"];
+	[request setShouldStreamPostDataFromDisk:YES];
+	[request setUploadProgressDelegate:self];
+	[request setPostBodyFilePath:requestContentPath];
+	[request setPostBodyFileOffset:8];
+	[request setPostBodyFileLength:7];
+	[request startSynchronous];
+
+	success = (progress == 1.0);
+	GHAssertTrue(success,@"Failed to properly increment upload progress %f != 1.0",progress);
+
+	success = [[request responseString] isEqualToString:@"the req"];
+	GHAssertTrue(success,@"Failed upload the correct part of the file");
+
+	// A range that runs past the end of the file should fail before sending anything
+	request = [[[ASIHTTPRequest alloc] initWithURL:url] autorelease];
+	[request setRequestMethod:@"PUT"];
+	[request setShouldStreamPostDataFromDisk:YES];
+	[request setPostBodyFilePath:requestContentPath];
+	[request setPostBodyFileOffset:20];
+	[request setPostBodyFileLength:10];
+	[request startSynchronous];
+	success = ([[request error] code] == ASIFileManagementError);
+	GHAssertTrue(success,@"Failed to generate an error for a range past the end of the file");
 }
 
 - (void)testCookies
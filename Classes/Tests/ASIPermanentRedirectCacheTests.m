@@ -0,0 +1,158 @@
+//
+//  ASIPermanentRedirectCacheTests.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIPermanentRedirectCacheTests.h"
+#import "ASIHTTPRequest.h"
+#import "ASIFormDataRequest.h"
+#import "ASIPermanentRedirectCache.h"
+
+// Stuff used to fake redirect responses without going to the network
+@interface ASIHTTPRequest (ASIPermanentRedirectCacheTests)
+- (void)setResponseStatusCode:(int)status;
+@end
+
+@implementation ASIPermanentRedirectCacheTests
+
+- (void)storeRedirectFrom:(NSString *)fromURL to:(NSString *)toURL status:(int)status headers:(NSDictionary *)headers inCache:(ASIPermanentRedirectCache *)cache
+{
+	ASIHTTPRequest *request = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:fromURL]];
+	[request setResponseStatusCode:status];
+	[request setResponseHeaders:headers];
+	[cache storeRedirectForRequest:request toURL:[NSURL URLWithString:toURL]];
+}
+
+- (void)testRedirectMemoisation
+{
+	ASIPermanentRedirectCache *cache = [ASIPermanentRedirectCache cache];
+	NSURL *url = [NSURL URLWithString:@"http://allseeing-i.com/ASIHTTPRequest/tests/redirect/301"];
+
+	ASIHTTPRequest *request = [ASIHTTPRequest requestWithURL:url];
+	[request setPermanentRedirectCache:cache];
+	[request startSynchronous];
+	BOOL success = [[request responseString] isEqualToString:@"Redirected as GET after a 301 status code"];
+	GHAssertTrue(success,@"Failed to redirect");
+	GHAssertTrue([cache redirectCount] == 1,@"Failed to remember a permanent redirect");
+	GHAssertTrue([cache hitCount] == 0,@"Got a hit when we didn't know of any redirects");
+
+	NSURL *destinationURL = [request url];
+	request = [ASIHTTPRequest requestWithURL:url];
+	[request setPermanentRedirectCache:cache];
+	[request startSynchronous];
+	success = [[request responseString] isEqualToString:@"Redirected as GET after a 301 status code"];
+	GHAssertTrue(success,@"Failed to get the right content when skipping a redirect");
+	GHAssertTrue([cache hitCount] == 1,@"Failed to skip a redirect we had seen before");
+	success = [[request url] isEqual:destinationURL];
+	GHAssertTrue(success,@"Failed to go straight to the destination url");
+	success = [[request originalURL] isEqual:url];
+	GHAssertTrue(success,@"Failed to preserve original url when skipping a redirect");
+
+	// 301 redirects for POSTs are performed as GETs, so we can't skip them
+	ASIFormDataRequest *postRequest = [ASIFormDataRequest requestWithURL:url];
+	[postRequest setPostValue:@"Giant Monkey" forKey:@"lookbehindyou"];
+	[postRequest setPermanentRedirectCache:cache];
+	[postRequest startSynchronous];
+	success = [[postRequest responseString] isEqualToString:@"Redirected as GET after a 301 status code"];
+	GHAssertTrue(success,@"Got the wrong content for a POST redirect");
+	GHAssertTrue([cache hitCount] == 1,@"Skipped a 301 redirect for a POST request");
+
+	// Requests that don't follow redirects should see the redirect, even if we know where it goes
+	request = [ASIHTTPRequest requestWithURL:url];
+	[request setPermanentRedirectCache:cache];
+	[request setShouldRedirect:NO];
+	[request startSynchronous];
+	GHAssertTrue([request responseStatusCode] == 301,@"Skipped a redirect for a request that doesn't follow redirects");
+	GHAssertTrue([cache hitCount] == 1,@"Looked up a redirect for a request that doesn't follow redirects");
+}
+
+- (void)testCacheHeaders
+{
+	ASIPermanentRedirectCache *cache = [ASIPermanentRedirectCache cache];
+
+	[self storeRedirectFrom:@"http://a.com/1" to:@"http://b.com/1" status:301 headers:[NSDictionary dictionaryWithObject:@"no-store" forKey:@"Cache-Control"] inCache:cache];
+	[self storeRedirectFrom:@"http://a.com/2" to:@"http://b.com/2" status:301 headers:[NSDictionary dictionaryWithObject:@"private, max-age=0" forKey:@"Cache-Control"] inCache:cache];
+	[self storeRedirectFrom:@"http://a.com/3" to:@"http://b.com/3" status:301 headers:[NSDictionary dictionaryWithObject:@"Thu, 01 Jan 1970 00:00:00 GMT" forKey:@"Expires"] inCache:cache];
+	GHAssertTrue([cache redirectCount] == 0,@"Stored a redirect the server told us not to");
+
+	// max-age overrides Expires
+	NSDictionary *headers = [NSDictionary dictionaryWithObjectsAndKeys:@"max-age=3600",@"Cache-Control",@"Thu, 01 Jan 1970 00:00:00 GMT",@"Expires",nil];
+	[self storeRedirectFrom:@"http://a.com/4" to:@"http://b.com/4" status:301 headers:headers inCache:cache];
+	NSURL *destinationURL = [cache destinationURLForURL:[NSURL URLWithString:@"http://a.com/4"] requestMethod:@"GET"];
+	BOOL success = [[destinationURL absoluteString] isEqualToString:@"http://b.com/4"];
+	GHAssertTrue(success,@"Failed to remember a redirect with a max-age");
+
+	// A later response telling us not to cache the redirect should make us forget it
+	[self storeRedirectFrom:@"http://a.com/4" to:@"http://b.com/4" status:301 headers:[NSDictionary dictionaryWithObject:@"no-cache" forKey:@"Cache-Control"] inCache:cache];
+	GHAssertNil([cache destinationURLForURL:[NSURL URLWithString:@"http://a.com/4"] requestMethod:@"GET"],@"Failed to forget a redirect the server no longer wants cached");
+
+	// Temporary redirects are never stored
+	[self storeRedirectFrom:@"http://a.com/5" to:@"http://b.com/5" status:302 headers:nil inCache:cache];
+	GHAssertTrue([cache redirectCount] == 0,@"Stored a temporary redirect");
+
+	GHAssertTrue([cache hitCount] == 1 && [cache missCount] == 1,@"Got the wrong hit counts");
+}
+
+- (void)testRedirectChains
+{
+	ASIPermanentRedirectCache *cache = [ASIPermanentRedirectCache cache];
+	[self storeRedirectFrom:@"http://a.com/" to:@"http://b.com/" status:301 headers:nil inCache:cache];
+	[self storeRedirectFrom:@"http://b.com/" to:@"http://c.com/" status:308 headers:nil inCache:cache];
+
+	NSURL *destinationURL = [cache destinationURLForURL:[NSURL URLWithString:@"http://a.com/"] requestMethod:@"GET"];
+	BOOL success = [[destinationURL absoluteString] isEqualToString:@"http://c.com/"];
+	GHAssertTrue(success,@"Failed to follow a chain of redirects");
+
+	// 308 redirects keep the request method, so they can be skipped for a POST, but 301s can't
+	GHAssertNil([cache destinationURLForURL:[NSURL URLWithString:@"http://a.com/"] requestMethod:@"POST"],@"Skipped a 301 redirect for a POST");
+	destinationURL = [cache destinationURLForURL:[NSURL URLWithString:@"http://b.com/"] requestMethod:@"POST"];
+	success = [[destinationURL absoluteString] isEqualToString:@"http://c.com/"];
+	GHAssertTrue(success,@"Failed to skip a 308 redirect for a POST");
+
+	// Redirect loops shouldn't hang, and shouldn't be skipped
+	[self storeRedirectFrom:@"http://c.com/" to:@"http://a.com/" status:301 headers:nil inCache:cache];
+	GHAssertNil([cache destinationURLForURL:[NSURL URLWithString:@"http://a.com/"] requestMethod:@"GET"],@"Skipped a redirect loop");
+}
+
+- (void)testEviction
+{
+	ASIPermanentRedirectCache *cache = [ASIPermanentRedirectCache cache];
+	[cache setMaxEntries:2];
+	[self storeRedirectFrom:@"http://a.com/1" to:@"http://b.com/1" status:301 headers:nil inCache:cache];
+	[self storeRedirectFrom:@"http://a.com/2" to:@"http://b.com/2" status:301 headers:nil inCache:cache];
+
+	// Using the first redirect means the second is now the least recently used
+	[cache destinationURLForURL:[NSURL URLWithString:@"http://a.com/1"] requestMethod:@"GET"];
+	[self storeRedirectFrom:@"http://a.com/3" to:@"http://b.com/3" status:301 headers:nil inCache:cache];
+
+	GHAssertTrue([cache redirectCount] == 2,@"Stored more redirects than maxEntries");
+	GHAssertNotNil([cache destinationURLForURL:[NSURL URLWithString:@"http://a.com/1"] requestMethod:@"GET"],@"Threw away a recently used redirect");
+	GHAssertNil([cache destinationURLForURL:[NSURL URLWithString:@"http://a.com/2"] requestMethod:@"GET"],@"Failed to throw away the least recently used redirect");
+}
+
+- (void)testPersistence
+{
+	NSString *path = [[self filePathForTemporaryTestFiles] stringByAppendingPathComponent:@"PermanentRedirects.plist"];
+	[[[[NSFileManager alloc] init] autorelease] removeItemAtPath:path error:NULL];
+
+	ASIPermanentRedirectCache *cache = [ASIPermanentRedirectCache cacheWithStoragePath:path];
+	[self storeRedirectFrom:@"http://a.com/1" to:@"http://b.com/1" status:301 headers:nil inCache:cache];
+	[self storeRedirectFrom:@"http://a.com/2" to:@"http://b.com/2" status:308 headers:[NSDictionary dictionaryWithObject:@"max-age=3600" forKey:@"Cache-Control"] inCache:cache];
+	[cache waitUntilSaved];
+
+	cache = [ASIPermanentRedirectCache cacheWithStoragePath:path];
+	GHAssertTrue([cache redirectCount] == 2,@"Failed to load saved redirects");
+	NSURL *destinationURL = [cache destinationURLForURL:[NSURL URLWithString:@"http://a.com/2"] requestMethod:@"PUT"];
+	BOOL success = [[destinationURL absoluteString] isEqualToString:@"http://b.com/2"];
+	GHAssertTrue(success,@"Failed to load a saved 308 redirect");
+
+	[cache removeAllRedirects];
+	[cache waitUntilSaved];
+	cache = [ASIPermanentRedirectCache cacheWithStoragePath:path];
+	GHAssertTrue([cache redirectCount] == 0,@"Failed to save removing redirects");
+}
+
+@end
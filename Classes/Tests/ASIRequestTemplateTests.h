@@ -0,0 +1,14 @@
+//
+//  ASIRequestTemplateTests.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASITestCase.h"
+
+@interface ASIRequestTemplateTests : ASITestCase {
+}
+
+@end
@@ -0,0 +1,85 @@
+//
+//  ASIRequestTemplateTests.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASIRequestTemplateTests.h"
+#import "ASIHTTPRequest.h"
+#import "ASIRequestTemplate.h"
+
+@implementation ASIRequestTemplateTests
+
+- (void)testSettingsAreCopied
+{
+	ASIHTTPRequest *prototype = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/ASIHTTPRequest/tests/"]];
+	[prototype setDelegate:self];
+	[prototype setDidFinishSelector:@selector(templateRequestFinished:)];
+	[prototype setTimeOutSeconds:42];
+	[prototype setNumberOfTimesToRetryOnTimeout:3];
+	[prototype setShouldRedirect:NO];
+	[prototype setRequestMethod:@"HEAD"];
+	[prototype addRequestHeader:@"X-Test" value:@"yes"];
+	[prototype setUsername:@"secret_username"];
+	[prototype setPassword:@"secret_password"];
+	[prototype setAuthenticationScheme:(NSString *)kCFHTTPAuthenticationSchemeBasic];
+
+	ASIRequestTemplate *template = [ASIRequestTemplate templateWithRequest:prototype];
+
+	// Changes to the prototype after the template was created should have no effect
+	[prototype setTimeOutSeconds:1];
+	[prototype addRequestHeader:@"X-Test" value:@"no"];
+
+	ASIHTTPRequest *request = [template requestWithPath:@"first?a=b"];
+	BOOL success = [[[request url] absoluteString] isEqualToString:@"http://allseeing-i.com/ASIHTTPRequest/tests/first?a=b"];
+	GHAssertTrue(success,@"Failed to build the right url from a relative path");
+	GHAssertTrue([request delegate] == self,@"Failed to copy the delegate");
+	GHAssertTrue([request didFinishSelector] == @selector(templateRequestFinished:),@"Failed to copy a delegate selector");
+	GHAssertTrue([request timeOutSeconds] == 42,@"Failed to copy the timeout, or picked up a later change to the prototype");
+	GHAssertTrue([request numberOfTimesToRetryOnTimeout] == 3,@"Failed to copy the retry count");
+	GHAssertFalse([request shouldRedirect],@"Failed to copy the redirect behaviour");
+	success = [[request requestMethod] isEqualToString:@"HEAD"];
+	GHAssertTrue(success,@"Failed to copy the request method");
+	success = [[[request requestHeaders] objectForKey:@"X-Test"] isEqualToString:@"yes"];
+	GHAssertTrue(success,@"Failed to copy a custom header, or picked up a later change to the prototype");
+	GHAssertNotNil([[request requestHeaders] objectForKey:@"User-Agent"],@"Failed to pre-build the user agent header");
+
+	// Each request must get its own headers
+	[request addRequestHeader:@"X-Only-Here" value:@"yes"];
+	ASIHTTPRequest *request2 = [template requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/ASIHTTPRequest/tests/second"]];
+	GHAssertNil([[request2 requestHeaders] objectForKey:@"X-Only-Here"],@"Requests created from the same template share headers");
+	GHAssertNil([[template requestHeaders] objectForKey:@"X-Only-Here"],@"Changing a request's headers changed the template");
+}
+
+- (void)testExplicitProxyIsUsedForAllHosts
+{
+	ASIHTTPRequest *prototype = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com"]];
+	[prototype setProxyHost:@"127.0.0.1"];
+	[prototype setProxyPort:8080];
+	ASIRequestTemplate *template = [ASIRequestTemplate templateWithRequest:prototype];
+
+	// A proxy set explicitly on the prototype should be used for every request, whatever the host
+	ASIHTTPRequest *request = [template requestWithURL:[NSURL URLWithString:@"http://example.com"]];
+	BOOL success = ([[request proxyHost] isEqualToString:@"127.0.0.1"] && [request proxyPort] == 8080);
+	GHAssertTrue(success,@"Failed to copy the proxy");
+}
+
+- (void)testTemplateRequestsRun
+{
+	ASIHTTPRequest *prototype = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/ASIHTTPRequest/tests/"]];
+	[prototype setTimeOutSeconds:20];
+	ASIRequestTemplate *template = [ASIRequestTemplate templateWithRequest:prototype];
+
+	ASIHTTPRequest *request = [template requestWithPath:@"first"];
+	[request startSynchronous];
+	BOOL success = [[request responseString] isEqualToString:@"This is the expected content for the first string"];
+	GHAssertTrue(success,@"Request created from a template failed to fetch the right content");
+}
+
+- (void)templateRequestFinished:(ASIHTTPRequest *)request
+{
+}
+
+@end
@@ -16,6 +16,8 @@
 }
 
 - (void)testAuthenticationHeaderGeneration;
+- (void)testSignatureVersion4;
+- (void)testStreamingSignatureVersion4;
 - (void)testREST;
 - (void)testFailure;
 - (void)testListRequest;
@@ -23,6 +25,16 @@
 - (void)createTestBucket;
 - (void)testCopy;
 - (void)testHTTPS;
+- (void)testMultipartUpload;
+- (void)testParallelDownload;
+- (void)testParallelDownloadPerformance;
+- (void)testIncrementalListParsing;
+- (void)testBucketEnumerator;
+- (void)testMultiObjectDeleteParsing;
+- (void)testBulkHEADAndDelete;
+- (void)testDirectorySync;
+- (void)testPartitionSplitKeys;
+- (void)testPartitionedBucketEnumerator;
 
 @property (retain,nonatomic) ASINetworkQueue *networkQueue;
 @end
@@ -0,0 +1,118 @@
+//
+//  ASITrafficArchiveTests.m
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+
+#import "ASITrafficArchiveTests.h"
+#import "ASIHTTPRequest.h"
+#import "ASITrafficArchive.h"
+
+@implementation ASITrafficArchiveTests
+
+- (NSString *)archivePath
+{
+	return [[self filePathForTemporaryTestFiles] stringByAppendingPathComponent:@"TrafficArchive"];
+}
+
+- (void)recordTestTraffic
+{
+	ASITrafficArchive *archive = [ASITrafficArchive archiveWithPath:[self archivePath] mode:ASITrafficArchiveRecordMode];
+	[archive clearRecordedExchanges];
+
+	// allseeing-i.com will gzip this one
+	NSArray *urls = [NSArray arrayWithObjects:@"http://allseeing-i.com/ASIHTTPRequest/tests/first",@"http://allseeing-i.com",nil];
+	for (NSString *url in urls) {
+		ASIHTTPRequest *request = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:url]];
+		[request setTrafficArchive:archive];
+		[request startSynchronous];
+		GHAssertNil([request error],@"Failed to record a response");
+	}
+	GHAssertTrue([archive exchangeCount] == [urls count],@"Failed to record the right number of responses");
+}
+
+- (void)testRecordAndReplay
+{
+	[self recordTestTraffic];
+
+	ASIHTTPRequest *liveRequest = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com"]];
+	[liveRequest startSynchronous];
+
+	ASITrafficArchive *archive = [ASITrafficArchive archiveWithPath:[self archivePath] mode:ASITrafficArchiveReplayMode];
+	GHAssertTrue([archive exchangeCount] == 2,@"Failed to load recorded responses");
+
+	ASIHTTPRequest *request = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/ASIHTTPRequest/tests/first"]];
+	[request setTrafficArchive:archive];
+	[request startSynchronous];
+	GHAssertNil([request error],@"Replayed request failed");
+	GHAssertTrue([request responseStatusCode] == 200,@"Replayed request has the wrong status code");
+	BOOL success = [[request responseString] isEqualToString:@"This is the expected content for the first string"];
+	GHAssertTrue(success,@"Replayed request has the wrong content");
+
+	// The home page is gzipped, so this checks the replayed response is inflated like a live one
+	request = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com"]];
+	[request setTrafficArchive:archive];
+	[request startSynchronous];
+	GHAssertNil([request error],@"Replayed request failed");
+	success = [[[request responseHeaders] objectForKey:@"Content-Encoding"] isEqualToString:[[liveRequest responseHeaders] objectForKey:@"Content-Encoding"]];
+	GHAssertTrue(success,@"Replayed request has the wrong headers");
+	success = ([[request responseData] length] > 0 && [[request responseData] length] == [[liveRequest responseData] length]);
+	GHAssertTrue(success,@"Replayed request has the wrong content");
+
+	// We should be able to replay the same response over and over
+	request = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/ASIHTTPRequest/tests/first"]];
+	[request setTrafficArchive:archive];
+	[request startSynchronous];
+	success = [[request responseString] isEqualToString:@"This is the expected content for the first string"];
+	GHAssertTrue(success,@"Failed to replay the same response twice");
+}
+
+- (void)testReplayWithOriginalTiming
+{
+	[self recordTestTraffic];
+
+	ASITrafficArchive *archive = [ASITrafficArchive archiveWithPath:[self archivePath] mode:ASITrafficArchiveReplayMode];
+	[archive setReplaySpeed:ASIReplayWithOriginalTiming];
+
+	ASIHTTPRequest *request = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com"]];
+	[request setTrafficArchive:archive];
+	[request startSynchronous];
+	GHAssertNil([request error],@"Replayed request failed");
+	GHAssertTrue([[request responseData] length] > 0,@"Replayed request has no content");
+}
+
+- (void)testReplayMissingResponse
+{
+	ASITrafficArchive *archive = [ASITrafficArchive archiveWithPath:[self archivePath] mode:ASITrafficArchiveReplayMode];
+	ASIHTTPRequest *request = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/this-was-never-recorded"]];
+	[request setTrafficArchive:archive];
+	[request startSynchronous];
+	BOOL success = ([[request error] code] == ASIInternalErrorWhileBuildingRequestType);
+	GHAssertTrue(success,@"Failed to generate an error for a request with no recorded response");
+}
+
+- (void)testReplayPerformance
+{
+	[self recordTestTraffic];
+	ASITrafficArchive *archive = [ASITrafficArchive archiveWithPath:[self archivePath] mode:ASITrafficArchiveReplayMode];
+
+	int runTimes = 1000;
+	int i;
+	NSDate *startTime = [NSDate date];
+	for (i=0; i<runTimes; i++) {
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		ASIHTTPRequest *request = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com"]];
+		[request setTrafficArchive:archive];
+		[request startSynchronous];
+		if ([request error]) {
+			GHFail(@"Replayed request failed: %@",[request error]);
+		}
+		[pool release];
+	}
+	NSTimeInterval totalTime = [[NSDate date] timeIntervalSinceDate:startTime];
+	NSLog(@"Replayed %i requests in %f seconds (%f requests / second)",runTimes,totalTime,runTimes/totalTime);
+}
+
+@end
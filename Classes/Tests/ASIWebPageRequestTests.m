@@ -8,6 +8,20 @@
 
 #import "ASIWebPageRequestTests.h"
 #import "ASIWebPageRequest.h"
+#import "ASICSSTokenizer.h"
+#import "ASIWebArchive.h"
+
+// Private stuff
+@interface ASIWebPageRequest (ASIWebPageRequestTests)
+- (void)startParsingHTML;
+- (void)parseHTMLBytes:(const void *)bytes length:(NSUInteger)length;
+- (void)discardParserContext;
+- (NSMutableArray *)pendingResourceURLs;
+- (NSMutableArray *)pendingResourceTypes;
+- (void)setResourceList:(NSMutableDictionary *)newResourceList;
+- (NSString *)replacementForExternalURL:(NSString *)theURL;
+- (BOOL)replaceDataURIPlaceholders;
+@end
 
 @implementation ASIWebPageRequestTests
 
@@ -25,6 +39,175 @@
 	}
 }
 
+- (void)testIncrementalParsing
+{
+	ASIWebPageRequest *request = [ASIWebPageRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/ASIHTTPRequest/tests/asiwebpagerequest/incremental"]];
+	[request startParsingHTML];
+
+	NSString *head = @"<html><head><link rel=\"StyleSheet\" href=\"style.css\"><link rel=\"alternate\" href=\"feed.xml\"><style>body { background: url('bg.png'); }</style></head><body>";
+	NSString *body = @"<img src=\"a.png\"><a href=\"other.html\">Other</a><div style=\"background-image: url(b.png)\"></div><video poster=\"poster.jpg\"><source src=\"movie.ogv\"><source src=\"movie.mp4\"></video><p>The end</p></body></html>";
+
+	// Feed the head in small chunks, as if it was arriving slowly
+	NSData *data = [head dataUsingEncoding:NSUTF8StringEncoding];
+	NSUInteger offset;
+	for (offset = 0; offset < [data length]; offset += 7) {
+		NSUInteger length = ([data length]-offset < 7 ? [data length]-offset : 7);
+		[request parseHTMLBytes:(const char *)[data bytes]+offset length:length];
+	}
+
+	NSArray *expectedURLs = [NSArray arrayWithObjects:@"style.css",@"bg.png",nil];
+	BOOL success = [[request pendingResourceURLs] isEqualToArray:expectedURLs];
+	GHAssertTrue(success,@"Failed to find resources in the head before the rest of the page arrived");
+
+	data = [body dataUsingEncoding:NSUTF8StringEncoding];
+	[request parseHTMLBytes:[data bytes] length:[data length]];
+
+	expectedURLs = [NSArray arrayWithObjects:@"style.css",@"bg.png",@"a.png",@"b.png",@"poster.jpg",@"movie.mp4",nil];
+	success = [[request pendingResourceURLs] isEqualToArray:expectedURLs];
+	GHAssertTrue(success,@"Failed to find the expected resources");
+
+	// Urls from stylesheets are left for fetchExternalResources: to guess from their extension
+	NSArray *expectedTypes = [NSArray arrayWithObjects:[NSNumber numberWithInt:ASIStylesheetWebResourceType],[NSNumber numberWithInt:ASIUnknownWebResourceType],[NSNumber numberWithInt:ASIImageWebResourceType],[NSNumber numberWithInt:ASIUnknownWebResourceType],[NSNumber numberWithInt:ASIImageWebResourceType],[NSNumber numberWithInt:ASIMediaWebResourceType],nil];
+	success = [[request pendingResourceTypes] isEqualToArray:expectedTypes];
+	GHAssertTrue(success,@"Failed to record the type of each resource");
+
+	[request discardParserContext];
+}
+
+- (void)testCSSTokenizer
+{
+	NSString *css = @"@import \"reset.css\";\n"
+		@"@IMPORT url( 'print.css' ) print;\n"
+		@"/* body { background: url(commented-out.png); } */\n"
+		@"h1:before { content: \"url(not-a-url.png)\"; }\n"
+		@".myurl(x) {}\n"
+		@".a { background: URL(a.png); }\n"
+		@".b { background: url(\"b\\\"quoted.png\"); }\n"
+		@".c { background: url(c\\ space.png); }\n"
+		@".d { background: url(\\64 .png); }\n"
+		@".e { background: url(\n\te.png\n); }\n"
+		@".f { background: url(f.png";
+	NSArray *expectedURLs = [NSArray arrayWithObjects:@"reset.css",@"print.css",@"a.png",@"b\"quoted.png",@"c space.png",@"d.png",@"e.png",@"f.png",nil];
+
+	NSArray *urls = [ASICSSTokenizer URLsInData:[css dataUsingEncoding:NSUTF8StringEncoding]];
+	BOOL success = [urls isEqualToArray:expectedURLs];
+	GHAssertTrue(success,@"Failed to find the expected urls in the stylesheet");
+
+	// Now feed it one byte at a time, so every url, comment and escape is split across chunks
+	NSData *data = [css dataUsingEncoding:NSUTF8StringEncoding];
+	ASICSSTokenizer *tokenizer = [[[ASICSSTokenizer alloc] init] autorelease];
+	NSMutableArray *foundURLs = [NSMutableArray array];
+	NSUInteger i;
+	for (i=0; i<[data length]; i++) {
+		[tokenizer tokenizeBytes:(const unsigned char *)[data bytes]+i length:1];
+		[foundURLs addObjectsFromArray:[tokenizer takeURLs]];
+	}
+	[tokenizer finish];
+	[foundURLs addObjectsFromArray:[tokenizer takeURLs]];
+	success = [foundURLs isEqualToArray:expectedURLs];
+	GHAssertTrue(success,@"Failed to find the expected urls when reading the stylesheet in chunks");
+}
+
+- (void)testResourcePriorities
+{
+	GHAssertTrue([ASIWebPageRequest resourceTypeForURL:@"css/site.css?v=2"] == ASIStylesheetWebResourceType,@"Failed to recognise a stylesheet");
+	GHAssertTrue([ASIWebPageRequest resourceTypeForURL:@"fonts/Face.WOFF2#iefix"] == ASIFontWebResourceType,@"Failed to recognise a font");
+	GHAssertTrue([ASIWebPageRequest resourceTypeForURL:@"http://allseeing-i.com/i/logo.png"] == ASIImageWebResourceType,@"Failed to recognise an image");
+	GHAssertTrue([ASIWebPageRequest resourceTypeForURL:@"movie.mp4"] == ASIMediaWebResourceType,@"Failed to recognise a video");
+	GHAssertTrue([ASIWebPageRequest resourceTypeForURL:@"image.php?id=4"] == ASIUnknownWebResourceType,@"Guessed a type for a url with an unknown extension");
+
+	// Stylesheets should always come first, and audio and video last
+	NSOperationQueuePriority stylesheet = [ASIWebPageRequest queuePriorityForResourceType:ASIStylesheetWebResourceType];
+	NSOperationQueuePriority font = [ASIWebPageRequest queuePriorityForResourceType:ASIFontWebResourceType];
+	NSOperationQueuePriority image = [ASIWebPageRequest queuePriorityForResourceType:ASIImageWebResourceType];
+	NSOperationQueuePriority media = [ASIWebPageRequest queuePriorityForResourceType:ASIMediaWebResourceType];
+	BOOL success = (stylesheet > font && font > image && image > media);
+	GHAssertTrue(success,@"Resources would be fetched in the wrong order");
+}
+
+- (void)testStreamingDataURIs
+{
+	NSString *resourcePath = [[self filePathForTemporaryTestFiles] stringByAppendingPathComponent:@"data-uri-resource.png"];
+	NSString *pagePath = [[self filePathForTemporaryTestFiles] stringByAppendingPathComponent:@"data-uri-page.html"];
+
+	// Make the resource big enough to be encoded in several chunks, and not a multiple of 3 bytes long
+	NSMutableData *resourceData = [NSMutableData dataWithLength:150001];
+	unsigned char *bytes = [resourceData mutableBytes];
+	NSUInteger i;
+	for (i=0; i<[resourceData length]; i++) {
+		bytes[i] = (unsigned char)(i*31);
+	}
+	[resourceData writeToFile:resourcePath atomically:NO];
+
+	ASIWebPageRequest *request = [ASIWebPageRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/ASIHTTPRequest/tests/asiwebpagerequest/data-uri"]];
+	[request setUrlReplacementMode:ASIReplaceExternalResourcesWithData];
+	[request setDownloadDestinationPath:pagePath];
+	[request setResourceList:[NSMutableDictionary dictionaryWithObject:[NSMutableDictionary dictionaryWithObjectsAndKeys:@"image/png",@"ContentType",resourcePath,@"DataPath",nil] forKey:@"image.png"]];
+
+	NSString *placeholder = [request replacementForExternalURL:@"image.png"];
+	GHAssertNotNil(placeholder,@"Failed to get a placeholder for the resource");
+	NSString *page = [NSString stringWithFormat:@"<img src=\"%@\"><img src=\"%@\">",placeholder,placeholder];
+	[page writeToFile:pagePath atomically:NO encoding:NSUTF8StringEncoding error:NULL];
+
+	BOOL success = [request replaceDataURIPlaceholders];
+	GHAssertTrue(success,@"Failed to write data uris into the page");
+
+	NSString *dataURI = [@"data:image/png;base64," stringByAppendingString:[ASIHTTPRequest base64forData:resourceData]];
+	NSString *expectedPage = [NSString stringWithFormat:@"<img src=\"%@\"><img src=\"%@\">",dataURI,dataURI];
+	success = [[NSString stringWithContentsOfFile:pagePath encoding:NSUTF8StringEncoding error:NULL] isEqualToString:expectedPage];
+	GHAssertTrue(success,@"Page contained the wrong data uris");
+}
+
+- (void)testWebArchive
+{
+	NSString *archivePath = [[self filePathForTemporaryTestFiles] stringByAppendingPathComponent:@"test.warc"];
+	NSString *bodyPath = [[self filePathForTemporaryTestFiles] stringByAppendingPathComponent:@"web-archive-body.png"];
+	NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+	[fileManager removeItemAtPath:archivePath error:NULL];
+	[fileManager removeItemAtPath:[archivePath stringByAppendingString:@".idx"] error:NULL];
+
+	NSData *page = [@"<html><body><img src=\"logo.png\"></body></html>" dataUsingEncoding:NSUTF8StringEncoding];
+	ASIHTTPRequest *pageRequest = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/archived/page.html"]];
+	[pageRequest setResponseHeaders:[NSDictionary dictionaryWithObjectsAndKeys:@"text/html; charset=utf-8",@"Content-Type",@"12",@"Content-Length",nil]];
+	[pageRequest setRawResponseData:[NSMutableData dataWithData:page]];
+
+	NSMutableData *logo = [NSMutableData dataWithLength:100000];
+	unsigned char *bytes = [logo mutableBytes];
+	NSUInteger i;
+	for (i=0; i<[logo length]; i++) {
+		bytes[i] = (unsigned char)(i*7);
+	}
+	[logo writeToFile:bodyPath atomically:NO];
+	ASIHTTPRequest *logoRequest = [ASIHTTPRequest requestWithURL:[NSURL URLWithString:@"http://allseeing-i.com/archived/logo.png"]];
+	[logoRequest setResponseHeaders:[NSDictionary dictionaryWithObject:@"image/png" forKey:@"Content-Type"]];
+	[logoRequest setDownloadDestinationPath:bodyPath];
+	[logoRequest setOriginalURL:[NSURL URLWithString:@"http://allseeing-i.com/archived/old-logo.png"]];
+
+	ASIWebArchive *archive = [ASIWebArchive archiveWithPath:archivePath];
+	NSError *err = nil;
+	BOOL success = [archive addResponseForRequest:pageRequest error:&err] && [archive addResponseForRequest:logoRequest error:&err];
+	GHAssertTrue(success,@"Failed to add responses to the archive: %@",err);
+
+	// Open the archive again, so we're reading from the index on disk
+	archive = [ASIWebArchive archiveWithPath:archivePath];
+	GHAssertTrue([[archive archivedURLs] count] == 3,@"Archive has the wrong number of responses");
+
+	success = [[archive responseDataForURL:[NSURL URLWithString:@"http://allseeing-i.com/archived/logo.png"]] isEqualToData:logo];
+	GHAssertTrue(success,@"Failed to read back a response stored from a file");
+	success = [[archive responseDataForURL:[NSURL URLWithString:@"http://allseeing-i.com/archived/old-logo.png"]] isEqualToData:logo];
+	GHAssertTrue(success,@"Failed to read back a redirected response using the url originally requested");
+	success = [[archive responseDataForURL:[NSURL URLWithString:@"http://allseeing-i.com/archived/page.html"]] isEqualToData:page];
+	GHAssertTrue(success,@"Failed to read back a response stored from memory");
+	success = [[archive contentTypeForURL:[NSURL URLWithString:@"http://allseeing-i.com/archived/page.html"]] isEqualToString:@"text/html; charset=utf-8"];
+	GHAssertTrue(success,@"Archive has the wrong content type");
+	GHAssertFalse([archive containsResponseForURL:[NSURL URLWithString:@"http://allseeing-i.com/archived/missing.png"]],@"Archive claims to contain a response we never added");
+
+	// The archived headers should describe the body as it was stored
+	NSString *archiveHead = [[[NSString alloc] initWithData:[[NSData dataWithContentsOfFile:archivePath] subdataWithRange:NSMakeRange(0,512)] encoding:NSISOLatin1StringEncoding] autorelease];
+	success = ([archiveHead hasPrefix:@"WARC/1.0\r\n"] && [archiveHead rangeOfString:[NSString stringWithFormat:@"Content-Length: %lu\r\n",(unsigned long)[page length]]].location != NSNotFound && [archiveHead rangeOfString:@"Content-Length: 12\r\n"].location == NSNotFound);
+	GHAssertTrue(success,@"Archive doesn't start with a valid WARC record");
+}
+
 - (void)requestFinished:(ASIHTTPRequest *)request
 {
 	if ([[request userInfo] objectForKey:@"expected-response"]) {
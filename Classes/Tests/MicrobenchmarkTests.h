@@ -0,0 +1,62 @@
+//
+//  MicrobenchmarkTests.h
+//  Part of ASIHTTPRequest -> http://allseeing-i.com/ASIHTTPRequest
+//
+//  Created by agent on 18/10/2026.
+//  Copyright 2026 agent. All rights reserved.
+//
+//  Microbenchmarks for the CPU-heavy primitives used internally by ASIHTTPRequest and its subclasses
+//  Unlike PerformanceTests, these never touch the network - each benchmark runs against a fixed corpus generated in setUp
+//  Results are written to the console in ns/op and MB/s - compare them before and after a change to spot regressions
+
+#import <Foundation/Foundation.h>
+#import "ASITestCase.h"
+
+@class ASIHTTPRequest;
+@class ASIRequestTemplate;
+
+@interface MicrobenchmarkTests : ASITestCase {
+
+	// Around 256KB of english-like text, always generated the same way
+	NSData *textCorpus;
+
+	// textCorpus after deflating, used for the inflate benchmarks
+	NSData *compressedTextCorpus;
+
+	// A stylesheet with plenty of url() references, @import rules, comments and escapes, used for the CSS parsing benchmarks
+	NSString *cssCorpus;
+	NSData *cssCorpusData;
+
+	// A web page with plenty of stylesheets, scripts and images, used for the HTML parsing benchmark
+	NSData *htmlCorpus;
+
+	// Sample inputs for the benchmarks that operate on short strings
+	NSArray *dateStrings;
+	NSArray *contentTypes;
+	NSArray *cacheURLs;
+	NSArray *stringsToSign;
+
+	// Used by the request construction benchmark
+	ASIHTTPRequest *prototypeRequest;
+	ASIRequestTemplate *requestTemplate;
+
+	// Used by the cancellation benchmarks
+	CFAbsoluteTime cancelTime;
+	NSMutableArray *cancelLatencies;
+}
+
+// Runs selector (which should perform 'operations' operations on 'bytes' bytes of input) a few times to warm up,
+// then times a number of runs and logs the results
+// Subclasses or other benchmarks can use this to get output in the same format
+- (void)benchmark:(NSString *)name selector:(SEL)selector operations:(NSUInteger)operations bytes:(unsigned long long)bytes;
+
+@property (retain, nonatomic) NSData *textCorpus;
+@property (retain, nonatomic) NSData *compressedTextCorpus;
+@property (retain, nonatomic) NSString *cssCorpus;
+@property (retain, nonatomic) NSData *cssCorpusData;
+@property (retain, nonatomic) NSData *htmlCorpus;
+@property (retain, nonatomic) NSArray *dateStrings;
+@property (retain, nonatomic) NSArray *contentTypes;
+@property (retain, nonatomic) NSArray *cacheURLs;
+@property (retain, nonatomic) NSArray *stringsToSign;
+@end